@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <span>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vtils/os/io_uring.hpp>
+#include <vtils/os/memory_mapped.hpp>
+
+namespace {
+
+    constexpr std::size_t BlockSize = 4096;
+
+    // The number of random blocks read per iteration.
+    constexpr std::size_t Reads = 4096;
+
+    // The size of the temporary file used when no file is given. The page
+    // cache is dropped before every iteration, so that reads go to storage
+    // as they would for a file bigger than RAM.
+    constexpr std::size_t DefaultFileSize = std::size_t(1) << 30;
+
+    // A coroutine which starts right away and cleans up after itself.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    // The file to read from. Set `VTILS_BENCH_FILE` to use an existing
+    // file, ideally one bigger than RAM, instead of a temporary one.
+    std::FILE *GetFile() {
+        static std::FILE *file = [] {
+            if (const char *path = std::getenv("VTILS_BENCH_FILE")) {
+                return std::fopen(path, "rb");
+            }
+
+            std::FILE *file = std::tmpfile();
+            std::vector<std::uint8_t> chunk(1 << 20);
+            for (std::size_t offset = 0; offset < DefaultFileSize; offset += chunk.size()) {
+                std::memset(chunk.data(), static_cast<int>(offset >> 20), chunk.size());
+                std::fwrite(chunk.data(), 1, chunk.size(), file);
+            }
+            std::fflush(file);
+            fsync(fileno(file));
+            return file;
+        }();
+
+        return file;
+    }
+
+    void DropCache(std::FILE *file) {
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    // Random block-aligned offsets within a file of `size` bytes, the same
+    // on every call.
+    std::vector<std::uint64_t> MakeOffsets(std::uint64_t size) {
+        std::vector<std::uint64_t> offsets(Reads);
+
+        std::uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (std::uint64_t &offset : offsets) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            offset = state % (size / BlockSize) * BlockSize;
+        }
+
+        return offsets;
+    }
+
+    std::uint64_t GetFileSize(std::FILE *file) {
+        std::fseek(file, 0, SEEK_END);
+        return static_cast<std::uint64_t>(std::ftell(file));
+    }
+
+    // Copies every block out of the mapping, faulting it in on first touch.
+    void BM_MappedRandomRead(benchmark::State &state) {
+        std::FILE *file = GetFile();
+        if (file == nullptr) {
+            state.SkipWithError("failed to open VTILS_BENCH_FILE");
+            return;
+        }
+        const auto offsets = MakeOffsets(GetFileSize(file));
+
+        alignas(BlockSize) std::array<std::uint8_t, BlockSize> buffer;
+        for (auto _ : state) {
+            // Pages which are still mapped cannot be evicted, so every
+            // iteration starts out with a new mapping.
+            state.PauseTiming();
+            DropCache(file);
+            const auto mapped = vtils::ReadOnlyMapped::Map(file, vtils::Access::Random);
+            const auto *data = static_cast<const std::uint8_t *>(mapped.GetPtr());
+            state.ResumeTiming();
+
+            for (const std::uint64_t offset : offsets) {
+                std::memcpy(buffer.data(), data + offset, BlockSize);
+                benchmark::DoNotOptimize(buffer.data());
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * Reads);
+        state.SetBytesProcessed(state.iterations() * Reads * BlockSize);
+    }
+
+    // Reads every block through the ring, with as many coroutines as the
+    // argument says keeping one read in flight each.
+    void BM_IoUringRandomRead(benchmark::State &state) {
+        const std::size_t depth = static_cast<std::size_t>(state.range(0));
+
+        std::FILE *file = GetFile();
+        if (file == nullptr) {
+            state.SkipWithError("failed to open VTILS_BENCH_FILE");
+            return;
+        }
+        const auto offsets = MakeOffsets(GetFileSize(file));
+        const int fd = fileno(file);
+
+        vtils::IoUring ring(static_cast<unsigned>(depth));
+        std::vector<std::array<std::byte, BlockSize>> buffers(depth);
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            DropCache(file);
+            state.ResumeTiming();
+
+            // Each reader takes the next offset once its read completed.
+            std::size_t next = 0;
+            for (auto &buffer : buffers) {
+                [](vtils::IoUring &ring, int fd, std::span<std::byte> buffer,
+                   const std::vector<std::uint64_t> &offsets, std::size_t &next) -> Detached {
+                    while (next < offsets.size()) {
+                        const std::int32_t res = co_await ring.Read(fd, buffer, offsets[next++]);
+                        benchmark::DoNotOptimize(res);
+                    }
+                }(ring, fd, buffer, offsets, next);
+            }
+
+            while (ring.GetInFlightCount() != 0) {
+                ring.Wait();
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * Reads);
+        state.SetBytesProcessed(state.iterations() * Reads * BlockSize);
+    }
+
+}
+
+BENCHMARK(BM_MappedRandomRead)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_IoUringRandomRead)->RangeMultiplier(4)->Range(1, 64)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vtils/os/memory_mapped.hpp>
+
+namespace {
+
+    // Large enough that readahead matters, but small enough to be cached
+    // in full, so that the footprint after a scan is not capped by memory.
+    constexpr std::size_t FileSize = 512 << 20;
+
+    // How much is scanned before dropping the pages behind the scan.
+    constexpr std::size_t Window = 16 << 20;
+
+    const std::size_t PageSize = static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE));
+
+    // A temporary file which is shared by all benchmarks. Its contents are
+    // flushed to disk, so that the page cache can drop them at any time.
+    std::FILE *GetFile() {
+        static std::FILE *file = [] {
+            std::FILE *file = std::tmpfile();
+            std::vector<std::uint8_t> chunk(1 << 20);
+            for (std::size_t offset = 0; offset < FileSize; offset += chunk.size()) {
+                std::memset(chunk.data(), static_cast<int>(offset >> 20), chunk.size());
+                std::fwrite(chunk.data(), 1, chunk.size(), file);
+            }
+            std::fflush(file);
+            fsync(fileno(file));
+            return file;
+        }();
+
+        return file;
+    }
+
+    // Evicts the file from the page cache, so that every scan starts cold.
+    void DropCache(std::FILE *file) {
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    // Gets how much of the mapped file is held in the page cache.
+    std::size_t GetCachedBytes(const void *ptr, std::size_t len) {
+        std::vector<unsigned char> pages((len + PageSize - 1) / PageSize);
+        if (mincore(const_cast<void *>(ptr), len, pages.data()) != 0) {
+            return 0;
+        }
+
+        std::size_t cached = 0;
+        for (const unsigned char page : pages) {
+            cached += page & 1;
+        }
+        return cached * PageSize;
+    }
+
+    // Gets how much of the process' resident memory is backed by files,
+    // i.e. which pages of file mappings it currently has mapped in.
+    std::size_t GetResidentFileBytes() {
+        std::ifstream status("/proc/self/status");
+        for (std::string line; std::getline(status, line);) {
+            if (line.starts_with("RssFile:")) {
+                return std::stoull(line.substr(8)) << 10;
+            }
+        }
+        return 0;
+    }
+
+    std::uint64_t Sum(const std::uint8_t *data, std::size_t len) {
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < len; i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            sum += word;
+        }
+        return sum;
+    }
+
+    // Scans the whole file front to back with `Hint` applied at map time.
+    // With a `Drop` hint other than `Normal`, every window of the file is
+    // advised with it right after it was scanned.
+    //
+    // Afterwards, `cached_MiB` is how much of the file stays in the page
+    // cache, and `resident_MiB` how much of it is still mapped in.
+    template <vtils::Access Hint, vtils::Access Drop>
+    void BM_SequentialScan(benchmark::State &state) {
+        std::FILE *file = GetFile();
+
+        std::size_t cached = 0, resident = 0;
+        for (auto _ : state) {
+            state.PauseTiming();
+            DropCache(file);
+            const std::size_t baseline = GetResidentFileBytes();
+            state.ResumeTiming();
+
+            auto mapped = vtils::ReadOnlyMapped::Map(file, Hint);
+            const auto *data = static_cast<const std::uint8_t *>(std::as_const(mapped).GetPtr());
+
+            for (std::size_t offset = 0; offset < mapped.GetLength(); offset += Window) {
+                benchmark::DoNotOptimize(Sum(data + offset, Window));
+                if constexpr (Drop != vtils::Access::Normal) {
+                    mapped.Advise(offset, Window, Drop);
+                }
+            }
+
+            state.PauseTiming();
+            cached   = GetCachedBytes(data, mapped.GetLength());
+            resident = std::max(GetResidentFileBytes(), baseline) - baseline;
+            state.ResumeTiming();
+        }
+
+        state.SetBytesProcessed(state.iterations() * FileSize);
+        state.counters["cached_MiB"]   = static_cast<double>(cached >> 20);
+        state.counters["resident_MiB"] = static_cast<double>(resident >> 20);
+    }
+
+}
+
+#define V_SCAN_BENCHMARK(hint, drop)                                                    \
+    BENCHMARK_TEMPLATE(BM_SequentialScan, vtils::Access::hint, vtils::Access::drop)     \
+        ->Unit(benchmark::kMillisecond)->UseRealTime()
+
+V_SCAN_BENCHMARK(Normal, Normal);
+V_SCAN_BENCHMARK(Sequential, Normal);
+V_SCAN_BENCHMARK(Sequential, DontNeed);
+V_SCAN_BENCHMARK(Sequential, Free);
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vtils/os/mpmc_queue.hpp>
+
+namespace {
+
+    constexpr std::size_t Capacity = 1024;
+
+    // One element in and out again through `TryPush` and `TryPop`, so that
+    // the queue never runs empty or full and nobody ever waits. This is the
+    // cost of the non-blocking path, including the check for sleepers.
+    void BM_TryPushTryPop(benchmark::State &state) {
+        static vtils::MpmcQueue<std::uint64_t> queue(Capacity);
+
+        std::uint64_t value = static_cast<std::uint64_t>(state.thread_index());
+        for (auto _ : state) {
+            while (!queue.TryPush(value)) {}
+            while (!queue.TryPop(value)) {}
+            benchmark::DoNotOptimize(value);
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // The same through the blocking `Push` and `Pop`, which only differ
+    // from the above once they have to wait.
+    void BM_PushPop(benchmark::State &state) {
+        static vtils::MpmcQueue<std::uint64_t> queue(Capacity);
+
+        std::uint64_t value = static_cast<std::uint64_t>(state.thread_index());
+        for (auto _ : state) {
+            queue.Push(value);
+            value = queue.Pop();
+            benchmark::DoNotOptimize(value);
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+}
+
+BENCHMARK(BM_TryPushTryPop)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PushPop)->ThreadRange(1, 8)->UseRealTime();
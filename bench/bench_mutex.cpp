@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <vtils/impl/cpu_relax.hpp>
+#include <vtils/os/mutex.hpp>
+
+namespace {
+
+    // Burns `iterations` spin-wait hints, standing in for the work done
+    // inside and outside of critical sections.
+    void Spin(std::int64_t iterations) {
+        for (std::int64_t i = 0; i < iterations; ++i) {
+            vtils::impl::CpuRelax();
+        }
+    }
+
+    // Spins for a fixed number of rounds before parking, like
+    // `impl::AdaptiveMutex` without the self-tuning. Sweeping the budget
+    // shows up to which point spinning still pays off.
+    template <std::int32_t Budget>
+    class FixedSpinMutex final {
+    private:
+        vtils::impl::Mutex m_mutex;
+
+    public:
+        constexpr FixedSpinMutex() = default;
+
+        void Lock() {
+            if (m_mutex.TryLock()) {
+                return;
+            }
+
+            for (std::int32_t i = 0; i < Budget; ++i) {
+                vtils::impl::CpuRelax();
+                if (!m_mutex.IsLocked() && m_mutex.TryLock()) {
+                    return;
+                }
+            }
+
+            m_mutex.Lock();
+        }
+
+        bool TryLock() {
+            return m_mutex.TryLock();
+        }
+
+        void Unlock() {
+            m_mutex.Unlock();
+        }
+    };
+
+    // All threads hammer the same lock. The argument is the length of the
+    // critical section, and as much work is done outside of it, so that
+    // other threads get the chance to take the lock in between.
+    template <class RawMutex>
+    void BM_Contended(benchmark::State &state) {
+        static vtils::Mutex<std::uint64_t, RawMutex> mutex;
+        const std::int64_t critical = state.range(0);
+
+        for (auto _ : state) {
+            {
+                auto guard = mutex.Lock();
+                Spin(critical);
+                ++*guard;
+            }
+            Spin(critical);
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+}
+
+// The plain mutex parks right away and is the baseline for spinning. The
+// crossover is the critical section length at which the spinning locks
+// stop beating it.
+#define V_MUTEX_BENCHMARK(...)                           \
+    BENCHMARK_TEMPLATE(BM_Contended, __VA_ARGS__)        \
+        ->RangeMultiplier(4)->Range(1, 4096)             \
+        ->ThreadRange(1, 16)->UseRealTime()
+
+V_MUTEX_BENCHMARK(vtils::impl::Mutex);
+V_MUTEX_BENCHMARK(vtils::impl::AdaptiveMutex);
+V_MUTEX_BENCHMARK(FixedSpinMutex<10>);
+V_MUTEX_BENCHMARK(FixedSpinMutex<100>);
+V_MUTEX_BENCHMARK(FixedSpinMutex<1000>);
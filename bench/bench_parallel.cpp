@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include <vtils/os/thread_pool.hpp>
+#include <vtils/parallel.hpp>
+
+namespace {
+
+    using Element = std::uint32_t;
+
+    vtils::ThreadPool &GetPool() {
+        static vtils::ThreadPool pool;
+        return pool;
+    }
+
+    // Random elements filling `bytes` of memory, the same on every call.
+    std::vector<Element> MakeInput(std::size_t bytes) {
+        std::vector<Element> input(bytes / sizeof(Element));
+
+        // splitmix64, fast enough to fill a gigabyte without dominating
+        // the setup time.
+        std::uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (Element &value : input) {
+            std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = static_cast<Element>(z ^ (z >> 31));
+        }
+
+        return input;
+    }
+
+    // A lambda rather than a function, so that the call can be inlined
+    // after passing it through the pool's type-erased jobs.
+    constexpr auto Transform = [](Element value) -> Element {
+        return value * 3 + 1;
+    };
+
+    void BM_SerialFor(benchmark::State &state) {
+        auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state) {
+            std::ranges::for_each(input, [](Element &value) { value = Transform(value); });
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_ParallelFor(benchmark::State &state) {
+        auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state) {
+            vtils::ParallelFor(GetPool(), input, [](Element &value) { value = Transform(value); });
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_SerialReduce(benchmark::State &state) {
+        const auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(std::accumulate(input.begin(), input.end(), std::uint64_t(0)));
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_ParallelReduce(benchmark::State &state) {
+        const auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(vtils::ParallelReduce(GetPool(), input, std::uint64_t(0)));
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_SerialTransform(benchmark::State &state) {
+        const auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        std::vector<Element> output(input.size());
+        for (auto _ : state) {
+            std::ranges::transform(input, output.begin(), Transform);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_ParallelTransform(benchmark::State &state) {
+        const auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        std::vector<Element> output(input.size());
+        for (auto _ : state) {
+            vtils::ParallelTransform(GetPool(), input, output.begin(), Transform);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    // Sorting is destructive, so every iteration starts over from a copy
+    // of the input, which is left out of the measurement.
+    void BM_SerialSort(benchmark::State &state) {
+        const auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        std::vector<Element> data(input.size());
+        for (auto _ : state) {
+            state.PauseTiming();
+            std::ranges::copy(input, data.begin());
+            state.ResumeTiming();
+
+            std::ranges::sort(data);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_ParallelSort(benchmark::State &state) {
+        const auto input = MakeInput(static_cast<std::size_t>(state.range(0)));
+        std::vector<Element> data(input.size());
+        for (auto _ : state) {
+            state.PauseTiming();
+            std::ranges::copy(input, data.begin());
+            state.ResumeTiming();
+
+            vtils::ParallelSort(GetPool(), data);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+}
+
+// Inputs from just above the minimum grain of 16 KiB up to 1 GiB, so that
+// both the lower bound and the chunks-per-thread target of the grain size
+// are covered.
+#define V_PARALLEL_BENCHMARK(name)                                       \
+    BENCHMARK(name)                                                      \
+        ->RangeMultiplier(16)->Range(64 << 10, 1 << 30)                  \
+        ->Unit(benchmark::kMillisecond)->UseRealTime()
+
+V_PARALLEL_BENCHMARK(BM_SerialFor);
+V_PARALLEL_BENCHMARK(BM_ParallelFor);
+V_PARALLEL_BENCHMARK(BM_SerialReduce);
+V_PARALLEL_BENCHMARK(BM_ParallelReduce);
+V_PARALLEL_BENCHMARK(BM_SerialTransform);
+V_PARALLEL_BENCHMARK(BM_ParallelTransform);
+V_PARALLEL_BENCHMARK(BM_SerialSort);
+V_PARALLEL_BENCHMARK(BM_ParallelSort);
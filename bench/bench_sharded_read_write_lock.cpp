@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include <vtils/os/read_write_lock.hpp>
+#include <vtils/os/sharded_read_write_lock.hpp>
+
+namespace {
+
+    // A small lookup table, standing in for read-mostly shared state such
+    // as routing tables.
+    struct Table {
+        std::array<std::uint64_t, 64> entries{};
+    };
+
+    // Every thread looks up entries in the same table. The argument is the
+    // number of writes per million operations, so that zero measures pure
+    // read scaling and the others how much occasional writers cost.
+    template <class Lock>
+    void BM_ReadMostly(benchmark::State &state) {
+        static Lock table;
+        const std::uint64_t writes = static_cast<std::uint64_t>(state.range(0));
+
+        // Spread the writes over the threads, so that their total does not
+        // depend on the thread count.
+        std::uint64_t counter = static_cast<std::uint64_t>(state.thread_index()) * 7919;
+        for (auto _ : state) {
+            counter += 1'000'003;
+            if (counter % 1'000'000 < writes) {
+                auto guard = table.Write();
+                ++guard->entries[counter % guard->entries.size()];
+            } else {
+                auto guard = table.Read();
+                benchmark::DoNotOptimize(guard->entries[counter % guard->entries.size()]);
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+}
+
+#define V_RWLOCK_BENCHMARK(...)                                              \
+    BENCHMARK_TEMPLATE(BM_ReadMostly, __VA_ARGS__)                           \
+        ->Arg(0)->Arg(100)                                                   \
+        ->ThreadRange(1, 2 * static_cast<int>(std::thread::hardware_concurrency())) \
+        ->UseRealTime()
+
+V_RWLOCK_BENCHMARK(vtils::ReadWriteLock<Table>);
+V_RWLOCK_BENCHMARK(vtils::ShardedReadWriteLock<Table>);
@@ -0,0 +1,191 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <vtils/impl/cpu_relax.hpp>
+#include <vtils/os/spsc_ring.hpp>
+
+namespace {
+
+    // The number of elements passed through the ring per iteration.
+    constexpr std::size_t Count = 1 << 20;
+
+    constexpr std::size_t Capacity = 4096;
+
+    // A small log record, as opposed to a single word.
+    struct Record {
+        std::array<std::uint64_t, 8> data;
+    };
+
+    // Spins briefly, then yields, so that the other side gets to run
+    // even when both share a core.
+    class Backoff {
+    private:
+        int m_spins = 0;
+
+    public:
+        void Wait() {
+            if (m_spins < 64) {
+                vtils::impl::CpuRelax();
+                ++m_spins;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        void Reset() {
+            m_spins = 0;
+        }
+    };
+
+    template <typename T>
+    T MakeElement(std::size_t i) {
+        T value{};
+        if constexpr (std::is_same_v<T, Record>) {
+            value.data[0] = i;
+        } else {
+            value = static_cast<T>(i);
+        }
+        return value;
+    }
+
+    // One element at a time through `TryPush` and `TryPop`.
+    template <typename T>
+    void BM_SingleThroughput(benchmark::State &state) {
+        vtils::SpscRing<T> ring(Capacity);
+
+        for (auto _ : state) {
+            std::thread producer([&] {
+                Backoff backoff;
+                for (std::size_t i = 0; i < Count; ++i) {
+                    const T value = MakeElement<T>(i);
+                    while (!ring.TryPush(value)) {
+                        backoff.Wait();
+                    }
+                    backoff.Reset();
+                }
+            });
+
+            Backoff backoff;
+            T value;
+            for (std::size_t i = 0; i < Count; ++i) {
+                while (!ring.TryPop(value)) {
+                    backoff.Wait();
+                }
+                backoff.Reset();
+                benchmark::DoNotOptimize(value);
+            }
+
+            producer.join();
+        }
+
+        state.SetItemsProcessed(state.iterations() * Count);
+        state.SetBytesProcessed(state.iterations() * Count * sizeof(T));
+    }
+
+    // Batches of the given size through `Write` and `Read`, which publish
+    // a whole batch with one release store.
+    template <typename T>
+    void BM_BatchThroughput(benchmark::State &state) {
+        const std::size_t batch = static_cast<std::size_t>(state.range(0));
+        vtils::SpscRing<T> ring(Capacity);
+
+        std::vector<T> in(batch), out(batch);
+        for (std::size_t i = 0; i < batch; ++i) {
+            in[i] = MakeElement<T>(i);
+        }
+
+        for (auto _ : state) {
+            std::thread producer([&] {
+                Backoff backoff;
+                for (std::size_t sent = 0; sent < Count;) {
+                    const std::size_t written = ring.Write(std::span(in).first(std::min(batch, Count - sent)));
+                    if (written == 0) {
+                        backoff.Wait();
+                        continue;
+                    }
+                    backoff.Reset();
+                    sent += written;
+                }
+            });
+
+            Backoff backoff;
+            for (std::size_t received = 0; received < Count;) {
+                const std::size_t read = ring.Read(out);
+                if (read == 0) {
+                    backoff.Wait();
+                    continue;
+                }
+                backoff.Reset();
+                benchmark::DoNotOptimize(out.data());
+                received += read;
+            }
+
+            producer.join();
+        }
+
+        state.SetItemsProcessed(state.iterations() * Count);
+        state.SetBytesProcessed(state.iterations() * Count * sizeof(T));
+    }
+
+    // Round trips of a single element through a pair of rings, to an echo
+    // thread and back. Each iteration is one round trip.
+    void BM_RoundTripLatency(benchmark::State &state) {
+        vtils::SpscRing<std::uint64_t> request(Capacity), response(Capacity);
+
+        // Zero tells the echo thread to stop.
+        std::thread echo([&] {
+            Backoff backoff;
+            std::uint64_t value;
+            while (true) {
+                while (!request.TryPop(value)) {
+                    backoff.Wait();
+                }
+                backoff.Reset();
+
+                if (value == 0) {
+                    break;
+                }
+                while (!response.TryPush(value)) {
+                    backoff.Wait();
+                }
+                backoff.Reset();
+            }
+        });
+
+        Backoff backoff;
+        std::uint64_t sequence = 0;
+        for (auto _ : state) {
+            while (!request.TryPush(++sequence)) {
+                backoff.Wait();
+            }
+            backoff.Reset();
+
+            std::uint64_t value;
+            while (!response.TryPop(value)) {
+                backoff.Wait();
+            }
+            backoff.Reset();
+            benchmark::DoNotOptimize(value);
+        }
+
+        while (!request.TryPush(0)) {
+            backoff.Wait();
+        }
+        echo.join();
+    }
+
+}
+
+BENCHMARK_TEMPLATE(BM_SingleThroughput, std::uint64_t)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SingleThroughput, Record)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_BatchThroughput, std::uint64_t)->RangeMultiplier(8)->Range(1, 512)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_BatchThroughput, Record)->RangeMultiplier(8)->Range(1, 512)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_RoundTripLatency)->UseRealTime();
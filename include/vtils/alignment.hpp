@@ -10,10 +10,23 @@
 #include <type_traits>
 
 #include "vtils/assert.hpp"
+#include "vtils/macros/arch.hpp"
 #include "vtils/macros/attr.hpp"
 
 namespace vtils {
 
+    /// The assumed size of a cache line on the target architecture.
+    ///
+    /// Objects written by different threads should be placed at least this
+    /// far apart to avoid false sharing. x86_64 prefetches adjacent lines in
+    /// pairs and several AArch64 cores use 128-byte lines, so both targets
+    /// use twice the common line size.
+    #if defined(V_ARCH_X64) || defined(V_ARCH_AARCH64)
+    constexpr inline std::size_t CacheLineSize = 128;
+    #else
+    constexpr inline std::size_t CacheLineSize = 64;
+    #endif
+
     namespace impl {
 
         // TODO: Move this elsewhere?
@@ -0,0 +1,46 @@
+/**
+ * @file cpu_relax.hpp
+ * @brief Portable spin-wait hints for busy loops.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include "vtils/macros/arch.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/macros/compiler.hpp"
+
+#if defined(V_COMPILER_MSVC)
+    #include <intrin.h>
+#endif
+
+#if defined(V_COMPILER_MSVC) && (defined(V_ARCH_X64) || defined(V_ARCH_X86))
+    #define V_CPU_RELAX_IMPL() _mm_pause()
+#elif defined(V_COMPILER_MSVC) && (defined(V_ARCH_AARCH64) || defined(V_ARCH_ARM))
+    #define V_CPU_RELAX_IMPL() __yield()
+#elif defined(V_ARCH_X64) || defined(V_ARCH_X86)
+    // `pause` de-pipelines the spin loop and avoids the memory order
+    // violation penalty when the awaited cache line finally changes.
+    #define V_CPU_RELAX_IMPL() __asm__ __volatile__("pause" ::: "memory")
+#elif defined(V_ARCH_AARCH64) || defined(V_ARCH_ARM)
+    #define V_CPU_RELAX_IMPL() __asm__ __volatile__("yield" ::: "memory")
+#elif defined(V_ARCH_RISCV)
+    // Zihintpause `pause`, encoded manually so that older assemblers
+    // accept it. It executes as a no-op fence on cores without it.
+    #define V_CPU_RELAX_IMPL() __asm__ __volatile__(".4byte 0x0100000f" ::: "memory")
+#else
+    #define V_CPU_RELAX_IMPL() __asm__ __volatile__("" ::: "memory")
+#endif
+
+namespace vtils::impl {
+
+    /// Signals the processor that the caller is executing a spin-wait loop.
+    ///
+    /// This reduces power consumption and frees execution resources for
+    /// sibling hardware threads while waiting on another core.
+    ALWAYS_INLINE void CpuRelax() {
+        V_CPU_RELAX_IMPL();
+    }
+
+}
+
+#undef V_CPU_RELAX_IMPL
@@ -0,0 +1,43 @@
+/**
+ * @file function_ref.hpp
+ * @brief Non-owning references to callable objects.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    template <typename Sig>
+    class FunctionRef;
+
+    /// A non-owning, type-erased reference to a callable object.
+    ///
+    /// This allows passing arbitrary callables across translation unit
+    /// boundaries without allocating. The referenced callable must outlive
+    /// the FunctionRef, so it is primarily meant for function parameters.
+    template <typename R, typename... Args>
+    class FunctionRef<R(Args...)> final {
+    private:
+        void *m_obj;
+        R (*m_fn)(void *, Args...);
+
+    public:
+        template <class Fn> requires (!std::is_same_v<std::remove_cvref_t<Fn>, FunctionRef> && std::is_invocable_r_v<R, Fn&, Args...>)
+        ALWAYS_INLINE FunctionRef(Fn &&fn)
+            : m_obj(const_cast<void *>(static_cast<const void *>(std::addressof(fn)))),
+              m_fn([](void *obj, Args... args) -> R {
+                  return (*static_cast<std::remove_reference_t<Fn> *>(obj))(std::forward<Args>(args)...);
+              }) {}
+
+        ALWAYS_INLINE R operator()(Args... args) const {
+            return m_fn(m_obj, std::forward<Args>(args)...);
+        }
+    };
+
+}
@@ -27,7 +27,11 @@
 
 /// Indicates that a function should never be inlined.
 #ifndef NOINLINE
-    #define NOINLINE [[noreturn]]
+    #ifdef V_COMPILER_MSVC
+        #define NOINLINE [[msvc::noinline]]
+    #else
+        #define NOINLINE [[gnu::noinline]]
+    #endif
 #endif
 
 /// Hints to the compiler that this function is unlikely to be executed.
@@ -85,3 +89,12 @@
 #ifndef NODISCARD
     #define NODISCARD [[nodiscard]]
 #endif
+
+/// Allows an empty data member to share its address with other members.
+#ifndef NO_UNIQUE_ADDRESS
+    #ifdef V_COMPILER_MSVC
+        #define NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+    #else
+        #define NO_UNIQUE_ADDRESS [[no_unique_address]]
+    #endif
+#endif
@@ -0,0 +1,256 @@
+/**
+ * @file async_mutex.hpp
+ * @brief Mutual exclusion for coroutines which suspends instead of blocking.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/async_waiter.hpp"
+
+namespace vtils {
+
+    namespace impl {
+
+        // A lock-free mutex whose waiters are suspended coroutines.
+        //
+        // The state word is either `Unlocked`, `LockedNoWaiters`, or points to
+        // a stack of waiters which arrived while the lock was held. The holder
+        // moves that stack into a private FIFO queue on unlock and hands the
+        // lock over to the oldest waiter, so that no waiter is ever passed over.
+        class AsyncMutex final {
+        private:
+            static constexpr std::uintptr_t LockedNoWaiters = 0;
+            static constexpr std::uintptr_t Unlocked        = 1;
+
+        private:
+            std::atomic<std::uintptr_t> m_state;
+            // Waiters in FIFO order. Only accessed while holding the lock.
+            AsyncWaiterQueue m_waiters;
+
+        private:
+            COLD void UnlockSlow() {
+                if (m_waiters.IsEmpty()) {
+                    // New waiters pushed themselves in LIFO order, so reverse them.
+                    auto *waiter = reinterpret_cast<AsyncWaiter *>(m_state.exchange(LockedNoWaiters, std::memory_order_acquire));
+                    m_waiters.tail = waiter;
+
+                    AsyncWaiter *prev = nullptr;
+                    while (waiter != nullptr) {
+                        AsyncWaiter *next = waiter->next;
+                        waiter->next = prev;
+                        prev   = waiter;
+                        waiter = next;
+                    }
+                    m_waiters.head = prev;
+                }
+
+                // The lock stays held and now belongs to the resumed coroutine.
+                m_waiters.Pop()->Resume();
+            }
+
+        public:
+            constexpr AsyncMutex() : m_state(Unlocked), m_waiters() {}
+            constexpr ~AsyncMutex() = default;
+
+            AsyncMutex(const AsyncMutex &) = delete;
+            const AsyncMutex &operator=(const AsyncMutex &) = delete;
+
+            ALWAYS_INLINE bool TryLock() {
+                std::uintptr_t expected = Unlocked;
+                return m_state.compare_exchange_strong(expected, LockedNoWaiters, std::memory_order_acquire, std::memory_order_relaxed);
+            }
+
+            // Takes the lock and returns `false`, or enqueues the waiter and
+            // returns `true` when the lock is held by someone else.
+            ALWAYS_INLINE bool LockOrEnqueue(AsyncWaiter *waiter) {
+                std::uintptr_t state = m_state.load(std::memory_order_relaxed);
+                while (true) {
+                    if (state == Unlocked) {
+                        if (m_state.compare_exchange_weak(state, LockedNoWaiters, std::memory_order_acquire, std::memory_order_relaxed)) {
+                            return false;
+                        }
+                        continue;
+                    }
+
+                    // The waiter may be resumed as soon as it is published.
+                    waiter->next = reinterpret_cast<AsyncWaiter *>(state);
+                    if (m_state.compare_exchange_weak(state, reinterpret_cast<std::uintptr_t>(waiter), std::memory_order_release, std::memory_order_relaxed)) {
+                        return true;
+                    }
+                }
+            }
+
+            ALWAYS_INLINE void Unlock() {
+                std::uintptr_t expected = LockedNoWaiters;
+                if (!m_waiters.IsEmpty() ||
+                    !m_state.compare_exchange_strong(expected, Unlocked, std::memory_order_release, std::memory_order_relaxed)) UNLIKELY {
+                    this->UnlockSlow();
+                }
+            }
+        };
+
+    }
+
+    template <typename T>
+    struct AsyncMutexGuard;
+
+    template <typename T>
+    class AsyncMutexAwaiter;
+
+    /// A mutual exclusion primitive for coroutines to protect shared data.
+    ///
+    /// This behaves like @ref Mutex, except that acquiring the lock is done
+    /// with `co_await` and suspends the calling coroutine rather than blocking
+    /// the thread it runs on. Other coroutines scheduled on the same thread
+    /// can keep making progress in the meantime.
+    ///
+    /// Waiters are queued inside their own coroutine frames, so waiting never
+    /// allocates. The lock is handed over in FIFO order on unlock, and the next
+    /// waiter is resumed through the @ref AsyncExecutor it was suspended with.
+    ///
+    /// @tparam T The type of data to guard.
+    template <typename T>
+    class AsyncMutex {
+        friend class AsyncMutexGuard<T>;
+        friend class AsyncMutexAwaiter<T>;
+
+    public:
+        // Copying mutexes is an error hazard since the point is to protect
+        // a common shared value and not accidentally duplicate it.
+        AsyncMutex(const AsyncMutex &) = delete;
+        AsyncMutex &operator=(const AsyncMutex &) = delete;
+
+    private:
+        impl::AsyncMutex m_raw;
+        T m_value;
+
+    public:
+        /// Default-constructs the AsyncMutex along with its resource.
+        ALWAYS_INLINE constexpr AsyncMutex() : m_raw(), m_value() {}
+
+        /// Constructs the AsyncMutex from an existing resource.
+        ALWAYS_INLINE constexpr explicit AsyncMutex(T &&value)
+            : m_raw(), m_value(std::forward<T>(value)) {}
+
+        /// Constructs the AsyncMutex with its resource in-place, forwarding all
+        /// arguments to the resource constructor.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        ALWAYS_INLINE constexpr explicit AsyncMutex(std::in_place_t, Args &&...args)
+            : m_raw(), m_value(std::forward<Args>(args)...) {}
+
+        /// Locks the AsyncMutex, suspending the awaiting coroutine until it
+        /// becomes available.
+        ///
+        /// When the lock is handed over, the coroutine is resumed directly on
+        /// the thread that released it.
+        ///
+        /// @return An awaitable which produces a scope guard providing exclusive
+        ///         access to the resource. When destructed, the resource will
+        ///         be released again.
+        ALWAYS_INLINE AsyncMutexAwaiter<T> Lock() {
+            return AsyncMutexAwaiter<T>(*this);
+        }
+
+        /// Locks the AsyncMutex, suspending the awaiting coroutine until it
+        /// becomes available.
+        ///
+        /// When the lock is handed over, the coroutine is resumed through the
+        /// given executor. The executor is not used when the lock is free.
+        ///
+        /// @param executor The executor to resume the coroutine on.
+        /// @return An awaitable which produces a scope guard providing exclusive
+        ///         access to the resource. When destructed, the resource will
+        ///         be released again.
+        template <AsyncExecutor E>
+        ALWAYS_INLINE AsyncMutexAwaiter<T> Lock(E &executor) {
+            return AsyncMutexAwaiter<T>(*this, executor);
+        }
+    };
+
+    /// The awaitable returned by @ref AsyncMutex::Lock.
+    ///
+    /// It holds the wait queue node of the coroutine and must be awaited
+    /// right away.
+    template <typename T>
+    class AsyncMutexAwaiter {
+        friend class AsyncMutex<T>;
+
+    private:
+        AsyncMutex<T> &m_mutex;
+        impl::AsyncWaiter m_waiter;
+
+    private:
+        ALWAYS_INLINE explicit AsyncMutexAwaiter(AsyncMutex<T> &mutex)
+            : m_mutex(mutex), m_waiter() {}
+
+        template <AsyncExecutor E>
+        ALWAYS_INLINE AsyncMutexAwaiter(AsyncMutex<T> &mutex, E &executor)
+            : m_mutex(mutex), m_waiter(executor) {}
+
+    public:
+        ALWAYS_INLINE bool await_ready() {
+            return m_mutex.m_raw.TryLock();
+        }
+
+        ALWAYS_INLINE bool await_suspend(std::coroutine_handle<> handle) {
+            m_waiter.handle = handle;
+            return m_mutex.m_raw.LockOrEnqueue(std::addressof(m_waiter));
+        }
+
+        ALWAYS_INLINE AsyncMutexGuard<T> await_resume() {
+            return AsyncMutexGuard<T>(m_mutex);
+        }
+    };
+
+    /// A lock guard providing RAII semantics for accessing the value.
+    ///
+    /// When working with a guard object, its lifetime must never exceed
+    /// that of the @ref AsyncMutex it was obtained from.
+    ///
+    /// Releasing the lock may resume the next waiting coroutine before the
+    /// destructor returns, depending on its executor.
+    template <typename T>
+    struct AsyncMutexGuard {
+        friend class AsyncMutexAwaiter<T>;
+
+    public:
+        // Guard is not copyable for the same reason as AsyncMutex.
+        AsyncMutexGuard(const AsyncMutexGuard &) = delete;
+        AsyncMutexGuard &operator=(const AsyncMutexGuard &) = delete;
+
+        // Guard is not movable because it represents an exclusive
+        // permit to access the locked value in the current coroutine.
+        AsyncMutexGuard(AsyncMutexGuard &&) = delete;
+        AsyncMutexGuard &operator=(AsyncMutexGuard &&) = delete;
+
+    private:
+        T *m_ptr;
+        impl::AsyncMutex &m_raw;
+
+    private:
+        ALWAYS_INLINE explicit AsyncMutexGuard(AsyncMutex<T> &m)
+            : m_ptr(std::addressof(m.m_value)), m_raw(m.m_raw) {}
+
+    public:
+        // Releases exclusive access to the resource on destruction.
+        ALWAYS_INLINE ~AsyncMutexGuard() {
+            m_raw.Unlock();
+        }
+
+        // Immutable resource access, by pointer and by reference.
+        ALWAYS_INLINE const T *operator->() const   { return m_ptr;  }
+        ALWAYS_INLINE const T &operator*()  const & { return *m_ptr; }
+
+        // Mutable resource access, by pointer and by reference.
+        ALWAYS_INLINE T *operator->()   { return m_ptr;  }
+        ALWAYS_INLINE T &operator*()  & { return *m_ptr; }
+    };
+
+}
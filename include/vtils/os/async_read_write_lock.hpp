@@ -0,0 +1,422 @@
+/**
+ * @file async_read_write_lock.hpp
+ * @brief Reader-writer locks for coroutines which suspend instead of blocking.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/parking_lot.hpp"
+#include "vtils/os/impl/async_waiter.hpp"
+
+namespace vtils {
+
+    namespace impl {
+
+        struct AsyncSharedWaiter : AsyncWaiter {
+            bool exclusive;
+
+            ALWAYS_INLINE explicit AsyncSharedWaiter(bool exclusive)
+                : AsyncWaiter(), exclusive(exclusive) {}
+
+            template <AsyncExecutor E>
+            ALWAYS_INLINE AsyncSharedWaiter(bool exclusive, E &e)
+                : AsyncWaiter(e), exclusive(exclusive) {}
+        };
+
+        // A reader-writer lock whose waiters are suspended coroutines.
+        //
+        // The state is guarded by a one-byte @ref RawMutex which is only held
+        // for a handful of instructions and never while resuming a coroutine.
+        // Waiters are served in FIFO order: arriving readers queue up behind
+        // waiting writers, and a writer releasing the lock admits the whole
+        // run of readers at the head of the queue at once.
+        class AsyncReadWriteLock final {
+        private:
+            static constexpr std::int32_t WriteLocked = -1;
+
+        private:
+            RawMutex m_lock;
+            // The number of readers holding the lock, or `WriteLocked`.
+            std::int32_t m_readers;
+            AsyncWaiterQueue m_waiters;
+
+        private:
+            // Resumes a chain of waiters which were granted the lock.
+            static void ResumeAll(AsyncWaiter *waiter) {
+                while (waiter != nullptr) {
+                    AsyncWaiter *next = waiter->next;
+                    waiter->Resume();
+                    waiter = next;
+                }
+            }
+
+            // Grants the lock to the waiters at the head of the queue and
+            // returns them for resumption once the state lock is released.
+            AsyncWaiter *GrantWaiters() {
+                V_DEBUG_ASSERT(m_readers == 0);
+                if (m_waiters.IsEmpty()) {
+                    return nullptr;
+                }
+
+                auto *first = static_cast<AsyncSharedWaiter *>(m_waiters.Pop());
+                first->next = nullptr;
+                if (first->exclusive) {
+                    m_readers = WriteLocked;
+                    return first;
+                }
+
+                m_readers = 1;
+                AsyncWaiter *last = first;
+                while (!m_waiters.IsEmpty() && !static_cast<AsyncSharedWaiter *>(m_waiters.head)->exclusive) {
+                    AsyncWaiter *waiter = m_waiters.Pop();
+                    waiter->next = nullptr;
+                    last->next   = waiter;
+                    last = waiter;
+                    ++m_readers;
+                }
+
+                return first;
+            }
+
+        public:
+            constexpr AsyncReadWriteLock() : m_lock(), m_readers(0), m_waiters() {}
+            constexpr ~AsyncReadWriteLock() = default;
+
+            AsyncReadWriteLock(const AsyncReadWriteLock &) = delete;
+            const AsyncReadWriteLock &operator=(const AsyncReadWriteLock &) = delete;
+
+            ALWAYS_INLINE bool TryRead() {
+                m_lock.Lock();
+                const bool success = m_readers != WriteLocked && m_waiters.IsEmpty();
+                if (success) {
+                    ++m_readers;
+                }
+                m_lock.Unlock();
+
+                return success;
+            }
+
+            ALWAYS_INLINE bool TryWrite() {
+                m_lock.Lock();
+                const bool success = m_readers == 0;
+                if (success) {
+                    m_readers = WriteLocked;
+                }
+                m_lock.Unlock();
+
+                return success;
+            }
+
+            // Takes the lock and returns `false`, or enqueues the waiter and
+            // returns `true` when it has to wait.
+            bool LockOrEnqueue(AsyncSharedWaiter *waiter) {
+                m_lock.Lock();
+
+                bool wait;
+                if (waiter->exclusive) {
+                    wait = m_readers != 0;
+                    if (!wait) {
+                        m_readers = WriteLocked;
+                    }
+                } else {
+                    // Joining other readers would overtake queued writers.
+                    wait = m_readers == WriteLocked || !m_waiters.IsEmpty();
+                    if (!wait) {
+                        ++m_readers;
+                    }
+                }
+
+                if (wait) {
+                    m_waiters.Push(waiter);
+                }
+
+                m_lock.Unlock();
+                return wait;
+            }
+
+            ALWAYS_INLINE void ReadUnlock() {
+                m_lock.Lock();
+                V_DEBUG_ASSERT(m_readers > 0);
+                AsyncWaiter *granted = --m_readers == 0 ? this->GrantWaiters() : nullptr;
+                m_lock.Unlock();
+
+                ResumeAll(granted);
+            }
+
+            ALWAYS_INLINE void WriteUnlock() {
+                m_lock.Lock();
+                V_DEBUG_ASSERT(m_readers == WriteLocked);
+                m_readers = 0;
+                AsyncWaiter *granted = this->GrantWaiters();
+                m_lock.Unlock();
+
+                ResumeAll(granted);
+            }
+        };
+
+    }
+
+    template <typename T>
+    struct AsyncReaderGuard;
+
+    template <typename T>
+    struct AsyncWriterGuard;
+
+    template <typename T>
+    class AsyncReadAwaiter;
+
+    template <typename T>
+    class AsyncWriteAwaiter;
+
+    /// A reader-writer lock for coroutines to protect shared data.
+    ///
+    /// This behaves like @ref ReadWriteLock, except that acquiring the lock
+    /// is done with `co_await` and suspends the calling coroutine rather than
+    /// blocking the thread it runs on.
+    ///
+    /// Waiters are queued inside their own coroutine frames, so waiting never
+    /// allocates. They are served in FIFO order, which means that neither
+    /// readers nor writers can starve, and are resumed through the
+    /// @ref AsyncExecutor they were suspended with.
+    ///
+    /// @tparam T The type of data to guard.
+    template <typename T>
+    class AsyncReadWriteLock {
+        friend class AsyncReaderGuard<T>;
+        friend class AsyncWriterGuard<T>;
+        friend class AsyncReadAwaiter<T>;
+        friend class AsyncWriteAwaiter<T>;
+
+    public:
+        // Copying locks is an error hazard since the point is to protect
+        // a common shared value and not accidentally duplicate it.
+        AsyncReadWriteLock(const AsyncReadWriteLock &) = delete;
+        AsyncReadWriteLock &operator=(const AsyncReadWriteLock &) = delete;
+
+    private:
+        mutable impl::AsyncReadWriteLock m_raw;
+        T m_value;
+
+    public:
+        /// Default-constructs the AsyncReadWriteLock along with its resource.
+        ALWAYS_INLINE constexpr AsyncReadWriteLock() : m_raw(), m_value() {}
+
+        /// Constructs the AsyncReadWriteLock from an existing resource.
+        ALWAYS_INLINE constexpr explicit AsyncReadWriteLock(T &&value)
+            : m_raw(), m_value(std::forward<T>(value)) {}
+
+        /// Constructs the AsyncReadWriteLock with its resource in-place,
+        /// forwarding all arguments to the resource constructor.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        ALWAYS_INLINE constexpr explicit AsyncReadWriteLock(std::in_place_t, Args &&...args)
+            : m_raw(), m_value(std::forward<Args>(args)...) {}
+
+        /// Locks the lock for shared access, suspending the awaiting coroutine
+        /// until it becomes available.
+        ///
+        /// When the lock is granted, the coroutine is resumed directly on the
+        /// thread that released it.
+        ///
+        /// @return An awaitable which produces a scope guard providing shared
+        ///         access to the resource.
+        ALWAYS_INLINE AsyncReadAwaiter<T> Read() const {
+            return AsyncReadAwaiter<T>(*this);
+        }
+
+        /// Locks the lock for shared access, suspending the awaiting coroutine
+        /// until it becomes available.
+        ///
+        /// When the lock is granted, the coroutine is resumed through the
+        /// given executor. The executor is not used when the lock is free.
+        ///
+        /// @param executor The executor to resume the coroutine on.
+        /// @return An awaitable which produces a scope guard providing shared
+        ///         access to the resource.
+        template <AsyncExecutor E>
+        ALWAYS_INLINE AsyncReadAwaiter<T> Read(E &executor) const {
+            return AsyncReadAwaiter<T>(*this, executor);
+        }
+
+        /// Locks the lock for exclusive access, suspending the awaiting
+        /// coroutine until it becomes available.
+        ///
+        /// When the lock is granted, the coroutine is resumed directly on the
+        /// thread that released it.
+        ///
+        /// @return An awaitable which produces a scope guard providing
+        ///         exclusive access to the resource.
+        ALWAYS_INLINE AsyncWriteAwaiter<T> Write() {
+            return AsyncWriteAwaiter<T>(*this);
+        }
+
+        /// Locks the lock for exclusive access, suspending the awaiting
+        /// coroutine until it becomes available.
+        ///
+        /// When the lock is granted, the coroutine is resumed through the
+        /// given executor. The executor is not used when the lock is free.
+        ///
+        /// @param executor The executor to resume the coroutine on.
+        /// @return An awaitable which produces a scope guard providing
+        ///         exclusive access to the resource.
+        template <AsyncExecutor E>
+        ALWAYS_INLINE AsyncWriteAwaiter<T> Write(E &executor) {
+            return AsyncWriteAwaiter<T>(*this, executor);
+        }
+    };
+
+    /// The awaitable returned by @ref AsyncReadWriteLock::Read.
+    ///
+    /// It holds the wait queue node of the coroutine and must be awaited
+    /// right away.
+    template <typename T>
+    class AsyncReadAwaiter {
+        friend class AsyncReadWriteLock<T>;
+
+    private:
+        const AsyncReadWriteLock<T> &m_lock;
+        impl::AsyncSharedWaiter m_waiter;
+
+    private:
+        ALWAYS_INLINE explicit AsyncReadAwaiter(const AsyncReadWriteLock<T> &lock)
+            : m_lock(lock), m_waiter(false) {}
+
+        template <AsyncExecutor E>
+        ALWAYS_INLINE AsyncReadAwaiter(const AsyncReadWriteLock<T> &lock, E &executor)
+            : m_lock(lock), m_waiter(false, executor) {}
+
+    public:
+        ALWAYS_INLINE bool await_ready() const {
+            return false;
+        }
+
+        ALWAYS_INLINE bool await_suspend(std::coroutine_handle<> handle) {
+            m_waiter.handle = handle;
+            return m_lock.m_raw.LockOrEnqueue(std::addressof(m_waiter));
+        }
+
+        ALWAYS_INLINE AsyncReaderGuard<T> await_resume() {
+            return AsyncReaderGuard<T>(m_lock);
+        }
+    };
+
+    /// The awaitable returned by @ref AsyncReadWriteLock::Write.
+    ///
+    /// It holds the wait queue node of the coroutine and must be awaited
+    /// right away.
+    template <typename T>
+    class AsyncWriteAwaiter {
+        friend class AsyncReadWriteLock<T>;
+
+    private:
+        AsyncReadWriteLock<T> &m_lock;
+        impl::AsyncSharedWaiter m_waiter;
+
+    private:
+        ALWAYS_INLINE explicit AsyncWriteAwaiter(AsyncReadWriteLock<T> &lock)
+            : m_lock(lock), m_waiter(true) {}
+
+        template <AsyncExecutor E>
+        ALWAYS_INLINE AsyncWriteAwaiter(AsyncReadWriteLock<T> &lock, E &executor)
+            : m_lock(lock), m_waiter(true, executor) {}
+
+    public:
+        ALWAYS_INLINE bool await_ready() const {
+            return false;
+        }
+
+        ALWAYS_INLINE bool await_suspend(std::coroutine_handle<> handle) {
+            m_waiter.handle = handle;
+            return m_lock.m_raw.LockOrEnqueue(std::addressof(m_waiter));
+        }
+
+        ALWAYS_INLINE AsyncWriterGuard<T> await_resume() {
+            return AsyncWriterGuard<T>(m_lock);
+        }
+    };
+
+    /// A lock guard providing RAII semantics for shared access to the value.
+    ///
+    /// When working with a guard object, its lifetime must never exceed that
+    /// of the @ref AsyncReadWriteLock it was obtained from.
+    template <typename T>
+    struct AsyncReaderGuard {
+        friend class AsyncReadAwaiter<T>;
+
+    public:
+        // Guard is not copyable for the same reason as AsyncReadWriteLock.
+        AsyncReaderGuard(const AsyncReaderGuard &) = delete;
+        AsyncReaderGuard &operator=(const AsyncReaderGuard &) = delete;
+
+        // Guard is not movable because it represents a permit to access
+        // the locked value in the current coroutine.
+        AsyncReaderGuard(AsyncReaderGuard &&) = delete;
+        AsyncReaderGuard &operator=(AsyncReaderGuard &&) = delete;
+
+    private:
+        const T *m_ptr;
+        impl::AsyncReadWriteLock &m_raw;
+
+    private:
+        ALWAYS_INLINE explicit AsyncReaderGuard(const AsyncReadWriteLock<T> &lock)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw) {}
+
+    public:
+        // Releases shared access to the resource on destruction.
+        ALWAYS_INLINE ~AsyncReaderGuard() {
+            m_raw.ReadUnlock();
+        }
+
+        // Immutable resource access, by pointer and by reference.
+        ALWAYS_INLINE const T *operator->() const   { return m_ptr;  }
+        ALWAYS_INLINE const T &operator*()  const & { return *m_ptr; }
+    };
+
+    /// A lock guard providing RAII semantics for exclusive access to the value.
+    ///
+    /// When working with a guard object, its lifetime must never exceed that
+    /// of the @ref AsyncReadWriteLock it was obtained from.
+    template <typename T>
+    struct AsyncWriterGuard {
+        friend class AsyncWriteAwaiter<T>;
+
+    public:
+        // Guard is not copyable for the same reason as AsyncReadWriteLock.
+        AsyncWriterGuard(const AsyncWriterGuard &) = delete;
+        AsyncWriterGuard &operator=(const AsyncWriterGuard &) = delete;
+
+        // Guard is not movable because it represents a permit to access
+        // the locked value in the current coroutine.
+        AsyncWriterGuard(AsyncWriterGuard &&) = delete;
+        AsyncWriterGuard &operator=(AsyncWriterGuard &&) = delete;
+
+    private:
+        T *m_ptr;
+        impl::AsyncReadWriteLock &m_raw;
+
+    private:
+        ALWAYS_INLINE explicit AsyncWriterGuard(AsyncReadWriteLock<T> &lock)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw) {}
+
+    public:
+        // Releases exclusive access to the resource on destruction.
+        ALWAYS_INLINE ~AsyncWriterGuard() {
+            m_raw.WriteUnlock();
+        }
+
+        // Immutable resource access, by pointer and by reference.
+        ALWAYS_INLINE const T *operator->() const   { return m_ptr;  }
+        ALWAYS_INLINE const T &operator*()  const & { return *m_ptr; }
+
+        // Mutable resource access, by pointer and by reference.
+        ALWAYS_INLINE T *operator->()   { return m_ptr;  }
+        ALWAYS_INLINE T &operator*()  & { return *m_ptr; }
+    };
+
+}
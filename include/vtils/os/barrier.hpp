@@ -0,0 +1,104 @@
+/**
+ * @file barrier.hpp
+ * @brief Reusable phase barriers built directly on futexes.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    /// A reusable barrier which blocks a fixed number of threads until all
+    /// of them have arrived, and then releases them together.
+    ///
+    /// Every such round is called a phase. Threads may immediately arrive
+    /// for the next phase after being released, without any reset in between.
+    ///
+    /// Arrivals are counted with a single atomic decrement. Waiting threads
+    /// sleep on a separate phase word, which also carries a flag for sleeping
+    /// waiters so that the last thread only enters the kernel when needed.
+    class Barrier {
+    public:
+        // Copying barriers is an error hazard since the point is
+        // to synchronize threads through a common counter.
+        Barrier(const Barrier &) = delete;
+        Barrier &operator=(const Barrier &) = delete;
+
+    private:
+        // The lowest bit of the phase word flags sleeping waiters, the
+        // remaining bits count the phases.
+        static constexpr std::uint32_t Waiters  = 1 << 0;
+        static constexpr std::uint32_t OnePhase = 1 << 1;
+
+    private:
+        const std::uint32_t m_count;
+        std::atomic<std::uint32_t> m_remaining;
+        std::atomic<std::uint32_t> m_phase;
+
+    private:
+        COLD void WaitForPhase(std::uint32_t phase) {
+            std::uint32_t state = m_phase.load(std::memory_order_acquire);
+            while ((state & ~Waiters) == phase) {
+                // Announce that we are going to sleep before doing so.
+                if ((state & Waiters) == 0) {
+                    if (!m_phase.compare_exchange_weak(state, state | Waiters, std::memory_order_acquire, std::memory_order_acquire)) {
+                        continue;
+                    }
+                    state |= Waiters;
+                }
+
+                impl::FutexWait(m_phase, state);
+                state = m_phase.load(std::memory_order_acquire);
+            }
+        }
+
+        COLD void Wake() {
+            impl::FutexWakeAll(m_phase);
+        }
+
+    public:
+        /// Constructs a barrier for a group of `count` threads.
+        ALWAYS_INLINE constexpr explicit Barrier(std::uint32_t count)
+            : m_count(count), m_remaining(count), m_phase(0) {
+            V_DEBUG_ASSERT(count > 0, "barrier needs at least one thread");
+        }
+
+        /// Arrives at the barrier and blocks the current thread until all
+        /// other threads of the group have arrived as well.
+        ///
+        /// Exactly one thread per phase, the last one to arrive, is told so
+        /// through the return value. It may use this to perform work which
+        /// has to be done once between two phases, while the other threads
+        /// are already released.
+        ///
+        /// @return `true` for the last thread to arrive, `false` for all others.
+        ALWAYS_INLINE bool ArriveAndWait() {
+            // The phase cannot advance before we arrived, so reading it
+            // first ensures that we wait for the right one.
+            const std::uint32_t phase = m_phase.load(std::memory_order_relaxed) & ~Waiters;
+
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // Rearm for the next phase before releasing anyone into it.
+                m_remaining.store(m_count, std::memory_order_relaxed);
+
+                const std::uint32_t state = m_phase.exchange(phase + OnePhase, std::memory_order_release);
+                if (state & Waiters) {
+                    this->Wake();
+                }
+                return true;
+            }
+
+            if ((m_phase.load(std::memory_order_acquire) & ~Waiters) == phase) {
+                this->WaitForPhase(phase);
+            }
+            return false;
+        }
+    };
+
+}
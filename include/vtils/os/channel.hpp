@@ -0,0 +1,679 @@
+/**
+ * @file channel.hpp
+ * @brief Blocking channels for passing values between threads.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/parking_lot.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    template <typename T>
+    class Channel;
+
+    namespace impl {
+
+        // The futex word a blocked thread sleeps on. A thread which waits on
+        // several channels at once shares it between all its registrations,
+        // and whoever wakes it records which one that was.
+        class ChannelSignal final {
+        public:
+            static constexpr std::uint32_t Waiting   = 0;
+            static constexpr std::uint32_t Cancelled = std::numeric_limits<std::uint32_t>::max();
+
+        private:
+            std::atomic<std::uint32_t> m_state;
+
+        public:
+            ALWAYS_INLINE ChannelSignal() : m_state(Waiting) {}
+
+            ChannelSignal(const ChannelSignal &) = delete;
+            ChannelSignal &operator=(const ChannelSignal &) = delete;
+
+            ALWAYS_INLINE void Reset() {
+                m_state.store(Waiting, std::memory_order_relaxed);
+            }
+
+            // Claims the waiter on behalf of registration `index`. This fails
+            // when another channel got there first or the wait timed out, so
+            // that the wakeup can be passed on to somebody else.
+            //
+            // Must be called under the lock of the channel the registration
+            // belongs to, which keeps the waiter from returning in between.
+            ALWAYS_INLINE bool Notify(std::uint32_t index) {
+                std::uint32_t expected = Waiting;
+                if (!m_state.compare_exchange_strong(expected, index + 1, std::memory_order_release, std::memory_order_relaxed)) {
+                    return false;
+                }
+
+                FutexWakeOne(m_state);
+                return true;
+            }
+
+            // Sleeps until notified and returns the index of the registration
+            // which did it, or `Cancelled` once the deadline is reached.
+            std::uint32_t Wait(const std::chrono::steady_clock::time_point *deadline) {
+                std::uint32_t state;
+                while ((state = m_state.load(std::memory_order_acquire)) == Waiting) {
+                    if (deadline == nullptr) {
+                        FutexWait(m_state, Waiting);
+                    } else if (!FutexWaitUntil(m_state, Waiting, *deadline)) {
+                        // Refuse any late notifications, unless one came in
+                        // before we did so.
+                        if (m_state.compare_exchange_strong(state, Cancelled, std::memory_order_acquire, std::memory_order_acquire)) {
+                            return Cancelled;
+                        }
+                        break;
+                    }
+                }
+
+                return state - 1;
+            }
+
+            // Gets the index of the registration which claimed the waiter, or
+            // `Cancelled` when nobody did. Only final once the waiter has been
+            // removed from all channels it registered with.
+            ALWAYS_INLINE std::uint32_t GetClaimed() const {
+                const std::uint32_t state = m_state.load(std::memory_order_acquire);
+                return state != Waiting && state != Cancelled ? state - 1 : Cancelled;
+            }
+        };
+
+        // The registration of a waiting thread with one channel.
+        struct ChannelWaiter {
+            ChannelSignal *signal = nullptr;
+            std::uint32_t index   = 0;
+            ChannelWaiter *prev   = nullptr;
+            ChannelWaiter *next   = nullptr;
+            bool linked           = false;
+        };
+
+        // An intrusive FIFO list of registrations, protected by the lock of
+        // the channel it belongs to.
+        class ChannelWaitList final {
+        private:
+            ChannelWaiter *m_head = nullptr;
+            ChannelWaiter *m_tail = nullptr;
+
+        public:
+            ALWAYS_INLINE bool IsEmpty() const {
+                return m_head == nullptr;
+            }
+
+            ALWAYS_INLINE void PushBack(ChannelWaiter &waiter) {
+                waiter.prev   = m_tail;
+                waiter.next   = nullptr;
+                waiter.linked = true;
+
+                if (m_tail != nullptr) {
+                    m_tail->next = std::addressof(waiter);
+                } else {
+                    m_head = std::addressof(waiter);
+                }
+                m_tail = std::addressof(waiter);
+            }
+
+            ALWAYS_INLINE void Remove(ChannelWaiter &waiter) {
+                if (!waiter.linked) {
+                    return;
+                }
+
+                (waiter.prev != nullptr ? waiter.prev->next : m_head) = waiter.next;
+                (waiter.next != nullptr ? waiter.next->prev : m_tail) = waiter.prev;
+                waiter.linked = false;
+            }
+
+            // Wakes up to `count` waiters in FIFO order. This is a single
+            // branch when nobody waits.
+            ALWAYS_INLINE void Notify(std::size_t count) {
+                while (count != 0 && m_head != nullptr) UNLIKELY {
+                    ChannelWaiter &waiter = *m_head;
+                    this->Remove(waiter);
+                    if (waiter.signal->Notify(waiter.index)) {
+                        --count;
+                    }
+                }
+            }
+
+            ALWAYS_INLINE void NotifyAll() {
+                this->Notify(std::numeric_limits<std::size_t>::max());
+            }
+        };
+
+        // The outcome of polling a channel on behalf of a select.
+        enum class ChannelPoll {
+            Ready,
+            Empty,
+            Closed,
+        };
+
+        template <class... Cases>
+        std::optional<std::size_t> SelectImpl(const std::chrono::steady_clock::time_point *deadline, Cases &...cases);
+
+        ALWAYS_INLINE std::chrono::steady_clock::time_point ToSteadyDeadline(const std::chrono::steady_clock::time_point &time) {
+            return time;
+        }
+
+        template <class Clock, class Duration>
+        ALWAYS_INLINE std::chrono::steady_clock::time_point ToSteadyDeadline(const std::chrono::time_point<Clock, Duration> &time) {
+            return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time - Clock::now());
+        }
+
+    }
+
+    /// A FIFO channel which passes values from any number of sending
+    /// threads to any number of receiving threads.
+    ///
+    /// Channels are either bounded, in which case senders block while the
+    /// channel is full, or unbounded. Receivers block while the channel is
+    /// empty. Once a channel is closed, sends fail and receivers drain the
+    /// remaining values before they are told about it.
+    ///
+    /// Values are kept under a small @ref RawMutex. Blocked threads register
+    /// themselves with the channel, so sending or receiving only wakes
+    /// somebody through the kernel when there actually is a sleeping thread
+    /// on the other side. Batches of values can be moved through a channel
+    /// with a single lock acquisition.
+    ///
+    /// @ref Select waits for values on several channels at once.
+    ///
+    /// @tparam T The type of the values.
+    template <typename T>
+    class Channel {
+        template <class... Cases>
+        friend std::optional<std::size_t> impl::SelectImpl(const std::chrono::steady_clock::time_point *deadline, Cases &...cases);
+
+    public:
+        // Copying channels is an error hazard since the point is to
+        // pass values between threads through a common buffer.
+        Channel(const Channel &) = delete;
+        Channel &operator=(const Channel &) = delete;
+
+    public:
+        using ValueType = T;
+
+        /// The capacity of unbounded channels.
+        static constexpr std::size_t Unbounded = std::numeric_limits<std::size_t>::max();
+
+    private:
+        RawMutex m_lock;
+        bool m_closed;
+        const std::size_t m_capacity;
+        std::deque<T> m_values;
+        impl::ChannelWaitList m_receivers;
+        impl::ChannelWaitList m_senders;
+
+    private:
+        // Takes `count` values from the front and wakes up as many senders.
+        // Must be called with the lock held.
+        template <class Out>
+        ALWAYS_INLINE void TakeLocked(std::size_t count, Out &&out) {
+            for (std::size_t i = 0; i < count; ++i) {
+                out(std::move(m_values.front()));
+                m_values.pop_front();
+            }
+            m_senders.Notify(count);
+        }
+
+        // Acquires the lock once values are available. Returns `false`
+        // without the lock when the channel is closed and drained, or
+        // the deadline was reached.
+        bool LockWithValues(const std::chrono::steady_clock::time_point *deadline) {
+            impl::ChannelSignal signal;
+            impl::ChannelWaiter waiter{ .signal = std::addressof(signal) };
+
+            m_lock.Lock();
+            while (m_values.empty()) {
+                if (m_closed) {
+                    m_lock.Unlock();
+                    return false;
+                }
+
+                signal.Reset();
+                m_receivers.PushBack(waiter);
+                m_lock.Unlock();
+
+                const std::uint32_t result = signal.Wait(deadline);
+
+                m_lock.Lock();
+                m_receivers.Remove(waiter);
+                if (result == impl::ChannelSignal::Cancelled && m_values.empty()) {
+                    m_lock.Unlock();
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        std::size_t ReceiveBatchImpl(std::span<T> values, const std::chrono::steady_clock::time_point *deadline) {
+            if (values.empty() || !this->LockWithValues(deadline)) {
+                return 0;
+            }
+
+            const std::size_t count = std::min(values.size(), m_values.size());
+            this->TakeLocked(count, [it = values.begin()](T &&value) mutable { *it++ = std::move(value); });
+            m_lock.Unlock();
+
+            return count;
+        }
+
+        std::optional<T> ReceiveImpl(const std::chrono::steady_clock::time_point *deadline) {
+            if (!this->LockWithValues(deadline)) {
+                return std::nullopt;
+            }
+
+            std::optional<T> value;
+            this->TakeLocked(1, [&](T &&v) { value.emplace(std::move(v)); });
+            m_lock.Unlock();
+
+            return value;
+        }
+
+        // Select support. Polls for a value without blocking.
+        impl::ChannelPoll SelectPoll(std::optional<T> &out) {
+            m_lock.Lock();
+            impl::ChannelPoll result = impl::ChannelPoll::Ready;
+            if (!m_values.empty()) {
+                this->TakeLocked(1, [&](T &&v) { out.emplace(std::move(v)); });
+            } else {
+                result = m_closed ? impl::ChannelPoll::Closed : impl::ChannelPoll::Empty;
+            }
+            m_lock.Unlock();
+
+            return result;
+        }
+
+        // Select support. Registers a waiter unless a value is available
+        // or the channel is closed.
+        impl::ChannelPoll SelectRegister(impl::ChannelWaiter &waiter) {
+            m_lock.Lock();
+            impl::ChannelPoll result = impl::ChannelPoll::Ready;
+            if (m_values.empty()) {
+                if (m_closed) {
+                    result = impl::ChannelPoll::Closed;
+                } else {
+                    m_receivers.PushBack(waiter);
+                    result = impl::ChannelPoll::Empty;
+                }
+            }
+            m_lock.Unlock();
+
+            return result;
+        }
+
+        void SelectUnregister(impl::ChannelWaiter &waiter) {
+            m_lock.Lock();
+            m_receivers.Remove(waiter);
+            m_lock.Unlock();
+        }
+
+        // Select support. Passes on a wakeup which a select consumed without
+        // receiving from this channel, so that the value it was meant for
+        // does not sit around while other receivers sleep.
+        void SelectRenotify() {
+            m_lock.Lock();
+            if (!m_values.empty()) {
+                m_receivers.Notify(1);
+            }
+            m_lock.Unlock();
+        }
+
+    public:
+        /// Constructs an open, unbounded channel.
+        Channel() : Channel(Unbounded) {}
+
+        /// Constructs an open, bounded channel.
+        ///
+        /// @param capacity The maximum number of values in the channel.
+        explicit Channel(std::size_t capacity)
+            : m_lock(), m_closed(false), m_capacity(capacity), m_values(), m_receivers(), m_senders() {
+            V_ASSERT(capacity != 0, "channel capacity must not be zero");
+        }
+
+        /// Destroys the channel. No thread may still be blocked on it.
+        ~Channel() {
+            V_DEBUG_ASSERT(m_receivers.IsEmpty() && m_senders.IsEmpty(), "channel destroyed with blocked threads");
+        }
+
+        /// Gets the maximum number of values the channel can hold, which
+        /// is @ref Unbounded for unbounded channels.
+        ALWAYS_INLINE std::size_t GetCapacity() const {
+            return m_capacity;
+        }
+
+        /// Gets the number of values in the channel. This is only a snapshot
+        /// and may be outdated by the time it returns.
+        std::size_t GetSize() {
+            m_lock.Lock();
+            const std::size_t size = m_values.size();
+            m_lock.Unlock();
+
+            return size;
+        }
+
+        /// Checks whether the channel has been closed.
+        bool IsClosed() {
+            m_lock.Lock();
+            const bool closed = m_closed;
+            m_lock.Unlock();
+
+            return closed;
+        }
+
+        /// Closes the channel and wakes up all blocked threads.
+        ///
+        /// Subsequent sends fail. Receivers still get all values which are
+        /// left in the channel before they fail as well.
+        void Close() {
+            m_lock.Lock();
+            m_closed = true;
+            m_receivers.NotifyAll();
+            m_senders.NotifyAll();
+            m_lock.Unlock();
+        }
+
+        /// Moves values into the channel, blocking the current thread while
+        /// the channel is full. Values are added and handed to receivers in
+        /// groups as large as the free capacity allows.
+        ///
+        /// @param values The values to send, which are moved from.
+        /// @return The number of values sent. This is less than the size
+        ///         of `values` only when the channel was closed.
+        std::size_t SendBatch(std::span<T> values) {
+            impl::ChannelSignal signal;
+            impl::ChannelWaiter waiter{ .signal = std::addressof(signal) };
+            std::size_t sent = 0;
+
+            m_lock.Lock();
+            while (true) {
+                m_senders.Remove(waiter);
+                if (m_closed) {
+                    break;
+                }
+
+                const std::size_t count = std::min(values.size() - sent, m_capacity - m_values.size());
+                for (std::size_t i = 0; i < count; ++i) {
+                    m_values.push_back(std::move(values[sent + i]));
+                }
+                sent += count;
+                m_receivers.Notify(count);
+
+                if (sent == values.size()) {
+                    break;
+                }
+
+                signal.Reset();
+                m_senders.PushBack(waiter);
+                m_lock.Unlock();
+
+                signal.Wait(nullptr);
+                m_lock.Lock();
+            }
+            m_lock.Unlock();
+
+            return sent;
+        }
+
+        /// Moves a value into the channel, blocking the current thread while
+        /// the channel is full.
+        ///
+        /// @return `true` when the value was sent, `false` when the channel
+        ///         was closed.
+        bool Send(T value) {
+            return this->SendBatch(std::span<T>(std::addressof(value), 1)) == 1;
+        }
+
+        /// Attempts to move a value into the channel without blocking.
+        ///
+        /// @return `true` when the value was sent, `false` when the channel
+        ///         was full or closed. `value` is left untouched then.
+        bool TrySend(T &&value) {
+            m_lock.Lock();
+            const bool success = !m_closed && m_values.size() < m_capacity;
+            if (success) {
+                m_values.push_back(std::move(value));
+                m_receivers.Notify(1);
+            }
+            m_lock.Unlock();
+
+            return success;
+        }
+
+        /// Moves as many values as are available, but at least one, out of
+        /// the channel. Blocks the current thread while the channel is empty.
+        ///
+        /// @param values The buffer to fill, in order.
+        /// @return The number of values received, which is zero only when
+        ///         the channel was closed and all values were received.
+        std::size_t ReceiveBatch(std::span<T> values) {
+            return this->ReceiveBatchImpl(values, nullptr);
+        }
+
+        /// Moves as many values as are available out of the channel, without
+        /// blocking.
+        ///
+        /// @param values The buffer to fill, in order.
+        /// @return The number of values received.
+        std::size_t TryReceiveBatch(std::span<T> values) {
+            m_lock.Lock();
+            const std::size_t count = std::min(values.size(), m_values.size());
+            this->TakeLocked(count, [it = values.begin()](T &&value) mutable { *it++ = std::move(value); });
+            m_lock.Unlock();
+
+            return count;
+        }
+
+        /// Takes the next value out of the channel, blocking the current
+        /// thread while the channel is empty.
+        ///
+        /// @return The value, or nothing when the channel was closed and
+        ///         all values were received.
+        std::optional<T> Receive() {
+            return this->ReceiveImpl(nullptr);
+        }
+
+        /// Attempts to take the next value out of the channel without blocking.
+        ///
+        /// @return The value, or nothing when the channel was empty.
+        std::optional<T> TryReceive() {
+            std::optional<T> value;
+            this->SelectPoll(value);
+            return value;
+        }
+
+        /// Takes the next value out of the channel, blocking the current thread
+        /// while the channel is empty and the given point in time has not been
+        /// reached yet.
+        ///
+        /// @param time The deadline to wait until.
+        /// @return The value, or nothing on timeout or when the channel was
+        ///         closed and all values were received.
+        template <class Clock, class Duration>
+        std::optional<T> TryReceiveUntil(const std::chrono::time_point<Clock, Duration> &time) {
+            const auto deadline = impl::ToSteadyDeadline(time);
+            return this->ReceiveImpl(std::addressof(deadline));
+        }
+
+        /// Takes the next value out of the channel, blocking the current thread
+        /// while the channel is empty for at most the given duration.
+        ///
+        /// @param time The duration to wait for.
+        /// @return The value, or nothing on timeout or when the channel was
+        ///         closed and all values were received.
+        template <class Rep, class Period>
+        std::optional<T> TryReceiveFor(const std::chrono::duration<Rep, Period> &time) {
+            return this->TryReceiveUntil(std::chrono::steady_clock::now() + time);
+        }
+    };
+
+    /// A case of a @ref Select, which receives a value from a channel and
+    /// passes it on to a handler. Created by @ref OnReceive.
+    template <typename T, class Fn>
+    struct ReceiveCase {
+        Channel<T> &channel;
+        Fn handler;
+    };
+
+    /// Creates a @ref Select case which calls `handler` with the value
+    /// when it receives from `channel`.
+    template <typename T, class Fn> requires std::is_invocable_v<std::decay_t<Fn>&, T&&>
+    ALWAYS_INLINE ReceiveCase<T, std::decay_t<Fn>> OnReceive(Channel<T> &channel, Fn &&handler) {
+        return { channel, std::forward<Fn>(handler) };
+    }
+
+    namespace impl {
+
+        // Invokes `fn` with the case at runtime index `index`.
+        template <class Tuple, class Fn, std::size_t... I>
+        ALWAYS_INLINE auto VisitCase(Tuple &cases, std::size_t index, Fn &&fn, std::index_sequence<I...>) {
+            using R = decltype(fn(std::get<0>(cases)));
+            R result{};
+            (void)((index == I ? (result = fn(std::get<I>(cases)), true) : false) || ...);
+            return result;
+        }
+
+        template <class... Cases>
+        std::optional<std::size_t> SelectImpl(const std::chrono::steady_clock::time_point *deadline, Cases &...cases) {
+            constexpr std::size_t Count = sizeof...(Cases);
+            constexpr auto Indices = std::index_sequence_for<Cases...>{};
+
+            auto tuple = std::tie(cases...);
+            ChannelSignal signal;
+            std::array<ChannelWaiter, Count> waiters;
+            for (std::size_t i = 0; i < Count; ++i) {
+                waiters[i].signal = std::addressof(signal);
+                waiters[i].index  = static_cast<std::uint32_t>(i);
+            }
+
+            // Earlier cases take precedence, except for the one which woke us.
+            std::size_t first = 0;
+            std::size_t claimed = Count;
+            bool timed_out = false;
+            while (true) {
+                std::size_t closed = 0;
+                for (std::size_t n = 0; n < Count; ++n) {
+                    const std::size_t i = (first + n) % Count;
+                    const bool received = VisitCase(tuple, i, [&](auto &c) {
+                        std::optional<typename std::remove_reference_t<decltype(c.channel)>::ValueType> value;
+                        closed += c.channel.SelectPoll(value) == ChannelPoll::Closed;
+                        if (value.has_value()) {
+                            std::invoke(c.handler, std::move(*value));
+                            return true;
+                        }
+                        return false;
+                    }, Indices);
+
+                    if (received) {
+                        // The channel which claimed us loses the wakeup it
+                        // sent, so make it wake up somebody else instead.
+                        if (claimed < Count && claimed != i) {
+                            VisitCase(tuple, claimed, [&](auto &c) {
+                                c.channel.SelectRenotify();
+                                return true;
+                            }, Indices);
+                        }
+                        return i;
+                    }
+                }
+
+                if (closed == Count || timed_out) {
+                    return std::nullopt;
+                }
+
+                // Register with all open channels before going to sleep. Should
+                // a value arrive in the meantime, skip sleeping and poll again.
+                signal.Reset();
+                std::size_t registered = 0;
+                std::size_t waiting = 0;
+                bool ready = false;
+                for (; registered < Count && !ready; ++registered) {
+                    const ChannelPoll poll = VisitCase(tuple, registered, [&](auto &c) {
+                        return c.channel.SelectRegister(waiters[registered]);
+                    }, Indices);
+
+                    ready    = poll == ChannelPoll::Ready;
+                    waiting += poll == ChannelPoll::Empty;
+                }
+
+                if (!ready && waiting != 0) {
+                    timed_out = signal.Wait(deadline) == ChannelSignal::Cancelled;
+                }
+
+                for (std::size_t i = 0; i < registered; ++i) {
+                    VisitCase(tuple, i, [&](auto &c) {
+                        c.channel.SelectUnregister(waiters[i]);
+                        return true;
+                    }, Indices);
+                }
+
+                // A channel registered before a ready one may have claimed the
+                // signal even though we never slept, so always check.
+                const std::uint32_t result = signal.GetClaimed();
+                claimed = result < Count ? result : Count;
+                first   = result < Count ? result : 0;
+            }
+        }
+
+    }
+
+    /// Waits until one of several channels has a value, receives it and
+    /// passes it to the handler of the corresponding case.
+    ///
+    /// Channels are polled in the order of the cases, so earlier cases
+    /// take precedence when several have values available. Cases with
+    /// closed and drained channels are skipped.
+    ///
+    /// @param cases The cases to wait for, created with @ref OnReceive.
+    /// @return The index of the case which received a value, or nothing
+    ///         when all channels were closed and drained.
+    template <class... Cases> requires (sizeof...(Cases) > 0)
+    std::optional<std::size_t> Select(Cases &&...cases) {
+        return impl::SelectImpl(nullptr, cases...);
+    }
+
+    /// Like @ref Select, but gives up once the given point in time has
+    /// been reached.
+    ///
+    /// @param time  The deadline to wait until.
+    /// @param cases The cases to wait for, created with @ref OnReceive.
+    /// @return The index of the case which received a value, or nothing on
+    ///         timeout or when all channels were closed and drained.
+    template <class Clock, class Duration, class... Cases> requires (sizeof...(Cases) > 0)
+    std::optional<std::size_t> SelectUntil(const std::chrono::time_point<Clock, Duration> &time, Cases &&...cases) {
+        const auto deadline = impl::ToSteadyDeadline(time);
+        return impl::SelectImpl(std::addressof(deadline), cases...);
+    }
+
+    /// Like @ref Select, but gives up after the given duration has elapsed.
+    ///
+    /// @param time  The duration to wait for.
+    /// @param cases The cases to wait for, created with @ref OnReceive.
+    /// @return The index of the case which received a value, or nothing on
+    ///         timeout or when all channels were closed and drained.
+    template <class Rep, class Period, class... Cases> requires (sizeof...(Cases) > 0)
+    std::optional<std::size_t> SelectFor(const std::chrono::duration<Rep, Period> &time, Cases &&...cases) {
+        return SelectUntil(std::chrono::steady_clock::now() + time, std::forward<Cases>(cases)...);
+    }
+
+}
@@ -13,6 +13,8 @@
 
 #if defined(V_PLATFORM_WINDOWS)
     #include "vtils/os/impl/condvar.os.windows.hpp"
+#elif defined(V_PLATFORM_LINUX)
+    #include "vtils/os/impl/condvar.futex.hpp"
 #else
     #include "vtils/os/impl/condvar.pthread.hpp"
 #endif
@@ -65,6 +67,19 @@ namespace vtils {
     private:
         impl::CondVar m_raw;
 
+    private:
+        template <typename T, class Clock, class Duration>
+        ALWAYS_INLINE bool WaitUntil(MutexGuard<T> &guard, const std::chrono::time_point<Clock, Duration> &time) {
+#if defined(V_ENABLE_LOCK_PROFILING)
+            guard.m_token.Release();
+            const bool res = m_raw.WaitUntil(guard.m_raw, time);
+            guard.m_token.Resume();
+            return res;
+#else
+            return m_raw.WaitUntil(guard.m_raw, time);
+#endif
+        }
+
     public:
         /// Constructs a new condition variable.
         ALWAYS_INLINE constexpr ConditionVariable() : m_raw() {}
@@ -101,7 +116,14 @@ namespace vtils {
         /// @param guard The guard of the locked mutex.
         template <typename T>
         ALWAYS_INLINE void Wait(MutexGuard<T> &guard) {
+#if defined(V_ENABLE_LOCK_PROFILING)
+            // Time spent waiting for a notification does not count as holding the lock.
+            guard.m_token.Release();
+            m_raw.Wait(guard.m_raw);
+            guard.m_token.Resume();
+#else
             m_raw.Wait(guard.m_raw);
+#endif
         }
 
         /// Blocks the current thread on the condition variable until
@@ -144,7 +166,7 @@ namespace vtils {
         template <typename T, class Rep, class Period>
         bool WaitFor(MutexGuard<T> &guard, const std::chrono::duration<Rep, Period> &time) {
             auto end = std::chrono::steady_clock::now() + time;
-            return m_raw.WaitUntil(guard.m_raw, end);
+            return this->WaitUntil(guard, end);
         }
 
         /// Blocks the current thread on the condition variable until
@@ -168,7 +190,7 @@ namespace vtils {
         bool WaitFor(MutexGuard<T> &guard, const std::chrono::duration<Rep, Period> &time, Fn pred) {
             auto end = std::chrono::steady_clock::now() + time;
             while (!pred(*guard)) {
-                if (!m_raw.WaitUntil(guard.m_raw, end)) {
+                if (!this->WaitUntil(guard, end)) {
                     return pred(*guard);
                 }
             }
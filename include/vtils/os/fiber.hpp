@@ -0,0 +1,267 @@
+/**
+ * @file fiber.hpp
+ * @brief Stackful fibers multiplexed onto a pool of threads.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/event_count.hpp"
+#include "vtils/os/parking_lot.hpp"
+
+namespace vtils {
+
+    class Fiber;
+    class FiberScheduler;
+
+    namespace impl {
+
+        struct FiberWorker;
+
+    }
+
+    /// A pool of fixed-size stacks for fibers.
+    ///
+    /// Stacks are carved out of larger anonymous mappings, several at a
+    /// time, and every stack is preceded by an inaccessible guard page so
+    /// that an overflow crashes right away instead of silently corrupting
+    /// its neighbour. Released stacks are kept for reuse rather than
+    /// unmapped, so spawning fibers rarely needs a system call. The memory
+    /// is only committed by the kernel as the stacks are actually touched.
+    class FiberStackPool {
+    public:
+        /// The default usable size of a stack.
+        static constexpr std::size_t DefaultStackSize = 256 * 1024;
+
+        // Copying pools is an error hazard since the
+        // stacks are owned by the mappings.
+        FiberStackPool(const FiberStackPool &) = delete;
+        FiberStackPool &operator=(const FiberStackPool &) = delete;
+
+    private:
+        static constexpr std::size_t StacksPerRegion = 16;
+
+    private:
+        const std::size_t m_page_size;
+        const std::size_t m_stack_size;
+
+        RawMutex m_lock;
+        // The lowest usable address of every free stack.
+        std::vector<void *> m_free;
+        std::vector<void *> m_regions;
+
+    private:
+        void MapRegion();
+
+    public:
+        /// Constructs an empty pool.
+        ///
+        /// @param stack_size The usable size of every stack, which is
+        ///                   rounded up to whole pages.
+        explicit FiberStackPool(std::size_t stack_size = DefaultStackSize);
+
+        /// Unmaps all stacks. None of them may be in use anymore.
+        ~FiberStackPool();
+
+        /// Gets the usable size of every stack.
+        ALWAYS_INLINE std::size_t GetStackSize() const {
+            return m_stack_size;
+        }
+
+        /// Takes a stack from the pool, mapping more if necessary.
+        ///
+        /// \throws std::system_error When the OS reported an error.
+        /// @return The lowest usable address of the stack.
+        void *Allocate();
+
+        /// Returns a stack obtained from @ref Allocate to the pool.
+        void Free(void *stack);
+    };
+
+    /// A lightweight thread of execution with its own stack, which runs on
+    /// the worker threads of a @ref FiberScheduler.
+    ///
+    /// Fibers let code written in a blocking style run M:N on a few threads.
+    /// When a fiber yields, parks or finishes, its worker saves a handful of
+    /// registers and switches straight to the next runnable fiber, which
+    /// takes nanoseconds and never involves the kernel. Fibers may resume on
+    /// a different worker than the one they were suspended on.
+    ///
+    /// Blocking the thread itself, e.g. on a @ref Mutex or in a system call,
+    /// holds up the worker along with all fibers waiting to run on it.
+    /// Fibers should wait on each other with @ref Join or with @ref Park and
+    /// @ref Unpark instead.
+    ///
+    /// The callable is stored at the top of the fiber's own stack, so
+    /// starting a fiber does not allocate unless the stack pool needs to
+    /// grow. Exceptions escaping the callable terminate the program.
+    class Fiber {
+        friend class FiberScheduler;
+        friend struct impl::FiberWorker;
+
+    public:
+        // Copying fibers is an error hazard since the
+        // scheduler refers to them by address.
+        Fiber(const Fiber &) = delete;
+        Fiber &operator=(const Fiber &) = delete;
+
+    private:
+        enum WakeState : std::uint32_t {
+            Running,
+            Parked,
+            Notified,
+        };
+
+    private:
+        FiberScheduler &m_scheduler;
+        // The next fiber in the run queue.
+        Fiber *m_next;
+        // The saved stack pointer while the fiber is suspended.
+        void *m_context;
+        void *m_stack;
+        void *m_callable;
+        void (*m_invoke)(void *callable);
+        // A handle for thread sanitizer to track the fiber, if enabled.
+        void *m_sanitizer_fiber;
+        // The fake stack of address sanitizer while the fiber is suspended.
+        void *m_sanitizer_fake_stack;
+
+        std::atomic<std::uint32_t> m_wake;
+        // The fiber waiting in `Join`, or `this` once the fiber finished.
+        std::atomic<Fiber *> m_joiner;
+        std::atomic<std::uint32_t> m_done;
+
+    private:
+        void *AllocateStack();
+        void Start(void *stack_top);
+        static void Entry(void *arg);
+
+    public:
+        /// Starts a fiber which runs `fn` on the given scheduler.
+        ///
+        /// @param scheduler The scheduler to run the fiber on, which must
+        ///                  outlive it.
+        /// @param fn        The callable to run.
+        ///
+        /// \throws std::system_error When no stack could be mapped.
+        template <class Fn> requires std::is_invocable_v<std::decay_t<Fn>&>
+        Fiber(FiberScheduler &scheduler, Fn &&fn)
+            : m_scheduler(scheduler), m_next(nullptr), m_context(nullptr), m_stack(nullptr),
+              m_callable(nullptr), m_invoke(nullptr), m_sanitizer_fiber(nullptr), m_sanitizer_fake_stack(nullptr),
+              m_wake(Running), m_joiner(nullptr), m_done(0) {
+            using Callable = std::decay_t<Fn>;
+
+            // Move the callable to the top of the stack and run the
+            // fiber right below it.
+            void *top = this->AllocateStack();
+            auto address = AlignDown(reinterpret_cast<std::uintptr_t>(top) - sizeof(Callable), alignof(Callable));
+            m_callable = ::new (reinterpret_cast<void *>(address)) Callable(std::forward<Fn>(fn));
+            m_invoke   = [](void *callable) {
+                auto *fn = static_cast<Callable *>(callable);
+                (*fn)();
+                std::destroy_at(fn);
+            };
+
+            this->Start(m_callable);
+        }
+
+        /// Waits for the fiber to finish, unless it was joined already.
+        ~Fiber();
+
+        /// Checks whether the fiber has finished running.
+        ALWAYS_INLINE bool IsDone() const {
+            return m_done.load(std::memory_order_acquire) != 0;
+        }
+
+        /// Waits for the fiber to finish.
+        ///
+        /// When called from another fiber, that fiber is suspended in the
+        /// meantime so that its worker can go on with other fibers. Only one
+        /// fiber may join a given fiber at a time.
+        void Join();
+
+        /// Makes the fiber runnable again if it is parked, or lets its next
+        /// call to @ref Park return right away otherwise. May be called
+        /// from any thread.
+        void Unpark();
+
+        /// Gets the fiber running on the current thread, if any.
+        static Fiber *GetCurrent();
+
+        /// Suspends the current fiber and puts it at the back of the run
+        /// queue, letting other fibers run. Yields the thread when called
+        /// outside of a fiber.
+        static void Yield();
+
+        /// Suspends the current fiber until another thread or fiber calls
+        /// @ref Unpark on it. Returns right away when it was unparked since
+        /// the last call. Must be called from within a fiber.
+        ///
+        /// Like with condition variables, the condition that is waited for
+        /// must be checked again in a loop after this returns.
+        static void Park();
+    };
+
+    /// A scheduler which runs fibers on a fixed set of worker threads.
+    ///
+    /// Runnable fibers wait in a single FIFO queue, from which idle workers
+    /// take the oldest one. Workers without anything to do sleep on a futex
+    /// until a fiber becomes runnable.
+    class FiberScheduler {
+        friend class Fiber;
+
+    public:
+        // Copying schedulers is an error hazard since the point
+        // is to share a common set of threads.
+        FiberScheduler(const FiberScheduler &) = delete;
+        FiberScheduler &operator=(const FiberScheduler &) = delete;
+
+    private:
+        FiberStackPool m_stacks;
+
+        RawMutex m_lock;
+        Fiber *m_head;
+        Fiber *m_tail;
+        bool m_stop;
+        impl::EventCount m_runnable;
+
+        std::vector<std::thread> m_threads;
+
+    private:
+        void WorkerMain();
+        bool TryPop(Fiber *&fiber);
+        Fiber *Pop();
+        void Enqueue(Fiber &fiber);
+        void Finish(Fiber &fiber);
+
+    public:
+        /// Starts a scheduler with the given number of worker threads.
+        ///
+        /// @param threads    The number of workers, or zero to start one
+        ///                   for every hardware thread.
+        /// @param stack_size The usable stack size of every fiber.
+        explicit FiberScheduler(std::size_t threads = 0,
+                                std::size_t stack_size = FiberStackPool::DefaultStackSize);
+
+        /// Stops the worker threads. All fibers must have finished.
+        ~FiberScheduler();
+
+        /// Gets the number of worker threads.
+        ALWAYS_INLINE std::size_t GetThreadCount() const {
+            return m_threads.size();
+        }
+    };
+
+}
@@ -0,0 +1,103 @@
+/**
+ * @file async_waiter.hpp
+ * @brief Intrusive wait queue nodes for coroutine-aware locks.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <memory>
+
+#include "vtils/macros/attr.hpp"
+
+namespace vtils {
+
+    /// An executor which resumes coroutines that were granted an async lock.
+    ///
+    /// `Schedule` is called from the thread that released the lock, while no
+    /// internal lock is held. It may resume the coroutine right away or queue
+    /// it to run somewhere else. The executor must outlive the wait.
+    template <typename E>
+    concept AsyncExecutor = requires (E &e, std::coroutine_handle<> handle) {
+        { e.Schedule(handle) } -> std::same_as<void>;
+    };
+
+    /// An @ref AsyncExecutor which resumes coroutines directly on the
+    /// thread that released the lock.
+    ///
+    /// This is what async locks use unless told otherwise. The releasing
+    /// coroutine only continues once the resumed one suspends again.
+    struct InlineExecutor {
+        ALWAYS_INLINE void Schedule(std::coroutine_handle<> handle) {
+            handle.resume();
+        }
+    };
+
+}
+
+namespace vtils::impl {
+
+    // A suspended coroutine waiting for an async lock.
+    //
+    // The node lives inside the awaiter, which in turn lives in the frame
+    // of the waiting coroutine, so queueing never allocates. Once a node is
+    // published to a lock, it belongs to the lock until it is resumed.
+    struct AsyncWaiter {
+        AsyncWaiter *next = nullptr;
+        std::coroutine_handle<> handle;
+        void *executor = nullptr;
+        void (*schedule)(void *, std::coroutine_handle<>) = nullptr;
+
+        AsyncWaiter() = default;
+
+        template <AsyncExecutor E>
+        ALWAYS_INLINE explicit AsyncWaiter(E &e)
+            : executor(std::addressof(e)),
+              schedule([](void *obj, std::coroutine_handle<> handle) { static_cast<E *>(obj)->Schedule(handle); }) {}
+
+        AsyncWaiter(const AsyncWaiter &) = delete;
+        AsyncWaiter &operator=(const AsyncWaiter &) = delete;
+
+        // Hands the lock over to the waiting coroutine. The node must not
+        // be accessed afterwards, as the coroutine may already be gone.
+        ALWAYS_INLINE void Resume() {
+            const auto h = handle;
+            if (schedule != nullptr) {
+                schedule(executor, h);
+            } else {
+                h.resume();
+            }
+        }
+    };
+
+    // A FIFO queue of waiters linked through their nodes.
+    struct AsyncWaiterQueue {
+        AsyncWaiter *head = nullptr;
+        AsyncWaiter *tail = nullptr;
+
+        ALWAYS_INLINE bool IsEmpty() const {
+            return head == nullptr;
+        }
+
+        ALWAYS_INLINE void Push(AsyncWaiter *waiter) {
+            waiter->next = nullptr;
+            if (tail != nullptr) {
+                tail->next = waiter;
+            } else {
+                head = waiter;
+            }
+            tail = waiter;
+        }
+
+        ALWAYS_INLINE AsyncWaiter *Pop() {
+            AsyncWaiter *waiter = head;
+            head = waiter->next;
+            if (head == nullptr) {
+                tail = nullptr;
+            }
+            return waiter;
+        }
+    };
+
+}
@@ -0,0 +1,100 @@
+/**
+ * @file condvar.futex.hpp
+ * @brief Condition Variable implementation on top of Linux futexes.
+ * @copyright Valentin B.
+ *
+ * NotifyAll() wakes a single waiter and uses `FUTEX_CMP_REQUEUE` to move
+ * all others over to the futex of the associated mutex. They are then
+ * woken one by one as the mutex is released, instead of all waking up at
+ * once only to immediately block on the mutex again.
+ *
+ * For this to work, a woken waiter reacquires the mutex in the contended
+ * state, so that its unlock passes the wakeup on to the next requeued one.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+#include "vtils/os/impl/mutex.futex.hpp"
+
+namespace vtils::impl {
+
+    class CondVarImpl final {
+    public:
+        // The futex words need no runtime setup, so there is no reason
+        // to box them when they don't fit a pointer.
+        static constexpr bool InlineStorage = true;
+
+    private:
+        // Bumped on every notification. Waiters sleep on the value they
+        // observed before releasing the mutex, so a notification that
+        // races with them going to sleep is never lost.
+        std::atomic<std::uint32_t> m_seq;
+        std::atomic<MutexImpl *> m_mutex;
+
+    private:
+        ALWAYS_INLINE void Verify(MutexImpl *mutex) {
+            MutexImpl *tmp = nullptr;
+            // Relaxed is fine because we only use it to compare addresses.
+            if (!m_mutex.compare_exchange_strong(tmp, mutex, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                V_ASSERT(tmp == mutex, "attempted to use condvar with two mutexes");
+            }
+        }
+
+    public:
+        constexpr CondVarImpl() : m_seq(0), m_mutex(nullptr) {}
+        constexpr ~CondVarImpl() = default;
+
+        ALWAYS_INLINE void Initialize() {}
+        ALWAYS_INLINE bool Finalize() { return false; }
+
+        ALWAYS_INLINE void Wait(MutexImpl &mutex) {
+            this->Verify(std::addressof(mutex));
+
+            const std::uint32_t seq = m_seq.load(std::memory_order_relaxed);
+            mutex.Unlock();
+            FutexWait(m_seq, seq);
+            mutex.LockContended();
+        }
+
+        template <class Clock, class Duration>
+        ALWAYS_INLINE bool WaitUntil(MutexImpl &mutex, const std::chrono::time_point<Clock, Duration> &time) {
+            this->Verify(std::addressof(mutex));
+
+            const std::uint32_t seq = m_seq.load(std::memory_order_relaxed);
+            mutex.Unlock();
+            FutexWaitUntil(m_seq, seq, time);
+            mutex.LockContended();
+
+            return Clock::now() < time;
+        }
+
+        ALWAYS_INLINE void NotifyOne() {
+            m_seq.fetch_add(1, std::memory_order_relaxed);
+            FutexWakeOne(m_seq);
+        }
+
+        void NotifyAll() {
+            std::uint32_t seq = m_seq.fetch_add(1, std::memory_order_relaxed) + 1;
+
+            MutexImpl *mutex = m_mutex.load(std::memory_order_relaxed);
+            if (mutex == nullptr) UNLIKELY {
+                // We can't tell which mutex to requeue to yet.
+                FutexWakeAll(m_seq);
+                return;
+            }
+
+            // Retry when a concurrent notification changed the sequence.
+            while (!FutexRequeue(m_seq, seq, 1, mutex->m_state, INT_MAX)) {
+                seq = m_seq.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+}
@@ -0,0 +1,71 @@
+/**
+ * @file epoch.hpp
+ * @brief Epoch-based memory reclamation for read-copy-update.
+ * @copyright Valentin B.
+ *
+ * A global epoch counter is advanced whenever all threads which are
+ * currently pinned have observed its current value. Objects retired in
+ * epoch `e` can no longer be reached by any reader once the global epoch
+ * has reached `e + 2`, at which point they are freed in batches.
+ *
+ * Each thread owns a record on its own cache line which it writes to when
+ * pinning. Readers thus never write to memory shared with other threads.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    struct alignas(CacheLineSize) EpochRecord {
+        // The epoch observed when pinning, shifted left by one. The lowest
+        // bit is set while the thread is pinned and zero otherwise.
+        std::atomic<std::uint64_t> state;
+        // The depth of nested pins. Only ever accessed by the owning thread.
+        std::uint32_t nesting;
+        // Whether the record is owned by a live thread.
+        std::atomic<bool> in_use;
+        // Records are never freed, so this is immutable once published.
+        EpochRecord *next;
+    };
+
+    extern constinit thread_local EpochRecord *t_epoch_record;
+    extern constinit std::atomic<std::uint64_t> g_global_epoch;
+
+    COLD EpochRecord *AcquireEpochRecord();
+
+    void RetireEpochObject(void *ptr, void (*deleter)(void *));
+
+    void SynchronizeEpochs();
+
+    ALWAYS_INLINE void EpochPin() {
+        EpochRecord *record = t_epoch_record;
+        if (record == nullptr) UNLIKELY {
+            record = AcquireEpochRecord();
+        }
+
+        if (record->nesting++ == 0) {
+            const std::uint64_t epoch = g_global_epoch.load(std::memory_order_relaxed);
+            record->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+
+            // Our pin must be visible before we load any protected pointer,
+            // or a concurrent epoch advance could miss us.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    ALWAYS_INLINE void EpochUnpin() {
+        EpochRecord *record = t_epoch_record;
+        V_DEBUG_ASSERT(record != nullptr && record->nesting != 0);
+
+        if (--record->nesting == 0) {
+            record->state.store(0, std::memory_order_release);
+        }
+    }
+
+}
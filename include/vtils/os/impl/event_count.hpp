@@ -0,0 +1,100 @@
+/**
+ * @file event_count.hpp
+ * @brief Futex-based event counts for blocking on lock-free conditions.
+ * @copyright Valentin B.
+ *
+ * An event count lets threads sleep until some condition which is
+ * maintained by lock-free code becomes true, without that code having
+ * to take a lock or enter the kernel unless somebody is really asleep.
+ *
+ * Waiters follow a fixed protocol:
+ *
+ * ```cpp
+ * while (!TryOperation()) {
+ *     const auto key = events.PrepareWait();
+ *     if (TryOperation()) {
+ *         events.CancelWait();
+ *         break;
+ *     }
+ *     events.Wait(key);
+ * }
+ * ```
+ *
+ * and whoever changes the condition calls `Notify` afterwards. Either
+ * the notifier sees the registered waiter and bumps the epoch it sleeps
+ * on, or the waiter sees the changed condition in its second check.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils::impl {
+
+    class EventCount final {
+    private:
+        std::atomic<std::uint32_t> m_epoch;
+        // The number of threads which are about to sleep or sleeping.
+        std::atomic<std::uint32_t> m_waiters;
+
+    private:
+        COLD void Wake(bool all) {
+            m_epoch.fetch_add(1, std::memory_order_acq_rel);
+            if (all) {
+                FutexWakeAll(m_epoch);
+            } else {
+                FutexWakeOne(m_epoch);
+            }
+        }
+
+    public:
+        ALWAYS_INLINE constexpr EventCount() : m_epoch(0), m_waiters(0) {}
+
+        EventCount(const EventCount &) = delete;
+        EventCount &operator=(const EventCount &) = delete;
+
+        // Registers the current thread as a waiter. The condition must be
+        // checked once more afterwards, followed by either `CancelWait` or
+        // `Wait` with the returned key.
+        ALWAYS_INLINE std::uint32_t PrepareWait() {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return m_epoch.load(std::memory_order_acquire);
+        }
+
+        ALWAYS_INLINE void CancelWait() {
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Sleeps until a notification arrives after `PrepareWait` returned
+        // `key`. May return spuriously.
+        ALWAYS_INLINE void Wait(std::uint32_t key) {
+            FutexWait(m_epoch, key);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Must be called after changing the condition to wake up one or all
+        // waiting threads. This is a fence and a load unless anyone waits.
+        ALWAYS_INLINE void Notify(bool all = false) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_waiters.load(std::memory_order_relaxed) != 0) UNLIKELY {
+                this->Wake(all);
+            }
+        }
+
+        // Like `Notify`, for conditions which were changed by a sequentially
+        // consistent read-modify-write that waiters check with a sequentially
+        // consistent load after `PrepareWait`. That already orders the change
+        // before our check for waiters, so no fence is needed and this is a
+        // plain load unless anyone waits.
+        ALWAYS_INLINE void NotifyAfterSeqCst(bool all = false) {
+            if (m_waiters.load(std::memory_order_seq_cst) != 0) UNLIKELY {
+                this->Wake(all);
+            }
+        }
+    };
+
+}
@@ -0,0 +1,44 @@
+/**
+ * @file fiber_context.hpp
+ * @brief Low-level execution context switching for fibers.
+ * @copyright Valentin B.
+ *
+ * A suspended context is nothing more than a stack pointer. Switching
+ * pushes the callee-saved registers of the current context onto its own
+ * stack, stores the stack pointer, loads the one of the target context
+ * and pops its registers again. Everything else was already spilled by
+ * the compiler around the call, so a switch costs about as much as a
+ * regular function call and never enters the kernel.
+ *
+ * The routines are written in assembly for every supported architecture,
+ * following the calling convention of the respective System V ABI.
+ */
+#pragma once
+
+#include <cstddef>
+
+#include "vtils/macros/arch.hpp"
+
+#if !defined(V_ARCH_X64) && !defined(V_ARCH_AARCH64) && !defined(V_ARCH_ARM) && !defined(V_ARCH_X86) && !defined(V_ARCH_RISCV)
+    #error "Fibers are not supported on the target architecture"
+#endif
+
+extern "C" {
+
+    // Saves the current context to `*from` and resumes `to`. Returns once
+    // another context switches back to the saved one.
+    void vtils_fiber_switch(void **from, void *to);
+
+}
+
+namespace vtils::impl {
+
+    // The entry point of a new context. It must never return, but switch
+    // away to another context for good when it is done.
+    using FiberEntry = void (*)(void *arg);
+
+    // Prepares the stack below `stack_top` so that the first switch to the
+    // returned context calls `entry(arg)` on that stack.
+    void *MakeFiberContext(void *stack_top, FiberEntry entry, void *arg);
+
+}
@@ -0,0 +1,64 @@
+/**
+ * @file futex.generic.hpp
+ * @brief Futex-like waiting on top of C++20 atomic waits.
+ * @copyright Valentin B.
+ *
+ * This is the fallback for platforms without a dedicated backend. The
+ * standard library provides no timed atomic waits, so timeouts degrade
+ * to polling with short sleeps.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    ALWAYS_INLINE bool FutexWait(const std::atomic<std::uint32_t> &futex, std::uint32_t expected) {
+        futex.wait(expected, std::memory_order_relaxed);
+        return true;
+    }
+
+    template <class Clock, class Duration>
+    bool FutexWaitUntil(const std::atomic<std::uint32_t> &futex, std::uint32_t expected, const std::chrono::time_point<Clock, Duration> &time) {
+        using namespace std::chrono_literals;
+
+        while (futex.load(std::memory_order_relaxed) == expected) {
+            auto now = Clock::now();
+            if (now >= time) {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(time - now, 1ms));
+        }
+
+        return true;
+    }
+
+    // The standard library does not tell us whether a thread was actually
+    // woken up, so callers must conservatively assume that nobody was.
+    ALWAYS_INLINE bool FutexWakeOne(const std::atomic<std::uint32_t> &futex) {
+        const_cast<std::atomic<std::uint32_t> &>(futex).notify_one();
+        return false;
+    }
+
+    ALWAYS_INLINE bool FutexWakeAll(const std::atomic<std::uint32_t> &futex) {
+        const_cast<std::atomic<std::uint32_t> &>(futex).notify_all();
+        return false;
+    }
+
+    // There is no way to wake a given number of threads at once, so they
+    // are woken one by one.
+    ALWAYS_INLINE int FutexWake(const std::atomic<std::uint32_t> &futex, int count) {
+        for (int i = 0; i < count; ++i) {
+            const_cast<std::atomic<std::uint32_t> &>(futex).notify_one();
+        }
+        return 0;
+    }
+
+}
@@ -0,0 +1,27 @@
+/**
+ * @file futex.hpp
+ * @brief Portable waiting on the value of a 32-bit atomic word.
+ * @copyright Valentin B.
+ *
+ * Every backend provides the same set of functions:
+ *
+ * - `FutexWait(futex, expected)`
+ * - `FutexWaitUntil(futex, expected, time)`, returning `false` on timeout
+ * - `FutexWakeOne(futex)`, returning whether a waiter was definitely woken
+ * - `FutexWake(futex, count)`, returning how many waiters were definitely woken
+ * - `FutexWakeAll(futex)`, returning whether any waiter was definitely woken
+ *
+ * Waits may return spuriously, so callers must always re-check the
+ * condition they are waiting for.
+ */
+#pragma once
+
+#include "vtils/macros/platform.hpp"
+
+#if defined(V_PLATFORM_LINUX)
+    #include "vtils/os/impl/futex.os.linux.hpp"
+#elif defined(V_PLATFORM_WINDOWS)
+    #include "vtils/os/impl/futex.os.windows.hpp"
+#else
+    #include "vtils/os/impl/futex.generic.hpp"
+#endif
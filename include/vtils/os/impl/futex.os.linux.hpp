@@ -0,0 +1,143 @@
+/**
+ * @file futex.os.linux.hpp
+ * @brief Thin wrappers around the Linux futex system call.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include <errno.h>
+#include <time.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    // The kernel operates on plain 32-bit words, so we rely on atomics
+    // of that size to have the exact same object representation.
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+    ALWAYS_INLINE std::uint32_t *FutexAddress(const std::atomic<std::uint32_t> &futex) {
+        return reinterpret_cast<std::uint32_t *>(const_cast<std::atomic<std::uint32_t> *>(std::addressof(futex)));
+    }
+
+    /// Converts an arbitrary deadline into an absolute `CLOCK_MONOTONIC`
+    /// timestamp suitable for `FUTEX_WAIT_BITSET`.
+    template <class Clock, class Duration>
+    ALWAYS_INLINE struct timespec ToMonotonicTimespec(const std::chrono::time_point<Clock, Duration> &time) {
+        using namespace std::chrono;
+
+        // libstdc++ and libc++ both implement steady_clock on top of
+        // CLOCK_MONOTONIC, which is what the futex timeout expects.
+        steady_clock::time_point deadline;
+        if constexpr (std::is_same_v<Clock, steady_clock>) {
+            deadline = time_point_cast<steady_clock::duration>(time);
+        } else {
+            deadline = steady_clock::now() + duration_cast<steady_clock::duration>(time - Clock::now());
+        }
+
+        // Negative timestamps are rejected by the kernel, clamp to the epoch.
+        auto since_epoch = deadline.time_since_epoch();
+        if (since_epoch.count() < 0) {
+            since_epoch = steady_clock::duration::zero();
+        }
+
+        auto secs = duration_cast<seconds>(since_epoch);
+        auto ns   = duration_cast<nanoseconds>(since_epoch - secs);
+
+        return {
+            .tv_sec  = static_cast<time_t>(secs.count()),
+            .tv_nsec = static_cast<long>(ns.count()),
+        };
+    }
+
+    /// Blocks the calling thread while `futex` holds `expected`.
+    ///
+    /// An optional absolute deadline on the monotonic clock may be given.
+    /// Returns `false` only when the deadline has passed; wakeups, value
+    /// mismatches and signal interruptions are all reported as `true`
+    /// and callers must re-check their condition.
+    ALWAYS_INLINE bool FutexWait(const std::atomic<std::uint32_t> &futex, std::uint32_t expected, const struct timespec *deadline = nullptr) {
+        long res = ::syscall(SYS_futex, FutexAddress(futex), FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                             expected, deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+
+        if (res == -1) UNLIKELY {
+            const int err = errno;
+            V_DEBUG_ASSERT(err == EAGAIN || err == EINTR || err == ETIMEDOUT, "unexpected futex wait error: {}", err);
+            return err != ETIMEDOUT;
+        }
+
+        return true;
+    }
+
+    /// Blocks the calling thread while `futex` holds `expected`, or until
+    /// the given point in time has been reached.
+    ///
+    /// Returns `false` when the deadline has passed.
+    template <class Clock, class Duration>
+    ALWAYS_INLINE bool FutexWaitUntil(const std::atomic<std::uint32_t> &futex, std::uint32_t expected, const std::chrono::time_point<Clock, Duration> &time) {
+        const struct timespec ts = ToMonotonicTimespec(time);
+        return FutexWait(futex, expected, std::addressof(ts));
+    }
+
+    /// Wakes up to `count` threads blocked on `futex` and returns the
+    /// number of threads that were actually woken.
+    ALWAYS_INLINE int FutexWake(const std::atomic<std::uint32_t> &futex, int count) {
+        long res = ::syscall(SYS_futex, FutexAddress(futex), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count);
+
+        // The woken thread may already have freed the memory backing the futex
+        // word by the time we get here, in which case the kernel reports EFAULT.
+        if (res == -1) UNLIKELY {
+            V_DEBUG_ASSERT(errno == EFAULT, "unexpected futex wake error: {}", errno);
+            return 0;
+        }
+
+        return static_cast<int>(res);
+    }
+
+    /// Wakes up to `wake` threads blocked on `from` and moves up to `requeue`
+    /// of the remaining ones over to wait on `to` without waking them.
+    ///
+    /// Nothing happens when `from` no longer holds `expected`, in which
+    /// case `false` is returned.
+    ALWAYS_INLINE bool FutexRequeue(const std::atomic<std::uint32_t> &from, std::uint32_t expected, int wake,
+                                    const std::atomic<std::uint32_t> &to, int requeue) {
+        // The kernel takes the requeue limit in place of the timeout argument.
+        long res = ::syscall(SYS_futex, FutexAddress(from), FUTEX_CMP_REQUEUE | FUTEX_PRIVATE_FLAG, wake,
+                             reinterpret_cast<void *>(static_cast<std::uintptr_t>(requeue)), FutexAddress(to), expected);
+
+        if (res == -1) UNLIKELY {
+            V_DEBUG_ASSERT(errno == EAGAIN, "unexpected futex requeue error: {}", errno);
+            return false;
+        }
+
+        return true;
+    }
+
+    /// Wakes a single thread blocked on `futex`.
+    ///
+    /// Returns whether a thread was actually woken up.
+    ALWAYS_INLINE bool FutexWakeOne(const std::atomic<std::uint32_t> &futex) {
+        return FutexWake(futex, 1) > 0;
+    }
+
+    /// Wakes all threads blocked on `futex`.
+    ///
+    /// Returns whether any thread was actually woken up.
+    ALWAYS_INLINE bool FutexWakeAll(const std::atomic<std::uint32_t> &futex) {
+        return FutexWake(futex, INT_MAX) > 0;
+    }
+
+}
@@ -0,0 +1,71 @@
+/**
+ * @file futex.os.windows.hpp
+ * @brief Futex-like waiting on Windows through WaitOnAddress.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include <errhandlingapi.h>
+#include <synchapi.h>
+#include <winerror.h>
+
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    ALWAYS_INLINE volatile void *FutexAddress(const std::atomic<std::uint32_t> &futex) {
+        return const_cast<std::atomic<std::uint32_t> *>(std::addressof(futex));
+    }
+
+    ALWAYS_INLINE bool FutexWait(const std::atomic<std::uint32_t> &futex, std::uint32_t expected) {
+        ::WaitOnAddress(FutexAddress(futex), std::addressof(expected), sizeof(expected), INFINITE);
+        return true;
+    }
+
+    template <class Clock, class Duration>
+    ALWAYS_INLINE bool FutexWaitUntil(const std::atomic<std::uint32_t> &futex, std::uint32_t expected, const std::chrono::time_point<Clock, Duration> &time) {
+        auto reltime = time - Clock::now();
+        if (reltime <= Duration::zero()) {
+            return false;
+        }
+
+        // Round up so that we never wake before the deadline; INFINITE is reserved.
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(reltime).count();
+        auto duration = std::min<decltype(ms)>(ms, std::numeric_limits<DWORD>::max() - 1);
+
+        if (::WaitOnAddress(FutexAddress(futex), std::addressof(expected), sizeof(expected), static_cast<DWORD>(duration)) == FALSE) {
+            return ::GetLastError() != ERROR_TIMEOUT;
+        }
+
+        return true;
+    }
+
+    // Windows does not tell us whether a thread was actually woken up,
+    // so callers must conservatively assume that nobody was.
+    ALWAYS_INLINE bool FutexWakeOne(const std::atomic<std::uint32_t> &futex) {
+        ::WakeByAddressSingle(const_cast<void *>(FutexAddress(futex)));
+        return false;
+    }
+
+    ALWAYS_INLINE bool FutexWakeAll(const std::atomic<std::uint32_t> &futex) {
+        ::WakeByAddressAll(const_cast<void *>(FutexAddress(futex)));
+        return false;
+    }
+
+    // There is no way to wake a given number of threads at once, so they
+    // are woken one by one.
+    ALWAYS_INLINE int FutexWake(const std::atomic<std::uint32_t> &futex, int count) {
+        for (int i = 0; i < count; ++i) {
+            ::WakeByAddressSingle(const_cast<void *>(FutexAddress(futex)));
+        }
+        return 0;
+    }
+
+}
@@ -53,13 +53,19 @@ namespace vtils::impl {
             return m_len;
         }
 
-        DWORD Map(HANDLE handle, DWORD protect, DWORD access, std::size_t offset, std::size_t len) noexcept;
+        std::size_t GetPageSize() const noexcept;
+
+        DWORD Map(HANDLE handle, DWORD protect, DWORD access, std::size_t offset, std::size_t len, bool huge) noexcept;
 
         void Unmap() noexcept;
 
         DWORD Flush(std::size_t offset, std::size_t len) noexcept;
 
         DWORD FlushAsync(std::size_t offset, std::size_t len) noexcept;
+
+        DWORD Prefetch(std::size_t offset, std::size_t len) noexcept;
+
+        DWORD Evict(std::size_t offset, std::size_t len) noexcept;
     };
 
     DWORD GetFileSize(HANDLE handle, std::uint64_t *size);
@@ -26,6 +26,11 @@ namespace vtils::impl {
         void *m_ptr = nullptr;
         std::size_t m_len = 0;
 
+        // The granularity which the mapping is aligned to, and the size of
+        // the pages which back it.
+        std::size_t m_granularity = 0;
+        std::size_t m_page_size = 0;
+
     public:
         ALWAYS_INLINE MemoryMapped() = default;
 
@@ -51,13 +56,19 @@ namespace vtils::impl {
             return m_len;
         }
 
-        int Map(int fd, int protect, int flags, std::size_t offset, std::size_t len) noexcept;
+        ALWAYS_INLINE std::size_t GetPageSize() const {
+            return m_page_size;
+        }
+
+        int Map(int fd, int protect, int flags, std::size_t offset, std::size_t len, bool huge) noexcept;
 
         void Unmap() noexcept;
 
         int Flush(std::size_t offset, std::size_t len) noexcept;
 
         int FlushAsync(std::size_t offset, std::size_t len) noexcept;
+
+        int Advise(std::size_t offset, std::size_t len, int advice) noexcept;
     };
 
     int GetFileSize(int fd, std::uint64_t *size);
@@ -0,0 +1,81 @@
+/**
+ * @file mutex.futex.hpp
+ * @brief Exclusive mutex implementation based on Linux futexes.
+ * @copyright Valentin B.
+ *
+ * The lock is a single 32-bit word with three states, following the
+ * design from Ulrich Drepper's "Futexes Are Tricky":
+ *
+ * - 0: unlocked
+ * - 1: locked, no other threads waiting
+ * - 2: locked, other threads may be waiting
+ *
+ * Since the word fits a pointer, `PointerValue` stores it inline and it
+ * never needs to allocate or be explicitly initialized or destroyed.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils::impl {
+
+    class CondVarImpl;
+
+    class MutexImpl final {
+        friend class CondVarImpl;
+
+    private:
+        static constexpr std::uint32_t Unlocked  = 0;
+        static constexpr std::uint32_t Locked    = 1;
+        static constexpr std::uint32_t Contended = 2;
+
+    private:
+        std::atomic<std::uint32_t> m_state;
+
+    private:
+        COLD void LockContended() {
+            // Announce that we are about to sleep so that the owner knows
+            // to wake us. If the exchange observes the lock as free, we
+            // took it with the contended marker which merely costs a
+            // superfluous wake later on.
+            while (m_state.exchange(Contended, std::memory_order_acquire) != Unlocked) {
+                FutexWait(m_state, Contended);
+            }
+        }
+
+    public:
+        ALWAYS_INLINE constexpr MutexImpl() : m_state(Unlocked) {}
+        constexpr ~MutexImpl() = default;
+
+        ALWAYS_INLINE void Initialize() {}
+        ALWAYS_INLINE bool Finalize() { return false; }
+
+        ALWAYS_INLINE void Lock() {
+            std::uint32_t expected = Unlocked;
+            if (!m_state.compare_exchange_strong(expected, Locked, std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->LockContended();
+            }
+        }
+
+        ALWAYS_INLINE bool TryLock() {
+            std::uint32_t expected = Unlocked;
+            return m_state.compare_exchange_strong(expected, Locked, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        ALWAYS_INLINE bool IsLocked() const {
+            return m_state.load(std::memory_order_relaxed) != Unlocked;
+        }
+
+        ALWAYS_INLINE void Unlock() {
+            // Only enter the kernel when someone may actually be waiting.
+            if (m_state.exchange(Unlocked, std::memory_order_release) == Contended) UNLIKELY {
+                FutexWakeOne(m_state);
+            }
+        }
+    };
+
+}
@@ -18,6 +18,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
 
 #include <synchapi.h>
@@ -56,6 +57,12 @@ namespace vtils::impl {
             return ::TryAcquireSRWLockExclusive(std::addressof(m_srw)) != FALSE;
         }
 
+        // The lock word is non-null while the lock is held or contended.
+        // This is only a hint for spinning and must not be relied on.
+        ALWAYS_INLINE bool IsLocked() const {
+            return std::atomic_ref<PVOID>(const_cast<PVOID &>(m_srw.Ptr)).load(std::memory_order_relaxed) != nullptr;
+        }
+
         ALWAYS_INLINE void Unlock() {
             ::ReleaseSRWLockExclusive(std::addressof(m_srw));
         }
@@ -76,6 +76,12 @@ namespace vtils::impl {
             return pthread_mutex_trylock(std::addressof(m_mutex)) == 0;
         }
 
+        // pthreads does not expose the lock state, so always report it as
+        // free and let callers fall back to `TryLock`.
+        ALWAYS_INLINE bool IsLocked() const {
+            return false;
+        }
+
         ALWAYS_INLINE void Unlock() {
             int res = pthread_mutex_unlock(std::addressof(m_mutex));
             V_DEBUG_ASSERT(res == 0);
@@ -0,0 +1,134 @@
+/**
+ * @file parking_lot.hpp
+ * @brief A global table of parked threads keyed by address.
+ * @copyright Valentin B.
+ *
+ * The parking lot lets any memory address serve as a wait queue, so that
+ * synchronization primitives built on top of it only need to store a few
+ * bits of state inline. Threads are queued in a fixed-size hash table of
+ * buckets, each protected by its own lock, and sleep on a futex word in
+ * thread-local storage until they are unparked.
+ *
+ * The design follows WebKit's WTF::ParkingLot and Rust's parking_lot crate.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "vtils/impl/cpu_relax.hpp"
+#include "vtils/impl/function_ref.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    /// A value given by a parking thread to identify itself to unparkers.
+    using ParkToken = std::uintptr_t;
+
+    /// A value passed from an unparking thread to the threads it wakes up.
+    using UnparkToken = std::uintptr_t;
+
+    constexpr inline ParkToken DefaultParkToken = 0;
+    constexpr inline UnparkToken DefaultUnparkToken = 0;
+
+    enum class ParkResultKind {
+        /// The thread was unparked by another thread.
+        Unparked,
+        /// The validation callback returned `false`.
+        Invalid,
+        /// The deadline was reached before the thread was unparked.
+        TimedOut,
+    };
+
+    struct ParkResult {
+        ParkResultKind kind;
+        UnparkToken token;
+    };
+
+    struct UnparkResult {
+        /// The number of threads that were unparked.
+        std::size_t unparked_threads;
+        /// Whether threads remain parked on the same key.
+        bool have_more_threads;
+        /// Whether the unparker should hand over ownership directly to the
+        /// woken thread. This is set periodically to ensure eventual fairness.
+        bool be_fair;
+    };
+
+    enum class FilterOp {
+        /// Unpark the thread and continue scanning.
+        Unpark,
+        /// Leave the thread parked and continue scanning.
+        Skip,
+        /// Leave the thread parked and stop scanning.
+        Stop,
+    };
+
+    using ParkDeadline = std::chrono::steady_clock::time_point;
+
+    /// Parks the calling thread in the queue associated with `key`.
+    ///
+    /// `validate` is called with the queue locked and aborts parking when it
+    /// returns `false`. `before_sleep` runs after the thread was queued, but
+    /// before it goes to sleep. When the deadline is reached, the thread is
+    /// removed from the queue and `timed_out` is called with the queue still
+    /// locked, along with whether it was the last thread parked on `key`.
+    ParkResult Park(const void *key, FunctionRef<bool()> validate, FunctionRef<void()> before_sleep,
+                    FunctionRef<void(const void *, bool)> timed_out, ParkToken token, const ParkDeadline *deadline);
+
+    /// Unparks threads parked on `key` in FIFO order, as decided by `filter`.
+    ///
+    /// `callback` runs with the queue locked after the threads to wake have
+    /// been selected, but before they are woken. Its result is passed to all
+    /// unparked threads.
+    UnparkResult UnparkFiltered(const void *key, FunctionRef<FilterOp(ParkToken)> filter, FunctionRef<UnparkToken(UnparkResult)> callback);
+
+    /// Unparks the thread which parked on `key` first, if any.
+    UnparkResult UnparkOne(const void *key, FunctionRef<UnparkToken(UnparkResult)> callback);
+
+    /// Unparks all threads parked on `key` and returns their number.
+    std::size_t UnparkAll(const void *key);
+
+    /// Bounded exponential backoff for spinning before parking.
+    class SpinWait final {
+    private:
+        std::uint32_t m_counter = 0;
+
+    public:
+        constexpr SpinWait() = default;
+
+        ALWAYS_INLINE void Reset() {
+            m_counter = 0;
+        }
+
+        /// Spins for a while and returns `false` once the thread should park.
+        ALWAYS_INLINE bool Spin() {
+            if (m_counter >= 10) {
+                return false;
+            }
+
+            ++m_counter;
+            if (m_counter <= 3) {
+                for (std::uint32_t i = 0; i < (1u << m_counter); ++i) {
+                    CpuRelax();
+                }
+            } else {
+                std::this_thread::yield();
+            }
+
+            return true;
+        }
+    };
+
+    template <class Clock, class Duration>
+    ALWAYS_INLINE ParkDeadline ToParkDeadline(const std::chrono::time_point<Clock, Duration> &time) {
+        if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+            return std::chrono::time_point_cast<ParkDeadline::duration>(time);
+        } else {
+            return std::chrono::steady_clock::now() + std::chrono::duration_cast<ParkDeadline::duration>(time - Clock::now());
+        }
+    }
+
+}
@@ -0,0 +1,449 @@
+/**
+ * @file read_write_lock.futex.hpp
+ * @brief Reader-Writer lock implementation based on futexes.
+ * @copyright Valentin B.
+ *
+ * The whole lock state lives in a single 32-bit word, with a second word
+ * only serving as a wakeup channel for writers:
+ *
+ * - Bit 0 is set while a writer holds the lock.
+ * - Bit 1 is set when writers may be waiting for the lock.
+ * - Bit 2 is set when readers may be waiting for the lock.
+ * - Bit 3 marks a read phase granted by a writer in phase-fair mode. It
+ *   keeps writers out until the last reader of the phase clears it.
+ * - Bit 4 is set while an upgradable reader waits to become the writer.
+ * - The remaining bits count the readers holding the lock.
+ *
+ * A third word is a plain mutex which upgradable readers hold in addition
+ * to their read lock, so that at most one of them exists at a time.
+ *
+ * Readers optimistically add themselves to the reader count with a single
+ * `fetch_add` and only back out when the observed state forbids reading.
+ * Every transition into the unlocked state therefore checks the waiter
+ * bits, as a reader backing out may be the one releasing a writer.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/macros/platform.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    /// Scheduling policies for reader-writer locks.
+    enum class ReadWritePolicy {
+        /// Readers may always join other readers. Writers may starve when
+        /// there is a continuous stream of readers.
+        ReaderPreferring,
+        /// Arriving readers wait as soon as a writer is waiting. Readers may
+        /// starve when there is a continuous stream of writers.
+        WriterPreferring,
+        /// Readers and writers alternate in phases. Readers which had to wait
+        /// for a writer are all admitted together before the next writer.
+        PhaseFair,
+    };
+
+}
+
+namespace vtils::impl {
+
+    template <ReadWritePolicy Policy>
+    class FutexReadWriteLockImpl final {
+    private:
+        static constexpr std::uint32_t WriteLocked    = 1 << 0;
+        static constexpr std::uint32_t WritersWaiting = 1 << 1;
+        static constexpr std::uint32_t ReadersWaiting = 1 << 2;
+        static constexpr std::uint32_t ReadPhase      = 1 << 3;
+        static constexpr std::uint32_t UpgradePending = 1 << 4;
+
+        static constexpr std::uint32_t ReaderShift = 5;
+        static constexpr std::uint32_t ReadLocked  = 1 << ReaderShift;
+        static constexpr std::uint32_t MaxReaders  = (~std::uint32_t{0} >> ReaderShift) - 1;
+
+        // State bits which turn away readers on the fast path.
+        static constexpr std::uint32_t ReadBlocked = Policy == ReadWritePolicy::ReaderPreferring
+            ? WriteLocked
+            : WriteLocked | WritersWaiting | UpgradePending;
+
+    public:
+        // All state is plain futex words which need no runtime setup.
+        static constexpr bool InlineStorage = true;
+
+    private:
+        std::atomic<std::uint32_t> m_state;
+        std::atomic<std::uint32_t> m_writer_notify;
+        std::atomic<std::uint32_t> m_upgrader;
+
+    private:
+        ALWAYS_INLINE static constexpr std::uint32_t GetReaders(std::uint32_t state) {
+            return state >> ReaderShift;
+        }
+
+        ALWAYS_INLINE static constexpr bool IsUnlocked(std::uint32_t state) {
+            return GetReaders(state) == 0 && (state & WriteLocked) == 0;
+        }
+
+        // Whether a reader in the slow path may take the lock. Readers
+        // which already slept once may join a read phase granted to them.
+        ALWAYS_INLINE static constexpr bool CanRead(std::uint32_t state, bool waited) {
+            if (GetReaders(state) >= MaxReaders) {
+                return false;
+            }
+
+            // A read phase which nobody holds yet may also be joined by new
+            // readers, as it would otherwise have nobody left to end it.
+            if constexpr (Policy == ReadWritePolicy::PhaseFair) {
+                if ((waited || GetReaders(state) == 0) && (state & (WriteLocked | ReadPhase)) == ReadPhase) {
+                    return true;
+                }
+            }
+
+            return (state & ReadBlocked) == 0;
+        }
+
+        ALWAYS_INLINE static constexpr bool CanWrite(std::uint32_t state) {
+            return IsUnlocked(state) && (state & ReadPhase) == 0;
+        }
+
+        ALWAYS_INLINE static constexpr bool IsEmptyReadPhase(std::uint32_t state) {
+            return IsUnlocked(state) && (state & ReadPhase) != 0;
+        }
+
+        ALWAYS_INLINE bool WakeWriter() {
+            m_writer_notify.fetch_add(1, std::memory_order_release);
+            return FutexWakeOne(m_writer_notify);
+        }
+
+        // Must be called by every thread which moves the lock into the unlocked
+        // state while waiter bits are set. If the lock is taken by someone else
+        // in the meantime, waking waiters becomes their responsibility.
+        void WakeWritersOrReaders(std::uint32_t state) {
+            V_DEBUG_ASSERT(IsUnlocked(state));
+
+            // A read phase ends once all of its readers are gone.
+            if (state & ReadPhase) {
+                if (!m_state.compare_exchange_strong(state, state & ~ReadPhase, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                    return;
+                }
+                state &= ~ReadPhase;
+            }
+
+            if constexpr (Policy == ReadWritePolicy::ReaderPreferring) {
+                // Release everyone and let the readers win the race.
+                if (state & (ReadersWaiting | WritersWaiting)) {
+                    if (!m_state.compare_exchange_strong(state, 0, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        return;
+                    }
+
+                    if (state & ReadersWaiting) {
+                        FutexWakeAll(m_state);
+                    }
+                    if (state & WritersWaiting) {
+                        this->WakeWriter();
+                    }
+                }
+            } else {
+                // If only writers are waiting, wake one of them up.
+                if (state == WritersWaiting) {
+                    if (m_state.compare_exchange_strong(state, 0, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        this->WakeWriter();
+                        return;
+                    }
+                }
+
+                // If both are waiting, hand the lock to one writer and leave the
+                // readers waiting. If no writer was actually asleep, the bit may
+                // have been stale and the readers are woken up instead.
+                if (state == (ReadersWaiting | WritersWaiting)) {
+                    if (!m_state.compare_exchange_strong(state, ReadersWaiting, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        return;
+                    }
+
+                    if (this->WakeWriter()) {
+                        return;
+                    }
+                    state = ReadersWaiting;
+                }
+
+                if (state == ReadersWaiting) {
+                    if (m_state.compare_exchange_strong(state, 0, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        FutexWakeAll(m_state);
+                    }
+                }
+            }
+        }
+
+        // Whether a reader which left the lock in the given state must wake
+        // other threads through `ReaderLeft`.
+        ALWAYS_INLINE static constexpr bool MustWakeAfterRead(std::uint32_t state) {
+            return (state & UpgradePending) != 0 || (IsUnlocked(state) && (state & (WritersWaiting | ReadersWaiting | ReadPhase)) != 0);
+        }
+
+        COLD void ReaderLeft(std::uint32_t state) {
+            if (state & UpgradePending) {
+                // The upgrader holds a read lock itself, so it is waiting
+                // for the reader count to drop to one.
+                if (GetReaders(state) == 1) {
+                    FutexWakeAll(m_state);
+                }
+            } else {
+                this->WakeWritersOrReaders(state);
+            }
+        }
+
+        COLD void ReadContended() {
+            // Back out of the optimistic increment from the fast path. We never
+            // held the lock, so instead of ending a read phase whose readers
+            // may still be on their way, we join it below.
+            std::uint32_t state = m_state.fetch_sub(ReadLocked, std::memory_order_relaxed) - ReadLocked;
+            if (MustWakeAfterRead(state) && !IsEmptyReadPhase(state)) {
+                this->ReaderLeft(state);
+            }
+
+            bool waited = false;
+            state = m_state.load(std::memory_order_relaxed);
+            while (true) {
+                if (CanRead(state, waited)) {
+                    if (m_state.compare_exchange_weak(state, state + ReadLocked, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return;
+                    }
+                    continue;
+                }
+
+                V_ASSERT(GetReaders(state) < MaxReaders, "rwlock maximum reader count exceeded");
+
+                // Announce that we are going to sleep before doing so.
+                if ((state & ReadersWaiting) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | ReadersWaiting, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+                    state |= ReadersWaiting;
+                }
+
+                FutexWait(m_state, state);
+                waited = true;
+                state  = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        COLD void WriteContended() {
+            std::uint32_t state = m_state.load(std::memory_order_relaxed);
+            std::uint32_t other_writers_waiting = 0;
+
+            while (true) {
+                if (CanWrite(state)) {
+                    // Once we slept, other writers may be asleep too, so keep the bit
+                    // set for our unlock to wake them.
+                    const std::uint32_t desired = state | WriteLocked | other_writers_waiting;
+                    if (m_state.compare_exchange_weak(state, desired, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return;
+                    }
+                    continue;
+                }
+
+                if ((state & WritersWaiting) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | WritersWaiting, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+                }
+                other_writers_waiting = WritersWaiting;
+
+                // Observe the notification counter before re-checking the state
+                // so that we never miss a wakeup in between.
+                const std::uint32_t seq = m_writer_notify.load(std::memory_order_acquire);
+                state = m_state.load(std::memory_order_relaxed);
+                if (CanWrite(state) || (state & WritersWaiting) == 0) {
+                    continue;
+                }
+
+                FutexWait(m_writer_notify, seq);
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        COLD void LockUpgraderContended() {
+            while (m_upgrader.exchange(2, std::memory_order_acquire) != 0) {
+                FutexWait(m_upgrader, 2);
+            }
+        }
+
+        ALWAYS_INLINE void UnlockUpgrader() {
+            if (m_upgrader.exchange(0, std::memory_order_release) == 2) UNLIKELY {
+                FutexWakeOne(m_upgrader);
+            }
+        }
+
+        // Converts the read lock of the upgrader into the write lock. This
+        // succeeds once the upgrader is the only remaining reader.
+        ALWAYS_INLINE static constexpr std::uint32_t UpgradedState(std::uint32_t state) {
+            return ((state - ReadLocked) & ~(UpgradePending | ReadPhase)) | WriteLocked;
+        }
+
+        COLD void UpgradeContended() {
+            std::uint32_t state = m_state.load(std::memory_order_relaxed);
+            while (true) {
+                if (GetReaders(state) == 1) {
+                    if (m_state.compare_exchange_weak(state, UpgradedState(state), std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return;
+                    }
+                    continue;
+                }
+
+                // Keep new readers out unless the policy prefers them, and
+                // make the last reader to leave wake us up.
+                if ((state & UpgradePending) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | UpgradePending, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+                    state |= UpgradePending;
+                }
+
+                FutexWait(m_state, state);
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        COLD void WakeReadersAfterDowngrade() {
+            m_state.fetch_and(~ReadersWaiting, std::memory_order_relaxed);
+            FutexWakeAll(m_state);
+        }
+
+    public:
+        constexpr FutexReadWriteLockImpl() : m_state(0), m_writer_notify(0), m_upgrader(0) {}
+        constexpr ~FutexReadWriteLockImpl() = default;
+
+        ALWAYS_INLINE void Initialize() {}
+        ALWAYS_INLINE bool Finalize() { return false; }
+
+        ALWAYS_INLINE void Read() {
+            const std::uint32_t state = m_state.fetch_add(ReadLocked, std::memory_order_acquire);
+            V_DEBUG_ASSERT(GetReaders(state) < MaxReaders, "rwlock maximum reader count exceeded");
+
+            if ((state & ReadBlocked) != 0) UNLIKELY {
+                this->ReadContended();
+            }
+        }
+
+        ALWAYS_INLINE bool TryRead() {
+            std::uint32_t state = m_state.load(std::memory_order_relaxed);
+            while (CanRead(state, false)) {
+                if (m_state.compare_exchange_weak(state, state + ReadLocked, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        ALWAYS_INLINE void ReadUnlock() {
+            const std::uint32_t state = m_state.fetch_sub(ReadLocked, std::memory_order_release) - ReadLocked;
+            if (MustWakeAfterRead(state)) UNLIKELY {
+                this->ReaderLeft(state);
+            }
+        }
+
+        ALWAYS_INLINE void Write() {
+            std::uint32_t expected = 0;
+            if (!m_state.compare_exchange_strong(expected, WriteLocked, std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->WriteContended();
+            }
+        }
+
+        ALWAYS_INLINE bool TryWrite() {
+            std::uint32_t state = m_state.load(std::memory_order_relaxed);
+            while (CanWrite(state)) {
+                if (m_state.compare_exchange_weak(state, state | WriteLocked, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        ALWAYS_INLINE void WriteUnlock() {
+            std::uint32_t state = m_state.load(std::memory_order_relaxed);
+
+            if constexpr (Policy == ReadWritePolicy::PhaseFair) {
+                // Readers which waited during our write phase are granted the
+                // next phase, even if other writers are queued up already.
+                if ((state & ReadersWaiting) != 0) {
+                    while (!m_state.compare_exchange_weak(state, (state & ~(WriteLocked | ReadersWaiting)) | ReadPhase, std::memory_order_release, std::memory_order_relaxed)) {}
+
+                    // The phase keeps writers out until its last reader leaves. The
+                    // waiter bit may have been stale though, so unless we know that
+                    // readers are coming, end the phase ourselves. Backends which
+                    // cannot tell always take this path.
+                    if (!FutexWakeAll(m_state)) {
+                        state = m_state.load(std::memory_order_relaxed);
+                        if (IsEmptyReadPhase(state)) {
+                            this->WakeWritersOrReaders(state);
+                        }
+                    }
+                    return;
+                }
+            }
+
+            state = m_state.fetch_sub(WriteLocked, std::memory_order_release) - WriteLocked;
+            if (IsUnlocked(state) && (state & (WritersWaiting | ReadersWaiting)) != 0) UNLIKELY {
+                this->WakeWritersOrReaders(state);
+            }
+        }
+
+        ALWAYS_INLINE void UpgradableRead() {
+            std::uint32_t expected = 0;
+            if (!m_upgrader.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->LockUpgraderContended();
+            }
+            this->Read();
+        }
+
+        ALWAYS_INLINE bool TryUpgradableRead() {
+            std::uint32_t expected = 0;
+            if (!m_upgrader.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return false;
+            }
+
+            if (!this->TryRead()) {
+                this->UnlockUpgrader();
+                return false;
+            }
+
+            return true;
+        }
+
+        ALWAYS_INLINE void UpgradableUnlock() {
+            this->ReadUnlock();
+            this->UnlockUpgrader();
+        }
+
+        ALWAYS_INLINE void Upgrade() {
+            // No writer can get in while we hold our read lock, so
+            // the conversion only has to wait for the other readers.
+            std::uint32_t state = m_state.load(std::memory_order_relaxed);
+            if (GetReaders(state) != 1 ||
+                !m_state.compare_exchange_strong(state, UpgradedState(state), std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->UpgradeContended();
+            }
+        }
+
+        ALWAYS_INLINE void Downgrade() {
+            // Since the writer bit is set, this clears it and adds a reader.
+            const std::uint32_t state = m_state.fetch_add(ReadLocked - WriteLocked, std::memory_order_release);
+            if ((state & ReadersWaiting) != 0) UNLIKELY {
+                this->WakeReadersAfterDowngrade();
+            }
+        }
+    };
+
+    #if defined(V_PLATFORM_LINUX)
+    // Futexes are the native primitive on Linux, so they also back the
+    // default lock. Writer preference avoids the writer starvation that
+    // glibc's reader-preferring default is prone to.
+    using ReadWriteLockImpl = FutexReadWriteLockImpl<ReadWritePolicy::WriterPreferring>;
+    #endif
+
+}
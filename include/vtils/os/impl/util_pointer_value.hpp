@@ -22,9 +22,16 @@ namespace vtils::impl {
         { t.Finalize()   } -> std::same_as<bool>;
     };
 
+    // Types which never need to be boxed may opt into inline storage
+    // regardless of their size by declaring `static constexpr bool
+    // InlineStorage = true;`.
     template <typename T>
     ALWAYS_INLINE constexpr bool UseInlineStorageForPointerValue() {
-        return sizeof(T) <= sizeof(T*);
+        if constexpr (requires { { T::InlineStorage } -> std::convertible_to<bool>; }) {
+            return T::InlineStorage;
+        } else {
+            return sizeof(T) <= sizeof(T*);
+        }
     }
 
     template <typename T, typename = void>
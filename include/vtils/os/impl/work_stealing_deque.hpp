@@ -0,0 +1,169 @@
+/**
+ * @file work_stealing_deque.hpp
+ * @brief Chase-Lev work-stealing deque.
+ * @copyright Valentin B.
+ *
+ * The deque is owned by a single thread which pushes and takes items at
+ * the bottom end without any read-modify-write operations, except when
+ * competing for the last item. Any other thread may steal from the top
+ * end with a single compare-and-swap.
+ *
+ * The implementation follows "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" by Lê et al. When the ring buffer fills up, the
+ * owner replaces it with one of twice the size. Thieves may still read
+ * from the old buffer, so retired buffers are only freed together with
+ * the deque.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils::impl {
+
+    template <typename T> requires std::is_trivially_copyable_v<T> && std::atomic<T>::is_always_lock_free
+    class WorkStealingDeque final {
+    private:
+        struct Buffer {
+            std::int64_t mask;
+            Buffer *retired;
+            std::unique_ptr<std::atomic<T>[]> slots;
+
+            explicit Buffer(std::int64_t capacity, Buffer *retired)
+                : mask(capacity - 1), retired(retired), slots(new std::atomic<T>[static_cast<std::size_t>(capacity)]) {
+                V_DEBUG_ASSERT(IsPowerOfTwo(capacity));
+            }
+
+            ALWAYS_INLINE std::int64_t GetCapacity() const {
+                return mask + 1;
+            }
+
+            ALWAYS_INLINE T Load(std::int64_t index) const {
+                return slots[static_cast<std::size_t>(index & mask)].load(std::memory_order_relaxed);
+            }
+
+            ALWAYS_INLINE void Store(std::int64_t index, T value) {
+                slots[static_cast<std::size_t>(index & mask)].store(value, std::memory_order_relaxed);
+            }
+        };
+
+    public:
+        // The outcome of a steal attempt.
+        enum class StealResult {
+            Success,
+            Empty,
+            // Lost a race against another thread; the deque may not be empty.
+            Retry,
+        };
+
+    private:
+        alignas(CacheLineSize) std::atomic<std::int64_t> m_top;
+        alignas(CacheLineSize) std::atomic<std::int64_t> m_bottom;
+        std::atomic<Buffer *> m_buffer;
+
+    private:
+        COLD Buffer *Grow(Buffer *buffer, std::int64_t top, std::int64_t bottom) {
+            Buffer *grown = new Buffer(buffer->GetCapacity() * 2, buffer);
+            for (std::int64_t i = top; i < bottom; ++i) {
+                grown->Store(i, buffer->Load(i));
+            }
+
+            m_buffer.store(grown, std::memory_order_release);
+            return grown;
+        }
+
+    public:
+        explicit WorkStealingDeque(std::int64_t capacity = 256)
+            : m_top(0), m_bottom(0), m_buffer(new Buffer(capacity, nullptr)) {}
+
+        ~WorkStealingDeque() {
+            Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+            while (buffer != nullptr) {
+                Buffer *retired = buffer->retired;
+                delete buffer;
+                buffer = retired;
+            }
+        }
+
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+        // Checks whether the deque appears to be empty. This is only a
+        // snapshot and may be outdated by the time it returns.
+        ALWAYS_INLINE bool IsEmpty() const {
+            const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+            const std::int64_t top    = m_top.load(std::memory_order_relaxed);
+            return bottom <= top;
+        }
+
+        // Pushes an item to the bottom. Must only be called by the owner.
+        ALWAYS_INLINE void Push(T value) {
+            const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+            const std::int64_t top    = m_top.load(std::memory_order_acquire);
+            Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+
+            if (bottom - top > buffer->mask) UNLIKELY {
+                buffer = this->Grow(buffer, top, bottom);
+            }
+
+            // Publishes the item to thieves which read the bottom index.
+            buffer->Store(bottom, value);
+            m_bottom.store(bottom + 1, std::memory_order_release);
+        }
+
+        // Takes the most recently pushed item from the bottom. Must only
+        // be called by the owner.
+        ALWAYS_INLINE bool Take(T &out) {
+            const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+            Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+            m_bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+            if (top > bottom) {
+                // The deque was empty.
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            out = buffer->Load(bottom);
+            if (top == bottom) {
+                // This is the last item, so race thieves for it.
+                const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            return true;
+        }
+
+        // Steals the least recently pushed item from the top. May be called
+        // from any thread.
+        ALWAYS_INLINE StealResult Steal(T &out) {
+            std::int64_t top = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+            if (top >= bottom) {
+                return StealResult::Empty;
+            }
+
+            Buffer *buffer = m_buffer.load(std::memory_order_acquire);
+            const T value = buffer->Load(top);
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return StealResult::Retry;
+            }
+
+            out = value;
+            return StealResult::Success;
+        }
+    };
+
+}
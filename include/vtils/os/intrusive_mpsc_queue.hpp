@@ -0,0 +1,218 @@
+/**
+ * @file intrusive_mpsc_queue.hpp
+ * @brief Intrusive multi-producer, single-consumer queue.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+#include "vtils/alignment.hpp"
+#include "vtils/impl/cpu_relax.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils {
+
+    /// The link which an object needs to contain to be enqueued into an
+    /// @ref IntrusiveMpscQueue.
+    ///
+    /// An object can only be linked into one queue through a given hook at
+    /// a time. Copying an object does not copy its link.
+    class MpscHook {
+        template <typename T, MpscHook T::*Hook>
+        friend class IntrusiveMpscQueue;
+
+    private:
+        std::atomic<MpscHook *> m_next;
+        // The object which was pushed through this hook. A member pointer
+        // cannot portably be turned into an offset, so the way back from
+        // the hook to its object is recorded on every push instead.
+        void *m_owner;
+
+    public:
+        ALWAYS_INLINE constexpr MpscHook() : m_next(nullptr), m_owner(nullptr) {}
+
+        ALWAYS_INLINE constexpr MpscHook(const MpscHook &) : m_next(nullptr), m_owner(nullptr) {}
+        ALWAYS_INLINE constexpr MpscHook &operator=(const MpscHook &) { return *this; }
+    };
+
+    /// A FIFO queue of objects which are linked through an @ref MpscHook
+    /// member. Any number of threads may push objects, but only a single
+    /// consumer thread may remove them.
+    ///
+    /// The queue follows Dmitry Vyukov's intrusive MPSC design. Pushing is a
+    /// single atomic exchange and never allocates, since the link lives in
+    /// the object itself. The queue does not own its objects, which must stay
+    /// alive until the consumer has removed them.
+    ///
+    /// A push is only visible to the consumer after the producer has stored
+    /// its link, a moment after the exchange. A producer which is preempted
+    /// in between briefly hides all elements pushed after it.
+    ///
+    /// @tparam T    The type of the queued objects.
+    /// @tparam Hook The member of `T` that links objects together.
+    template <typename T, MpscHook T::*Hook>
+    class IntrusiveMpscQueue {
+    public:
+        // Copying queues is an error hazard since the point is to
+        // pass objects between threads through a common chain.
+        IntrusiveMpscQueue(const IntrusiveMpscQueue &) = delete;
+        IntrusiveMpscQueue &operator=(const IntrusiveMpscQueue &) = delete;
+
+    private:
+        // The most recently pushed link, written by producers.
+        std::atomic<MpscHook *> m_head;
+
+        // The oldest link in the queue, owned by the consumer.
+        alignas(CacheLineSize) MpscHook *m_tail;
+        // Whether the stub is part of the chain. Only the consumer pushes the
+        // stub and moves past it, so this is tracked by the consumer alone.
+        bool m_stub_linked;
+        // A dummy link which keeps the chain from ever becoming empty.
+        MpscHook m_stub;
+
+    private:
+        // The owner was written before the hook was published, so it is
+        // visible to the consumer which reached the hook through the chain.
+        ALWAYS_INLINE static T *FromHook(MpscHook *hook) {
+            return static_cast<T *>(hook->m_owner);
+        }
+
+        ALWAYS_INLINE void PushHook(MpscHook *hook) {
+            hook->m_next.store(nullptr, std::memory_order_relaxed);
+            MpscHook *prev = m_head.exchange(hook, std::memory_order_acq_rel);
+            prev->m_next.store(hook, std::memory_order_release);
+        }
+
+        // Waits for the producer which pushed after `hook` to link it.
+        // Must only be called when `hook` is known not to be the head.
+        ALWAYS_INLINE static MpscHook *WaitForNext(MpscHook *hook) {
+            MpscHook *next;
+            while ((next = hook->m_next.load(std::memory_order_acquire)) == nullptr) {
+                impl::CpuRelax();
+            }
+            return next;
+        }
+
+    public:
+        /// Constructs an empty queue.
+        ALWAYS_INLINE IntrusiveMpscQueue()
+            : m_head(std::addressof(m_stub)), m_tail(std::addressof(m_stub)), m_stub_linked(true), m_stub() {}
+
+        /// Adds an object to the end of the queue. May be called from any thread.
+        ///
+        /// @param object The object to add, which must not currently be queued.
+        ALWAYS_INLINE void Push(T &object) {
+            MpscHook *hook = std::addressof(object.*Hook);
+            hook->m_owner = std::addressof(object);
+            this->PushHook(hook);
+        }
+
+        /// Checks whether the queue appears to be empty. Must only be called
+        /// by the consumer.
+        ALWAYS_INLINE bool IsEmpty() const {
+            return m_tail == std::addressof(m_stub)
+                && m_stub.m_next.load(std::memory_order_acquire) == nullptr;
+        }
+
+        /// Attempts to remove the object at the front of the queue. Must only
+        /// be called by the consumer.
+        ///
+        /// @return The removed object, or `nullptr` when the queue is empty or
+        ///         the next push is not fully visible yet.
+        T *TryPop() {
+            MpscHook *tail = m_tail;
+            MpscHook *next = tail->m_next.load(std::memory_order_acquire);
+
+            if (tail == std::addressof(m_stub)) {
+                if (next == nullptr) {
+                    return nullptr;
+                }
+
+                m_tail = tail = next;
+                m_stub_linked = false;
+                next = next->m_next.load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr) {
+                m_tail = next;
+                return FromHook(tail);
+            }
+
+            // `tail` is the last element, unless a push is in progress. We can
+            // only hand it out when something follows it, so push the stub.
+            if (tail != m_head.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            this->PushHook(std::addressof(m_stub));
+            m_stub_linked = true;
+
+            next = tail->m_next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                m_tail = next;
+                return FromHook(tail);
+            }
+
+            return nullptr;
+        }
+
+        /// Removes all objects from the queue in one go and calls `fn` on
+        /// each of them in FIFO order. Must only be called by the consumer.
+        ///
+        /// The current chain is detached with a single atomic exchange, so
+        /// objects pushed while `fn` runs are left for the next call. `fn`
+        /// may push the object it was passed back into the queue.
+        ///
+        /// @param fn The callable to invoke with every object as `T &`.
+        /// @return The number of removed objects.
+        template <class Fn> requires std::is_invocable_v<Fn&, T&>
+        std::size_t DrainAll(Fn &&fn) {
+            MpscHook *stub = std::addressof(m_stub);
+            MpscHook *node = m_tail;
+            std::size_t count = 0;
+
+            // The stub becomes the new end of the chain, so it must not still
+            // be part of the old one. Deliver everything up to it and step over.
+            if (m_stub_linked) {
+                while (node != stub) {
+                    MpscHook *next = WaitForNext(node);
+                    m_tail = next;
+                    std::invoke(fn, *FromHook(node));
+                    node = next;
+                    ++count;
+                }
+
+                node = stub->m_next.load(std::memory_order_acquire);
+                if (node == nullptr) {
+                    if (m_head.load(std::memory_order_acquire) == stub) {
+                        return count;
+                    }
+                    node = WaitForNext(stub);
+                }
+
+                m_tail = node;
+                m_stub_linked = false;
+            }
+
+            // Swap out the whole chain and terminate it with the stub.
+            this->PushHook(stub);
+            m_stub_linked = true;
+
+            while (node != stub) {
+                MpscHook *next = WaitForNext(node);
+                m_tail = next;
+                std::invoke(fn, *FromHook(node));
+                node = next;
+                ++count;
+            }
+
+            return count;
+        }
+    };
+
+}
@@ -0,0 +1,288 @@
+/**
+ * @file io_uring.hpp
+ * @brief Asynchronous file I/O for coroutines on top of Linux io_uring.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include <linux/io_uring.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils {
+
+    class IoUring;
+
+    /// A file which I/O operations are performed on.
+    ///
+    /// This is either a plain file descriptor, or the index of a file that
+    /// was registered with @ref IoUring::RegisterFiles. Registered files
+    /// spare the kernel from looking up and reference counting the file
+    /// on every single operation.
+    class IoFile {
+        friend class IoOperation;
+
+    private:
+        int m_fd;
+        bool m_registered;
+
+    private:
+        ALWAYS_INLINE constexpr IoFile(int fd, bool registered) : m_fd(fd), m_registered(registered) {}
+
+    public:
+        /// Refers to a file by its descriptor.
+        ALWAYS_INLINE constexpr IoFile(int fd) : IoFile(fd, false) {}
+
+        /// Refers to a file by its index in the registered file table.
+        ALWAYS_INLINE static constexpr IoFile Registered(unsigned index) {
+            return IoFile(static_cast<int>(index), true);
+        }
+    };
+
+    /// The awaitable for a single I/O operation on an @ref IoUring.
+    ///
+    /// Awaiting it queues the operation for submission and suspends the
+    /// coroutine, which is resumed by the thread driving the ring once the
+    /// operation completes. The awaitable lives in the frame of the awaiting
+    /// coroutine, so operations never allocate. It must be awaited right away.
+    ///
+    /// The result is what the corresponding system call would return, or
+    /// the negated `errno` value on failure. For example, a read produces
+    /// the number of bytes read and an open produces the new descriptor.
+    class IoOperation {
+        friend class IoUring;
+
+    public:
+        // Copying operations is an error hazard since the ring
+        // refers to them by address until they complete.
+        IoOperation(const IoOperation &) = delete;
+        IoOperation &operator=(const IoOperation &) = delete;
+
+    private:
+        IoUring &m_ring;
+        // The next operation which is waiting for room in the submission ring.
+        IoOperation *m_next;
+        std::coroutine_handle<> m_handle;
+
+        // Arguments for the submission queue entry.
+        std::uint64_t m_addr;
+        std::uint64_t m_offset;
+        std::uint32_t m_len;
+        std::uint32_t m_op_flags;
+        std::int32_t m_fd;
+        std::uint16_t m_buf_index;
+        std::uint8_t m_opcode;
+        std::uint8_t m_flags;
+
+        std::int32_t m_result;
+
+    private:
+        ALWAYS_INLINE IoOperation(IoUring &ring, std::uint8_t opcode, IoFile file,
+                                  const void *addr, std::size_t len, std::uint64_t offset,
+                                  std::uint32_t op_flags = 0, unsigned buf_index = 0)
+            : m_ring(ring), m_next(nullptr), m_handle(),
+              m_addr(reinterpret_cast<std::uintptr_t>(addr)), m_offset(offset),
+              m_len(static_cast<std::uint32_t>(len)), m_op_flags(op_flags), m_fd(file.m_fd),
+              m_buf_index(static_cast<std::uint16_t>(buf_index)),
+              m_opcode(opcode), m_flags(file.m_registered ? IOSQE_FIXED_FILE : 0), m_result(0) {
+            // Submission entries only have room for 32-bit lengths.
+            V_ASSERT(len <= std::numeric_limits<std::uint32_t>::max(), "io_uring operations are limited to 4 GiB");
+        }
+
+    public:
+        ALWAYS_INLINE bool await_ready() const {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        ALWAYS_INLINE std::int32_t await_resume() const {
+            return m_result;
+        }
+    };
+
+    /// An engine for asynchronous file I/O based on the io_uring interface
+    /// of the Linux kernel.
+    ///
+    /// The kernel and the process share a submission ring and a completion
+    /// ring. Operations are prepared in place in the submission ring and
+    /// handed over to the kernel in batches, so a single system call starts
+    /// any number of reads and writes and reaps their completions. The ring
+    /// is set up with raw system calls and does not depend on liburing.
+    ///
+    /// Unlike a @ref MemoryMapped file, where touching a cold page blocks
+    /// the thread on a page fault without warning, reads are explicit and
+    /// the thread keeps running other coroutines while they are in flight.
+    ///
+    /// A ring is owned by a single thread, which awaits operations from its
+    /// coroutines and calls @ref Submit, @ref Poll or @ref Wait to make
+    /// progress. Awaiting an operation only queues it. Nothing is passed to
+    /// the kernel until the next call to one of these, which then submits
+    /// everything queued so far at once. Coroutines are resumed from within
+    /// @ref Poll and @ref Wait and may await further operations right away.
+    class IoUring {
+        friend class IoOperation;
+
+    public:
+        // Copying rings is an error hazard since they own
+        // kernel resources and the operations in flight.
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+
+    private:
+        int m_fd;
+
+        // The memory shared with the kernel.
+        void *m_sq_ring;
+        void *m_cq_ring;
+        io_uring_sqe *m_sqes;
+        std::size_t m_sq_ring_size;
+        std::size_t m_cq_ring_size;
+
+        // The submission ring. Entries up to the local tail have been
+        // prepared, but are only published to the kernel on submission.
+        std::uint32_t *m_sq_head;
+        std::uint32_t *m_sq_tail;
+        std::uint32_t m_sq_mask;
+        std::uint32_t m_sq_entries;
+        std::uint32_t m_sq_local_tail;
+
+        // The completion ring.
+        std::uint32_t *m_cq_head;
+        std::uint32_t *m_cq_tail;
+        std::uint32_t m_cq_mask;
+        io_uring_cqe *m_cqes;
+
+        // Operations which were awaited while the submission ring was full.
+        IoOperation *m_backlog_head;
+        IoOperation *m_backlog_tail;
+        std::size_t m_backlog_count;
+        std::size_t m_in_flight;
+
+    private:
+        void Close();
+        void Enqueue(IoOperation &op);
+        bool TryPrepare(IoOperation &op);
+        void FlushBacklog();
+        std::size_t Reap();
+        std::uint32_t Enter(std::uint32_t to_submit, std::uint32_t min_complete);
+        void Register(unsigned opcode, const void *arg, unsigned count);
+
+    public:
+        /// Sets up a new ring.
+        ///
+        /// @param entries The number of submission ring entries, which the
+        ///                kernel rounds up to a power of two. More operations
+        ///                may be awaited at once, and the surplus is submitted
+        ///                as entries become free.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        explicit IoUring(unsigned entries = 256);
+
+        /// Tears down the ring. No operations may be in flight.
+        ~IoUring();
+
+        /// Gets the number of awaited operations which did not complete yet.
+        ALWAYS_INLINE std::size_t GetInFlightCount() const {
+            return m_in_flight;
+        }
+
+        /// Reads from `file` at `offset` into `buffer`.
+        ALWAYS_INLINE IoOperation Read(IoFile file, std::span<std::byte> buffer, std::uint64_t offset) {
+            return IoOperation(*this, IORING_OP_READ, file, buffer.data(), buffer.size(), offset);
+        }
+
+        /// Writes `buffer` to `file` at `offset`.
+        ALWAYS_INLINE IoOperation Write(IoFile file, std::span<const std::byte> buffer, std::uint64_t offset) {
+            return IoOperation(*this, IORING_OP_WRITE, file, buffer.data(), buffer.size(), offset);
+        }
+
+        /// Reads from `file` at `offset` into `buffer`, which must lie within
+        /// the registered buffer at `buffer_index`.
+        ///
+        /// The kernel keeps the pages of registered buffers pinned, which
+        /// saves mapping them in for every single operation.
+        ALWAYS_INLINE IoOperation ReadFixed(IoFile file, std::span<std::byte> buffer, std::uint64_t offset,
+                                            unsigned buffer_index) {
+            return IoOperation(*this, IORING_OP_READ_FIXED, file, buffer.data(), buffer.size(), offset, 0, buffer_index);
+        }
+
+        /// Writes `buffer` to `file` at `offset`. The buffer must lie within
+        /// the registered buffer at `buffer_index`.
+        ALWAYS_INLINE IoOperation WriteFixed(IoFile file, std::span<const std::byte> buffer, std::uint64_t offset,
+                                             unsigned buffer_index) {
+            return IoOperation(*this, IORING_OP_WRITE_FIXED, file, buffer.data(), buffer.size(), offset, 0, buffer_index);
+        }
+
+        /// Flushes the data of `file` to storage, along with its metadata
+        /// unless `data_only` is set.
+        ALWAYS_INLINE IoOperation Fsync(IoFile file, bool data_only = false) {
+            return IoOperation(*this, IORING_OP_FSYNC, file, nullptr, 0, 0, data_only ? IORING_FSYNC_DATASYNC : 0);
+        }
+
+        /// Opens the file at `path`, relative to the directory `dir_fd`, and
+        /// produces its new descriptor. `path` must stay valid until the
+        /// operation completes.
+        ALWAYS_INLINE IoOperation OpenAt(int dir_fd, const char *path, int flags, mode_t mode = 0) {
+            return IoOperation(*this, IORING_OP_OPENAT, dir_fd, path, mode, 0, static_cast<std::uint32_t>(flags));
+        }
+
+        /// Registers buffers for use with @ref ReadFixed and @ref WriteFixed.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        void RegisterBuffers(std::span<const iovec> buffers);
+
+        /// Unregisters all buffers. No fixed operations may be in flight.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        void UnregisterBuffers();
+
+        /// Registers file descriptors, which can then be referred to by their
+        /// index in `fds` through @ref IoFile::Registered.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        void RegisterFiles(std::span<const int> fds);
+
+        /// Unregisters all files.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        void UnregisterFiles();
+
+        /// Hands all queued operations over to the kernel without waiting.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        /// @return The number of submitted operations.
+        std::size_t Submit();
+
+        /// Resumes the coroutines of all operations which completed so far
+        /// and submits all queued operations, without waiting.
+        ///
+        /// Operations awaited by the resumed coroutines are submitted too.
+        /// The kernel is only entered when there is anything to submit.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        /// @return The number of completed operations.
+        std::size_t Poll();
+
+        /// Submits all queued operations, blocks until at least `min_complete`
+        /// operations have completed, and resumes their coroutines.
+        ///
+        /// The wait is capped to the number of operations the kernel knows
+        /// of, so this never blocks forever when there is nothing left to
+        /// complete.
+        ///
+        /// \throws std::system_error When the kernel reported an error.
+        /// @return The number of completed operations.
+        std::size_t Wait(std::size_t min_complete = 1);
+    };
+
+}
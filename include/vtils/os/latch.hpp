@@ -0,0 +1,150 @@
+/**
+ * @file latch.hpp
+ * @brief Single-use countdown latches built directly on futexes.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    /// A single-use barrier which releases waiting threads once a counter
+    /// has been decremented to zero.
+    ///
+    /// Typical uses are waiting for a number of tasks to finish, or holding
+    /// back a group of threads until initialization is complete. Once open,
+    /// the latch stays open and cannot be reset.
+    ///
+    /// The counter and a flag for sleeping waiters share a single futex word,
+    /// so counting down does not enter the kernel unless someone is waiting.
+    class Latch {
+    public:
+        // Copying latches is an error hazard since the point is
+        // to synchronize threads through a common counter.
+        Latch(const Latch &) = delete;
+        Latch &operator=(const Latch &) = delete;
+
+    public:
+        /// The maximum initial count of a latch.
+        static constexpr std::uint32_t Max = (1u << 31) - 1;
+
+    private:
+        static constexpr std::uint32_t Waiters   = 1u << 31;
+        static constexpr std::uint32_t CountMask = Waiters - 1;
+
+    private:
+        std::atomic<std::uint32_t> m_state;
+
+    private:
+        COLD void Wake() {
+            impl::FutexWakeAll(m_state);
+        }
+
+        // Returns `false` on timeout. Waits indefinitely without a deadline.
+        COLD bool WaitSlow(const std::chrono::steady_clock::time_point *deadline) {
+            std::uint32_t state = m_state.load(std::memory_order_acquire);
+            while ((state & CountMask) != 0) {
+                // Announce that we are going to sleep before doing so.
+                if ((state & Waiters) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | Waiters, std::memory_order_acquire, std::memory_order_acquire)) {
+                        continue;
+                    }
+                    state |= Waiters;
+                }
+
+                if (deadline != nullptr) {
+                    if (!impl::FutexWaitUntil(m_state, state, *deadline)) {
+                        return this->TryWait();
+                    }
+                } else {
+                    impl::FutexWait(m_state, state);
+                }
+
+                state = m_state.load(std::memory_order_acquire);
+            }
+
+            return true;
+        }
+
+    public:
+        /// Constructs a latch which opens after `count` decrements.
+        ALWAYS_INLINE constexpr explicit Latch(std::uint32_t count) : m_state(count) {
+            V_DEBUG_ASSERT(count <= Max, "latch count out of range");
+        }
+
+        /// Decrements the counter by `n`, releasing all waiting threads
+        /// when it reaches zero.
+        ///
+        /// The counter must not be decremented past zero.
+        ///
+        /// @param n The amount to decrement the counter by.
+        ALWAYS_INLINE void CountDown(std::uint32_t n = 1) {
+            const std::uint32_t state = m_state.fetch_sub(n, std::memory_order_release);
+            V_DEBUG_ASSERT((state & CountMask) >= n, "latch counted down past zero");
+
+            if (state == (n | Waiters)) UNLIKELY {
+                this->Wake();
+            }
+        }
+
+        /// Checks whether the counter has reached zero, without blocking.
+        ALWAYS_INLINE bool TryWait() const {
+            return (m_state.load(std::memory_order_acquire) & CountMask) == 0;
+        }
+
+        /// Blocks the current thread until the counter reaches zero.
+        ALWAYS_INLINE void Wait() {
+            if (!this->TryWait()) UNLIKELY {
+                this->WaitSlow(nullptr);
+            }
+        }
+
+        /// Blocks the current thread until the counter reaches zero or the
+        /// given point in time has been reached.
+        ///
+        /// @param time The deadline to wait until.
+        /// @return `true` when the latch is open, `false` on timeout.
+        template <class Clock, class Duration>
+        ALWAYS_INLINE bool WaitUntil(const std::chrono::time_point<Clock, Duration> &time) {
+            if (this->TryWait()) {
+                return true;
+            }
+
+            const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time - Clock::now());
+            return this->WaitSlow(std::addressof(end));
+        }
+
+        /// Blocks the current thread until the counter reaches zero or the
+        /// given duration has elapsed.
+        ///
+        /// @param time The duration to wait for.
+        /// @return `true` when the latch is open, `false` on timeout.
+        template <class Rep, class Period>
+        ALWAYS_INLINE bool WaitFor(const std::chrono::duration<Rep, Period> &time) {
+            if (this->TryWait()) {
+                return true;
+            }
+
+            const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time);
+            return this->WaitSlow(std::addressof(end));
+        }
+
+        /// Decrements the counter by `n` and then blocks the current thread
+        /// until it reaches zero.
+        ///
+        /// @param n The amount to decrement the counter by.
+        ALWAYS_INLINE void ArriveAndWait(std::uint32_t n = 1) {
+            this->CountDown(n);
+            this->Wait();
+        }
+    };
+
+}
@@ -0,0 +1,175 @@
+/**
+ * @file lock_profiling.hpp
+ * @brief Opt-in contention profiling for locks.
+ * @copyright Valentin B.
+ *
+ * When `V_ENABLE_LOCK_PROFILING` is defined, every acquisition of a
+ * @ref Mutex or @ref ReadWriteLock is attributed to the source location
+ * of the `Lock()`, `Read()`, `Write()` or `UpgradableRead()` call that
+ * performed it. For each such lock site, the profiler records how often
+ * the lock was acquired, how often the caller had to wait, histograms of
+ * wait and hold times, and which other lock sites held the lock while the
+ * caller was waiting.
+ *
+ * The macro must be defined consistently for vtils itself and all code
+ * using it, which is best done through the `VTILS_OPT_LOCK_PROFILING`
+ * CMake option. When it is not defined, none of the instrumentation is
+ * compiled in and the report functions do nothing.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+    #include <atomic>
+    #include <chrono>
+    #include <source_location>
+#endif
+
+#include "vtils/macros/attr.hpp"
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+    // Declares the call site parameter of a profiled lock operation.
+    #define V_LOCK_SITE_PARAMETER const std::source_location &site = std::source_location::current()
+    // Names the call site parameter in out-of-class definitions.
+    #define V_LOCK_SITE_PARAMETER_DEF const std::source_location &site
+#else
+    #define V_LOCK_SITE_PARAMETER
+    #define V_LOCK_SITE_PARAMETER_DEF
+#endif
+
+namespace vtils {
+
+    /// The number of buckets in wait and hold time histograms.
+    ///
+    /// Bucket `i` counts durations of less than `2^i` nanoseconds which
+    /// did not fit the previous bucket; the last one collects all others.
+    constexpr inline std::size_t LockHistogramBuckets = 32;
+
+    /// A lock site which held a lock while another site waited for it.
+    struct LockContender {
+        std::string_view file;
+        std::string_view function;
+        std::uint32_t line;
+        std::uint64_t count;
+    };
+
+    /// Profiling data collected for a single lock site.
+    struct LockSiteProfile {
+        std::string_view file;
+        std::string_view function;
+        std::uint32_t line;
+        std::uint32_t column;
+
+        std::uint64_t acquisitions;
+        std::uint64_t contended;
+        std::uint64_t total_wait_ns;
+        std::uint64_t max_wait_ns;
+        std::uint64_t total_hold_ns;
+
+        std::array<std::uint64_t, LockHistogramBuckets> wait_histogram;
+        std::array<std::uint64_t, LockHistogramBuckets> hold_histogram;
+
+        /// The sites which most often held the lock while this one waited,
+        /// ordered by how often that happened.
+        std::vector<LockContender> top_contenders;
+    };
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+
+    /// Takes a snapshot of all lock sites seen so far, sorted by the total
+    /// time spent waiting for the lock in descending order.
+    std::vector<LockSiteProfile> CollectLockProfile();
+
+    /// Writes a human-readable report of @ref CollectLockProfile to `out`.
+    ///
+    /// @param out   The stream to write to.
+    /// @param limit The maximum number of lock sites to report.
+    void DumpLockProfile(std::FILE *out = stderr, std::size_t limit = SIZE_MAX);
+
+    /// Resets the collected statistics of all lock sites to zero.
+    void ResetLockProfile();
+
+#else
+
+    inline std::vector<LockSiteProfile> CollectLockProfile() { return {}; }
+    inline void DumpLockProfile(std::FILE * = stderr, std::size_t = SIZE_MAX) {}
+    inline void ResetLockProfile() {}
+
+#endif
+
+}
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+
+namespace vtils::impl {
+
+    struct LockSite;
+
+    LockSite *GetLockSite(const std::source_location &location);
+    void RecordLockAcquire(LockSite *site, std::uint64_t wait_ns, bool contended, LockSite *holder);
+    void RecordLockRelease(LockSite *site, std::uint64_t hold_ns);
+
+    ALWAYS_INLINE std::uint64_t LockProfileNow() {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+
+    // Identifies an acquisition so that its hold time can be recorded.
+    // Acquisitions through the non-blocking `Try*` functions are not
+    // attributed to a site and leave it empty.
+    struct LockProfileToken {
+        LockSite *site = nullptr;
+        std::uint64_t acquired = 0;
+
+        ALWAYS_INLINE void Release() const {
+            if (site != nullptr) {
+                RecordLockRelease(site, LockProfileNow() - acquired);
+            }
+        }
+
+        // Restarts the hold time when the lock is reacquired after it was
+        // temporarily released, e.g. while waiting on a condition variable.
+        ALWAYS_INLINE void Resume() {
+            acquired = LockProfileNow();
+        }
+    };
+
+    // Per-lock profiling state, embedded into every instrumented lock.
+    class LockProfileState final {
+    private:
+        // The site which acquired the lock most recently. For shared
+        // locks, this is just one of potentially many holders.
+        std::atomic<LockSite *> m_holder;
+
+    public:
+        constexpr LockProfileState() : m_holder(nullptr) {}
+
+        template <typename TryFn, typename LockFn>
+        ALWAYS_INLINE LockProfileToken Acquire(const std::source_location &location, TryFn &&try_lock, LockFn &&lock) {
+            LockSite *site = GetLockSite(location);
+            const std::uint64_t start = LockProfileNow();
+
+            bool contended   = false;
+            LockSite *holder = nullptr;
+            if (!try_lock()) {
+                contended = true;
+                holder    = m_holder.load(std::memory_order_relaxed);
+                lock();
+            }
+
+            const std::uint64_t now = LockProfileNow();
+            RecordLockAcquire(site, now - start, contended, holder);
+            m_holder.store(site, std::memory_order_relaxed);
+
+            return { site, now };
+        }
+    };
+
+}
+
+#endif
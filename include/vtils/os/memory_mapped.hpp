@@ -6,6 +6,7 @@
 #pragma once
 
 #include <system_error>
+#include <type_traits>
 
 #include "vtils/assert.hpp"
 #include "vtils/macros/misc.hpp"
@@ -27,6 +28,48 @@ namespace vtils {
         ReadWrite,
     };
 
+    /// Hints about how a mapped memory region is going to be accessed.
+    ///
+    /// These let the OS tune readahead and caching of the underlying file to
+    /// the workload. They never change the contents of the mapping, so an
+    /// unsupported hint is simply ignored on the respective platform.
+    enum class Access {
+        /// No particular access pattern; restores the default behavior.
+        Normal,
+        /// The region is read front to back, so pages should be read ahead
+        /// aggressively and may be freed soon after they were accessed.
+        Sequential,
+        /// The region is accessed in no particular order, so reading ahead
+        /// of the accessed pages is pointless.
+        Random,
+        /// The region will be accessed soon, so its pages should be brought
+        /// into memory in the background right away.
+        WillNeed,
+        /// The region will not be accessed anytime soon, so its pages may be
+        /// dropped from the mapping. They are read back in on next access.
+        DontNeed,
+        /// Like @ref Access::DontNeed, but the pages are also reclaimed from
+        /// memory where possible, which frees their memory for good.
+        Free,
+    };
+
+    /// Sizes of the pages which back a mapped memory region.
+    enum class PageSize {
+        /// The base page size of the system.
+        Default,
+        /// Huge pages where available, which cover a lot more memory with a
+        /// single TLB entry. Useful for large, randomly accessed regions.
+        ///
+        /// Files on hugetlbfs are always mapped with huge pages. Files on
+        /// tmpfs mounts with huge pages enabled are set up for transparent
+        /// huge pages, and so are read-only mappings of files on any other
+        /// file system when transparent huge pages are enabled. Writable
+        /// mappings of those cannot use huge pages, so the mapping silently
+        /// falls back to regular pages, which @ref MemoryMapped::GetPageSize
+        /// reports.
+        Huge,
+    };
+
     /// Representation of a memory mapping backed by an underlying file.
     ///
     /// The given @ref AccessMode specifies how the file can be interacted
@@ -35,7 +78,7 @@ namespace vtils {
     class MemoryMapped {
     private:
         using HandleType = decltype(impl::GetFileHandle(std::declval<FILE *>()));
-        using ErrorCode = decltype(impl::MmapResultSuccess);
+        using ErrorCode = std::remove_const_t<decltype(impl::MmapResultSuccess)>;
 
         static constexpr ErrorCode Success = impl::MmapResultSuccess;
 
@@ -49,7 +92,7 @@ namespace vtils {
             return impl::GetFileHandle(file);
         }
 
-        ALWAYS_INLINE ErrorCode MapImpl(HandleType handle, std::size_t offset, std::size_t len) {
+        ALWAYS_INLINE ErrorCode MapImpl(HandleType handle, std::size_t offset, std::size_t len, PageSize page_size) {
         #if defined(V_PLATFORM_WINDOWS)
             DWORD access  = FILE_MAP_READ;
             DWORD protect = PAGE_READONLY;
@@ -67,10 +110,64 @@ namespace vtils {
             }
         #endif
 
-            return m_impl.Map(handle, protect, access, offset, len);
+            return m_impl.Map(handle, protect, access, offset, len, page_size == PageSize::Huge);
         }
 
-        ALWAYS_INLINE ErrorCode MapWithOffsetImpl(HandleType handle, std::size_t offset) {
+        ALWAYS_INLINE ErrorCode AdviseImpl(std::size_t offset, std::size_t len, Access access) {
+        #if defined(V_PLATFORM_WINDOWS)
+            switch (access) {
+                case Access::WillNeed:
+                    return m_impl.Prefetch(offset, len);
+                case Access::DontNeed:
+                case Access::Free:
+                    return m_impl.Evict(offset, len);
+                default:
+                    // Access patterns can only be hinted when opening a file.
+                    return Success;
+            }
+        #else
+            int advice = MADV_NORMAL;
+            switch (access) {
+                case Access::Normal:
+                    advice = MADV_NORMAL;
+                    break;
+                case Access::Sequential:
+                    advice = MADV_SEQUENTIAL;
+                    break;
+                case Access::Random:
+                    advice = MADV_RANDOM;
+                    break;
+                case Access::WillNeed:
+                    advice = MADV_WILLNEED;
+                    break;
+                case Access::DontNeed:
+                    advice = MADV_DONTNEED;
+                    break;
+                case Access::Free:
+                #if defined(MADV_PAGEOUT)
+                    advice = MADV_PAGEOUT;
+                #else
+                    advice = MADV_DONTNEED;
+                #endif
+                    break;
+            }
+
+            return m_impl.Advise(offset, len, advice);
+        #endif
+        }
+
+        ALWAYS_INLINE void FinishMap(ErrorCode res, Access access) {
+            // Apply the hint before the mapping is handed out to the caller.
+            const auto final_res = (res == Success && access != Access::Normal)
+                ? this->AdviseImpl(0, this->GetLength(), access)
+                : res;
+
+            if (final_res != Success) {
+                throw std::system_error(final_res, std::generic_category(), "failed to map file into memory");
+            }
+        }
+
+        ALWAYS_INLINE ErrorCode MapWithOffsetImpl(HandleType handle, std::size_t offset, PageSize page_size) {
             // Attempt to query the byte size for the given file.
             std::uint64_t size;
             if (auto res = impl::GetFileSize(handle, std::addressof(size)); res != impl::MmapResultSuccess) {
@@ -89,7 +186,7 @@ namespace vtils {
             }
 
             // Map the file into memory.
-            return this->MapImpl(handle, offset, len);
+            return this->MapImpl(handle, offset, len, page_size);
         }
 
     public:
@@ -101,39 +198,44 @@ namespace vtils {
 
         /// Maps the full range of a file into memory.
         ///
+        /// The given @ref Access hint is applied to the whole mapping, as
+        /// if by @ref Advise, before any of its pages are touched. The page
+        /// size which was obtained can be queried with @ref GetPageSize.
+        ///
         /// \throws std::system_error When the OS reported an error.
-        ALWAYS_INLINE static MemoryMapped Map(FILE *file) {
+        ALWAYS_INLINE static MemoryMapped Map(FILE *file, Access access = Access::Normal, PageSize page_size = PageSize::Default) {
             MemoryMapped mapped{};
-
-            if (const auto res = mapped.MapWithOffsetImpl(MemoryMapped::GetFileHandle(file), 0); res != Success) {
-                throw std::system_error(res, std::generic_category(), "failed to map file into memory");
-            }
+            mapped.FinishMap(mapped.MapWithOffsetImpl(MemoryMapped::GetFileHandle(file), 0, page_size), access);
 
             return mapped;
         }
 
         /// Maps a file into memory, given a start offset for the mapping.
         ///
+        /// The given @ref Access hint is applied to the whole mapping, as
+        /// if by @ref Advise, before any of its pages are touched. The page
+        /// size which was obtained can be queried with @ref GetPageSize.
+        ///
         /// \throws std::system_error When the OS reported an error.
-        ALWAYS_INLINE static MemoryMapped MapWithOffset(FILE *file, std::size_t offset) {
+        ALWAYS_INLINE static MemoryMapped MapWithOffset(FILE *file, std::size_t offset, Access access = Access::Normal,
+                                                        PageSize page_size = PageSize::Default) {
             MemoryMapped mapped{};
-
-            if (const auto res = mapped.MapWithOffsetImpl(MemoryMapped::GetFileHandle(file), offset); res != Success) {
-                throw std::system_error(res, std::generic_category(), "failed to map file into memory");
-            }
+            mapped.FinishMap(mapped.MapWithOffsetImpl(MemoryMapped::GetFileHandle(file), offset, page_size), access);
 
             return mapped;
         }
 
         /// Maps a file into memory, given a start offset and length for the mapping.
         ///
+        /// The given @ref Access hint is applied to the whole mapping, as
+        /// if by @ref Advise, before any of its pages are touched. The page
+        /// size which was obtained can be queried with @ref GetPageSize.
+        ///
         /// \throws std::system_error When the OS reported an error.
-        ALWAYS_INLINE static MemoryMapped MapWithOffsetAndLength(FILE *file, std::size_t offset, std::size_t len) {
+        ALWAYS_INLINE static MemoryMapped MapWithOffsetAndLength(FILE *file, std::size_t offset, std::size_t len,
+                                                                 Access access = Access::Normal, PageSize page_size = PageSize::Default) {
             MemoryMapped mapped{};
-
-            if (const auto res = mapped.MapImpl(MemoryMapped::GetFileHandle(file), offset, len); res != Success) {
-                throw std::system_error(res, std::generic_category(), "failed to map file into memory");
-            }
+            mapped.FinishMap(mapped.MapImpl(MemoryMapped::GetFileHandle(file), offset, len, page_size), access);
 
             return mapped;
         }
@@ -154,6 +256,16 @@ namespace vtils {
             return m_impl.GetLength();
         }
 
+        /// Gets the size in bytes of the pages which back the mapped memory
+        /// region.
+        ///
+        /// For transparent huge pages, this is the size the mapping was set
+        /// up for. The kernel may still use regular pages for parts of it,
+        /// e.g. until it finds the time to assemble the huge pages.
+        ALWAYS_INLINE std::size_t GetPageSize() const {
+            return m_impl.GetPageSize();
+        }
+
         /// Flushes outstanding memory modifications to disk.
         ///
         /// When the method does not error, it is guaranteed that all outstanding
@@ -181,6 +293,27 @@ namespace vtils {
                 throw std::system_error(res, std::generic_category(), "failed to flush memory mapping to disk");
             }
         }
+
+        /// Hints at how a range of the mapped memory region is going to be
+        /// accessed.
+        ///
+        /// The range is widened to whole pages as necessary. This is purely
+        /// advisory and never affects the contents of the mapping, although
+        /// @ref Access::DontNeed and @ref Access::Free may cause the range
+        /// to be read from the file again on next access.
+        ///
+        /// @param offset The start offset of the range in the mapping.
+        /// @param len    The length in bytes of the range.
+        /// @param access The expected access pattern for the range.
+        ///
+        /// \throws std::system_error When the OS reported an error.
+        ALWAYS_INLINE void Advise(std::size_t offset, std::size_t len, Access access) {
+            V_ASSERT(offset <= this->GetLength() && len <= this->GetLength() - offset);
+
+            if (const auto res = this->AdviseImpl(offset, len, access); res != Success) {
+                throw std::system_error(res, std::generic_category(), "failed to advise on memory mapping");
+            }
+        }
     };
 
     /// A read-only mapping of a file into memory.
@@ -0,0 +1,312 @@
+/**
+ * @file mpmc_queue.hpp
+ * @brief Bounded lock-free multi-producer, multi-consumer queue.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/alignment.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/event_count.hpp"
+
+namespace vtils {
+
+    /// A bounded FIFO queue which any number of threads may push to and
+    /// pop from concurrently, without locks.
+    ///
+    /// The queue is a ring buffer of slots that each carry a sequence number,
+    /// following Dmitry Vyukov's design. A sequence number tells whether its
+    /// slot is ready to be written or read in the current lap around the ring.
+    /// Producers and consumers claim slots by advancing their own position with
+    /// a single compare-and-swap. The positions sit on separate cache lines, so
+    /// the two sides only meet at the slots themselves.
+    ///
+    /// Besides the non-blocking `TryPush` and `TryPop`, the blocking `Push` and
+    /// `Pop` sleep while the queue is full or empty. Sleeping threads register
+    /// themselves first, so the other side only wakes them through the kernel
+    /// when anyone actually waits. Otherwise, checking for them costs a plain
+    /// load and no fence.
+    ///
+    /// @tparam T The type of the elements, which must be nothrow movable.
+    template <typename T> requires std::is_nothrow_move_constructible_v<T> && std::is_nothrow_destructible_v<T>
+    class MpmcQueue {
+    public:
+        // Copying queues is an error hazard since the point is to
+        // pass elements between threads through a common buffer.
+        MpmcQueue(const MpmcQueue &) = delete;
+        MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    private:
+        struct Slot {
+            std::atomic<std::size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            ALWAYS_INLINE T *GetValue() {
+                return std::launder(reinterpret_cast<T *>(storage));
+            }
+        };
+
+    private:
+        const std::size_t m_mask;
+        const std::unique_ptr<Slot[]> m_slots;
+
+        // The position of the next slot to be written by producers.
+        alignas(CacheLineSize) std::atomic<std::size_t> m_tail;
+        // The position of the next slot to be read by consumers.
+        alignas(CacheLineSize) std::atomic<std::size_t> m_head;
+
+        // Threads waiting for the queue to become non-empty and non-full.
+        // Waiters re-check the position advanced by the other side, whose
+        // sequentially consistent claim orders it before the waiter check.
+        alignas(CacheLineSize) impl::EventCount m_not_empty;
+        alignas(CacheLineSize) impl::EventCount m_not_full;
+
+    private:
+        // Claims the next writable slot, or returns `nullptr` if the queue is full.
+        ALWAYS_INLINE Slot *ClaimPush(std::size_t &pos) {
+            pos = m_tail.load(std::memory_order_relaxed);
+            while (true) {
+                Slot &slot = m_slots[pos & m_mask];
+                const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+
+                if (diff == 0) {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        return std::addressof(slot);
+                    }
+                } else if (diff < 0) {
+                    // The slot still holds an element from the previous lap.
+                    return nullptr;
+                } else {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Claims the next readable slot, or returns `nullptr` if the queue is empty.
+        ALWAYS_INLINE Slot *ClaimPop(std::size_t &pos) {
+            pos = m_head.load(std::memory_order_relaxed);
+            while (true) {
+                Slot &slot = m_slots[pos & m_mask];
+                const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+
+                if (diff == 0) {
+                    if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        return std::addressof(slot);
+                    }
+                } else if (diff < 0) {
+                    // The slot has not been written in this lap yet.
+                    return nullptr;
+                } else {
+                    pos = m_head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        ALWAYS_INLINE void PublishPush(Slot *slot, std::size_t pos) {
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            m_not_empty.NotifyAfterSeqCst();
+        }
+
+        ALWAYS_INLINE T FinishPop(Slot *slot, std::size_t pos) {
+            T value(std::move(*slot->GetValue()));
+            std::destroy_at(slot->GetValue());
+
+            // Hand the slot over to the producer of the next lap.
+            slot->sequence.store(pos + m_mask + 1, std::memory_order_release);
+            m_not_full.NotifyAfterSeqCst();
+            return value;
+        }
+
+        template <typename... Args>
+        COLD void EmplaceSlow(Args &&...args) {
+            std::size_t pos;
+            Slot *slot;
+            while ((slot = this->ClaimPush(pos)) == nullptr) {
+                const std::uint32_t key = m_not_full.PrepareWait();
+                if ((slot = this->ClaimPush(pos)) != nullptr) {
+                    m_not_full.CancelWait();
+                    break;
+                }
+
+                // A consumer which claimed the oldest slot before we registered
+                // may not notify us, but hands the slot back shortly, so let it run.
+                if (m_head.load(std::memory_order_seq_cst) != pos - (m_mask + 1)) {
+                    m_not_full.CancelWait();
+                    std::this_thread::yield();
+                    continue;
+                }
+                m_not_full.Wait(key);
+            }
+
+            ::new (static_cast<void *>(slot->storage)) T(std::forward<Args>(args)...);
+            this->PublishPush(slot, pos);
+        }
+
+        COLD T PopSlow() {
+            std::size_t pos;
+            Slot *slot;
+            while ((slot = this->ClaimPop(pos)) == nullptr) {
+                const std::uint32_t key = m_not_empty.PrepareWait();
+                if ((slot = this->ClaimPop(pos)) != nullptr) {
+                    m_not_empty.CancelWait();
+                    break;
+                }
+
+                // A producer which claimed the slot before we registered may
+                // not notify us, but publishes its element shortly, so let it run.
+                if (m_tail.load(std::memory_order_seq_cst) != pos) {
+                    m_not_empty.CancelWait();
+                    std::this_thread::yield();
+                    continue;
+                }
+                m_not_empty.Wait(key);
+            }
+
+            return this->FinishPop(slot, pos);
+        }
+
+    public:
+        /// Constructs an empty queue.
+        ///
+        /// @param capacity The minimum number of elements the queue can hold.
+        ///                 It is rounded up to the next power of two.
+        explicit MpmcQueue(std::size_t capacity)
+            : m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+              m_slots(std::make_unique<Slot[]>(m_mask + 1)),
+              m_tail(0), m_head(0), m_not_empty(), m_not_full() {
+            for (std::size_t i = 0; i <= m_mask; ++i) {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /// Destroys the queue along with all elements left in it.
+        ~MpmcQueue() {
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            for (std::size_t pos = m_head.load(std::memory_order_relaxed); pos != tail; ++pos) {
+                std::destroy_at(m_slots[pos & m_mask].GetValue());
+            }
+        }
+
+        /// Gets the maximum number of elements the queue can hold.
+        ALWAYS_INLINE std::size_t GetCapacity() const {
+            return m_mask + 1;
+        }
+
+        /// Gets the number of elements in the queue. This is only a snapshot
+        /// and may be outdated by the time it returns.
+        ALWAYS_INLINE std::size_t GetSize() const {
+            const std::size_t head = m_head.load(std::memory_order_relaxed);
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            return static_cast<std::ptrdiff_t>(tail - head) > 0 ? tail - head : 0;
+        }
+
+        /// Attempts to construct an element at the end of the queue without
+        /// blocking.
+        ///
+        /// @return `true` when the element was added, `false` when the queue
+        ///         was full.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        ALWAYS_INLINE bool TryEmplace(Args &&...args) {
+            if constexpr (!std::is_nothrow_constructible_v<T, Args...>) {
+                // A claimed slot must be filled, so construct the element
+                // before claiming one in case that throws.
+                return this->TryEmplace(T(std::forward<Args>(args)...));
+            } else {
+                std::size_t pos;
+                Slot *slot = this->ClaimPush(pos);
+                if (slot == nullptr) {
+                    return false;
+                }
+
+                ::new (static_cast<void *>(slot->storage)) T(std::forward<Args>(args)...);
+                this->PublishPush(slot, pos);
+                return true;
+            }
+        }
+
+        /// Attempts to add an element to the end of the queue without blocking.
+        ///
+        /// @return `true` when the element was added, `false` when the queue
+        ///         was full.
+        ALWAYS_INLINE bool TryPush(const T &value) requires std::is_copy_constructible_v<T> {
+            return this->TryEmplace(value);
+        }
+
+        /// @copydoc TryPush(const T&)
+        ALWAYS_INLINE bool TryPush(T &&value) {
+            return this->TryEmplace(std::move(value));
+        }
+
+        /// Constructs an element at the end of the queue, blocking the
+        /// current thread while the queue is full.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        ALWAYS_INLINE void Emplace(Args &&...args) {
+            if constexpr (!std::is_nothrow_constructible_v<T, Args...>) {
+                this->Emplace(T(std::forward<Args>(args)...));
+            } else if (!this->TryEmplace(std::forward<Args>(args)...)) UNLIKELY {
+                // Arguments are not consumed when the queue was full.
+                this->EmplaceSlow(std::forward<Args>(args)...);
+            }
+        }
+
+        /// Adds an element to the end of the queue, blocking the current
+        /// thread while the queue is full.
+        ALWAYS_INLINE void Push(const T &value) requires std::is_copy_constructible_v<T> {
+            this->Emplace(value);
+        }
+
+        /// @copydoc Push(const T&)
+        ALWAYS_INLINE void Push(T &&value) {
+            this->Emplace(std::move(value));
+        }
+
+        /// Attempts to remove the element at the front of the queue without
+        /// blocking.
+        ///
+        /// The element is assigned to `out` after its slot was handed back to
+        /// the producers, so the assignment must not throw. Use @ref Pop for
+        /// types which can only throw on assignment.
+        ///
+        /// @param out Receives the element on success.
+        /// @return `true` when an element was removed, `false` when the queue
+        ///         was empty.
+        ALWAYS_INLINE bool TryPop(T &out) requires std::is_nothrow_move_assignable_v<T> {
+            std::size_t pos;
+            Slot *slot = this->ClaimPop(pos);
+            if (slot == nullptr) {
+                return false;
+            }
+
+            out = this->FinishPop(slot, pos);
+            return true;
+        }
+
+        /// Removes the element at the front of the queue, blocking the
+        /// current thread while the queue is empty.
+        ///
+        /// @return The removed element.
+        ALWAYS_INLINE T Pop() {
+            std::size_t pos;
+            Slot *slot = this->ClaimPop(pos);
+            if (slot == nullptr) UNLIKELY {
+                return this->PopSlow();
+            }
+
+            return this->FinishPop(slot, pos);
+        }
+    };
+
+}
@@ -5,14 +5,22 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
 #include <optional>
 #include <utility>
 
+#include "vtils/impl/cpu_relax.hpp"
 #include "vtils/macros/platform.hpp"
+#include "vtils/os/lock_profiling.hpp"
 #include "vtils/os/impl/util_pointer_value.hpp"
 
 #if defined(V_PLATFORM_WINDOWS)
     #include "vtils/os/impl/mutex.os.windows.hpp"
+#elif defined(V_PLATFORM_LINUX)
+    #include "vtils/os/impl/mutex.futex.hpp"
 #else
     #include "vtils/os/impl/mutex.pthread.hpp"
 #endif
@@ -52,13 +60,92 @@ namespace vtils {
             ALWAYS_INLINE void Unlock() {
                 m_impl.Get().Unlock();
             }
+
+            // Racy check whether the lock is currently held. The result may
+            // be stale by the time it is observed and is only a hint.
+            ALWAYS_INLINE bool IsLocked() {
+                return m_impl.Get().IsLocked();
+            }
+        };
+
+        template <typename M>
+        concept Lockable = requires (M &m) {
+            { m.Lock()    } -> std::same_as<void>;
+            { m.TryLock() } -> std::same_as<bool>;
+            { m.Unlock()  } -> std::same_as<void>;
+        };
+
+        // A mutex which briefly spins before parking the thread in the kernel.
+        //
+        // Most critical sections are shorter than a round-trip through the
+        // scheduler, so a short spin often wins the lock. The spin budget is
+        // tuned at runtime from how long past acquisitions took to succeed,
+        // similar to glibc's `PTHREAD_MUTEX_ADAPTIVE_NP`.
+        class AdaptiveMutex final {
+        private:
+            static constexpr std::int32_t MaxSpins = 100;
+
+        private:
+            Mutex m_mutex;
+            std::atomic<std::int32_t> m_spins;
+
+        private:
+            COLD void LockSlow() {
+                const std::int32_t average = m_spins.load(std::memory_order_relaxed);
+                const std::int32_t budget  = std::min(MaxSpins, average * 2 + 10);
+
+                std::int32_t count = 0;
+                while (true) {
+                    if (count >= budget) {
+                        // Spinning did not pay off, park until the lock is free.
+                        m_mutex.Lock();
+                        break;
+                    }
+
+                    ++count;
+                    CpuRelax();
+
+                    // Only attempt the CAS once the lock reads as free so
+                    // spinning waiters do not keep stealing the cache line
+                    // from the owner.
+                    if (!m_mutex.IsLocked() && m_mutex.TryLock()) {
+                        break;
+                    }
+                }
+
+                // Move the running average towards the spin count we observed.
+                // Updates from several threads may race, but the value is just
+                // a heuristic so the occasional lost update does not matter.
+                m_spins.store(average + (count - average) / 8, std::memory_order_relaxed);
+            }
+
+        public:
+            constexpr AdaptiveMutex() : m_mutex(), m_spins(0) {}
+            constexpr ~AdaptiveMutex() = default;
+
+            AdaptiveMutex(const AdaptiveMutex &) = delete;
+            const AdaptiveMutex &operator=(const AdaptiveMutex &) = delete;
+
+            ALWAYS_INLINE void Lock() {
+                if (!m_mutex.TryLock()) UNLIKELY {
+                    this->LockSlow();
+                }
+            }
+
+            ALWAYS_INLINE bool TryLock() {
+                return m_mutex.TryLock();
+            }
+
+            ALWAYS_INLINE void Unlock() {
+                m_mutex.Unlock();
+            }
         };
 
     }
 
     class ConditionVariable;
 
-    template <typename T>
+    template <typename T, impl::Lockable RawMutex = impl::Mutex>
     struct MutexGuard;
 
     /// A mutual exclusion primitive to protect shared data from being simultaneously
@@ -71,10 +158,12 @@ namespace vtils {
     /// the value it is intended to protect and only exposes it through a safe API
     /// which ensures proper resource management through RAII.
     ///
-    /// @tparam T The type of data to guard.
-    template <typename T>
+    /// @tparam T        The type of data to guard.
+    /// @tparam RawMutex The underlying lock implementation. The default is the
+    ///                  native OS mutex. See @ref AdaptiveMutex for alternatives.
+    template <typename T, impl::Lockable RawMutex = impl::Mutex>
     class Mutex {
-        friend class MutexGuard<T>;
+        friend class MutexGuard<T, RawMutex>;
 
     public:
         // Copying mutexes is an error hazard since the point is to protect
@@ -83,7 +172,10 @@ namespace vtils {
         Mutex &operator=(const Mutex &) = delete;
 
     private:
-        impl::Mutex m_raw;
+        RawMutex m_raw;
+#if defined(V_ENABLE_LOCK_PROFILING)
+        impl::LockProfileState m_profile;
+#endif
         T m_value;
 
     public:
@@ -104,7 +196,7 @@ namespace vtils {
         ///
         /// @return A scope guard providing exclusive access to the resource. When
         ///         destructed, the resource will be released again.
-        ALWAYS_INLINE MutexGuard<T> Lock();
+        ALWAYS_INLINE MutexGuard<T, RawMutex> Lock(V_LOCK_SITE_PARAMETER);
 
         /// Attempts to lock the Mutex, returning a @ref MutexGuard on success.
         ///
@@ -113,17 +205,17 @@ namespace vtils {
         ///
         /// @return When locked, a scope guard providing exclusive access to the
         ///         resource. Otherwise, an empty value.
-        ALWAYS_INLINE std::optional<MutexGuard<T>> TryLock();
+        ALWAYS_INLINE std::optional<MutexGuard<T, RawMutex>> TryLock();
     };
 
     /// A lock guard providing RAII semantics for accessing the value.
     ///
     /// When working with a guard object, its lifetime must never exceed
     /// that of the @ref Mutex it was obtained from.
-    template <typename T>
+    template <typename T, impl::Lockable RawMutex>
     struct MutexGuard {
         friend class ConditionVariable;
-        friend class Mutex<T>;
+        friend class Mutex<T, RawMutex>;
 
     public:
         // Guard is not copyable for the same reason as Mutex.
@@ -137,15 +229,26 @@ namespace vtils {
 
     private:
         T *m_ptr;
-        impl::Mutex &m_raw;
+        RawMutex &m_raw;
+#if defined(V_ENABLE_LOCK_PROFILING)
+        impl::LockProfileToken m_token;
+#endif
 
     private:
-        ALWAYS_INLINE explicit MutexGuard(Mutex<T> &m)
+        ALWAYS_INLINE explicit MutexGuard(Mutex<T, RawMutex> &m)
             : m_ptr(std::addressof(m.m_value)), m_raw(m.m_raw) {}
 
+#if defined(V_ENABLE_LOCK_PROFILING)
+        ALWAYS_INLINE MutexGuard(Mutex<T, RawMutex> &m, const impl::LockProfileToken &token)
+            : m_ptr(std::addressof(m.m_value)), m_raw(m.m_raw), m_token(token) {}
+#endif
+
     public:
         // Releases exclusive access to the resource on destruction.
         ALWAYS_INLINE ~MutexGuard() {
+#if defined(V_ENABLE_LOCK_PROFILING)
+            m_token.Release();
+#endif
             m_raw.Unlock();
         }
 
@@ -158,14 +261,19 @@ namespace vtils {
         ALWAYS_INLINE T &operator*()  & { return *m_ptr; }
     };
 
-    template<typename T>
-    MutexGuard<T> Mutex<T>::Lock() {
+    template <typename T, impl::Lockable RawMutex>
+    MutexGuard<T, RawMutex> Mutex<T, RawMutex>::Lock(V_LOCK_SITE_PARAMETER_DEF) {
+#if defined(V_ENABLE_LOCK_PROFILING)
+        const auto token = m_profile.Acquire(site, [&] { return m_raw.TryLock(); }, [&] { m_raw.Lock(); });
+        return MutexGuard(*this, token);
+#else
         m_raw.Lock();
         return MutexGuard(*this);
+#endif
     }
 
-    template<typename T>
-    std::optional<MutexGuard<T>> Mutex<T>::TryLock() {
+    template <typename T, impl::Lockable RawMutex>
+    std::optional<MutexGuard<T, RawMutex>> Mutex<T, RawMutex>::TryLock() {
         if (!m_raw.TryLock()) {
             return {};
         }
@@ -173,4 +281,14 @@ namespace vtils {
         return MutexGuard(*this);
     }
 
+    /// A @ref Mutex which spins for a short, self-tuning amount of time
+    /// before parking the thread.
+    ///
+    /// This is beneficial when critical sections are typically shorter
+    /// than the cost of sleeping and waking up in the kernel.
+    ///
+    /// @tparam T The type of data to guard.
+    template <typename T>
+    using AdaptiveMutex = Mutex<T, impl::AdaptiveMutex>;
+
 }
@@ -0,0 +1,214 @@
+/**
+ * @file once_cell.hpp
+ * @brief Thread-safe one-time initialization of inline values.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/scope_guard.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    /// A cell which is written to at most once, by whichever thread
+    /// first asks for its value.
+    ///
+    /// The value is stored inline and constructed in place. Once it is
+    /// initialized, reading it costs a single acquire load. Threads which
+    /// arrive while another one is running the initializer sleep until it
+    /// finishes rather than constructing a value of their own.
+    ///
+    /// If the initializer throws, the cell remains empty and one of the
+    /// waiting threads gets to try again.
+    ///
+    /// @tparam T The type of the stored value.
+    template <typename T>
+    class OnceCell {
+    public:
+        // Copying cells is an error hazard since the point is to share
+        // a common value and not accidentally duplicate it.
+        OnceCell(const OnceCell &) = delete;
+        OnceCell &operator=(const OnceCell &) = delete;
+
+    private:
+        static constexpr std::uint32_t Empty   = 0;
+        static constexpr std::uint32_t Running = 1;
+        static constexpr std::uint32_t Waiting = 2;
+        static constexpr std::uint32_t Ready   = 3;
+
+    private:
+        std::atomic<std::uint32_t> m_state;
+        union {
+            // Keeps the cell constant-initializable while it is empty.
+            std::uint8_t m_empty;
+            T m_value;
+        };
+
+    private:
+        template <class Fn>
+        COLD T &InitializeSlow(Fn &init) {
+            std::uint32_t state = m_state.load(std::memory_order_acquire);
+            while (true) {
+                switch (state) {
+                    case Ready:
+                        return m_value;
+
+                    case Empty:
+                        if (m_state.compare_exchange_weak(state, Running, std::memory_order_acquire, std::memory_order_acquire)) {
+                            return this->RunInitializer(init);
+                        }
+                        break;
+
+                    case Running:
+                        // Announce that we are going to sleep before doing so.
+                        if (!m_state.compare_exchange_weak(state, Waiting, std::memory_order_acquire, std::memory_order_acquire)) {
+                            break;
+                        }
+                        [[fallthrough]];
+
+                    case Waiting:
+                        impl::FutexWait(m_state, Waiting);
+                        state = m_state.load(std::memory_order_acquire);
+                        break;
+                }
+            }
+        }
+
+        template <class Fn>
+        T &RunInitializer(Fn &init) {
+            // Give up the slot when the initializer throws.
+            impl::ScopeGuard reset([this] {
+                if (m_state.exchange(Empty, std::memory_order_release) == Waiting) {
+                    impl::FutexWakeAll(m_state);
+                }
+            });
+
+            ::new (static_cast<void *>(std::addressof(m_value))) T(std::invoke(init));
+            reset.Cancel();
+
+            if (m_state.exchange(Ready, std::memory_order_release) == Waiting) {
+                impl::FutexWakeAll(m_state);
+            }
+            return m_value;
+        }
+
+    public:
+        /// Constructs an empty cell.
+        ALWAYS_INLINE constexpr OnceCell() : m_state(Empty), m_empty() {}
+
+        /// Destroys the cell along with its value, if any.
+        ALWAYS_INLINE ~OnceCell() {
+            if (m_state.load(std::memory_order_relaxed) == Ready) {
+                std::destroy_at(std::addressof(m_value));
+            }
+        }
+
+        /// Checks whether the value has been initialized.
+        ALWAYS_INLINE bool IsInitialized() const {
+            return m_state.load(std::memory_order_acquire) == Ready;
+        }
+
+        /// Gets a pointer to the value if it has been initialized.
+        ///
+        /// @return The value, or `nullptr` if the cell is still empty.
+        ALWAYS_INLINE T *TryGet() {
+            return this->IsInitialized() ? std::addressof(m_value) : nullptr;
+        }
+
+        /// Gets a pointer to the value if it has been initialized.
+        ///
+        /// @return The value, or `nullptr` if the cell is still empty.
+        ALWAYS_INLINE const T *TryGet() const {
+            return this->IsInitialized() ? std::addressof(m_value) : nullptr;
+        }
+
+        /// Gets the value, initializing it with the result of `init` first
+        /// if the cell is still empty.
+        ///
+        /// Exactly one thread runs its initializer. All other threads which
+        /// call this in the meantime block until the value is available.
+        /// The initializer must not access the same cell.
+        ///
+        /// @param init A callable returning the value to store.
+        /// @return The stored value.
+        template <class Fn> requires std::is_invocable_r_v<T, Fn&>
+        ALWAYS_INLINE T &GetOrInit(Fn &&init) {
+            if (m_state.load(std::memory_order_acquire) != Ready) UNLIKELY {
+                return this->InitializeSlow(init);
+            }
+
+            return m_value;
+        }
+
+        /// Initializes the cell with a value constructed from `args`, unless
+        /// it already holds one.
+        ///
+        /// If another thread is initializing the cell at the same time, this
+        /// waits for it to finish.
+        ///
+        /// @return `true` when the value was constructed, `false` when the
+        ///         cell was already initialized.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        bool Set(Args &&...args) {
+            bool constructed = false;
+            this->GetOrInit([&] {
+                constructed = true;
+                return T(std::forward<Args>(args)...);
+            });
+
+            return constructed;
+        }
+    };
+
+    /// A value which is initialized on first access, in a thread-safe way.
+    ///
+    /// This is primarily meant for expensive global tables which should only
+    /// be built when they are actually needed. Like @ref OnceCell, the value
+    /// lives inline and accessing it after initialization costs a single
+    /// acquire load. Since the constructor is `constexpr`, global instances
+    /// can be declared `constinit` and do not partake in static initialization
+    /// order issues.
+    ///
+    /// @tparam T    The type of the value.
+    /// @tparam Init A callable type returning the value, e.g. the type of a
+    ///              captureless lambda.
+    template <typename T, class Init> requires std::is_invocable_r_v<T, Init&>
+    class Lazy {
+    public:
+        // Copying is an error hazard for the same reasons as with OnceCell.
+        Lazy(const Lazy &) = delete;
+        Lazy &operator=(const Lazy &) = delete;
+
+    private:
+        OnceCell<T> m_cell;
+        NO_UNIQUE_ADDRESS Init m_init;
+
+    public:
+        /// Constructs the lazy value with its initializer.
+        ALWAYS_INLINE constexpr explicit Lazy(Init init = Init()) : m_cell(), m_init(std::move(init)) {}
+
+        /// Gets the value, initializing it first if this is the first access.
+        ALWAYS_INLINE T &Get() {
+            return m_cell.GetOrInit(m_init);
+        }
+
+        /// Checks whether the value has been initialized.
+        ALWAYS_INLINE bool IsInitialized() const {
+            return m_cell.IsInitialized();
+        }
+
+        // Resource access, by pointer and by reference.
+        ALWAYS_INLINE T *operator->() { return std::addressof(this->Get()); }
+        ALWAYS_INLINE T &operator*()  { return this->Get(); }
+    };
+
+}
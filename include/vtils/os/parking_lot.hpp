@@ -0,0 +1,527 @@
+/**
+ * @file parking_lot.hpp
+ * @brief Compact locks which park waiting threads in a global table.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/mutex.hpp"
+#include "vtils/os/read_write_lock.hpp"
+#include "vtils/os/impl/parking_lot.hpp"
+
+namespace vtils {
+
+    /// A mutual exclusion primitive which occupies a single byte.
+    ///
+    /// Waiting threads spin briefly and then park in a global table keyed
+    /// by the address of the lock, so the lock itself only needs to track
+    /// whether it is held and whether anyone is parked on it. This makes it
+    /// practical to embed a lock into every element of a large collection.
+    ///
+    /// The lock is not fair by default, which lets a running thread reacquire
+    /// it without a context switch. To prevent starvation, ownership is
+    /// handed over directly to a parked thread every millisecond or so, and
+    /// @ref UnlockFair can be used to force this behavior.
+    ///
+    /// Together with @ref Mutex, this can guard data as `Mutex<T, RawMutex>`.
+    class RawMutex final {
+    private:
+        static constexpr std::uint8_t LockedBit = 1 << 0;
+        static constexpr std::uint8_t ParkedBit = 1 << 1;
+
+        // Signals a woken thread that it owns the lock now.
+        static constexpr impl::UnparkToken TokenHandoff = 1;
+
+    private:
+        std::atomic<std::uint8_t> m_state;
+
+    private:
+        COLD bool LockSlow(const impl::ParkDeadline *deadline) {
+            impl::SpinWait spin;
+            std::uint8_t state = m_state.load(std::memory_order_relaxed);
+            while (true) {
+                // Grab the lock if it is free, even when threads are parked.
+                if ((state & LockedBit) == 0) {
+                    if (m_state.compare_exchange_weak(state, state | LockedBit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return true;
+                    }
+                    continue;
+                }
+
+                // Spin for a while if nobody is parked yet.
+                if ((state & ParkedBit) == 0 && spin.Spin()) {
+                    state = m_state.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                // Announce that we are about to park.
+                if ((state & ParkedBit) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | ParkedBit, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+                }
+
+                const auto result = impl::Park(
+                    this,
+                    [&] { return m_state.load(std::memory_order_relaxed) == (LockedBit | ParkedBit); },
+                    [] {},
+                    [&](const void *, bool was_last) {
+                        if (was_last) {
+                            m_state.fetch_and(static_cast<std::uint8_t>(~ParkedBit), std::memory_order_relaxed);
+                        }
+                    },
+                    impl::DefaultParkToken,
+                    deadline
+                );
+
+                if (result.kind == impl::ParkResultKind::TimedOut) {
+                    return false;
+                }
+                if (result.kind == impl::ParkResultKind::Unparked && result.token == TokenHandoff) {
+                    return true;
+                }
+
+                spin.Reset();
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        COLD void UnlockSlow(bool force_fair) {
+            impl::UnparkOne(this, [&](impl::UnparkResult result) {
+                if (result.unparked_threads != 0 && (force_fair || result.be_fair)) {
+                    // Keep the lock held and pass it on to the woken thread.
+                    if (!result.have_more_threads) {
+                        m_state.store(LockedBit, std::memory_order_relaxed);
+                    }
+                    return TokenHandoff;
+                }
+
+                m_state.store(result.have_more_threads ? ParkedBit : 0, std::memory_order_release);
+                return impl::DefaultUnparkToken;
+            });
+        }
+
+    public:
+        constexpr RawMutex() : m_state(0) {}
+        constexpr ~RawMutex() = default;
+
+        RawMutex(const RawMutex &) = delete;
+        RawMutex &operator=(const RawMutex &) = delete;
+
+        /// Acquires the lock, blocking the current thread until it is able to do so.
+        ALWAYS_INLINE void Lock() {
+            std::uint8_t expected = 0;
+            if (!m_state.compare_exchange_weak(expected, LockedBit, std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->LockSlow(nullptr);
+            }
+        }
+
+        /// Attempts to acquire the lock without blocking.
+        ALWAYS_INLINE bool TryLock() {
+            std::uint8_t state = m_state.load(std::memory_order_relaxed);
+            while ((state & LockedBit) == 0) {
+                if (m_state.compare_exchange_weak(state, state | LockedBit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Attempts to acquire the lock until the given point in time is reached.
+        template <class Clock, class Duration>
+        ALWAYS_INLINE bool TryLockUntil(const std::chrono::time_point<Clock, Duration> &time) {
+            std::uint8_t expected = 0;
+            if (m_state.compare_exchange_weak(expected, LockedBit, std::memory_order_acquire, std::memory_order_relaxed)) LIKELY {
+                return true;
+            }
+
+            const auto deadline = impl::ToParkDeadline(time);
+            return this->LockSlow(std::addressof(deadline));
+        }
+
+        /// Attempts to acquire the lock for at most the given duration.
+        template <class Rep, class Period>
+        ALWAYS_INLINE bool TryLockFor(const std::chrono::duration<Rep, Period> &timeout) {
+            return this->TryLockUntil(std::chrono::steady_clock::now() + timeout);
+        }
+
+        /// Releases the lock, which must be held by the current thread.
+        ALWAYS_INLINE void Unlock() {
+            std::uint8_t expected = LockedBit;
+            if (!m_state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed)) UNLIKELY {
+                this->UnlockSlow(false);
+            }
+        }
+
+        /// Releases the lock and hands it over directly to a parked thread,
+        /// if there is one.
+        ///
+        /// This guarantees that the lock cannot be stolen by another running
+        /// thread, at the cost of a context switch for every handover.
+        ALWAYS_INLINE void UnlockFair() {
+            std::uint8_t expected = LockedBit;
+            if (!m_state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed)) UNLIKELY {
+                this->UnlockSlow(true);
+            }
+        }
+
+        /// Checks whether the lock is currently held by any thread.
+        ALWAYS_INLINE bool IsLocked() const {
+            return (m_state.load(std::memory_order_relaxed) & LockedBit) != 0;
+        }
+    };
+
+    static_assert(sizeof(RawMutex) == 1);
+
+    /// A reader-writer lock which occupies two bytes.
+    ///
+    /// Like @ref RawMutex, waiting threads park in the global parking lot.
+    /// A writer first claims the lock, which stops new readers from entering,
+    /// and then waits for the remaining readers to drain. When a writer
+    /// releases the lock, parked threads are woken in the order they arrived:
+    /// either the next writer alone, or all readers up to the next writer.
+    ///
+    /// At most 8191 readers may hold the lock at the same time.
+    ///
+    /// Together with @ref ReadWriteLock, this can guard data as
+    /// `ReadWriteLock<T, RawReadWriteLock>`.
+    class RawReadWriteLock final {
+    private:
+        // Set when threads are parked on the lock itself.
+        static constexpr std::uint16_t ParkedBit       = 1 << 0;
+        // Set when a writer is parked waiting for the readers to drain.
+        static constexpr std::uint16_t WriterParkedBit = 1 << 1;
+        static constexpr std::uint16_t WriterBit       = 1 << 2;
+        static constexpr std::uint16_t OneReader       = 1 << 3;
+        static constexpr std::uint16_t ReaderMask      = static_cast<std::uint16_t>(~(OneReader - 1));
+
+        static constexpr impl::ParkToken TokenReader = 0;
+        static constexpr impl::ParkToken TokenWriter = 1;
+
+        // Signals a woken thread that it owns the lock now.
+        static constexpr impl::UnparkToken TokenHandoff = 1;
+
+    private:
+        std::atomic<std::uint16_t> m_state;
+
+    private:
+        // The key on which a writer waits for the readers to drain. This is
+        // the address of the second byte of the lock, so it is unique too.
+        ALWAYS_INLINE const void *WriterKey() const {
+            return reinterpret_cast<const std::uint8_t *>(this) + 1;
+        }
+
+        // Parks on the lock until the writer bit is cleared. Returns whether
+        // the lock was handed over to the caller, `false` on timeout, or no
+        // value if the caller should retry.
+        std::optional<bool> ParkUntilUnlocked(impl::ParkToken token, const impl::ParkDeadline *deadline) {
+            const auto result = impl::Park(
+                this,
+                [&] {
+                    const std::uint16_t state = m_state.load(std::memory_order_relaxed);
+                    return (state & (WriterBit | ParkedBit)) == (WriterBit | ParkedBit);
+                },
+                [] {},
+                [&](const void *, bool was_last) {
+                    if (was_last) {
+                        m_state.fetch_and(static_cast<std::uint16_t>(~ParkedBit), std::memory_order_relaxed);
+                    }
+                },
+                token,
+                deadline
+            );
+
+            if (result.kind == impl::ParkResultKind::TimedOut) {
+                return false;
+            }
+            if (result.kind == impl::ParkResultKind::Unparked && result.token == TokenHandoff) {
+                return true;
+            }
+            return std::nullopt;
+        }
+
+        COLD bool ReadSlow(const impl::ParkDeadline *deadline) {
+            impl::SpinWait spin;
+            std::uint16_t state = m_state.load(std::memory_order_relaxed);
+            while (true) {
+                if ((state & WriterBit) == 0) {
+                    V_ASSERT((state & ReaderMask) != ReaderMask, "too many readers");
+                    if (m_state.compare_exchange_weak(state, state + OneReader, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return true;
+                    }
+                    continue;
+                }
+
+                if ((state & ParkedBit) == 0 && spin.Spin()) {
+                    state = m_state.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if ((state & ParkedBit) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | ParkedBit, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+                }
+
+                if (const auto acquired = this->ParkUntilUnlocked(TokenReader, deadline); acquired.has_value()) {
+                    return *acquired;
+                }
+
+                spin.Reset();
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+
+        COLD void ReadUnlockSlow() {
+            // We were the last reader, so let the waiting writer proceed.
+            impl::UnparkOne(this->WriterKey(), [&](impl::UnparkResult) {
+                m_state.fetch_and(static_cast<std::uint16_t>(~WriterParkedBit), std::memory_order_relaxed);
+                return impl::DefaultUnparkToken;
+            });
+        }
+
+        COLD bool WriteSlow(const impl::ParkDeadline *deadline) {
+            impl::SpinWait spin;
+            std::uint16_t state = m_state.load(std::memory_order_relaxed);
+            while (true) {
+                // Claim the writer bit first, which keeps new readers out.
+                if ((state & WriterBit) == 0) {
+                    if (m_state.compare_exchange_weak(state, state | WriterBit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        break;
+                    }
+                    continue;
+                }
+
+                if ((state & ParkedBit) == 0 && spin.Spin()) {
+                    state = m_state.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if ((state & ParkedBit) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | ParkedBit, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+                }
+
+                if (const auto acquired = this->ParkUntilUnlocked(TokenWriter, deadline); acquired.has_value()) {
+                    // A handover only ever happens without active readers.
+                    return *acquired;
+                }
+
+                spin.Reset();
+                state = m_state.load(std::memory_order_relaxed);
+            }
+
+            return this->WaitForReaders(deadline);
+        }
+
+        bool WaitForReaders(const impl::ParkDeadline *deadline) {
+            impl::SpinWait spin;
+            std::uint16_t state = m_state.load(std::memory_order_acquire);
+            while ((state & ReaderMask) != 0) {
+                if ((state & WriterParkedBit) == 0 && spin.Spin()) {
+                    state = m_state.load(std::memory_order_acquire);
+                    continue;
+                }
+
+                if ((state & WriterParkedBit) == 0) {
+                    if (!m_state.compare_exchange_weak(state, state | WriterParkedBit, std::memory_order_acquire, std::memory_order_acquire)) {
+                        continue;
+                    }
+                }
+
+                const auto result = impl::Park(
+                    this->WriterKey(),
+                    [&] {
+                        const std::uint16_t state = m_state.load(std::memory_order_relaxed);
+                        return (state & ReaderMask) != 0 && (state & WriterParkedBit) != 0;
+                    },
+                    [] {},
+                    [&](const void *, bool) {
+                        m_state.fetch_and(static_cast<std::uint16_t>(~WriterParkedBit), std::memory_order_relaxed);
+                    },
+                    TokenWriter,
+                    deadline
+                );
+
+                if (result.kind == impl::ParkResultKind::TimedOut) {
+                    // Give up the writer bit again and let blocked threads in.
+                    this->UnparkWaiters(false, false);
+                    return false;
+                }
+
+                state = m_state.load(std::memory_order_acquire);
+            }
+
+            return true;
+        }
+
+        // Clears the writer bit and wakes parked threads in FIFO order. When
+        // readers may still hold the lock, ownership is never handed over.
+        COLD void UnparkWaiters(bool force_fair, bool may_handoff) {
+            bool wake_writer  = false;
+            bool wake_readers = false;
+            const auto filter = [&](impl::ParkToken token) {
+                if (wake_writer || (wake_readers && token == TokenWriter)) {
+                    return impl::FilterOp::Stop;
+                }
+
+                if (token == TokenWriter) {
+                    wake_writer = true;
+                } else {
+                    wake_readers = true;
+                }
+                return impl::FilterOp::Unpark;
+            };
+
+            const auto callback = [&](impl::UnparkResult result) {
+                const bool handoff = may_handoff && result.unparked_threads != 0 && (force_fair || result.be_fair);
+
+                std::uint16_t state = m_state.load(std::memory_order_relaxed);
+                std::uint16_t new_state;
+                do {
+                    new_state = state & static_cast<std::uint16_t>(~(WriterBit | ParkedBit));
+                    if (result.have_more_threads) {
+                        new_state |= ParkedBit;
+                    }
+                    if (handoff) {
+                        new_state += wake_writer ? WriterBit : static_cast<std::uint16_t>(result.unparked_threads * OneReader);
+                    }
+                } while (!m_state.compare_exchange_weak(state, new_state, std::memory_order_release, std::memory_order_relaxed));
+
+                return handoff ? TokenHandoff : impl::DefaultUnparkToken;
+            };
+
+            impl::UnparkFiltered(this, filter, callback);
+        }
+
+    public:
+        constexpr RawReadWriteLock() : m_state(0) {}
+        constexpr ~RawReadWriteLock() = default;
+
+        RawReadWriteLock(const RawReadWriteLock &) = delete;
+        RawReadWriteLock &operator=(const RawReadWriteLock &) = delete;
+
+        /// Acquires shared read access, blocking while a writer holds the lock.
+        ALWAYS_INLINE void Read() {
+            std::uint16_t state = m_state.load(std::memory_order_relaxed);
+            if ((state & WriterBit) != 0 || (state & ReaderMask) == ReaderMask ||
+                !m_state.compare_exchange_weak(state, state + OneReader, std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->ReadSlow(nullptr);
+            }
+        }
+
+        /// Attempts to acquire shared read access without blocking.
+        ALWAYS_INLINE bool TryRead() {
+            std::uint16_t state = m_state.load(std::memory_order_relaxed);
+            while ((state & WriterBit) == 0 && (state & ReaderMask) != ReaderMask) {
+                if (m_state.compare_exchange_weak(state, state + OneReader, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Attempts to acquire shared read access until the given point in time.
+        template <class Clock, class Duration>
+        ALWAYS_INLINE bool TryReadUntil(const std::chrono::time_point<Clock, Duration> &time) {
+            if (this->TryRead()) LIKELY {
+                return true;
+            }
+
+            const auto deadline = impl::ToParkDeadline(time);
+            return this->ReadSlow(std::addressof(deadline));
+        }
+
+        /// Attempts to acquire shared read access for at most the given duration.
+        template <class Rep, class Period>
+        ALWAYS_INLINE bool TryReadFor(const std::chrono::duration<Rep, Period> &timeout) {
+            return this->TryReadUntil(std::chrono::steady_clock::now() + timeout);
+        }
+
+        /// Releases shared read access held by the current thread.
+        ALWAYS_INLINE void ReadUnlock() {
+            const std::uint16_t state = m_state.fetch_sub(OneReader, std::memory_order_release);
+            if ((state & (ReaderMask | WriterParkedBit)) == (OneReader | WriterParkedBit)) UNLIKELY {
+                this->ReadUnlockSlow();
+            }
+        }
+
+        /// Acquires exclusive write access, blocking until all other readers
+        /// and writers have released the lock.
+        ALWAYS_INLINE void Write() {
+            std::uint16_t expected = 0;
+            if (!m_state.compare_exchange_weak(expected, WriterBit, std::memory_order_acquire, std::memory_order_relaxed)) UNLIKELY {
+                this->WriteSlow(nullptr);
+            }
+        }
+
+        /// Attempts to acquire exclusive write access without blocking.
+        ALWAYS_INLINE bool TryWrite() {
+            std::uint16_t state = m_state.load(std::memory_order_relaxed);
+            while ((state & (WriterBit | ReaderMask)) == 0) {
+                if (m_state.compare_exchange_weak(state, state | WriterBit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Attempts to acquire exclusive write access until the given point in time.
+        template <class Clock, class Duration>
+        ALWAYS_INLINE bool TryWriteUntil(const std::chrono::time_point<Clock, Duration> &time) {
+            std::uint16_t expected = 0;
+            if (m_state.compare_exchange_weak(expected, WriterBit, std::memory_order_acquire, std::memory_order_relaxed)) LIKELY {
+                return true;
+            }
+
+            const auto deadline = impl::ToParkDeadline(time);
+            return this->WriteSlow(std::addressof(deadline));
+        }
+
+        /// Attempts to acquire exclusive write access for at most the given duration.
+        template <class Rep, class Period>
+        ALWAYS_INLINE bool TryWriteFor(const std::chrono::duration<Rep, Period> &timeout) {
+            return this->TryWriteUntil(std::chrono::steady_clock::now() + timeout);
+        }
+
+        /// Releases exclusive write access held by the current thread.
+        ALWAYS_INLINE void WriteUnlock() {
+            std::uint16_t expected = WriterBit;
+            if (!m_state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed)) UNLIKELY {
+                this->UnparkWaiters(false, true);
+            }
+        }
+
+        /// Releases exclusive write access and hands the lock over directly
+        /// to the next parked threads, if there are any.
+        ALWAYS_INLINE void WriteUnlockFair() {
+            std::uint16_t expected = WriterBit;
+            if (!m_state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed)) UNLIKELY {
+                this->UnparkWaiters(true, true);
+            }
+        }
+    };
+
+    static_assert(sizeof(RawReadWriteLock) == 2);
+
+    /// A @ref Mutex backed by a one-byte @ref RawMutex.
+    ///
+    /// @tparam T The type of data to guard.
+    template <typename T>
+    using ParkingMutex = Mutex<T, RawMutex>;
+
+    /// A @ref ReadWriteLock backed by a two-byte @ref RawReadWriteLock.
+    ///
+    /// @tparam T The type of data to guard.
+    template <typename T>
+    using ParkingReadWriteLock = ReadWriteLock<T, RawReadWriteLock>;
+
+}
@@ -0,0 +1,184 @@
+/**
+ * @file queue_mutex.hpp
+ * @brief Fair, scalable mutual exclusion through an MCS queue lock.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/impl/cpu_relax.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/mutex.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    namespace impl {
+
+        struct alignas(CacheLineSize) McsNode {
+            static constexpr std::uint32_t Waiting  = 0;
+            static constexpr std::uint32_t Sleeping = 1;
+            static constexpr std::uint32_t Granted  = 2;
+
+            std::atomic<McsNode *> next;
+            std::atomic<std::uint32_t> state;
+        };
+
+        // Every thread owns a small pool of queue nodes, one for each queue
+        // lock it may hold at the same time. This keeps acquisition free of
+        // allocations without requiring the node to outlive a stack frame.
+        struct McsNodePool {
+            static constexpr std::size_t Capacity = 8;
+
+            McsNode nodes[Capacity];
+            std::uint8_t used;
+
+            ALWAYS_INLINE McsNode *Acquire() {
+                const auto index = std::countr_one(used);
+                V_ASSERT(index < static_cast<int>(Capacity), "too many queue locks held by one thread");
+
+                used |= static_cast<std::uint8_t>(1u << index);
+                return std::addressof(nodes[index]);
+            }
+
+            ALWAYS_INLINE void Release(McsNode *node) {
+                const auto index = node - nodes;
+                used &= static_cast<std::uint8_t>(~(1u << index));
+            }
+        };
+
+        inline constinit thread_local McsNodePool t_mcs_node_pool = {};
+
+        // An MCS queue lock.
+        //
+        // Waiters enqueue themselves with a single exchange on the tail and
+        // then wait on a node which no other waiter touches, so contention
+        // does not cause a cache line to bounce between all cores. The lock
+        // is handed over directly to the next waiter in FIFO order.
+        //
+        // Waiters spin briefly before sleeping on their node, which keeps
+        // oversubscribed systems from burning CPU time on spinning threads.
+        class McsLock final {
+        private:
+            static constexpr std::uint32_t SpinCount = 100;
+
+        private:
+            std::atomic<McsNode *> m_tail;
+            // The node of the current owner. Only accessed while holding the lock.
+            McsNode *m_owner;
+
+        private:
+            COLD static void WaitForGrant(McsNode *node) {
+                for (std::uint32_t i = 0; i < SpinCount; ++i) {
+                    if (node->state.load(std::memory_order_acquire) == McsNode::Granted) {
+                        return;
+                    }
+                    CpuRelax();
+                }
+
+                std::uint32_t state = McsNode::Waiting;
+                if (!node->state.compare_exchange_strong(state, McsNode::Sleeping, std::memory_order_acquire, std::memory_order_acquire)) {
+                    // The lock was granted in the meantime.
+                    return;
+                }
+
+                while (node->state.load(std::memory_order_acquire) != McsNode::Granted) {
+                    FutexWait(node->state, McsNode::Sleeping);
+                }
+            }
+
+            COLD static McsNode *WaitForSuccessor(McsNode *node) {
+                // A successor swapped itself into the tail but did not link
+                // itself to us yet. This window is just a few instructions.
+                McsNode *next;
+                while ((next = node->next.load(std::memory_order_acquire)) == nullptr) {
+                    CpuRelax();
+                }
+
+                return next;
+            }
+
+        public:
+            constexpr McsLock() : m_tail(nullptr), m_owner(nullptr) {}
+            constexpr ~McsLock() = default;
+
+            McsLock(const McsLock &) = delete;
+            const McsLock &operator=(const McsLock &) = delete;
+
+            ALWAYS_INLINE void Lock() {
+                McsNode *node = t_mcs_node_pool.Acquire();
+                node->next.store(nullptr, std::memory_order_relaxed);
+                node->state.store(McsNode::Waiting, std::memory_order_relaxed);
+
+                McsNode *prev = m_tail.exchange(node, std::memory_order_acq_rel);
+                if (prev != nullptr) UNLIKELY {
+                    prev->next.store(node, std::memory_order_release);
+                    WaitForGrant(node);
+                }
+
+                m_owner = node;
+            }
+
+            ALWAYS_INLINE bool TryLock() {
+                McsNode *node = t_mcs_node_pool.Acquire();
+                node->next.store(nullptr, std::memory_order_relaxed);
+
+                McsNode *expected = nullptr;
+                if (!m_tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    t_mcs_node_pool.Release(node);
+                    return false;
+                }
+
+                m_owner = node;
+                return true;
+            }
+
+            ALWAYS_INLINE void Unlock() {
+                McsNode *node = m_owner;
+
+                McsNode *next = node->next.load(std::memory_order_acquire);
+                if (next == nullptr) {
+                    // Without a successor, the lock becomes free again.
+                    McsNode *expected = node;
+                    if (m_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) LIKELY {
+                        t_mcs_node_pool.Release(node);
+                        return;
+                    }
+
+                    next = WaitForSuccessor(node);
+                }
+
+                // Hand the lock over to the next waiter in line.
+                if (next->state.exchange(McsNode::Granted, std::memory_order_release) == McsNode::Sleeping) {
+                    FutexWakeOne(next->state);
+                }
+                t_mcs_node_pool.Release(node);
+            }
+        };
+
+    }
+
+    /// A @ref Mutex which queues up waiters and grants them the lock in the
+    /// order they arrived.
+    ///
+    /// Under heavy contention, every waiter spins on a cache line of its own
+    /// instead of all hammering on the shared lock word. This bounds the wait
+    /// time of each thread and keeps the cache coherence traffic constant
+    /// per handover, but makes each uncontended acquisition slightly more
+    /// expensive than with the default @ref Mutex.
+    ///
+    /// Since each thread draws queue nodes from a small fixed-size pool, no
+    /// thread may hold more than eight queue mutexes at the same time. The
+    /// lock must always be released on the thread which acquired it.
+    ///
+    /// @tparam T The type of data to guard.
+    template <typename T>
+    using QueueMutex = Mutex<T, impl::McsLock>;
+
+}
@@ -0,0 +1,161 @@
+/**
+ * @file rcu.hpp
+ * @brief Read-copy-update cells for hot-swappable shared objects.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/epoch.hpp"
+
+namespace vtils {
+
+    template <typename T>
+    struct EpochGuard;
+
+    /// A shared pointer to an immutable object which can be replaced at any
+    /// time without blocking readers.
+    ///
+    /// Readers pin the current epoch and load the pointer, which neither
+    /// takes a lock nor writes to memory shared with other threads. Writers
+    /// publish a new object with a single atomic exchange and retire the
+    /// previous one, which is freed in a batch once every reader that could
+    /// still observe it has finished.
+    ///
+    /// Replacing the object is comparatively expensive, so this is intended
+    /// for large objects which are read constantly and updated rarely, such
+    /// as configuration reloaded at runtime.
+    ///
+    /// @tparam T The type of the shared object.
+    template <typename T>
+    class EpochCell {
+        friend class EpochGuard<T>;
+
+    public:
+        // Copying cells is an error hazard since the point is to share
+        // a common object and not accidentally duplicate it.
+        EpochCell(const EpochCell &) = delete;
+        EpochCell &operator=(const EpochCell &) = delete;
+
+    private:
+        std::atomic<T *> m_ptr;
+
+    private:
+        static void Delete(void *ptr) {
+            delete static_cast<T *>(ptr);
+        }
+
+    public:
+        /// Default-constructs the EpochCell along with its object.
+        EpochCell() : m_ptr(new T()) {}
+
+        /// Constructs the EpochCell from an existing object.
+        explicit EpochCell(std::unique_ptr<T> value) : m_ptr(value.release()) {
+            V_ASSERT(m_ptr.load(std::memory_order_relaxed) != nullptr);
+        }
+
+        /// Constructs the EpochCell with its object in-place, forwarding all
+        /// arguments to the object constructor.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        explicit EpochCell(std::in_place_t, Args &&...args)
+            : m_ptr(new T(std::forward<Args>(args)...)) {}
+
+        /// Destroys the cell along with its current object.
+        ///
+        /// No reader may hold an @ref EpochGuard for this cell anymore.
+        ~EpochCell() {
+            delete m_ptr.load(std::memory_order_relaxed);
+        }
+
+        /// Pins the current epoch and provides access to the current object.
+        ///
+        /// The object stays alive for as long as the returned guard exists,
+        /// even when it is replaced in the meantime. Guards may be nested.
+        ///
+        /// @return A scope guard providing shared access to the object.
+        ALWAYS_INLINE EpochGuard<T> Read() const;
+
+        /// Publishes a new object and schedules the old one for destruction.
+        ///
+        /// This does not wait for readers to finish. The old object is freed
+        /// in a later batch once its grace period has completed.
+        ///
+        /// @param value The new object to publish.
+        void Store(std::unique_ptr<T> value) {
+            V_ASSERT(value != nullptr);
+
+            T *old = m_ptr.exchange(value.release(), std::memory_order_acq_rel);
+            impl::RetireEpochObject(old, &EpochCell::Delete);
+        }
+
+        /// Constructs a new object in-place and publishes it.
+        ///
+        /// @see Store
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        void Emplace(Args &&...args) {
+            this->Store(std::make_unique<T>(std::forward<Args>(args)...));
+        }
+    };
+
+    /// An alias for @ref EpochCell under its commonly known name.
+    template <typename T>
+    using Rcu = EpochCell<T>;
+
+    /// A guard which keeps the current epoch pinned and provides immutable
+    /// access to the object of an @ref EpochCell.
+    ///
+    /// Guards must not be held across calls to @ref RcuSynchronize, and
+    /// their lifetime must never exceed that of the cell.
+    template <typename T>
+    struct EpochGuard {
+        friend class EpochCell<T>;
+
+    public:
+        // Guard is not copyable for the same reason as EpochCell.
+        EpochGuard(const EpochGuard &) = delete;
+        EpochGuard &operator=(const EpochGuard &) = delete;
+
+        // Guard is not movable because pins belong to the current thread.
+        EpochGuard(EpochGuard &&) = delete;
+        EpochGuard &operator=(EpochGuard &&) = delete;
+
+    private:
+        const T *m_ptr;
+
+    private:
+        ALWAYS_INLINE explicit EpochGuard(const EpochCell<T> &cell) {
+            impl::EpochPin();
+            m_ptr = cell.m_ptr.load(std::memory_order_acquire);
+        }
+
+    public:
+        // Unpins the epoch on destruction.
+        ALWAYS_INLINE ~EpochGuard() {
+            impl::EpochUnpin();
+        }
+
+        // Immutable object access, by pointer and by reference.
+        ALWAYS_INLINE const T *operator->() const   { return m_ptr;  }
+        ALWAYS_INLINE const T &operator*()  const & { return *m_ptr; }
+    };
+
+    template <typename T>
+    EpochGuard<T> EpochCell<T>::Read() const {
+        return EpochGuard<T>(*this);
+    }
+
+    /// Blocks until all readers that were active at the time of the call
+    /// have finished, and frees every object retired up to that point.
+    ///
+    /// The calling thread must not hold an @ref EpochGuard itself.
+    inline void RcuSynchronize() {
+        impl::SynchronizeEpochs();
+    }
+
+}
@@ -5,15 +5,18 @@
  */
 #pragma once
 
+#include <concepts>
 #include <optional>
 #include <utility>
 
 #include "vtils/macros/platform.hpp"
+#include "vtils/os/lock_profiling.hpp"
+#include "vtils/os/impl/read_write_lock.futex.hpp"
 #include "vtils/os/impl/util_pointer_value.hpp"
 
 #if defined(V_PLATFORM_WINDOWS)
     #include "vtils/os/impl/read_write_lock.os.windows.hpp"
-#else
+#elif !defined(V_PLATFORM_LINUX)
     #include "vtils/os/impl/read_write_lock.pthread.hpp"
 #endif
 
@@ -55,16 +58,111 @@ namespace vtils {
             ALWAYS_INLINE void WriteUnlock() {
                 m_impl.Get().WriteUnlock();
             }
+
+#if defined(V_PLATFORM_LINUX)
+            ALWAYS_INLINE void UpgradableRead() {
+                m_impl.Get().UpgradableRead();
+            }
+
+            ALWAYS_INLINE bool TryUpgradableRead() {
+                return m_impl.Get().TryUpgradableRead();
+            }
+
+            ALWAYS_INLINE void UpgradableUnlock() {
+                m_impl.Get().UpgradableUnlock();
+            }
+
+            ALWAYS_INLINE void Upgrade() {
+                m_impl.Get().Upgrade();
+            }
+
+            ALWAYS_INLINE void Downgrade() {
+                m_impl.Get().Downgrade();
+            }
+#endif
+        };
+
+        template <typename L>
+        concept SharedLockable = requires (L &l) {
+            { l.Read()        } -> std::same_as<void>;
+            { l.TryRead()     } -> std::same_as<bool>;
+            { l.ReadUnlock()  } -> std::same_as<void>;
+            { l.Write()       } -> std::same_as<void>;
+            { l.TryWrite()    } -> std::same_as<bool>;
+            { l.WriteUnlock() } -> std::same_as<void>;
+        };
+
+        // Raw locks whose read locks are not tied to the acquiring thread hand
+        // out a ticket which must be passed back to release the lock again.
+        template <typename L>
+        concept TicketedSharedLockable = SharedLockable<L> && requires (L &l, typename L::ReadTicket &ticket) {
+            { l.Read(ticket)       } -> std::same_as<void>;
+            { l.TryRead(ticket)    } -> std::same_as<bool>;
+            { l.ReadUnlock(ticket) } -> std::same_as<void>;
+        };
+
+        struct NoReadTicket {};
+
+        template <typename L>
+        struct ReadTicketOf {
+            using Type = NoReadTicket;
+        };
+
+        template <TicketedSharedLockable L>
+        struct ReadTicketOf<L> {
+            using Type = typename L::ReadTicket;
+        };
+
+        template <typename L>
+        using ReadTicket = typename ReadTicketOf<L>::Type;
+
+        template <SharedLockable L>
+        ALWAYS_INLINE void Read(L &l, ReadTicket<L> &ticket) {
+            if constexpr (TicketedSharedLockable<L>) {
+                l.Read(ticket);
+            } else {
+                l.Read();
+            }
+        }
+
+        template <SharedLockable L>
+        ALWAYS_INLINE bool TryRead(L &l, ReadTicket<L> &ticket) {
+            if constexpr (TicketedSharedLockable<L>) {
+                return l.TryRead(ticket);
+            } else {
+                return l.TryRead();
+            }
+        }
+
+        template <SharedLockable L>
+        ALWAYS_INLINE void ReadUnlock(L &l, ReadTicket<L> &ticket) {
+            if constexpr (TicketedSharedLockable<L>) {
+                l.ReadUnlock(ticket);
+            } else {
+                l.ReadUnlock();
+            }
+        }
+
+        template <typename L>
+        concept UpgradableLockable = SharedLockable<L> && requires (L &l) {
+            { l.UpgradableRead()    } -> std::same_as<void>;
+            { l.TryUpgradableRead() } -> std::same_as<bool>;
+            { l.UpgradableUnlock()  } -> std::same_as<void>;
+            { l.Upgrade()           } -> std::same_as<void>;
+            { l.Downgrade()         } -> std::same_as<void>;
         };
 
     }
 
-    template <typename T>
+    template <typename T, impl::SharedLockable RawLock = impl::ReadWriteLock>
     struct ReaderGuard;
 
-    template <typename T>
+    template <typename T, impl::SharedLockable RawLock = impl::ReadWriteLock>
     struct WriterGuard;
 
+    template <typename T, impl::SharedLockable RawLock = impl::ReadWriteLock>
+    struct UpgradableGuard;
+
     /// A synchronization primitive to protect shared data from being simultaneously
     /// accessed by multiple threads.
     ///
@@ -75,15 +173,25 @@ namespace vtils {
     /// can simultaneously gain immutable access to the value. In exclusive mode,
     /// exactly one thread gains read and write access to the value.
     ///
+    /// Where the raw lock supports it, there is also an upgradable mode which
+    /// coexists with readers but not with other upgradable readers, and which
+    /// can later be turned into exclusive access without releasing the lock.
+    /// This is currently available with the Linux default lock and with
+    /// @ref PolicyReadWriteLock.
+    ///
     /// Since manual management of locks is often prone to errors, this one wraps
     /// the value it is intended to protect and only exposes it through a safe API
     /// which ensures proper resource management through RAII.
     ///
-    /// @tparam T The type of data to guard.
-    template <typename T>
+    /// @tparam T       The type of data to guard.
+    /// @tparam RawLock The underlying lock implementation. The default is the
+    ///                 native OS lock. See @ref PolicyReadWriteLock for locks
+    ///                 with a well-defined scheduling policy.
+    template <typename T, impl::SharedLockable RawLock = impl::ReadWriteLock>
     class ReadWriteLock {
-        friend class ReaderGuard<T>;
-        friend class WriterGuard<T>;
+        friend class ReaderGuard<T, RawLock>;
+        friend class WriterGuard<T, RawLock>;
+        friend class UpgradableGuard<T, RawLock>;
 
     public:
         // Copying locks is an error hazard since the point is to protect
@@ -92,7 +200,10 @@ namespace vtils {
         ReadWriteLock &operator=(const ReadWriteLock &) = delete;
 
     private:
-        mutable impl::ReadWriteLock m_raw;
+        mutable RawLock m_raw;
+#if defined(V_ENABLE_LOCK_PROFILING)
+        mutable impl::LockProfileState m_profile;
+#endif
         T m_value;
 
     public:
@@ -117,7 +228,7 @@ namespace vtils {
         ///
         /// @return A scope guard providing shared access to the resource.
         ///         When destructed, the resource will be released again.
-        ALWAYS_INLINE ReaderGuard<T> Read() const;
+        ALWAYS_INLINE ReaderGuard<T, RawLock> Read(V_LOCK_SITE_PARAMETER) const;
 
         /// Attempts to lock the lock for shared access.
         ///
@@ -126,7 +237,7 @@ namespace vtils {
         ///
         /// @return A scope guard providing shared access to the resource on
         ///         success. Otherwise, an empty value.
-        ALWAYS_INLINE std::optional<ReaderGuard<T>> TryRead() const;
+        ALWAYS_INLINE std::optional<ReaderGuard<T, RawLock>> TryRead() const;
 
         /// Locks the lock for exclusive access, blocking the current thread
         /// until it becomes available.
@@ -137,7 +248,7 @@ namespace vtils {
         ///
         /// @return A scope guard providing exclusive access to the resource.
         ///         When destructed, the resource will be released again.
-        ALWAYS_INLINE WriterGuard<T> Write();
+        ALWAYS_INLINE WriterGuard<T, RawLock> Write(V_LOCK_SITE_PARAMETER);
 
         /// Attempts to lock the lock for exclusive access.
         ///
@@ -147,16 +258,28 @@ namespace vtils {
         ///
         /// @return A scope guard providing exclusive access to the resource on
         ///         success. Otherwise, an empty value.
-        ALWAYS_INLINE std::optional<WriterGuard<T>> TryWrite();
+        ALWAYS_INLINE std::optional<WriterGuard<T, RawLock>> TryWrite();
+
+        /// Locks the lock for upgradable shared access, blocking the current
+        /// thread until it becomes available.
+        ///
+        /// Upgradable access is shared with plain readers, but only one thread
+        /// can hold it at a time. This makes it possible to inspect the value
+        /// and then decide to modify it with @ref UpgradableGuard::Upgrade,
+        /// without another writer slipping in between.
+        ///
+        /// @return A scope guard providing upgradable access to the resource.
+        ///         When destructed, the resource will be released again.
+        ALWAYS_INLINE UpgradableGuard<T, RawLock> UpgradableRead(V_LOCK_SITE_PARAMETER) requires impl::UpgradableLockable<RawLock>;
     };
 
     /// A lock guard providing RAII semantics for shared access to the value.
     ///
     /// When working with a guard object, its lifetime must never exceed that
     /// of the @ref ReadWriteLock it was obtained from.
-    template <typename T>
+    template <typename T, impl::SharedLockable RawLock>
     struct ReaderGuard {
-        friend class ReadWriteLock<T>;
+        friend class ReadWriteLock<T, RawLock>;
 
     public:
         // Guard is not copyable for the same reason as ReadWriteLock.
@@ -170,16 +293,28 @@ namespace vtils {
 
     private:
         const T *m_ptr;
-        impl::ReadWriteLock &m_raw;
+        RawLock &m_raw;
+        [[no_unique_address]] impl::ReadTicket<RawLock> m_ticket;
+#if defined(V_ENABLE_LOCK_PROFILING)
+        impl::LockProfileToken m_token;
+#endif
 
     private:
-        ALWAYS_INLINE explicit ReaderGuard(const ReadWriteLock<T> &lock)
-            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw) {}
+        ALWAYS_INLINE ReaderGuard(const ReadWriteLock<T, RawLock> &lock, const impl::ReadTicket<RawLock> &ticket)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw), m_ticket(ticket) {}
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+        ALWAYS_INLINE ReaderGuard(const ReadWriteLock<T, RawLock> &lock, const impl::ReadTicket<RawLock> &ticket, const impl::LockProfileToken &token)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw), m_ticket(ticket), m_token(token) {}
+#endif
 
     public:
         // Releases exclusive access to the resource on destruction.
         ALWAYS_INLINE ~ReaderGuard() {
-            m_raw.ReadUnlock();
+#if defined(V_ENABLE_LOCK_PROFILING)
+            m_token.Release();
+#endif
+            impl::ReadUnlock(m_raw, m_ticket);
         }
 
         // Immutable resource access, by pointer and by reference.
@@ -191,9 +326,9 @@ namespace vtils {
     ///
     /// When working with a guard object, its lifetime must never exceed that
     /// of the @ref ReadWriteLock it was obtained from.
-    template <typename T>
+    template <typename T, impl::SharedLockable RawLock>
     struct WriterGuard {
-        friend class ReadWriteLock<T>;
+        friend class ReadWriteLock<T, RawLock>;
 
     public:
         // Guard is not copyable for the same reason as ReadWriteLock.
@@ -207,15 +342,41 @@ namespace vtils {
 
     private:
         T *m_ptr;
-        impl::ReadWriteLock &m_raw;
+        RawLock &m_raw;
+        // Whether the lock was upgraded from an @ref UpgradableGuard, which
+        // gets its read lock back when this guard goes away.
+        bool m_upgraded;
+#if defined(V_ENABLE_LOCK_PROFILING)
+        impl::LockProfileToken m_token;
+#endif
 
     private:
-        ALWAYS_INLINE explicit WriterGuard(ReadWriteLock<T> &lock)
-            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw) {}
+        ALWAYS_INLINE explicit WriterGuard(ReadWriteLock<T, RawLock> &lock)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw), m_upgraded(false) {}
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+        ALWAYS_INLINE WriterGuard(ReadWriteLock<T, RawLock> &lock, const impl::LockProfileToken &token)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw), m_upgraded(false), m_token(token) {}
+#endif
+
+        friend struct UpgradableGuard<T, RawLock>;
+
+        ALWAYS_INLINE WriterGuard(T *ptr, RawLock &raw)
+            : m_ptr(ptr), m_raw(raw), m_upgraded(true) {}
 
     public:
         // Releases exclusive access to the resource on destruction.
         ALWAYS_INLINE ~WriterGuard() {
+#if defined(V_ENABLE_LOCK_PROFILING)
+            m_token.Release();
+#endif
+            if constexpr (impl::UpgradableLockable<RawLock>) {
+                if (m_upgraded) {
+                    m_raw.Downgrade();
+                    return;
+                }
+            }
+
             m_raw.WriteUnlock();
         }
 
@@ -228,29 +389,104 @@ namespace vtils {
         ALWAYS_INLINE T &operator*()  & { return *m_ptr; }
     };
 
-    template<typename T>
-    ReaderGuard<T> ReadWriteLock<T>::Read() const {
-        m_raw.Read();
-        return ReaderGuard(*this);
+    /// A lock guard providing RAII semantics for upgradable shared access
+    /// to the value.
+    ///
+    /// When working with a guard object, its lifetime must never exceed that
+    /// of the @ref ReadWriteLock it was obtained from.
+    template <typename T, impl::SharedLockable RawLock>
+    struct UpgradableGuard {
+        friend class ReadWriteLock<T, RawLock>;
+
+    public:
+        // Guard is not copyable for the same reason as ReadWriteLock.
+        UpgradableGuard(const UpgradableGuard &) = delete;
+        UpgradableGuard &operator=(const UpgradableGuard &) = delete;
+
+        // Guard is not movable because it represents a permit to access
+        // the locked value on the current thread.
+        UpgradableGuard(UpgradableGuard &&) = delete;
+        UpgradableGuard &operator=(UpgradableGuard &&) = delete;
+
+    private:
+        T *m_ptr;
+        RawLock &m_raw;
+#if defined(V_ENABLE_LOCK_PROFILING)
+        impl::LockProfileToken m_token;
+#endif
+
+    private:
+        ALWAYS_INLINE explicit UpgradableGuard(ReadWriteLock<T, RawLock> &lock)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw) {}
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+        ALWAYS_INLINE UpgradableGuard(ReadWriteLock<T, RawLock> &lock, const impl::LockProfileToken &token)
+            : m_ptr(std::addressof(lock.m_value)), m_raw(lock.m_raw), m_token(token) {}
+#endif
+
+    public:
+        // Releases upgradable access to the resource on destruction.
+        ALWAYS_INLINE ~UpgradableGuard() {
+#if defined(V_ENABLE_LOCK_PROFILING)
+            m_token.Release();
+#endif
+            m_raw.UpgradableUnlock();
+        }
+
+        /// Atomically upgrades to exclusive access, blocking the current
+        /// thread until all other readers have released the lock.
+        ///
+        /// No other writer can acquire the lock in between, so everything
+        /// observed through this guard still holds afterwards. Destroying
+        /// the returned guard downgrades back to upgradable access, which
+        /// is why it must not outlive this guard.
+        ///
+        /// @return A scope guard providing exclusive access to the resource.
+        ALWAYS_INLINE WriterGuard<T, RawLock> Upgrade() {
+            m_raw.Upgrade();
+            return WriterGuard<T, RawLock>(m_ptr, m_raw);
+        }
+
+        // Immutable resource access, by pointer and by reference.
+        ALWAYS_INLINE const T *operator->() const   { return m_ptr;  }
+        ALWAYS_INLINE const T &operator*()  const & { return *m_ptr; }
+    };
+
+    template <typename T, impl::SharedLockable RawLock>
+    ReaderGuard<T, RawLock> ReadWriteLock<T, RawLock>::Read(V_LOCK_SITE_PARAMETER_DEF) const {
+        impl::ReadTicket<RawLock> ticket{};
+#if defined(V_ENABLE_LOCK_PROFILING)
+        const auto token = m_profile.Acquire(site, [&] { return impl::TryRead(m_raw, ticket); }, [&] { impl::Read(m_raw, ticket); });
+        return ReaderGuard(*this, ticket, token);
+#else
+        impl::Read(m_raw, ticket);
+        return ReaderGuard(*this, ticket);
+#endif
     }
 
-    template<typename T>
-    std::optional<ReaderGuard<T>> ReadWriteLock<T>::TryRead() const {
-        if (!m_raw.TryRead()) {
+    template <typename T, impl::SharedLockable RawLock>
+    std::optional<ReaderGuard<T, RawLock>> ReadWriteLock<T, RawLock>::TryRead() const {
+        impl::ReadTicket<RawLock> ticket{};
+        if (!impl::TryRead(m_raw, ticket)) {
             return {};
         }
 
-        return ReaderGuard(*this);
+        return ReaderGuard(*this, ticket);
     }
 
-    template<typename T>
-    WriterGuard<T> ReadWriteLock<T>::Write() {
+    template <typename T, impl::SharedLockable RawLock>
+    WriterGuard<T, RawLock> ReadWriteLock<T, RawLock>::Write(V_LOCK_SITE_PARAMETER_DEF) {
+#if defined(V_ENABLE_LOCK_PROFILING)
+        const auto token = m_profile.Acquire(site, [&] { return m_raw.TryWrite(); }, [&] { m_raw.Write(); });
+        return WriterGuard(*this, token);
+#else
         m_raw.Write();
         return WriterGuard(*this);
+#endif
     }
 
-    template<typename T>
-    std::optional<WriterGuard<T>> ReadWriteLock<T>::TryWrite() {
+    template <typename T, impl::SharedLockable RawLock>
+    std::optional<WriterGuard<T, RawLock>> ReadWriteLock<T, RawLock>::TryWrite() {
         if (!m_raw.TryWrite()) {
             return {};
         }
@@ -258,4 +494,26 @@ namespace vtils {
         return WriterGuard(*this);
     }
 
+    template <typename T, impl::SharedLockable RawLock>
+    UpgradableGuard<T, RawLock> ReadWriteLock<T, RawLock>::UpgradableRead(V_LOCK_SITE_PARAMETER_DEF) requires impl::UpgradableLockable<RawLock> {
+#if defined(V_ENABLE_LOCK_PROFILING)
+        const auto token = m_profile.Acquire(site, [&] { return m_raw.TryUpgradableRead(); }, [&] { m_raw.UpgradableRead(); });
+        return UpgradableGuard(*this, token);
+#else
+        m_raw.UpgradableRead();
+        return UpgradableGuard(*this);
+#endif
+    }
+
+    /// A @ref ReadWriteLock with a fixed scheduling policy between readers
+    /// and writers, chosen at compile time.
+    ///
+    /// The lock state is stored inline and never allocates. Uncontended read
+    /// acquisition is a single atomic addition.
+    ///
+    /// @tparam T      The type of data to guard.
+    /// @tparam Policy The @ref ReadWritePolicy to apply.
+    template <typename T, ReadWritePolicy Policy>
+    using PolicyReadWriteLock = ReadWriteLock<T, impl::FutexReadWriteLockImpl<Policy>>;
+
 }
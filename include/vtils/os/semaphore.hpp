@@ -0,0 +1,147 @@
+/**
+ * @file semaphore.hpp
+ * @brief Counting semaphores built directly on futexes.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    /// A counting semaphore which limits concurrent access to a resource.
+    ///
+    /// The semaphore holds a number of permits. Acquiring one takes it from
+    /// the count, blocking the current thread while none are available, and
+    /// releasing hands it back. Unlike a @ref Mutex, a permit is not tied to
+    /// the thread which acquired it and may be released by any other.
+    ///
+    /// The count doubles as the futex word that waiters sleep on. Acquiring
+    /// an available permit is a single compare-and-swap and releasing one an
+    /// atomic addition, so the kernel is only involved when threads actually
+    /// need to be put to sleep or woken up.
+    class Semaphore {
+    public:
+        // Copying semaphores is an error hazard since the point is
+        // to synchronize threads through a common counter.
+        Semaphore(const Semaphore &) = delete;
+        Semaphore &operator=(const Semaphore &) = delete;
+
+    public:
+        /// The maximum number of permits a semaphore can hold.
+        static constexpr std::uint32_t Max = std::numeric_limits<std::uint32_t>::max();
+
+    private:
+        std::atomic<std::uint32_t> m_count;
+        // The number of threads which are about to sleep or sleeping.
+        std::atomic<std::uint32_t> m_waiters;
+
+    private:
+        // Returns `false` on timeout. Waits indefinitely without a deadline.
+        COLD bool AcquireSlow(const std::chrono::steady_clock::time_point *deadline) {
+            while (true) {
+                if (this->TryAcquire()) {
+                    return true;
+                }
+
+                // Registering as a waiter and reading the count in the kernel
+                // is ordered against releasing and checking for waiters, so
+                // either we observe the new permit or the releaser sees us.
+                m_waiters.fetch_add(1, std::memory_order_seq_cst);
+                bool success = true;
+                if (deadline != nullptr) {
+                    success = impl::FutexWaitUntil(m_count, 0, *deadline);
+                } else {
+                    impl::FutexWait(m_count, 0);
+                }
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+                if (!success) {
+                    return this->TryAcquire();
+                }
+            }
+        }
+
+    public:
+        /// Constructs a semaphore with the given number of permits.
+        ALWAYS_INLINE constexpr explicit Semaphore(std::uint32_t count = 0)
+            : m_count(count), m_waiters(0) {}
+
+        /// Attempts to take a permit without blocking.
+        ///
+        /// @return `true` when a permit was taken, `false` when none are available.
+        ALWAYS_INLINE bool TryAcquire() {
+            std::uint32_t count = m_count.load(std::memory_order_relaxed);
+            while (count != 0) {
+                if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /// Takes a permit, blocking the current thread until one is available.
+        ALWAYS_INLINE void Acquire() {
+            if (!this->TryAcquire()) UNLIKELY {
+                this->AcquireSlow(nullptr);
+            }
+        }
+
+        /// Takes a permit, blocking the current thread until one is available
+        /// or the given point in time has been reached.
+        ///
+        /// @param time The deadline to wait until.
+        /// @return `true` when a permit was taken, `false` on timeout.
+        template <class Clock, class Duration>
+        ALWAYS_INLINE bool TryAcquireUntil(const std::chrono::time_point<Clock, Duration> &time) {
+            if (this->TryAcquire()) {
+                return true;
+            }
+
+            const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time - Clock::now());
+            return this->AcquireSlow(std::addressof(end));
+        }
+
+        /// Takes a permit, blocking the current thread until one is available
+        /// or the given duration has elapsed.
+        ///
+        /// @param time The duration to wait for.
+        /// @return `true` when a permit was taken, `false` on timeout.
+        template <class Rep, class Period>
+        ALWAYS_INLINE bool TryAcquireFor(const std::chrono::duration<Rep, Period> &time) {
+            if (this->TryAcquire()) {
+                return true;
+            }
+
+            const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time);
+            return this->AcquireSlow(std::addressof(end));
+        }
+
+        /// Hands `count` permits back to the semaphore and wakes up to as
+        /// many waiting threads.
+        ///
+        /// @param count The number of permits to release.
+        ALWAYS_INLINE void Release(std::uint32_t count = 1) {
+            [[maybe_unused]] const std::uint32_t old = m_count.fetch_add(count, std::memory_order_seq_cst);
+            V_DEBUG_ASSERT(count <= Max - old, "semaphore count overflow");
+
+            // Waking more threads than there are permits would only send
+            // the surplus straight back to sleep.
+            if (const std::uint32_t waiters = m_waiters.load(std::memory_order_seq_cst); waiters != 0) UNLIKELY {
+                impl::FutexWake(m_count, static_cast<int>(std::min<std::uint32_t>({ count, waiters, INT_MAX })));
+            }
+        }
+    };
+
+}
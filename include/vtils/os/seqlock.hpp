@@ -0,0 +1,152 @@
+/**
+ * @file seqlock.hpp
+ * @brief Sequence locks for small, frequently read snapshots.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/impl/cpu_relax.hpp"
+#include "vtils/scope_guard.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/mutex.hpp"
+
+namespace vtils {
+
+    /// A synchronization primitive for sharing small values which are read
+    /// far more often than they are written.
+    ///
+    /// Readers never write to shared memory. Instead, they copy the value
+    /// optimistically and retry when a writer modified it concurrently. This
+    /// makes reads very cheap and keeps the cache line shared between cores,
+    /// at the expense of readers spinning while a write is in progress.
+    ///
+    /// Writers are serialized through a @ref Mutex.
+    ///
+    /// Since readers may observe a torn value before retrying, the value must
+    /// be trivially copyable. It is stored as an array of atomic words so that
+    /// these racy copies remain well-defined.
+    ///
+    /// @tparam T The type of value to share.
+    template <typename T> requires std::is_trivially_copyable_v<T>
+    class SeqLock {
+    public:
+        // Copying locks is an error hazard since the point is to protect
+        // a common shared value and not accidentally duplicate it.
+        SeqLock(const SeqLock &) = delete;
+        SeqLock &operator=(const SeqLock &) = delete;
+
+    private:
+        using Word = std::uintptr_t;
+
+        static constexpr std::size_t Words = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    private:
+        // An odd sequence number indicates that a write is in progress.
+        std::atomic<std::uint32_t> m_seq;
+        std::atomic<Word> m_data[Words];
+        impl::Mutex m_mutex;
+
+    private:
+        ALWAYS_INLINE void StoreWords(const T &value) {
+            Word words[Words] = {};
+            std::memcpy(words, std::addressof(value), sizeof(T));
+
+            for (std::size_t i = 0; i < Words; ++i) {
+                m_data[i].store(words[i], std::memory_order_relaxed);
+            }
+        }
+
+        ALWAYS_INLINE void WriteLocked(const T &value) {
+            const std::uint32_t seq = m_seq.load(std::memory_order_relaxed);
+
+            // Make the sequence odd before any of the data stores become visible.
+            m_seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            this->StoreWords(value);
+
+            m_seq.store(seq + 2, std::memory_order_release);
+        }
+
+    public:
+        /// Default-constructs the SeqLock along with its value.
+        SeqLock() : SeqLock(T{}) {}
+
+        /// Constructs the SeqLock from an initial value.
+        explicit SeqLock(const T &value) : m_seq(0), m_data(), m_mutex() {
+            this->StoreWords(value);
+        }
+
+        /// Constructs the SeqLock with its value in-place, forwarding all
+        /// arguments to the value constructor.
+        template <typename... Args> requires std::is_constructible_v<T, Args...>
+        explicit SeqLock(std::in_place_t, Args &&...args) : SeqLock(T(std::forward<Args>(args)...)) {}
+
+        /// Reads a consistent snapshot of the value.
+        ///
+        /// This never blocks on the writer mutex, but spins while a write
+        /// is in progress.
+        ///
+        /// @return A copy of the value.
+        T Read() const {
+            Word words[Words];
+
+            while (true) {
+                const std::uint32_t seq = m_seq.load(std::memory_order_acquire);
+                if (seq & 1) UNLIKELY {
+                    impl::CpuRelax();
+                    continue;
+                }
+
+                for (std::size_t i = 0; i < Words; ++i) {
+                    words[i] = m_data[i].load(std::memory_order_relaxed);
+                }
+
+                // Keep the data loads from being reordered past the re-check.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq.load(std::memory_order_relaxed) == seq) LIKELY {
+                    break;
+                }
+            }
+
+            // Trivially copyable types are implicit-lifetime types, so copying
+            // the bytes into suitable storage creates the object for us.
+            alignas(T) std::byte value[sizeof(T)];
+            std::memcpy(value, words, sizeof(T));
+            return *std::launder(reinterpret_cast<T *>(value));
+        }
+
+        /// Replaces the value, blocking until other writers are done.
+        ///
+        /// @param value The new value to store.
+        void Write(const T &value) {
+            m_mutex.Lock();
+            this->WriteLocked(value);
+            m_mutex.Unlock();
+        }
+
+        /// Atomically modifies the value with respect to other writers.
+        ///
+        /// @param fn A callable which receives a mutable copy of the current
+        ///           value. The modified copy is stored back afterwards.
+        template <class Fn> requires std::is_invocable_v<Fn, T&>
+        void Update(Fn fn) {
+            m_mutex.Lock();
+            V_ON_SCOPE_EXIT { m_mutex.Unlock(); };
+
+            // We are the only writer, so this will not spin.
+            T value = this->Read();
+            fn(value);
+            this->WriteLocked(value);
+        }
+    };
+
+}
@@ -0,0 +1,225 @@
+/**
+ * @file sharded_read_write_lock.hpp
+ * @brief Reader-writer lock with per-thread reader slots for read-mostly data.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/mutex.hpp"
+#include "vtils/os/read_write_lock.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    namespace impl {
+
+        // Hands out a stable, densely allocated index for the calling thread.
+        ALWAYS_INLINE std::uint32_t GetThreadShardIndex() {
+            static constinit std::atomic<std::uint32_t> s_next_index = 0;
+            static constinit thread_local std::uint32_t t_index = ~std::uint32_t{0};
+
+            if (t_index == ~std::uint32_t{0}) UNLIKELY {
+                t_index = s_next_index.fetch_add(1, std::memory_order_relaxed) & 0x7FFF'FFFF;
+            }
+
+            return t_index;
+        }
+
+        // A big-reader lock. Every thread announces itself as a reader in its
+        // own cache line, so readers on different cores never contend with
+        // each other. Writers are serialized by a mutex, raise a flag which
+        // turns away new readers and then wait until every slot is drained.
+        //
+        // Since readers back off as soon as a writer shows up, writers are
+        // preferred and cannot be starved by a continuous stream of readers.
+        //
+        // A read lock must be released on the slot it was taken on. The plain
+        // `Read` and `ReadUnlock` pick the slot of the calling thread and must
+        // therefore be paired on one thread. The overloads taking a ticket
+        // remember the slot instead, which is what @ref ReaderGuard uses so
+        // that guards may be released from fibers and coroutines which have
+        // moved to a different thread.
+        template <std::size_t Shards>
+        class ShardedReadWriteLockImpl final {
+            static_assert(IsPowerOfTwo(Shards));
+
+        private:
+            static constexpr std::uint32_t NoWriter       = 0;
+            static constexpr std::uint32_t WriterActive   = 1;
+            static constexpr std::uint32_t ReadersWaiting = 2;
+
+            struct alignas(CacheLineSize) Slot {
+                std::atomic<std::uint32_t> readers;
+
+                constexpr Slot() : readers(0) {}
+            };
+
+        public:
+            // The reader slot a read lock was taken on.
+            using ReadTicket = std::atomic<std::uint32_t> *;
+
+        private:
+            Slot m_slots[Shards];
+            alignas(CacheLineSize) std::atomic<std::uint32_t> m_writer;
+            Mutex m_writer_mutex;
+
+        private:
+            ALWAYS_INLINE std::atomic<std::uint32_t> &GetSlot() {
+                return m_slots[GetThreadShardIndex() & (Shards - 1)].readers;
+            }
+
+            // Retracts a reader announcement made while a writer is active.
+            ALWAYS_INLINE void Retract(std::atomic<std::uint32_t> &slot) {
+                if (slot.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+                    FutexWakeAll(slot);
+                }
+            }
+
+            COLD void WaitForWriter() {
+                std::uint32_t writer = m_writer.load(std::memory_order_relaxed);
+                while (writer != NoWriter) {
+                    if (writer == WriterActive && !m_writer.compare_exchange_weak(writer, ReadersWaiting, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                        continue;
+                    }
+
+                    FutexWait(m_writer, ReadersWaiting);
+                    writer = m_writer.load(std::memory_order_relaxed);
+                }
+            }
+
+            COLD void ReadContended(std::atomic<std::uint32_t> &slot) {
+                do {
+                    this->Retract(slot);
+                    this->WaitForWriter();
+
+                    slot.fetch_add(1, std::memory_order_seq_cst);
+                } while (m_writer.load(std::memory_order_seq_cst) != NoWriter);
+            }
+
+            ALWAYS_INLINE void ReleaseWriter() {
+                if (m_writer.exchange(NoWriter, std::memory_order_release) == ReadersWaiting) {
+                    FutexWakeAll(m_writer);
+                }
+                m_writer_mutex.Unlock();
+            }
+
+        public:
+            constexpr ShardedReadWriteLockImpl() : m_slots(), m_writer(NoWriter), m_writer_mutex() {}
+            constexpr ~ShardedReadWriteLockImpl() = default;
+
+            ShardedReadWriteLockImpl(const ShardedReadWriteLockImpl &) = delete;
+            const ShardedReadWriteLockImpl &operator=(const ShardedReadWriteLockImpl &) = delete;
+
+            ALWAYS_INLINE void Read(ReadTicket &ticket) {
+                // The announcement and the writer check must not be reordered
+                // with the writer's flag store and its sweep over the slots.
+                auto &slot = this->GetSlot();
+                slot.fetch_add(1, std::memory_order_seq_cst);
+
+                if (m_writer.load(std::memory_order_seq_cst) != NoWriter) UNLIKELY {
+                    this->ReadContended(slot);
+                }
+
+                ticket = std::addressof(slot);
+            }
+
+            ALWAYS_INLINE bool TryRead(ReadTicket &ticket) {
+                auto &slot = this->GetSlot();
+                slot.fetch_add(1, std::memory_order_seq_cst);
+
+                if (m_writer.load(std::memory_order_seq_cst) != NoWriter) UNLIKELY {
+                    this->Retract(slot);
+                    return false;
+                }
+
+                ticket = std::addressof(slot);
+                return true;
+            }
+
+            ALWAYS_INLINE void ReadUnlock(ReadTicket ticket) {
+                // Only a writer sweeping the slots may be waiting for us.
+                const std::uint32_t readers = ticket->fetch_sub(1, std::memory_order_seq_cst);
+                V_DEBUG_ASSERT(readers != 0, "read lock released on a slot it was not taken on");
+
+                if (readers == 1 && m_writer.load(std::memory_order_seq_cst) != NoWriter) UNLIKELY {
+                    FutexWakeAll(*ticket);
+                }
+            }
+
+            ALWAYS_INLINE void Read() {
+                ReadTicket ticket;
+                this->Read(ticket);
+            }
+
+            ALWAYS_INLINE bool TryRead() {
+                ReadTicket ticket;
+                return this->TryRead(ticket);
+            }
+
+            ALWAYS_INLINE void ReadUnlock() {
+                this->ReadUnlock(std::addressof(this->GetSlot()));
+            }
+
+            void Write() {
+                m_writer_mutex.Lock();
+                m_writer.store(WriterActive, std::memory_order_seq_cst);
+
+                // Wait for all readers which got in before us to leave.
+                for (auto &slot : m_slots) {
+                    std::uint32_t readers = slot.readers.load(std::memory_order_seq_cst);
+                    while (readers != 0) {
+                        FutexWait(slot.readers, readers);
+                        readers = slot.readers.load(std::memory_order_seq_cst);
+                    }
+                }
+            }
+
+            bool TryWrite() {
+                if (!m_writer_mutex.TryLock()) {
+                    return false;
+                }
+
+                m_writer.store(WriterActive, std::memory_order_seq_cst);
+
+                for (auto &slot : m_slots) {
+                    if (slot.readers.load(std::memory_order_seq_cst) != 0) {
+                        this->ReleaseWriter();
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            ALWAYS_INLINE void WriteUnlock() {
+                this->ReleaseWriter();
+            }
+        };
+
+    }
+
+    /// A @ref ReadWriteLock optimized for data which is read far more often
+    /// than it is written.
+    ///
+    /// Readers only touch a cache line dedicated to their own thread, so read
+    /// throughput scales with the number of cores instead of bouncing a shared
+    /// lock word between them. In turn, writers must sweep over all reader slots
+    /// and the lock occupies `Shards` cache lines.
+    ///
+    /// Writers are preferred over readers. Recursively acquiring shared access
+    /// on a single thread may therefore deadlock when a writer is waiting.
+    ///
+    /// @tparam T      The type of data to guard.
+    /// @tparam Shards The number of reader slots. Must be a power of two.
+    template <typename T, std::size_t Shards = 64>
+    using ShardedReadWriteLock = ReadWriteLock<T, impl::ShardedReadWriteLockImpl<Shards>>;
+
+}
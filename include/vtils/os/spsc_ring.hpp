@@ -0,0 +1,262 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief Wait-free single-producer, single-consumer ring buffer.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <type_traits>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+
+namespace vtils {
+
+    /// A bounded FIFO ring buffer for passing elements from exactly one
+    /// producer thread to exactly one consumer thread.
+    ///
+    /// Every operation completes in a bounded number of steps. Each side
+    /// owns its index on a separate cache line and keeps a cached copy of
+    /// the other side's index. The remote index is only loaded again when
+    /// the cached copy suggests that the ring is full or empty. Streaming
+    /// elements through the ring therefore rarely touches lines written by
+    /// the other thread.
+    ///
+    /// Besides single elements, both sides can work on whole batches. The
+    /// producer may `Reserve` contiguous slots, fill them in place and then
+    /// `Commit` all of them with a single release store. The consumer can
+    /// `Peek` and `Consume` in the same way. `Write` and `Read` copy whole
+    /// spans at once.
+    ///
+    /// The slots may live in a buffer owned by the ring or in memory that
+    /// the caller provides, such as a region of a @ref MemoryMapped file.
+    ///
+    /// @tparam T The type of the elements, which must be trivially copyable.
+    template <typename T> requires std::is_trivially_copyable_v<T>
+    class SpscRing {
+    public:
+        // Copying rings is an error hazard since the point is to
+        // pass elements between threads through a common buffer.
+        SpscRing(const SpscRing &) = delete;
+        SpscRing &operator=(const SpscRing &) = delete;
+
+    private:
+        static constexpr std::align_val_t BufferAlignment{std::max(alignof(T), CacheLineSize)};
+
+    private:
+        T *const m_buffer;
+        const std::size_t m_mask;
+        const bool m_owned;
+
+        // Written by the producer, along with its cached copy of `m_head`.
+        alignas(CacheLineSize) std::atomic<std::size_t> m_tail;
+        std::size_t m_cached_head;
+
+        // Written by the consumer, along with its cached copy of `m_tail`.
+        alignas(CacheLineSize) std::atomic<std::size_t> m_head;
+        std::size_t m_cached_tail;
+
+    private:
+        // Gets the number of free slots, refreshing the cached head when
+        // fewer than `wanted` appear to be available.
+        ALWAYS_INLINE std::size_t GetFree(std::size_t tail, std::size_t wanted) {
+            std::size_t free = this->GetCapacity() - (tail - m_cached_head);
+            if (free < wanted) {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+                free = this->GetCapacity() - (tail - m_cached_head);
+            }
+
+            return free;
+        }
+
+        // Gets the number of readable slots, refreshing the cached tail when
+        // fewer than `wanted` appear to be available.
+        ALWAYS_INLINE std::size_t GetAvailable(std::size_t head, std::size_t wanted) {
+            std::size_t available = m_cached_tail - head;
+            if (available < wanted) {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+                available = m_cached_tail - head;
+            }
+
+            return available;
+        }
+
+    public:
+        /// Constructs an empty ring with a buffer of its own.
+        ///
+        /// @param capacity The minimum number of elements the ring can hold.
+        ///                 It is rounded up to the next power of two.
+        explicit SpscRing(std::size_t capacity)
+            : m_buffer(static_cast<T *>(::operator new(std::bit_ceil(std::max<std::size_t>(capacity, 1)) * sizeof(T), BufferAlignment))),
+              m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1),
+              m_owned(true),
+              m_tail(0), m_cached_head(0), m_head(0), m_cached_tail(0) {}
+
+        /// Constructs an empty ring which uses the given memory for its slots.
+        ///
+        /// The memory must outlive the ring and must not be used by anything
+        /// else in the meantime.
+        ///
+        /// @param storage The slots, whose count must be a power of two.
+        explicit SpscRing(std::span<T> storage)
+            : m_buffer(storage.data()), m_mask(storage.size() - 1), m_owned(false),
+              m_tail(0), m_cached_head(0), m_head(0), m_cached_tail(0) {
+            V_ASSERT(std::has_single_bit(storage.size()), "ring capacity must be a power of two");
+        }
+
+        /// Destroys the ring. Elements left in it are discarded.
+        ~SpscRing() {
+            if (m_owned) {
+                ::operator delete(m_buffer, BufferAlignment);
+            }
+        }
+
+        /// Gets the maximum number of elements the ring can hold.
+        ALWAYS_INLINE std::size_t GetCapacity() const {
+            return m_mask + 1;
+        }
+
+        /// Gets the number of elements in the ring. This is only a snapshot
+        /// and may be outdated by the time it returns.
+        ALWAYS_INLINE std::size_t GetSize() const {
+            const std::size_t head = m_head.load(std::memory_order_acquire);
+            const std::size_t tail = m_tail.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+        /// Reserves up to `count` contiguous slots for the producer to write.
+        ///
+        /// The slots only become visible to the consumer after they are
+        /// published with @ref Commit. Fewer slots than requested are
+        /// returned when the ring is nearly full or the free space wraps
+        /// around its end. Must only be called by the producer.
+        ///
+        /// @param count The maximum number of slots to reserve.
+        /// @return The reserved slots, which may be empty.
+        ALWAYS_INLINE std::span<T> Reserve(std::size_t count) {
+            const std::size_t tail  = m_tail.load(std::memory_order_relaxed);
+            const std::size_t index = tail & m_mask;
+
+            count = std::min({ count, this->GetFree(tail, count), this->GetCapacity() - index });
+            return std::span<T>(m_buffer + index, count);
+        }
+
+        /// Publishes the first `count` slots obtained from @ref Reserve to
+        /// the consumer. Must only be called by the producer.
+        ///
+        /// @param count The number of slots which were written.
+        ALWAYS_INLINE void Commit(std::size_t count) {
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            V_DEBUG_ASSERT(count <= this->GetCapacity() - (tail - m_cached_head), "committed more slots than reserved");
+
+            m_tail.store(tail + count, std::memory_order_release);
+        }
+
+        /// Gets up to `count` contiguous elements for the consumer to read.
+        ///
+        /// The elements stay in the ring until they are released with
+        /// @ref Consume. Fewer elements than requested are returned when
+        /// the ring holds less or the elements wrap around its end. Must
+        /// only be called by the consumer.
+        ///
+        /// @param count The maximum number of elements to get.
+        /// @return The readable elements, which may be empty.
+        ALWAYS_INLINE std::span<const T> Peek(std::size_t count) {
+            const std::size_t head  = m_head.load(std::memory_order_relaxed);
+            const std::size_t index = head & m_mask;
+
+            count = std::min({ count, this->GetAvailable(head, count), this->GetCapacity() - index });
+            return std::span<const T>(m_buffer + index, count);
+        }
+
+        /// Removes the first `count` elements obtained from @ref Peek and
+        /// hands their slots back to the producer. Must only be called by
+        /// the consumer.
+        ///
+        /// @param count The number of elements which were read.
+        ALWAYS_INLINE void Consume(std::size_t count) {
+            const std::size_t head = m_head.load(std::memory_order_relaxed);
+            V_DEBUG_ASSERT(count <= m_cached_tail - head, "consumed more elements than available");
+
+            m_head.store(head + count, std::memory_order_release);
+        }
+
+        /// Attempts to add an element to the end of the ring. Must only be
+        /// called by the producer.
+        ///
+        /// @return `true` when the element was added, `false` when the ring
+        ///         was full.
+        ALWAYS_INLINE bool TryPush(const T &value) {
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (this->GetFree(tail, 1) == 0) {
+                return false;
+            }
+
+            m_buffer[tail & m_mask] = value;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Attempts to remove the element at the front of the ring. Must
+        /// only be called by the consumer.
+        ///
+        /// @param out Receives the element on success.
+        /// @return `true` when an element was removed, `false` when the ring
+        ///         was empty.
+        ALWAYS_INLINE bool TryPop(T &out) {
+            const std::size_t head = m_head.load(std::memory_order_relaxed);
+            if (this->GetAvailable(head, 1) == 0) {
+                return false;
+            }
+
+            out = m_buffer[head & m_mask];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Copies as many elements from `items` into the ring as fit, and
+        /// publishes all of them at once. Must only be called by the producer.
+        ///
+        /// @param items The elements to add, in order.
+        /// @return The number of elements which were added.
+        std::size_t Write(std::span<const T> items) {
+            const std::size_t tail  = m_tail.load(std::memory_order_relaxed);
+            const std::size_t index = tail & m_mask;
+            const std::size_t count = std::min(items.size(), this->GetFree(tail, items.size()));
+
+            // Up to two copies, the second one after wrapping around.
+            const std::size_t first = std::min(count, this->GetCapacity() - index);
+            std::copy_n(items.data(), first, m_buffer + index);
+            std::copy_n(items.data() + first, count - first, m_buffer);
+
+            m_tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        /// Moves as many elements as are available into `items`, and hands
+        /// all of their slots back at once. Must only be called by the consumer.
+        ///
+        /// @param items The buffer to fill, in order.
+        /// @return The number of elements which were removed.
+        std::size_t Read(std::span<T> items) {
+            const std::size_t head  = m_head.load(std::memory_order_relaxed);
+            const std::size_t index = head & m_mask;
+            const std::size_t count = std::min(items.size(), this->GetAvailable(head, items.size()));
+
+            const std::size_t first = std::min(count, this->GetCapacity() - index);
+            std::copy_n(m_buffer + index, first, items.data());
+            std::copy_n(m_buffer, count - first, items.data() + first);
+
+            m_head.store(head + count, std::memory_order_release);
+            return count;
+        }
+    };
+
+}
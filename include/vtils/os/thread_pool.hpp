@@ -0,0 +1,516 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Work-stealing thread pool with fork-join parallelism.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "vtils/alignment.hpp"
+#include "vtils/assert.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/mutex.hpp"
+#include "vtils/scope_guard.hpp"
+#include "vtils/os/impl/futex.hpp"
+#include "vtils/os/impl/work_stealing_deque.hpp"
+
+namespace vtils {
+
+    class ThreadPool;
+    class TaskScope;
+
+    namespace impl {
+
+        // A unit of work. Jobs are linked intrusively while they sit in
+        // the injection queue and are consumed by executing them.
+        struct Job {
+            void (*execute)(Job *);
+            Job *next;
+
+            ALWAYS_INLINE explicit Job(void (*execute)(Job *)) : execute(execute), next(nullptr) {}
+
+            ALWAYS_INLINE void Execute() {
+                this->execute(this);
+            }
+        };
+
+        // A counter of outstanding jobs which threads can wait on to reach zero.
+        //
+        // The counter and flags for waiting threads share one futex word, so
+        // counting down does not enter the kernel unless someone is waiting.
+        // Threads from outside the pool sleep on the counter itself. A worker
+        // instead parks on a word of its own, so that both new jobs and the
+        // counter reaching zero can wake it up. Every counter is waited for
+        // by the one thread which created it, so completion wakes only that
+        // worker rather than the whole pool.
+        class JobCounter final {
+        private:
+            static constexpr std::uint32_t Waiters   = 1u << 31;
+            static constexpr std::uint32_t Helpers   = 1u << 30;
+            static constexpr std::uint32_t CountMask = Helpers - 1;
+
+        private:
+            std::atomic<std::uint32_t> m_state;
+            // The park word of the waiting worker, or `nullptr` when the
+            // counter is waited for from outside the pool.
+            std::atomic<std::uint32_t> *m_park;
+
+        private:
+            COLD void Wake(std::uint32_t state, std::atomic<std::uint32_t> *park) {
+                if (state & Waiters) {
+                    FutexWakeAll(m_state);
+                }
+                if (state & Helpers) {
+                    V_DEBUG_ASSERT(park != nullptr, "job counter without a worker has helpers");
+                    park->fetch_add(1, std::memory_order_release);
+                    FutexWakeOne(*park);
+                }
+            }
+
+            COLD void WaitSlow() {
+                std::uint32_t state = m_state.load(std::memory_order_acquire);
+                while ((state & CountMask) != 0) {
+                    if ((state & Waiters) == 0) {
+                        if (!m_state.compare_exchange_weak(state, state | Waiters, std::memory_order_acquire, std::memory_order_acquire)) {
+                            continue;
+                        }
+                        state |= Waiters;
+                    }
+
+                    FutexWait(m_state, state);
+                    state = m_state.load(std::memory_order_acquire);
+                }
+            }
+
+        public:
+            ALWAYS_INLINE constexpr JobCounter(std::uint32_t count, std::atomic<std::uint32_t> *park)
+                : m_state(count), m_park(park) {}
+
+            JobCounter(const JobCounter &) = delete;
+            JobCounter &operator=(const JobCounter &) = delete;
+
+            ALWAYS_INLINE void Increment() {
+                [[maybe_unused]] const std::uint32_t state = m_state.fetch_add(1, std::memory_order_relaxed);
+                V_DEBUG_ASSERT((state & CountMask) != 0, "job counter incremented after reaching zero");
+            }
+
+            // The counter may be destroyed by a waiter as soon as it reaches
+            // zero, so it must not be accessed after the final decrement.
+            ALWAYS_INLINE void Decrement() {
+                auto *park = m_park;
+                const std::uint32_t state = m_state.fetch_sub(1, std::memory_order_release);
+                if ((state & CountMask) == 1 && (state & (Waiters | Helpers)) != 0) UNLIKELY {
+                    this->Wake(state, park);
+                }
+            }
+
+            ALWAYS_INLINE bool IsDone() const {
+                return (m_state.load(std::memory_order_acquire) & CountMask) == 0;
+            }
+
+            ALWAYS_INLINE void Wait() {
+                if (!this->IsDone()) {
+                    this->WaitSlow();
+                }
+            }
+
+            // Announces a worker about to park on its own word. Returns
+            // `false` when the counter already reached zero instead.
+            ALWAYS_INLINE bool PrepareHelperPark() {
+                std::uint32_t state = m_state.load(std::memory_order_relaxed);
+                while ((state & CountMask) != 0) {
+                    if ((state & Helpers) != 0 ||
+                        m_state.compare_exchange_weak(state, state | Helpers, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+        };
+
+        // A job which owns its closure and frees itself after running.
+        template <class Fn>
+        struct HeapJob final : Job {
+            Fn fn;
+
+            template <class F>
+            ALWAYS_INLINE explicit HeapJob(F &&f) : Job(&HeapJob::Run), fn(std::forward<F>(f)) {}
+
+            static void Run(Job *job) {
+                std::unique_ptr<HeapJob> self(static_cast<HeapJob *>(job));
+                std::invoke(self->fn);
+            }
+        };
+
+        // The value a job passed to `ThreadPool::Join` produces. Results are
+        // returned by value, and `void` is represented by an empty type.
+        template <class Fn>
+        using JoinResult = std::conditional_t<
+            std::is_void_v<std::invoke_result_t<Fn&>>,
+            std::monostate,
+            std::remove_cvref_t<std::invoke_result_t<Fn&>>
+        >;
+
+        // Runs `fn` and stores its result or the exception it threw.
+        template <class Fn>
+        struct JoinSlot {
+            std::optional<JoinResult<Fn>> value;
+            std::exception_ptr error;
+
+            ALWAYS_INLINE void Run(Fn &fn) {
+                try {
+                    if constexpr (std::is_void_v<std::invoke_result_t<Fn&>>) {
+                        std::invoke(fn);
+                        value.emplace();
+                    } else {
+                        value.emplace(std::invoke(fn));
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+
+            ALWAYS_INLINE JoinResult<Fn> Get() {
+                if (error) UNLIKELY {
+                    std::rethrow_exception(error);
+                }
+                return std::move(*value);
+            }
+        };
+
+        // A job which lives on the stack of a thread that waits for it.
+        template <class Fn>
+        struct StackJob final : Job {
+            Fn &fn;
+            JoinSlot<Fn> slot;
+            JobCounter done;
+
+            ALWAYS_INLINE StackJob(Fn &f, std::atomic<std::uint32_t> *park)
+                : Job(&StackJob::Run), fn(f), slot(), done(1, park) {}
+
+            static void Run(Job *job) {
+                auto *self = static_cast<StackJob *>(job);
+                self->slot.Run(self->fn);
+                self->done.Decrement();
+            }
+        };
+
+        struct alignas(CacheLineSize) PoolWorker {
+            ThreadPool *pool;
+            std::size_t index;
+            std::uint64_t rng;
+            WorkStealingDeque<Job *> deque;
+            std::thread thread;
+            // Where the worker parks while it waits for a job counter.
+            std::atomic<std::uint32_t> park_epoch;
+            std::atomic<bool> helping;
+
+            PoolWorker(ThreadPool *pool, std::size_t index)
+                : pool(pool), index(index), rng(index * 0x9E3779B97F4A7C15ull + 1), deque(), thread(),
+                  park_epoch(0), helping(false) {}
+        };
+
+        // The worker running on the current thread, if any.
+        inline constinit thread_local PoolWorker *t_current_worker = nullptr;
+
+        struct InjectionQueue {
+            Job *head = nullptr;
+            Job *tail = nullptr;
+        };
+
+    }
+
+    /// A pool of worker threads which execute jobs in parallel.
+    ///
+    /// Every worker owns a Chase-Lev deque. Jobs created on a worker are
+    /// pushed to its own deque and taken back in LIFO order, which keeps
+    /// recursive work cache-friendly. Idle workers steal the oldest jobs
+    /// from the deques of others, which tend to be the largest chunks of
+    /// work, so the common case never touches shared state. Jobs submitted
+    /// from outside the pool go through a global injection queue instead.
+    ///
+    /// Workers without anything to do sleep on a futex and are woken up
+    /// when new jobs arrive, so an idle pool does not burn CPU time.
+    ///
+    /// Jobs started through @ref Spawn must not throw exceptions. Exceptions
+    /// thrown by the callables given to @ref Join or by the jobs of a
+    /// @ref Scope are passed on to the caller.
+    class ThreadPool {
+        friend class TaskScope;
+
+    public:
+        // Copying pools is an error hazard since the point is to
+        // share a common set of threads.
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+    private:
+        std::vector<std::unique_ptr<impl::PoolWorker>> m_workers;
+        Mutex<impl::InjectionQueue> m_injected;
+        std::atomic<std::size_t> m_injected_count;
+
+        alignas(CacheLineSize) std::atomic<std::uint32_t> m_wake_epoch;
+        std::atomic<std::uint32_t> m_sleepers;
+        std::atomic<bool> m_stop;
+
+    private:
+        void WorkerMain(impl::PoolWorker &worker);
+        impl::Job *FindWork(impl::PoolWorker &worker);
+        impl::Job *PopInjected();
+        impl::Job *Steal(impl::PoolWorker &worker);
+        bool HasWork() const;
+        void Sleep();
+        void Inject(impl::Job *job);
+        COLD void WakeSleeper();
+
+        // Must be called after publishing a job to wake up an idle worker.
+        ALWAYS_INLINE void NotifyWork() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleepers.load(std::memory_order_relaxed) != 0) UNLIKELY {
+                this->WakeSleeper();
+            }
+        }
+
+        ALWAYS_INLINE impl::PoolWorker *GetCurrentWorker() const {
+            impl::PoolWorker *worker = impl::t_current_worker;
+            return worker != nullptr && worker->pool == this ? worker : nullptr;
+        }
+
+        // Where job counters waited for by the current thread wake it up.
+        ALWAYS_INLINE std::atomic<std::uint32_t> *GetParkWord() const {
+            impl::PoolWorker *worker = this->GetCurrentWorker();
+            return worker != nullptr ? std::addressof(worker->park_epoch) : nullptr;
+        }
+
+        ALWAYS_INLINE void Submit(impl::Job *job) {
+            if (impl::PoolWorker *worker = this->GetCurrentWorker()) {
+                worker->deque.Push(job);
+                this->NotifyWork();
+            } else {
+                this->Inject(job);
+            }
+        }
+
+        // Blocks until the counter reaches zero. Worker threads execute
+        // other jobs in the meantime instead of sitting idle, and keep
+        // doing so for jobs that are submitted while they wait.
+        void WaitUntilDone(impl::JobCounter &counter);
+        void ParkHelper(impl::PoolWorker &worker, impl::JobCounter &counter);
+
+    public:
+        /// Starts a pool with the given number of worker threads.
+        ///
+        /// @param threads The number of workers, or zero to start one
+        ///                for every hardware thread.
+        explicit ThreadPool(std::size_t threads = 0);
+
+        /// Executes all remaining jobs and then stops the worker threads.
+        ///
+        /// No other thread may submit jobs to the pool anymore.
+        ~ThreadPool();
+
+        /// Gets the number of worker threads in the pool.
+        ALWAYS_INLINE std::size_t GetThreadCount() const {
+            return m_workers.size();
+        }
+
+        /// Gets the index of the worker running the current thread in this
+        /// pool, or `-1` when called from any other thread.
+        ALWAYS_INLINE std::ptrdiff_t GetCurrentThreadIndex() const {
+            const impl::PoolWorker *worker = this->GetCurrentWorker();
+            return worker != nullptr ? static_cast<std::ptrdiff_t>(worker->index) : -1;
+        }
+
+        /// Runs `fn` asynchronously on the pool without waiting for it.
+        ///
+        /// The callable is moved onto the heap, so it must not reference
+        /// anything that may go away before it runs. See @ref Scope for
+        /// spawning jobs which borrow from the caller.
+        ///
+        /// @param fn The callable to run.
+        template <class Fn> requires std::is_invocable_v<std::decay_t<Fn>&>
+        void Spawn(Fn &&fn) {
+            this->Submit(new impl::HeapJob<std::decay_t<Fn>>(std::forward<Fn>(fn)));
+        }
+
+        /// Runs `a` and `b`, potentially in parallel, and returns once both
+        /// have completed.
+        ///
+        /// The calling worker runs `a` itself and offers `b` to be stolen by
+        /// idle workers. If nobody took it by the time `a` finishes, `b` runs
+        /// on the calling thread as well. This makes recursive divide-and-
+        /// conquer algorithms scale without any allocation or shared locks.
+        ///
+        /// When called from outside the pool, the whole operation is moved
+        /// onto a worker and the calling thread blocks until it completes.
+        ///
+        /// If either callable throws, the exception is rethrown once both
+        /// have completed. When both throw, the one from `a` wins.
+        ///
+        /// @param a The first callable to run.
+        /// @param b The second callable to run.
+        /// @return The results of `a` and `b`, by value. Callables returning
+        ///         `void` produce a `std::monostate`.
+        template <class A, class B> requires std::is_invocable_v<A&> && std::is_invocable_v<B&>
+        std::pair<impl::JoinResult<A>, impl::JoinResult<B>> Join(A &&a, B &&b);
+
+        /// Opens a scope in which jobs may be spawned that borrow data from
+        /// the caller, and waits for all of them to complete.
+        ///
+        /// `fn` is called with a @ref TaskScope, whose `Spawn` function may
+        /// be used to start jobs. These may in turn spawn more jobs into the
+        /// same scope. The calling thread helps executing jobs while waiting
+        /// if it is a worker of this pool.
+        ///
+        /// The scope is waited for even if `fn` or any of its jobs throws.
+        /// The exception is rethrown afterwards. An exception from `fn` wins
+        /// over those from jobs, of which only the first one is kept.
+        ///
+        /// @param fn The callable which opens the scope.
+        template <class Fn> requires std::is_invocable_v<Fn&, TaskScope&>
+        void Scope(Fn &&fn);
+    };
+
+    /// A scope in which jobs that borrow from the enclosing stack frame
+    /// can be spawned. See @ref ThreadPool::Scope.
+    class TaskScope {
+        friend class ThreadPool;
+
+    public:
+        TaskScope(const TaskScope &) = delete;
+        TaskScope &operator=(const TaskScope &) = delete;
+
+    private:
+        ThreadPool &m_pool;
+        // Starts out with a count of one for the scope body itself.
+        impl::JobCounter m_pending;
+        // Only the first job to fail stores its exception. It is read
+        // after the counter reached zero, which orders the store before.
+        std::atomic<bool> m_failed;
+        std::exception_ptr m_error;
+
+    private:
+        ALWAYS_INLINE explicit TaskScope(ThreadPool &pool)
+            : m_pool(pool), m_pending(1, pool.GetParkWord()), m_failed(false), m_error() {}
+
+        COLD void Fail(std::exception_ptr error) {
+            if (!m_failed.exchange(true, std::memory_order_relaxed)) {
+                m_error = std::move(error);
+            }
+        }
+
+    public:
+        /// Runs `fn` asynchronously on the pool. The enclosing scope waits
+        /// for it to complete.
+        ///
+        /// If `fn` accepts a `TaskScope &`, it is passed this scope so that
+        /// it can spawn further jobs.
+        ///
+        /// @param fn The callable to run.
+        template <class Fn>
+        void Spawn(Fn &&fn) {
+            auto job = [this, fn = std::forward<Fn>(fn)]() mutable {
+                V_ON_SCOPE_EXIT { m_pending.Decrement(); };
+
+                try {
+                    if constexpr (std::is_invocable_v<decltype(fn)&, TaskScope&>) {
+                        std::invoke(fn, *this);
+                    } else {
+                        std::invoke(fn);
+                    }
+                } catch (...) {
+                    this->Fail(std::current_exception());
+                }
+            };
+
+            // Only count the job once it exists, and take it back if it
+            // cannot be queued, so that a failed spawn never leaves the
+            // scope waiting forever.
+            auto heap_job = std::make_unique<impl::HeapJob<decltype(job)>>(std::move(job));
+            m_pending.Increment();
+            impl::ScopeGuard uncount([this] { m_pending.Decrement(); });
+
+            m_pool.Submit(heap_job.get());
+            uncount.Cancel();
+            heap_job.release();
+        }
+    };
+
+    template <class A, class B> requires std::is_invocable_v<A&> && std::is_invocable_v<B&>
+    std::pair<impl::JoinResult<A>, impl::JoinResult<B>> ThreadPool::Join(A &&a, B &&b) {
+        impl::PoolWorker *worker = this->GetCurrentWorker();
+        if (worker == nullptr) UNLIKELY {
+            auto body = [&] { return this->Join(a, b); };
+            impl::StackJob job(body, nullptr);
+            this->Inject(std::addressof(job));
+            this->WaitUntilDone(job.done);
+            return job.slot.Get();
+        }
+
+        impl::StackJob job_b(b, std::addressof(worker->park_epoch));
+        worker->deque.Push(std::addressof(job_b));
+        this->NotifyWork();
+
+        // `b` lives on our stack, so we must wait for it even if `a` throws.
+        impl::JoinSlot<A> slot_a;
+        slot_a.Run(a);
+
+        // Unless it was stolen, `b` is still in our deque, possibly beneath
+        // jobs that were spawned by `a` and are now taken care of first.
+        while (!job_b.done.IsDone()) {
+            impl::Job *job;
+            if (!worker->deque.Take(job)) {
+                this->WaitUntilDone(job_b.done);
+                break;
+            }
+
+            if (job == std::addressof(job_b)) {
+                job_b.slot.Run(b);
+                break;
+            }
+
+            job->Execute();
+        }
+
+        auto result_a = slot_a.Get();
+        return { std::move(result_a), job_b.slot.Get() };
+    }
+
+    template <class Fn> requires std::is_invocable_v<Fn&, TaskScope&>
+    void ThreadPool::Scope(Fn &&fn) {
+        TaskScope scope(*this);
+
+        // The jobs spawned so far point to `scope`, so we must wait for
+        // them even if `fn` throws.
+        std::exception_ptr error;
+        try {
+            std::invoke(fn, scope);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        scope.m_pending.Decrement();
+        this->WaitUntilDone(scope.m_pending);
+
+        if (error) UNLIKELY {
+            std::rethrow_exception(error);
+        }
+        if (scope.m_error) UNLIKELY {
+            std::rethrow_exception(scope.m_error);
+        }
+    }
+
+}
@@ -0,0 +1,246 @@
+/**
+ * @file timer_wheel.hpp
+ * @brief Hierarchical timer wheels for large numbers of timeouts.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/parking_lot.hpp"
+
+namespace vtils {
+
+    class TimerWheel;
+
+    /// A timer which can be scheduled on a @ref TimerWheel.
+    ///
+    /// Timers are intrusive: the wheel only links them together and never
+    /// allocates, so the owner decides where a timer lives and must keep it
+    /// alive while it is scheduled. To carry state, a timer is typically
+    /// embedded in a larger object which the callback recovers.
+    ///
+    /// Each timer holds two list links, its expiry, its callback and a few
+    /// bytes of bookkeeping, which is 40 bytes on 64-bit platforms.
+    class Timer {
+        friend class TimerWheel;
+
+    public:
+        /// The function called when the timer expires.
+        using Callback = void (*)(Timer &timer);
+
+        // Copying timers is an error hazard since the wheel
+        // links to them by address.
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+    private:
+        enum class State : std::uint8_t {
+            Idle,
+            Pending,
+            Expired,
+        };
+
+    private:
+        Timer *m_prev;
+        Timer *m_next;
+        std::uint64_t m_expiry;
+        Callback m_callback;
+        State m_state;
+        std::uint8_t m_level;
+        std::uint8_t m_slot;
+
+    public:
+        /// Constructs an idle timer which calls `callback` when it expires.
+        ALWAYS_INLINE constexpr explicit Timer(Callback callback)
+            : m_prev(nullptr), m_next(nullptr), m_expiry(0), m_callback(callback),
+              m_state(State::Idle), m_level(0), m_slot(0) {}
+    };
+
+    /// A hierarchical hashed timer wheel which tracks many timeouts at once
+    /// at a fixed resolution.
+    ///
+    /// Time is split into ticks of a configurable length. The wheel consists
+    /// of several levels of 64 slots. Each slot of the lowest level covers a
+    /// single tick, and every slot of a higher level covers a full rotation
+    /// of the level below. Scheduling a timer links it into the slot of its
+    /// expiry on the lowest level that reaches that far, and cancelling it
+    /// unlinks it again, both in constant time. When time advances into a
+    /// higher-level slot, its timers cascade down into finer slots.
+    ///
+    /// A bitmap of occupied slots per level lets @ref AdvanceTo jump straight
+    /// to the next tick at which anything happens, so an idle wheel costs
+    /// nothing no matter how much time passes.
+    ///
+    /// The wheel is driven either by polling @ref AdvanceTo, e.g. from an
+    /// event loop, or by a @ref TimerThread. Timers may be scheduled and
+    /// cancelled from any thread. Callbacks run on the thread which advances
+    /// the wheel, outside of its internal lock, so they may schedule timers
+    /// again.
+    class TimerWheel {
+        friend class TimerThread;
+
+    public:
+        using Clock     = std::chrono::steady_clock;
+        using TimePoint = Clock::time_point;
+
+        // Copying wheels is an error hazard since the point is
+        // to share a common set of timers.
+        TimerWheel(const TimerWheel &) = delete;
+        TimerWheel &operator=(const TimerWheel &) = delete;
+
+    private:
+        static constexpr std::size_t SlotBits   = 6;
+        static constexpr std::size_t SlotCount  = 1 << SlotBits;
+        static constexpr std::size_t SlotMask   = SlotCount - 1;
+        static constexpr std::size_t LevelCount = 6;
+
+        // Timers further out are parked in the last slot within reach and
+        // put back when that slot comes up.
+        static constexpr std::uint64_t MaxDelta = (std::uint64_t{1} << (SlotBits * LevelCount)) - 1;
+
+        static constexpr std::uint64_t NoTick = ~std::uint64_t{0};
+
+        struct Level {
+            std::uint64_t occupied = 0;
+            std::array<Timer *, SlotCount> slots{};
+        };
+
+    private:
+        RawMutex m_lock;
+        const TimePoint m_start;
+        const Clock::duration m_resolution;
+
+        // The last tick which has been processed.
+        std::uint64_t m_now;
+        std::size_t m_pending;
+        std::array<Level, LevelCount> m_levels;
+        // Timers which are due and waiting for their callback to run.
+        Timer *m_expired_head;
+        Timer *m_expired_tail;
+
+        // Whether a driver thread is about to sleep or sleeping, the tick it
+        // sleeps until, and the futex word it sleeps on. Without a sleeping
+        // driver, scheduling a timer never has to wake anyone.
+        bool m_driver_asleep;
+        std::uint64_t m_wake_tick;
+        std::atomic<std::uint32_t> m_wake_epoch;
+
+    private:
+        void Link(Timer &timer, std::uint64_t expiry);
+        void Unlink(Timer &timer);
+        void Cascade(std::size_t level, std::size_t slot);
+        void Expire(std::size_t slot);
+        std::uint64_t GetNextEventTick() const;
+        std::size_t RunExpired();
+
+        ALWAYS_INLINE std::uint64_t ToTick(TimePoint time, bool round_up) const {
+            if (time <= m_start) {
+                return 0;
+            }
+
+            const auto elapsed = time - m_start;
+            const auto ticks   = static_cast<std::uint64_t>(elapsed / m_resolution);
+            return ticks + (round_up && elapsed % m_resolution != Clock::duration::zero());
+        }
+
+        ALWAYS_INLINE TimePoint ToTimePoint(std::uint64_t tick) const {
+            return m_start + m_resolution * static_cast<Clock::rep>(tick);
+        }
+
+    public:
+        /// Constructs an empty wheel whose clock starts now.
+        ///
+        /// @param resolution The length of a tick. Timers fire up to one
+        ///                   tick late, but never early.
+        explicit TimerWheel(Clock::duration resolution = std::chrono::milliseconds(1));
+
+        /// Gets the number of scheduled timers which have not fired yet.
+        std::size_t GetPendingCount();
+
+        /// Schedules `timer` to fire at the given point in time, or on the
+        /// next advance if that has passed already.
+        ///
+        /// A timer which is already scheduled is moved to the new deadline.
+        ///
+        /// @param timer The timer to schedule.
+        /// @param time  The point in time to fire at.
+        void Schedule(Timer &timer, TimePoint time);
+
+        /// Schedules `timer` to fire after the given duration.
+        ///
+        /// @param timer The timer to schedule.
+        /// @param delay The duration to fire after.
+        template <class Rep, class Period>
+        ALWAYS_INLINE void ScheduleAfter(Timer &timer, const std::chrono::duration<Rep, Period> &delay) {
+            this->Schedule(timer, Clock::now() + std::chrono::duration_cast<Clock::duration>(delay));
+        }
+
+        /// Cancels `timer` if it has not fired yet.
+        ///
+        /// @return `true` when the timer was cancelled, `false` when it was
+        ///         not scheduled or its callback is already running.
+        bool Cancel(Timer &timer);
+
+        /// Advances the wheel to the given point in time and fires all timers
+        /// which expired until then, in order of their deadlines.
+        ///
+        /// Only one thread may advance the wheel at a time.
+        ///
+        /// @param now The current time.
+        /// @return The number of timers which fired.
+        std::size_t AdvanceTo(TimePoint now);
+
+        /// Gets the point in time at which the wheel next needs to be
+        /// advanced, if any timers are scheduled.
+        ///
+        /// This may be earlier than the closest deadline when timers need to
+        /// cascade into finer slots first.
+        std::optional<TimePoint> GetNextExpiry();
+
+        /// Blocks the current thread until the wheel has been advanced past
+        /// the given point in time.
+        ///
+        /// Unlike a timed futex wait, this does not arm a kernel timer per
+        /// waiter. All threads whose deadlines expire together are woken up
+        /// from a single advance of the wheel.
+        ///
+        /// @param time The point in time to sleep until.
+        void SleepUntil(TimePoint time);
+    };
+
+    /// A thread which drives a @ref TimerWheel, advancing it whenever the
+    /// next timer expires.
+    ///
+    /// The thread sleeps on a futex with a deadline until the next expiry,
+    /// and is only woken early when a timer is scheduled before that.
+    class TimerThread {
+    public:
+        // Copying is an error hazard since the point is to own the thread.
+        TimerThread(const TimerThread &) = delete;
+        TimerThread &operator=(const TimerThread &) = delete;
+
+    private:
+        TimerWheel &m_wheel;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+
+    private:
+        void Run();
+
+    public:
+        /// Starts driving `wheel`, which must outlive the thread.
+        explicit TimerThread(TimerWheel &wheel);
+
+        /// Stops the thread. Timers which have not fired yet stay scheduled.
+        ~TimerThread();
+    };
+
+}
@@ -0,0 +1,288 @@
+/**
+ * @file parallel.hpp
+ * @brief Parallel algorithms over ranges, executed on a ThreadPool.
+ * @copyright Valentin B.
+ *
+ * All algorithms cut their input into chunks of a grain size which is
+ * derived from the length of the input, the size of its elements and
+ * the number of threads in the pool. The chunks are then processed by
+ * recursively splitting them in halves with @ref ThreadPool::Join, so
+ * idle workers steal the biggest pieces of remaining work first.
+ *
+ * The way an input is partitioned only depends on its length and the
+ * pool size, never on how jobs end up being scheduled. Reductions with
+ * an associative operation therefore always combine values in the same
+ * order and yield the same results from run to run, even for operations
+ * like floating-point addition that are not exactly associative.
+ */
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#include "vtils/alignment.hpp"
+#include "vtils/macros/attr.hpp"
+#include "vtils/os/thread_pool.hpp"
+
+namespace vtils {
+
+    namespace impl {
+
+        // The number of chunks to aim for per thread, so that work is
+        // still balanced when some chunks take longer than others.
+        constexpr std::size_t ChunksPerThread = 8;
+
+        // The smallest amount of memory worth handing to another thread.
+        constexpr std::size_t MinChunkBytes = 16 * 1024;
+
+        template <typename T>
+        constexpr std::size_t GetGrainSize(const ThreadPool &pool, std::size_t size) {
+            constexpr std::size_t Bytes     = sizeof(T) != 0 ? sizeof(T) : 1;
+            constexpr std::size_t LineElems = CacheLineSize % Bytes == 0 ? CacheLineSize / Bytes : 1;
+
+            const std::size_t target = size / (pool.GetThreadCount() * ChunksPerThread);
+            const std::size_t grain  = std::max(target, std::max<std::size_t>(MinChunkBytes / Bytes, 1));
+
+            // Round up to whole cache lines so that neighbouring chunks
+            // do not write to the same line.
+            return AlignUp(grain, LineElems);
+        }
+
+        // Calls `fn(begin, end)` for every chunk of `[0, size)` on the pool.
+        template <class Fn>
+        void ForEachChunk(ThreadPool &pool, std::size_t first, std::size_t last, std::size_t size, std::size_t grain, Fn &fn) {
+            if (last - first == 1) {
+                const std::size_t begin = first * grain;
+                fn(begin, std::min(begin + grain, size));
+                return;
+            }
+
+            const std::size_t mid = first + (last - first) / 2;
+            pool.Join(
+                [&] { ForEachChunk(pool, first, mid, size, grain, fn); },
+                [&] { ForEachChunk(pool, mid, last, size, grain, fn); }
+            );
+        }
+
+        template <class Fn>
+        ALWAYS_INLINE void ForEachChunk(ThreadPool &pool, std::size_t size, std::size_t grain, Fn &&fn) {
+            if (size != 0) {
+                ForEachChunk(pool, 0, (size + grain - 1) / grain, size, grain, fn);
+            }
+        }
+
+        // Reduces every chunk with `leaf(begin, end)` and then combines the
+        // results pairwise, always in the same tree shape for a given input.
+        template <typename T, class Leaf, class Op>
+        T ReduceChunks(ThreadPool &pool, std::size_t first, std::size_t last, std::size_t size, std::size_t grain, Leaf &leaf, Op &op) {
+            if (last - first == 1) {
+                const std::size_t begin = first * grain;
+                return leaf(begin, std::min(begin + grain, size));
+            }
+
+            const std::size_t mid = first + (last - first) / 2;
+            std::optional<T> left, right;
+            pool.Join(
+                [&] { left.emplace(ReduceChunks<T>(pool, first, mid, size, grain, leaf, op)); },
+                [&] { right.emplace(ReduceChunks<T>(pool, mid, last, size, grain, leaf, op)); }
+            );
+
+            return std::invoke(op, std::move(*left), std::move(*right));
+        }
+
+        // Merges the sorted ranges `[a, a_end)` and `[b, b_end)` into `out`,
+        // splitting the work at the median of the longer one.
+        template <class It, class Out, class Comp, class Proj>
+        void ParallelMerge(ThreadPool &pool, It a, It a_end, It b, It b_end, Out out, std::size_t grain, Comp &comp, Proj &proj) {
+            const auto a_len = a_end - a;
+            const auto b_len = b_end - b;
+            // A single element on the longer side cannot be split, so the
+            // recursion would hand the whole input to one of its halves.
+            if (static_cast<std::size_t>(a_len + b_len) <= std::max<std::size_t>(grain, 2) || std::max(a_len, b_len) <= 1) {
+                std::ranges::merge(std::make_move_iterator(a), std::make_move_iterator(a_end),
+                                   std::make_move_iterator(b), std::make_move_iterator(b_end),
+                                   out, std::ref(comp), std::ref(proj), std::ref(proj));
+                return;
+            }
+
+            It a_mid, b_mid;
+            if (a_len >= b_len) {
+                a_mid = a + a_len / 2;
+                b_mid = std::ranges::lower_bound(b, b_end, std::invoke(proj, *a_mid), std::ref(comp), std::ref(proj));
+            } else {
+                b_mid = b + b_len / 2;
+                a_mid = std::ranges::upper_bound(a, a_end, std::invoke(proj, *b_mid), std::ref(comp), std::ref(proj));
+            }
+
+            const Out out_mid = out + ((a_mid - a) + (b_mid - b));
+            pool.Join(
+                [&] { ParallelMerge(pool, a, a_mid, b, b_mid, out, grain, comp, proj); },
+                [&] { ParallelMerge(pool, a_mid, a_end, b_mid, b_end, out_mid, grain, comp, proj); }
+            );
+        }
+
+        // Sorts `[src, src + size)`. The result ends up in `dst` when `to_dst`
+        // is set and in `src` otherwise, with the other range serving as
+        // scratch space. Alternating the direction between levels avoids
+        // copying the merged halves back after every merge.
+        template <class It, class Buf, class Comp, class Proj>
+        void ParallelMergeSort(ThreadPool &pool, It src, Buf dst, std::size_t size, bool to_dst, std::size_t grain, Comp &comp, Proj &proj) {
+            if (size <= grain) {
+                std::ranges::sort(src, src + size, std::ref(comp), std::ref(proj));
+                if (to_dst) {
+                    std::ranges::move(src, src + size, dst);
+                }
+                return;
+            }
+
+            const std::size_t half = size / 2;
+            pool.Join(
+                [&] { ParallelMergeSort(pool, src, dst, half, !to_dst, grain, comp, proj); },
+                [&] { ParallelMergeSort(pool, src + half, dst + half, size - half, !to_dst, grain, comp, proj); }
+            );
+
+            if (to_dst) {
+                ParallelMerge(pool, src, src + half, src + half, src + size, dst, grain, comp, proj);
+            } else {
+                ParallelMerge(pool, dst, dst + half, dst + half, dst + size, src, grain, comp, proj);
+            }
+        }
+
+    }
+
+    /// Calls `fn` on every element of `range` in parallel.
+    ///
+    /// The order in which elements are visited is unspecified, apart from
+    /// every chunk of adjacent elements being processed front to back.
+    ///
+    /// @param pool  The pool to run on.
+    /// @param range The elements to process.
+    /// @param fn    The callable to invoke with every element.
+    template <std::ranges::random_access_range R, class Fn>
+        requires std::ranges::sized_range<R> && std::invocable<Fn&, std::ranges::range_reference_t<R>>
+    void ParallelFor(ThreadPool &pool, R &&range, Fn fn) {
+        const auto first = std::ranges::begin(range);
+        const std::size_t size = std::ranges::size(range);
+        const std::size_t grain = impl::GetGrainSize<std::ranges::range_value_t<R>>(pool, size);
+
+        impl::ForEachChunk(pool, size, grain, [&](std::size_t begin, std::size_t end) {
+            const auto chunk_end = first + end;
+            for (auto it = first + begin; it != chunk_end; ++it) {
+                std::invoke(fn, *it);
+            }
+        });
+    }
+
+    /// Reduces the elements of `range` with `op`, in parallel.
+    ///
+    /// `op` must be associative, but need not be commutative: elements are
+    /// always combined in their original order. `init` is combined with the
+    /// result exactly once, so it does not need to be an identity element.
+    ///
+    /// @param pool  The pool to run on.
+    /// @param range The elements to reduce.
+    /// @param init  The initial value of the reduction.
+    /// @param op    The binary operation to reduce with.
+    /// @return The result of the reduction, or `init` for an empty range.
+    template <std::ranges::random_access_range R, typename T, class Op = std::plus<>>
+        requires std::ranges::sized_range<R>
+            && std::move_constructible<T>
+            && std::convertible_to<std::ranges::range_reference_t<R>, T>
+            && std::is_invocable_r_v<T, Op&, T, T>
+            && std::is_invocable_r_v<T, Op&, T, std::ranges::range_reference_t<R>>
+    T ParallelReduce(ThreadPool &pool, R &&range, T init, Op op = Op()) {
+        const auto first = std::ranges::begin(range);
+        const std::size_t size = std::ranges::size(range);
+        if (size == 0) {
+            return init;
+        }
+
+        const std::size_t grain = impl::GetGrainSize<std::ranges::range_value_t<R>>(pool, size);
+        auto leaf = [&](std::size_t begin, std::size_t end) -> T {
+            auto it = first + begin;
+            const auto chunk_end = first + end;
+
+            T acc = *it;
+            while (++it != chunk_end) {
+                acc = std::invoke(op, std::move(acc), *it);
+            }
+            return acc;
+        };
+
+        T result = impl::ReduceChunks<T>(pool, 0, (size + grain - 1) / grain, size, grain, leaf, op);
+        return std::invoke(op, std::move(init), std::move(result));
+    }
+
+    /// Stores the result of `fn` for every element of `range` in the range
+    /// beginning at `out`, in parallel.
+    ///
+    /// @param pool  The pool to run on.
+    /// @param range The input elements.
+    /// @param out   The beginning of the output range, which must be large
+    ///              enough to hold one result per input element.
+    /// @param fn    The callable to transform elements with.
+    /// @return The end of the output range.
+    template <std::ranges::random_access_range R, std::random_access_iterator O, class Fn>
+        requires std::ranges::sized_range<R>
+            && std::indirectly_writable<O, std::indirect_result_t<Fn&, std::ranges::iterator_t<R>>>
+    O ParallelTransform(ThreadPool &pool, R &&range, O out, Fn fn) {
+        const auto first = std::ranges::begin(range);
+        const std::size_t size = std::ranges::size(range);
+
+        // Grains are sized after the output, which is where chunks touching
+        // the same cache line would actually hurt.
+        const std::size_t grain = impl::GetGrainSize<std::iter_value_t<O>>(pool, size);
+
+        impl::ForEachChunk(pool, size, grain, [&](std::size_t begin, std::size_t end) {
+            // A counted loop lets the compiler vectorize, which it does not
+            // do when stepping two iterators side by side.
+            const auto src = first + begin;
+            const auto dst = out + begin;
+            for (std::size_t i = 0; i < end - begin; ++i) {
+                dst[i] = std::invoke(fn, src[i]);
+            }
+        });
+
+        return out + size;
+    }
+
+    /// Sorts the elements of `range` in parallel.
+    ///
+    /// Chunks are sorted independently and then combined by parallel merges,
+    /// which needs a temporary buffer as large as the input. Like
+    /// `std::ranges::sort`, the sort is not stable.
+    ///
+    /// @param pool  The pool to run on.
+    /// @param range The elements to sort.
+    /// @param comp  The comparison to order elements by.
+    /// @param proj  The projection to apply to elements before comparing.
+    template <std::ranges::random_access_range R, class Comp = std::ranges::less, class Proj = std::identity>
+        requires std::ranges::sized_range<R>
+            && std::sortable<std::ranges::iterator_t<R>, Comp, Proj>
+            && std::default_initializable<std::ranges::range_value_t<R>>
+    void ParallelSort(ThreadPool &pool, R &&range, Comp comp = Comp(), Proj proj = Proj()) {
+        using T = std::ranges::range_value_t<R>;
+
+        const auto first = std::ranges::begin(range);
+        const std::size_t size = std::ranges::size(range);
+        const std::size_t grain = impl::GetGrainSize<T>(pool, size);
+
+        // Not worth the allocation when there is nothing to parallelize.
+        if (size <= grain || pool.GetThreadCount() == 1) {
+            std::ranges::sort(first, first + size, std::ref(comp), std::ref(proj));
+            return;
+        }
+
+        auto buffer = std::make_unique_for_overwrite<T[]>(size);
+        impl::ParallelMergeSort(pool, first, buffer.get(), size, false, grain, comp, proj);
+    }
+
+}
@@ -0,0 +1,429 @@
+#include "vtils/os/fiber.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vtils/os/impl/fiber_context.hpp"
+#include "vtils/os/impl/futex.hpp"
+#include "vtils/scope_guard.hpp"
+
+#if defined(__SANITIZE_THREAD__)
+    #define V_FIBER_TSAN 1
+#elif defined(__has_feature)
+    #if __has_feature(thread_sanitizer)
+        #define V_FIBER_TSAN 1
+    #endif
+#endif
+
+#if defined(V_FIBER_TSAN)
+    #include <sanitizer/tsan_interface.h>
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+    #define V_FIBER_ASAN 1
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define V_FIBER_ASAN 1
+    #endif
+#endif
+
+#if defined(V_FIBER_ASAN)
+    #include <sanitizer/asan_interface.h>
+    #include <sanitizer/common_interface_defs.h>
+#endif
+
+namespace vtils {
+
+    namespace {
+
+        thread_local impl::FiberWorker *t_fiber_worker = nullptr;
+
+        // A fiber may migrate to another thread at every switch, but the
+        // compiler assumes that a function runs on one thread throughout
+        // and might reuse the address of a thread-local variable computed
+        // before the switch. Looking it up out of line prevents that.
+        NOINLINE impl::FiberWorker *GetFiberWorker() {
+            return t_fiber_worker;
+        }
+
+    }
+
+    namespace impl {
+
+        // The state of a thread which runs fibers for a scheduler.
+        struct FiberWorker {
+            // What the worker should do with a fiber that switched back to it.
+            enum class Action {
+                Yield,
+                Park,
+                Finish,
+            };
+
+            // The saved stack pointer of the worker's own context.
+            void *context = nullptr;
+            void *sanitizer_fiber = nullptr;
+            // The bounds of the worker's own stack and the usable size of
+            // fiber stacks, for address sanitizer.
+            const void *stack_bottom = nullptr;
+            std::size_t stack_size = 0;
+            std::size_t fiber_stack_size = 0;
+            Fiber *current = nullptr;
+            Action action = Action::Yield;
+
+            // Completes a switch into a fiber on whichever worker it landed,
+            // which address sanitizer tells the bounds of the stack it left.
+            ALWAYS_INLINE static void OnFiberEntered([[maybe_unused]] void *fake_stack) {
+            #if defined(V_FIBER_ASAN)
+                FiberWorker *worker = GetFiberWorker();
+                __sanitizer_finish_switch_fiber(fake_stack, std::addressof(worker->stack_bottom), std::addressof(worker->stack_size));
+            #endif
+            }
+
+            // Runs `fiber` until it switches back to the worker.
+            ALWAYS_INLINE void Run(Fiber &fiber) {
+                current = std::addressof(fiber);
+            #if defined(V_FIBER_ASAN)
+                void *fake_stack = nullptr;
+                __sanitizer_start_switch_fiber(std::addressof(fake_stack), fiber.m_stack, fiber_stack_size);
+            #endif
+            #if defined(V_FIBER_TSAN)
+                __tsan_switch_to_fiber(fiber.m_sanitizer_fiber, 0);
+            #endif
+                vtils_fiber_switch(std::addressof(context), fiber.m_context);
+            #if defined(V_FIBER_ASAN)
+                __sanitizer_finish_switch_fiber(fake_stack, nullptr, nullptr);
+            #endif
+                current = nullptr;
+            }
+
+            // Switches from the current fiber back to the worker, which
+            // then carries out `next`. The fiber may continue on another
+            // worker when this returns.
+            ALWAYS_INLINE void Suspend(Action next) {
+                Fiber *fiber = current;
+                action = next;
+            #if defined(V_FIBER_ASAN)
+                // The fake stack of a finished fiber can be released right away.
+                void **fake_stack = next != Action::Finish ? std::addressof(fiber->m_sanitizer_fake_stack) : nullptr;
+                __sanitizer_start_switch_fiber(fake_stack, stack_bottom, stack_size);
+            #endif
+            #if defined(V_FIBER_TSAN)
+                __tsan_switch_to_fiber(sanitizer_fiber, 0);
+            #endif
+                vtils_fiber_switch(std::addressof(fiber->m_context), context);
+
+                // `this` may refer to a different worker by now.
+                OnFiberEntered(fiber->m_sanitizer_fake_stack);
+            }
+        };
+
+    }
+
+    FiberStackPool::FiberStackPool(std::size_t stack_size)
+        : m_page_size(static_cast<std::size_t>(sysconf(_SC_PAGESIZE))),
+          m_stack_size(AlignUp(std::max(stack_size, m_page_size), m_page_size)),
+          m_lock(), m_free(), m_regions() {}
+
+    FiberStackPool::~FiberStackPool() {
+        V_DEBUG_ASSERT(m_free.size() == m_regions.size() * StacksPerRegion, "fiber stacks still in use");
+
+        for (void *region : m_regions) {
+            munmap(region, (m_page_size + m_stack_size) * StacksPerRegion);
+        }
+    }
+
+    void FiberStackPool::MapRegion() {
+        const std::size_t slot_size = m_page_size + m_stack_size;
+
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    #if defined(MAP_STACK)
+        flags |= MAP_STACK;
+    #endif
+
+        auto *region = static_cast<std::uint8_t *>(mmap(nullptr, slot_size * StacksPerRegion, PROT_READ | PROT_WRITE, flags, -1, 0));
+        if (region == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "failed to map fiber stacks");
+        }
+        impl::ScopeGuard unmap([&] { munmap(region, slot_size * StacksPerRegion); });
+
+        // Each stack grows down towards its own guard page. Handing out
+        // stacks without one would turn overflows into silent corruption.
+        for (std::size_t i = 0; i < StacksPerRegion; ++i) {
+            if (mprotect(region + i * slot_size, m_page_size, PROT_NONE) != 0) {
+                throw std::system_error(errno, std::generic_category(), "failed to protect fiber stack guard pages");
+            }
+        }
+
+        // Make room first, so that freeing stacks never needs to allocate.
+        m_regions.reserve(m_regions.size() + 1);
+        m_free.reserve((m_regions.size() + 1) * StacksPerRegion);
+        m_regions.push_back(region);
+        unmap.Cancel();
+
+        for (std::size_t i = StacksPerRegion; i-- > 0;) {
+            m_free.push_back(region + i * slot_size + m_page_size);
+        }
+    }
+
+    void *FiberStackPool::Allocate() {
+        m_lock.Lock();
+        V_ON_SCOPE_EXIT { m_lock.Unlock(); };
+
+        if (m_free.empty()) {
+            this->MapRegion();
+        }
+
+        void *stack = m_free.back();
+        m_free.pop_back();
+
+    #if defined(V_FIBER_ASAN)
+        // A reused stack may still be poisoned by frames of its last fiber.
+        ASAN_UNPOISON_MEMORY_REGION(stack, m_stack_size);
+    #endif
+
+        return stack;
+    }
+
+    void FiberStackPool::Free(void *stack) {
+        m_lock.Lock();
+        m_free.push_back(stack);
+        m_lock.Unlock();
+    }
+
+    void *Fiber::AllocateStack() {
+        FiberStackPool &stacks = m_scheduler.m_stacks;
+
+        m_stack = stacks.Allocate();
+        return static_cast<std::uint8_t *>(m_stack) + stacks.GetStackSize();
+    }
+
+    void Fiber::Start(void *stack_top) {
+        m_context = impl::MakeFiberContext(stack_top, &Fiber::Entry, this);
+    #if defined(V_FIBER_TSAN)
+        m_sanitizer_fiber = __tsan_create_fiber(0);
+    #endif
+
+        m_scheduler.Enqueue(*this);
+    }
+
+    void Fiber::Entry(void *arg) {
+        impl::FiberWorker::OnFiberEntered(nullptr);
+
+        auto *self = static_cast<Fiber *>(arg);
+        self->m_invoke(self->m_callable);
+
+        GetFiberWorker()->Suspend(impl::FiberWorker::Action::Finish);
+        // A finished fiber is never resumed again.
+        V_UNREACHABLE();
+    }
+
+    Fiber::~Fiber() {
+        this->Join();
+    }
+
+    void Fiber::Join() {
+        if (this->IsDone()) {
+            return;
+        }
+
+        if (Fiber *self = GetCurrent()) {
+            V_ASSERT(self != this, "a fiber cannot join itself");
+
+            Fiber *expected = nullptr;
+            if (m_joiner.compare_exchange_strong(expected, self, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                while (m_joiner.load(std::memory_order_acquire) != this) {
+                    Park();
+                }
+
+                // The worker finishing the fiber may still be unparking us,
+                // and only marks it as done once it is through with that.
+                while (!this->IsDone()) {
+                    Yield();
+                }
+                return;
+            }
+
+            // The fiber is being torn down right now and will be done soon.
+            V_ASSERT(expected == this, "a fiber can only be joined by one fiber at a time");
+        }
+
+        while (m_done.load(std::memory_order_acquire) == 0) {
+            impl::FutexWait(m_done, 0);
+        }
+    }
+
+    void Fiber::Unpark() {
+        std::uint32_t state = m_wake.load(std::memory_order_relaxed);
+        while (true) {
+            switch (state) {
+                case Notified:
+                    return;
+
+                case Parked:
+                    if (m_wake.compare_exchange_weak(state, Running, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        m_scheduler.Enqueue(*this);
+                        return;
+                    }
+                    break;
+
+                default:
+                    if (m_wake.compare_exchange_weak(state, Notified, std::memory_order_release, std::memory_order_relaxed)) {
+                        return;
+                    }
+                    break;
+            }
+        }
+    }
+
+    Fiber *Fiber::GetCurrent() {
+        impl::FiberWorker *worker = GetFiberWorker();
+        return worker != nullptr ? worker->current : nullptr;
+    }
+
+    void Fiber::Yield() {
+        if (impl::FiberWorker *worker = GetFiberWorker(); worker != nullptr && worker->current != nullptr) {
+            worker->Suspend(impl::FiberWorker::Action::Yield);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    void Fiber::Park() {
+        impl::FiberWorker *worker = GetFiberWorker();
+        V_ASSERT(worker != nullptr && worker->current != nullptr, "only fibers can park");
+
+        // Consume a pending notification without switching.
+        std::uint32_t expected = Notified;
+        if (worker->current->m_wake.compare_exchange_strong(expected, Running, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return;
+        }
+
+        worker->Suspend(impl::FiberWorker::Action::Park);
+    }
+
+    FiberScheduler::FiberScheduler(std::size_t threads, std::size_t stack_size)
+        : m_stacks(stack_size), m_lock(), m_head(nullptr), m_tail(nullptr), m_stop(false), m_runnable(), m_threads() {
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        m_threads.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this] { this->WorkerMain(); });
+        }
+    }
+
+    FiberScheduler::~FiberScheduler() {
+        m_lock.Lock();
+        m_stop = true;
+        m_lock.Unlock();
+        m_runnable.Notify(true);
+
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void FiberScheduler::WorkerMain() {
+        impl::FiberWorker worker;
+    #if defined(V_FIBER_TSAN)
+        worker.sanitizer_fiber = __tsan_get_current_fiber();
+    #endif
+        worker.fiber_stack_size = m_stacks.GetStackSize();
+        t_fiber_worker = std::addressof(worker);
+
+        while (Fiber *fiber = this->Pop()) {
+            worker.Run(*fiber);
+
+            // The fiber is completely switched out by now, so it is safe to
+            // hand it to another worker.
+            switch (worker.action) {
+                case impl::FiberWorker::Action::Yield:
+                    this->Enqueue(*fiber);
+                    break;
+
+                case impl::FiberWorker::Action::Park: {
+                    std::uint32_t expected = Fiber::Running;
+                    if (!fiber->m_wake.compare_exchange_strong(expected, Fiber::Parked, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        // Unparked while suspending, so it may go on.
+                        fiber->m_wake.store(Fiber::Running, std::memory_order_relaxed);
+                        this->Enqueue(*fiber);
+                    }
+                    break;
+                }
+
+                case impl::FiberWorker::Action::Finish:
+                    this->Finish(*fiber);
+                    break;
+            }
+        }
+
+        t_fiber_worker = nullptr;
+    }
+
+    bool FiberScheduler::TryPop(Fiber *&fiber) {
+        m_lock.Lock();
+        fiber = m_head;
+        if (fiber != nullptr) {
+            m_head = fiber->m_next;
+            if (m_head == nullptr) {
+                m_tail = nullptr;
+            }
+        }
+        const bool stop = m_stop;
+        m_lock.Unlock();
+
+        return fiber != nullptr || stop;
+    }
+
+    Fiber *FiberScheduler::Pop() {
+        Fiber *fiber;
+        while (!this->TryPop(fiber)) {
+            const auto key = m_runnable.PrepareWait();
+            if (this->TryPop(fiber)) {
+                m_runnable.CancelWait();
+                break;
+            }
+
+            m_runnable.Wait(key);
+        }
+
+        return fiber;
+    }
+
+    void FiberScheduler::Enqueue(Fiber &fiber) {
+        fiber.m_next = nullptr;
+
+        m_lock.Lock();
+        (m_tail != nullptr ? m_tail->m_next : m_head) = std::addressof(fiber);
+        m_tail = std::addressof(fiber);
+        m_lock.Unlock();
+
+        m_runnable.Notify();
+    }
+
+    void FiberScheduler::Finish(Fiber &fiber) {
+    #if defined(V_FIBER_TSAN)
+        __tsan_destroy_fiber(fiber.m_sanitizer_fiber);
+    #endif
+        m_stacks.Free(fiber.m_stack);
+
+        // A joining fiber waits for `m_done` after being unparked, so it is
+        // still around while we unpark it.
+        Fiber *joiner = fiber.m_joiner.exchange(std::addressof(fiber), std::memory_order_acq_rel);
+        if (joiner != nullptr) {
+            joiner->Unpark();
+        }
+
+        // Once it is marked as done, the fiber may be destroyed at any moment,
+        // so it must not be touched anymore. Waking the futex only uses its
+        // address as a key and never accesses the memory behind it.
+        fiber.m_done.store(1, std::memory_order_release);
+        impl::FutexWakeAll(fiber.m_done);
+    }
+
+}
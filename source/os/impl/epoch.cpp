@@ -0,0 +1,184 @@
+#include "vtils/os/impl/epoch.hpp"
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "vtils/scope_guard.hpp"
+#include "vtils/os/mutex.hpp"
+
+namespace vtils::impl {
+
+    constinit thread_local EpochRecord *t_epoch_record = nullptr;
+    alignas(CacheLineSize) constinit std::atomic<std::uint64_t> g_global_epoch = 0;
+
+    namespace {
+
+        struct RetiredObject {
+            void *ptr;
+            void (*deleter)(void *);
+            std::uint64_t epoch;
+        };
+
+        class EpochDomain final {
+        private:
+            std::atomic<EpochRecord *> m_records;
+            Mutex m_mutex;
+            std::vector<RetiredObject> m_retired;
+
+        private:
+            // Must be called with the domain mutex held.
+            bool TryAdvance() {
+                // Pairs with the fence in `EpochPin`.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                const std::uint64_t epoch = g_global_epoch.load(std::memory_order_relaxed);
+                for (auto *record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                    const std::uint64_t state = record->state.load(std::memory_order_relaxed);
+                    if ((state & 1) != 0 && (state >> 1) != epoch) {
+                        // A pinned thread has not caught up to the current epoch yet.
+                        return false;
+                    }
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                g_global_epoch.store(epoch + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Must be called with the domain mutex held. Moves all objects whose
+            // grace period has completed out of the retired list.
+            std::vector<RetiredObject> CollectExpired() {
+                const std::uint64_t epoch = g_global_epoch.load(std::memory_order_relaxed);
+
+                std::vector<RetiredObject> expired;
+                std::erase_if(m_retired, [&](const RetiredObject &obj) {
+                    if (obj.epoch + 2 <= epoch) {
+                        expired.push_back(obj);
+                        return true;
+                    }
+                    return false;
+                });
+
+                return expired;
+            }
+
+            static void Free(std::vector<RetiredObject> &&objects) {
+                // Deleters run without the domain mutex held since they may
+                // retire further objects themselves.
+                for (const auto &obj : objects) {
+                    obj.deleter(obj.ptr);
+                }
+            }
+
+        public:
+            constexpr EpochDomain() : m_records(nullptr), m_mutex(), m_retired() {}
+
+            ~EpochDomain() {
+                // No reader may be pinned when the program shuts down.
+                for (const auto &obj : m_retired) {
+                    obj.deleter(obj.ptr);
+                }
+            }
+
+            EpochRecord *Register() {
+                // Reuse a record abandoned by an exited thread, if available.
+                for (auto *record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                    bool in_use = false;
+                    if (record->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return record;
+                    }
+                }
+
+                auto *record = new EpochRecord{
+                    .state   = 0,
+                    .nesting = 0,
+                    .in_use  = true,
+                    .next    = m_records.load(std::memory_order_relaxed),
+                };
+                while (!m_records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {}
+
+                return record;
+            }
+
+            void Retire(void *ptr, void (*deleter)(void *)) {
+                std::vector<RetiredObject> expired;
+                {
+                    m_mutex.Lock();
+                    V_ON_SCOPE_EXIT { m_mutex.Unlock(); };
+
+                    // The object was unlinked before this point, so no reader
+                    // pinned in a later epoch may ever observe it.
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    m_retired.push_back({ ptr, deleter, g_global_epoch.load(std::memory_order_relaxed) });
+
+                    this->TryAdvance();
+                    expired = this->CollectExpired();
+                }
+
+                Free(std::move(expired));
+            }
+
+            void Synchronize() {
+                const std::uint64_t target = g_global_epoch.load(std::memory_order_relaxed) + 2;
+
+                std::vector<RetiredObject> expired;
+                while (true) {
+                    {
+                        m_mutex.Lock();
+                        V_ON_SCOPE_EXIT { m_mutex.Unlock(); };
+
+                        this->TryAdvance();
+                        if (g_global_epoch.load(std::memory_order_relaxed) >= target) {
+                            expired = this->CollectExpired();
+                            break;
+                        }
+                    }
+
+                    // Give pinned readers a chance to make progress.
+                    std::this_thread::yield();
+                }
+
+                Free(std::move(expired));
+            }
+        };
+
+        constinit EpochDomain g_domain;
+
+        // Releases the calling thread's record when the thread exits.
+        struct EpochRecordOwner {
+            EpochRecord *record = nullptr;
+
+            ~EpochRecordOwner() {
+                if (record != nullptr) {
+                    V_ASSERT(record->nesting == 0, "thread exited while pinned to an epoch");
+
+                    t_epoch_record = nullptr;
+                    record->in_use.store(false, std::memory_order_release);
+                }
+            }
+        };
+
+        thread_local EpochRecordOwner t_epoch_record_owner;
+
+    }
+
+    COLD EpochRecord *AcquireEpochRecord() {
+        EpochRecord *record = g_domain.Register();
+
+        t_epoch_record_owner.record = record;
+        t_epoch_record = record;
+
+        return record;
+    }
+
+    void RetireEpochObject(void *ptr, void (*deleter)(void *)) {
+        g_domain.Retire(ptr, deleter);
+    }
+
+    void SynchronizeEpochs() {
+        V_ASSERT(t_epoch_record == nullptr || t_epoch_record->nesting == 0, "cannot synchronize while pinned to an epoch");
+        g_domain.Synchronize();
+    }
+
+}
@@ -0,0 +1,421 @@
+#include "vtils/os/impl/fiber_context.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include "vtils/alignment.hpp"
+#include "vtils/macros/platform.hpp"
+
+// Symbol boilerplate for the assembly routines below.
+#if defined(V_PLATFORM_APPLE)
+    #define V_FIBER_FUNCTION(name) \
+        ".text\n"                  \
+        ".globl _" #name "\n"      \
+        ".p2align 4\n"             \
+        "_" #name ":\n"
+    #define V_FIBER_FUNCTION_END(name)
+#else
+    #define V_FIBER_FUNCTION(name)      \
+        ".text\n"                       \
+        ".globl " #name "\n"            \
+        ".hidden " #name "\n"           \
+        ".type " #name ", %function\n"  \
+        ".p2align 4\n"                  \
+        #name ":\n"
+    #define V_FIBER_FUNCTION_END(name) ".size " #name ", . - " #name "\n"
+#endif
+
+extern "C" {
+
+    // The first code to run on a new context. It picks the entry point and
+    // its argument up from callee-saved registers, where the initial frame
+    // placed them, and calls the entry point on a properly aligned stack.
+    void vtils_fiber_trampoline();
+
+}
+
+#if defined(V_ARCH_X64)
+
+// rbx, rbp and r12-r15 are callee-saved, along with the control bits of
+// the MXCSR and the x87 FPU control word.
+asm(
+    V_FIBER_FUNCTION(vtils_fiber_switch)
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_switch)
+
+    V_FIBER_FUNCTION(vtils_fiber_trampoline)
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_trampoline)
+);
+
+namespace vtils::impl {
+
+    namespace {
+
+        struct InitialFrame {
+            std::uint32_t mxcsr;
+            std::uint16_t fpu_control;
+            std::uint16_t padding;
+            std::uintptr_t r15, r14, r13, r12, rbx, rbp;
+            std::uintptr_t return_address;
+        };
+
+        ALWAYS_INLINE void FillFrame(InitialFrame &frame, FiberEntry entry, void *arg) {
+            frame.mxcsr          = 0x1F80;
+            frame.fpu_control    = 0x037F;
+            frame.r12            = reinterpret_cast<std::uintptr_t>(arg);
+            frame.r13            = reinterpret_cast<std::uintptr_t>(entry);
+            frame.return_address = reinterpret_cast<std::uintptr_t>(&vtils_fiber_trampoline);
+        }
+
+        // The trampoline calls the entry point right away, which needs a
+        // 16-byte aligned stack.
+        constexpr std::size_t FrameBias = 0;
+
+    }
+
+}
+
+#elif defined(V_ARCH_AARCH64)
+
+// x19-x28, the frame pointer, the link register and the low halves of
+// v8-v15 are callee-saved. The stack pointer stays 16-byte aligned.
+asm(
+    V_FIBER_FUNCTION(vtils_fiber_switch)
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_switch)
+
+    V_FIBER_FUNCTION(vtils_fiber_trampoline)
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_trampoline)
+);
+
+namespace vtils::impl {
+
+    namespace {
+
+        struct InitialFrame {
+            std::uintptr_t x19, x20, x21, x22, x23, x24, x25, x26, x27, x28;
+            std::uintptr_t x29, x30;
+            double d[8];
+        };
+
+        ALWAYS_INLINE void FillFrame(InitialFrame &frame, FiberEntry entry, void *arg) {
+            frame.x19 = reinterpret_cast<std::uintptr_t>(arg);
+            frame.x20 = reinterpret_cast<std::uintptr_t>(entry);
+            frame.x30 = reinterpret_cast<std::uintptr_t>(&vtils_fiber_trampoline);
+        }
+
+        constexpr std::size_t FrameBias = 0;
+
+    }
+
+}
+
+#elif defined(V_ARCH_ARM)
+
+// r4-r11 and the link register are callee-saved, as are d8-d15 when
+// there is a floating-point unit. r12 is saved along with them only to
+// keep the stack 8-byte aligned. The routines are assembled in ARM mode
+// and return through interworking branches, so they can be called from
+// Thumb code as well.
+#if defined(__ARM_FP)
+    #define V_FIBER_ARM_SAVE_FP    "    vpush {d8-d15}\n"
+    #define V_FIBER_ARM_RESTORE_FP "    vpop {d8-d15}\n"
+#else
+    #define V_FIBER_ARM_SAVE_FP
+    #define V_FIBER_ARM_RESTORE_FP
+#endif
+
+#if defined(__thumb__)
+    #define V_FIBER_ARM_RESTORE_MODE ".thumb\n"
+#else
+    #define V_FIBER_ARM_RESTORE_MODE ".arm\n"
+#endif
+
+asm(
+    ".syntax unified\n"
+    ".arm\n"
+    V_FIBER_FUNCTION(vtils_fiber_switch)
+    "    push {r4-r12, lr}\n"
+    V_FIBER_ARM_SAVE_FP
+    "    mov r2, sp\n"
+    "    str r2, [r0]\n"
+    "    mov sp, r1\n"
+    V_FIBER_ARM_RESTORE_FP
+    "    pop {r4-r12, lr}\n"
+    "    bx lr\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_switch)
+
+    V_FIBER_FUNCTION(vtils_fiber_trampoline)
+    "    mov r0, r4\n"
+    "    blx r5\n"
+    "    udf #0\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_trampoline)
+    V_FIBER_ARM_RESTORE_MODE
+);
+
+namespace vtils::impl {
+
+    namespace {
+
+        struct InitialFrame {
+        #if defined(__ARM_FP)
+            double d[8];
+        #endif
+            std::uintptr_t r4, r5, r6, r7, r8, r9, r10, r11, r12;
+            std::uintptr_t lr;
+        };
+
+        ALWAYS_INLINE void FillFrame(InitialFrame &frame, FiberEntry entry, void *arg) {
+            frame.r4 = reinterpret_cast<std::uintptr_t>(arg);
+            frame.r5 = reinterpret_cast<std::uintptr_t>(entry);
+            frame.lr = reinterpret_cast<std::uintptr_t>(&vtils_fiber_trampoline);
+        }
+
+        constexpr std::size_t FrameBias = 0;
+
+    }
+
+}
+
+#undef V_FIBER_ARM_SAVE_FP
+#undef V_FIBER_ARM_RESTORE_FP
+#undef V_FIBER_ARM_RESTORE_MODE
+
+#elif defined(V_ARCH_X86)
+
+// ebx, esi, edi and ebp are callee-saved, along with the x87 FPU control
+// word and, when targeting SSE, the control bits of the MXCSR. The slot
+// for the latter is always reserved to keep the frame layout fixed.
+// Arguments are passed on the stack.
+#if defined(__SSE__)
+    #define V_FIBER_X86_SAVE_MXCSR    "    stmxcsr (%esp)\n"
+    #define V_FIBER_X86_RESTORE_MXCSR "    ldmxcsr (%esp)\n"
+#else
+    #define V_FIBER_X86_SAVE_MXCSR
+    #define V_FIBER_X86_RESTORE_MXCSR
+#endif
+
+asm(
+    V_FIBER_FUNCTION(vtils_fiber_switch)
+    "    movl 4(%esp), %eax\n"
+    "    movl 8(%esp), %edx\n"
+    "    pushl %ebp\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    subl $8, %esp\n"
+    V_FIBER_X86_SAVE_MXCSR
+    "    fnstcw 4(%esp)\n"
+    "    movl %esp, (%eax)\n"
+    "    movl %edx, %esp\n"
+    V_FIBER_X86_RESTORE_MXCSR
+    "    fldcw 4(%esp)\n"
+    "    addl $8, %esp\n"
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %ebp\n"
+    "    ret\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_switch)
+
+    V_FIBER_FUNCTION(vtils_fiber_trampoline)
+    "    pushl %esi\n"
+    "    calll *%edi\n"
+    "    ud2\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_trampoline)
+);
+
+namespace vtils::impl {
+
+    namespace {
+
+        struct InitialFrame {
+            std::uint32_t mxcsr;
+            std::uint16_t fpu_control;
+            std::uint16_t padding;
+            std::uintptr_t edi, esi, ebx, ebp;
+            std::uintptr_t return_address;
+        };
+
+        ALWAYS_INLINE void FillFrame(InitialFrame &frame, FiberEntry entry, void *arg) {
+            frame.mxcsr          = 0x1F80;
+            frame.fpu_control    = 0x037F;
+            frame.esi            = reinterpret_cast<std::uintptr_t>(arg);
+            frame.edi            = reinterpret_cast<std::uintptr_t>(entry);
+            frame.return_address = reinterpret_cast<std::uintptr_t>(&vtils_fiber_trampoline);
+        }
+
+        // The trampoline pushes the argument, which must leave the stack
+        // 16-byte aligned for the call.
+        constexpr std::size_t FrameBias = 12;
+
+    }
+
+}
+
+#undef V_FIBER_X86_SAVE_MXCSR
+#undef V_FIBER_X86_RESTORE_MXCSR
+
+#elif defined(V_ARCH_RISCV)
+
+#if __riscv_xlen != 64
+    #error "Fibers are only supported on 64-bit RISC-V"
+#endif
+
+// ra and s0-s11 are callee-saved, as are fs0-fs11 with the D extension.
+// The frame is padded to keep the stack pointer 16-byte aligned.
+#if defined(__riscv_flen) && __riscv_flen == 64
+    #define V_FIBER_RISCV_FP(op)       \
+        "    " op " fs0, 104(sp)\n"    \
+        "    " op " fs1, 112(sp)\n"    \
+        "    " op " fs2, 120(sp)\n"    \
+        "    " op " fs3, 128(sp)\n"    \
+        "    " op " fs4, 136(sp)\n"    \
+        "    " op " fs5, 144(sp)\n"    \
+        "    " op " fs6, 152(sp)\n"    \
+        "    " op " fs7, 160(sp)\n"    \
+        "    " op " fs8, 168(sp)\n"    \
+        "    " op " fs9, 176(sp)\n"    \
+        "    " op " fs10, 184(sp)\n"   \
+        "    " op " fs11, 192(sp)\n"
+#elif !defined(__riscv_flen)
+    #define V_FIBER_RISCV_FP(op)
+#else
+    #error "Fibers are not supported with this RISC-V floating-point ABI"
+#endif
+
+#define V_FIBER_RISCV_GP(op)     \
+    "    " op " ra, 0(sp)\n"     \
+    "    " op " s0, 8(sp)\n"     \
+    "    " op " s1, 16(sp)\n"    \
+    "    " op " s2, 24(sp)\n"    \
+    "    " op " s3, 32(sp)\n"    \
+    "    " op " s4, 40(sp)\n"    \
+    "    " op " s5, 48(sp)\n"    \
+    "    " op " s6, 56(sp)\n"    \
+    "    " op " s7, 64(sp)\n"    \
+    "    " op " s8, 72(sp)\n"    \
+    "    " op " s9, 80(sp)\n"    \
+    "    " op " s10, 88(sp)\n"   \
+    "    " op " s11, 96(sp)\n"
+
+asm(
+    V_FIBER_FUNCTION(vtils_fiber_switch)
+    "    addi sp, sp, -208\n"
+    V_FIBER_RISCV_GP("sd")
+    V_FIBER_RISCV_FP("fsd")
+    "    sd sp, 0(a0)\n"
+    "    mv sp, a1\n"
+    V_FIBER_RISCV_GP("ld")
+    V_FIBER_RISCV_FP("fld")
+    "    addi sp, sp, 208\n"
+    "    ret\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_switch)
+
+    V_FIBER_FUNCTION(vtils_fiber_trampoline)
+    "    mv a0, s1\n"
+    "    jalr s2\n"
+    "    unimp\n"
+    V_FIBER_FUNCTION_END(vtils_fiber_trampoline)
+);
+
+namespace vtils::impl {
+
+    namespace {
+
+        struct InitialFrame {
+            std::uintptr_t ra, s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11;
+            double fs[12];
+            std::uintptr_t padding;
+        };
+
+        ALWAYS_INLINE void FillFrame(InitialFrame &frame, FiberEntry entry, void *arg) {
+            frame.ra = reinterpret_cast<std::uintptr_t>(&vtils_fiber_trampoline);
+            frame.s1 = reinterpret_cast<std::uintptr_t>(arg);
+            frame.s2 = reinterpret_cast<std::uintptr_t>(entry);
+        }
+
+        constexpr std::size_t FrameBias = 0;
+
+    }
+
+}
+
+#undef V_FIBER_RISCV_FP
+#undef V_FIBER_RISCV_GP
+
+#endif
+
+#undef V_FIBER_FUNCTION
+#undef V_FIBER_FUNCTION_END
+
+namespace vtils::impl {
+
+    void *MakeFiberContext(void *stack_top, FiberEntry entry, void *arg) {
+        // Leave 16 bytes of zeroes at the very top, which debuggers and
+        // unwinders take as the end of the call chain.
+        auto top = AlignDown(reinterpret_cast<std::uintptr_t>(stack_top), 16) - 16;
+        std::memset(reinterpret_cast<void *>(top), 0, 16);
+
+        // Place the frame such that the stack pointer is correctly aligned
+        // once the registers have been popped off again.
+        const auto frame_end = top - FrameBias;
+        auto *frame = reinterpret_cast<InitialFrame *>(frame_end - sizeof(InitialFrame));
+        std::memset(frame, 0, sizeof(InitialFrame));
+        FillFrame(*frame, entry, arg);
+
+        return frame;
+    }
+
+}
@@ -16,6 +16,12 @@ namespace vtils::impl {
             return info.dwAllocationGranularity;
         }();
 
+        const std::size_t PageSize = [] {
+            SYSTEM_INFO info;
+            ::GetSystemInfo(std::addressof(info));
+            return info.dwPageSize;
+        }();
+
     }
 
     MemoryMapped::~MemoryMapped() {
@@ -48,7 +54,15 @@ namespace vtils::impl {
         return *this;
     }
 
-    DWORD MemoryMapped::Map(HANDLE handle, DWORD protect, DWORD access, std::size_t offset, std::size_t len) noexcept {
+    std::size_t MemoryMapped::GetPageSize() const noexcept {
+        return PageSize;
+    }
+
+    DWORD MemoryMapped::Map(HANDLE handle, DWORD protect, DWORD access, std::size_t offset, std::size_t len, bool huge) noexcept {
+        // Large pages are only available for mappings backed by the paging
+        // file, so file views always fall back to regular pages.
+        static_cast<void>(huge);
+
         // Compute offset and length of allocation with respect to granularity.
         const std::size_t aligned_offset = AlignDown(offset, AllocationGranularity);
         const std::size_t alignment      = offset - aligned_offset;
@@ -130,6 +144,41 @@ namespace vtils::impl {
         return MmapResultSuccess;
     }
 
+    DWORD MemoryMapped::Prefetch(std::size_t offset, std::size_t len) noexcept {
+        // If we don't maintain a mapping, we have nothing to do.
+        if (!this->IsMapped()) {
+            return MmapResultSuccess;
+        }
+
+        // Bring the pages of the range into memory in the background.
+        WIN32_MEMORY_RANGE_ENTRY entry;
+        entry.VirtualAddress = static_cast<std::uint8_t *>(m_ptr) + offset;
+        entry.NumberOfBytes  = len;
+        if (::PrefetchVirtualMemory(::GetCurrentProcess(), 1, std::addressof(entry), 0) == FALSE) {
+            return ::GetLastError();
+        }
+
+        return MmapResultSuccess;
+    }
+
+    DWORD MemoryMapped::Evict(std::size_t offset, std::size_t len) noexcept {
+        // If we don't maintain a mapping, we have nothing to do.
+        if (!this->IsMapped()) {
+            return MmapResultSuccess;
+        }
+
+        // Unlocking pages which are not locked removes them from the working
+        // set of the process, which is exactly what we want here. It is still
+        // reported as an error though.
+        if (::VirtualUnlock(static_cast<std::uint8_t *>(m_ptr) + offset, len) == FALSE) {
+            if (const DWORD res = ::GetLastError(); res != ERROR_NOT_LOCKED) {
+                return res;
+            }
+        }
+
+        return MmapResultSuccess;
+    }
+
     DWORD GetFileSize(HANDLE handle, std::uint64_t *size) {
         // Try to query file size information.
         BY_HANDLE_FILE_INFORMATION info;
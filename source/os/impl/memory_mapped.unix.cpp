@@ -1,5 +1,11 @@
 #include "vtils/os/impl/memory_mapped.unix.hpp"
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -8,22 +14,226 @@
 #include "vtils/macros/arch.hpp"
 #include "vtils/macros/platform.hpp"
 
+#if defined(V_PLATFORM_LINUX)
+    #include <linux/magic.h>
+    #include <sys/sysmacros.h>
+    #include <sys/vfs.h>
+#endif
+
 namespace vtils::impl {
 
     namespace {
 
         const std::size_t AllocationGranularity = sysconf(_SC_PAGE_SIZE);
 
+    #if defined(V_PLATFORM_LINUX)
+        // Reads a small text file from sysfs into `buf`, returning whether
+        // that succeeded.
+        bool ReadSysfs(const char *path, char *buf, std::size_t size) {
+            const int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return false;
+            }
+
+            const ssize_t read_bytes = read(fd, buf, size - 1);
+            close(fd);
+
+            if (read_bytes <= 0) {
+                return false;
+            }
+
+            buf[read_bytes] = '\0';
+            return true;
+        }
+
+        // Gets the size of transparent huge pages, or zero if the kernel
+        // does not support them. Only read once it is needed, so that
+        // programs not asking for huge pages never touch sysfs.
+        std::size_t GetTransparentHugePageSize() {
+            static const std::size_t size = []() -> std::size_t {
+                char buf[128];
+                if (!ReadSysfs("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", buf, sizeof(buf))) {
+                    return 0;
+                }
+
+                return std::strtoull(buf, nullptr, 10);
+            }();
+
+            return size;
+        }
+
+        // Checks whether a tmpfs huge page setting lets regions advised with
+        // `MADV_HUGEPAGE` use huge pages.
+        ALWAYS_INLINE bool AllowsShmemHugePages(std::string_view setting) {
+            return setting == "always" || setting == "within_size" || setting == "advise";
+        }
+
+        // Gets the selected setting from a sysfs file which lists all of
+        // them, with the selected one enclosed in brackets.
+        std::string_view GetSelectedSetting(const char *settings) {
+            const char *begin = std::strchr(settings, '[');
+            const char *end   = begin != nullptr ? std::strchr(begin, ']') : nullptr;
+            if (end == nullptr) {
+                return {};
+            }
+
+            return std::string_view(begin + 1, end);
+        }
+
+        // Gets the value of the `huge=` option from comma-separated mount
+        // options, or an empty string if it is not present.
+        std::string_view GetHugeOption(const char *options) {
+            for (const char *option = options; (option = std::strstr(option, "huge=")) != nullptr; option += 5) {
+                // Only match whole options, not ones merely ending in `huge`.
+                if (option != options && option[-1] != ',' && option[-1] != ' ') {
+                    continue;
+                }
+
+                const char *value = option + 5;
+                return std::string_view(value, std::strcspn(value, ", \t\n"));
+            }
+
+            return {};
+        }
+
+        // Checks whether a file on tmpfs is backed by transparent huge pages
+        // when asked to. That is only the case when it was mounted with huge
+        // pages enabled, or the global shmem setting forces them.
+        bool SupportsShmemHugePages(int fd) {
+            struct stat sb;
+            if (fstat(fd, std::addressof(sb)) != 0) {
+                return false;
+            }
+
+            // The global setting can override all mounts, and applies to
+            // files on the internal mount, e.g. from `memfd_create`.
+            char buf[128];
+            if (!ReadSysfs("/sys/kernel/mm/transparent_hugepage/shmem_enabled", buf, sizeof(buf))) {
+                return false;
+            }
+
+            const std::string_view shmem = GetSelectedSetting(buf);
+            if (shmem == "deny") {
+                return false;
+            }
+            if (shmem == "force") {
+                return true;
+            }
+
+            FILE *mounts = std::fopen("/proc/self/mountinfo", "re");
+            if (mounts == nullptr) {
+                return false;
+            }
+
+            // Look for the mount of the file by its device number. Its super
+            // block options come last, after a separator.
+            bool found = false, huge = false;
+            char *line = nullptr;
+            std::size_t capacity = 0;
+            while (!found && getline(std::addressof(line), std::addressof(capacity), mounts) > 0) {
+                unsigned id, parent, major, minor;
+                if (std::sscanf(line, "%u %u %u:%u", &id, &parent, &major, &minor) != 4 || makedev(major, minor) != sb.st_dev) {
+                    continue;
+                }
+
+                const char *options = std::strstr(line, " - ");
+                found = true;
+                huge  = options != nullptr && AllowsShmemHugePages(GetHugeOption(options));
+            }
+            std::free(line);
+            std::fclose(mounts);
+
+            return found ? huge : AllowsShmemHugePages(shmem);
+        }
+
+        // Checks whether the kernel backs mappings of the file with transparent
+        // huge pages when asked to. Files on tmpfs follow their own settings.
+        // On other file systems, the page cache can only collapse read-only
+        // file mappings into huge pages, given that THP are not disabled.
+        // Elsewhere, `MADV_HUGEPAGE` succeeds without any effect.
+        bool SupportsTransparentHugePages(int fd, int protect) {
+            struct statfs sfs;
+            if (fstatfs(fd, std::addressof(sfs)) != 0) {
+                return false;
+            }
+
+            if (sfs.f_type == TMPFS_MAGIC) {
+                return SupportsShmemHugePages(fd);
+            }
+            if ((protect & PROT_WRITE) != 0) {
+                return false;
+            }
+
+            char buf[128];
+            if (!ReadSysfs("/sys/kernel/mm/transparent_hugepage/enabled", buf, sizeof(buf))) {
+                return false;
+            }
+
+            const std::string_view enabled = GetSelectedSetting(buf);
+            return enabled == "always" || enabled == "madvise";
+        }
+
+        // Gets the page size of files on hugetlbfs, or zero for other files.
+        std::size_t GetHugeTlbPageSize(int fd) {
+            struct statfs sb;
+            if (fstatfs(fd, std::addressof(sb)) == 0 && sb.f_type == HUGETLBFS_MAGIC) {
+                return static_cast<std::size_t>(sb.f_bsize);
+            }
+
+            return 0;
+        }
+
+        // Maps a file view at a virtual address which is congruent to its
+        // file offset modulo `alignment`. Only then can the kernel back the
+        // view with pages of that size.
+        void *MapAligned(int fd, int protect, int flags, std::size_t offset, std::size_t len, std::size_t alignment) {
+            // Reserve enough address space to place the view in, and give
+            // back the unused ends afterwards.
+            const std::size_t reserved_len = len + alignment;
+            auto *reserved = static_cast<std::uint8_t *>(mmap(nullptr, reserved_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+            if (reserved == MAP_FAILED) {
+                return MAP_FAILED;
+            }
+
+            const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(reserved);
+            std::uintptr_t address = AlignDown(start, alignment) + offset % alignment;
+            if (address < start) {
+                address += alignment;
+            }
+
+            auto *ptr = static_cast<std::uint8_t *>(mmap(reinterpret_cast<void *>(address), len, protect, flags | MAP_FIXED, fd, static_cast<off_t>(offset)));
+            if (ptr == MAP_FAILED) {
+                const int res = errno;
+                munmap(reserved, reserved_len);
+                errno = res;
+                return MAP_FAILED;
+            }
+
+            if (ptr != reserved) {
+                munmap(reserved, ptr - reserved);
+            }
+            if (ptr + len != reserved + reserved_len) {
+                munmap(ptr + len, reserved + reserved_len - (ptr + len));
+            }
+
+            return ptr;
+        }
+    #endif
+
     }
 
     MemoryMapped::~MemoryMapped() {
         this->Unmap();
     }
 
-    MemoryMapped::MemoryMapped(MemoryMapped &&rhs) noexcept : m_ptr(rhs.m_ptr), m_len(rhs.m_len) {
+    MemoryMapped::MemoryMapped(MemoryMapped &&rhs) noexcept
+        : m_ptr(rhs.m_ptr), m_len(rhs.m_len), m_granularity(rhs.m_granularity), m_page_size(rhs.m_page_size)
+    {
         // Reset `rhs` back into default state.
-        rhs.m_ptr    = nullptr;
-        rhs.m_len    = 0;
+        rhs.m_ptr         = nullptr;
+        rhs.m_len         = 0;
+        rhs.m_granularity = 0;
+        rhs.m_page_size   = 0;
     }
 
     MemoryMapped &MemoryMapped::operator=(MemoryMapped &&rhs) noexcept {
@@ -31,61 +241,105 @@ namespace vtils::impl {
         this->Unmap();
 
         // Copy mapping details from `rhs`.
-        m_ptr    = rhs.m_ptr;
-        m_len    = rhs.m_len;
+        m_ptr         = rhs.m_ptr;
+        m_len         = rhs.m_len;
+        m_granularity = rhs.m_granularity;
+        m_page_size   = rhs.m_page_size;
 
         // Reset `rhs` back into default state.
-        rhs.m_ptr    = nullptr;
-        rhs.m_len    = 0;
+        rhs.m_ptr         = nullptr;
+        rhs.m_len         = 0;
+        rhs.m_granularity = 0;
+        rhs.m_page_size   = 0;
 
         return *this;
     }
 
-    int MemoryMapped::Map(int fd, int protect, int flags, std::size_t offset, std::size_t len) noexcept {
+    int MemoryMapped::Map(int fd, int protect, int flags, std::size_t offset, std::size_t len, bool huge) noexcept {
+        std::size_t granularity    = AllocationGranularity;
+        std::size_t huge_page_size = 0;
+
+    #if defined(V_PLATFORM_LINUX)
+        // Files on hugetlbfs are always backed by huge pages and can only
+        // be mapped at their granularity. Files on suitable tmpfs mounts,
+        // and read-only mappings of other files, get transparent huge pages
+        // when asked for it. Everything else stays with regular pages.
+        if (const std::size_t page_size = GetHugeTlbPageSize(fd); page_size != 0) {
+            granularity = page_size;
+        } else if (huge && SupportsTransparentHugePages(fd, protect)) {
+            huge_page_size = GetTransparentHugePageSize();
+        }
+    #else
+        static_cast<void>(huge);
+    #endif
+
         // Compute offset and length of allocation with respect to granularity.
-        const std::size_t aligned_offset = AlignDown(offset, AllocationGranularity);
+        const std::size_t aligned_offset = AlignDown(offset, granularity);
         const std::size_t alignment      = offset - aligned_offset;
-        const std::size_t aligned_len    = len + alignment;
+        const std::size_t aligned_len    = AlignUp(len + alignment, granularity);
 
         // Explicitly check for len 0 as we're not allowed to allocate that.
         V_DEBUG_ASSERT(aligned_len != 0);
 
-        // Map the file view into memory.
-        auto *ptr = mmap(nullptr, aligned_len, protect, flags, fd, static_cast<off_t>(aligned_offset));
+        // Map the file view into memory. Views smaller than a huge page
+        // could never use one, so they are not worth aligning.
+        void *ptr;
+    #if defined(V_PLATFORM_LINUX)
+        if (huge_page_size != 0 && aligned_len >= huge_page_size) {
+            ptr = MapAligned(fd, protect, flags, aligned_offset, aligned_len, huge_page_size);
+        } else {
+            huge_page_size = 0;
+            ptr = mmap(nullptr, aligned_len, protect, flags, fd, static_cast<off_t>(aligned_offset));
+        }
+    #else
+        ptr = mmap(nullptr, aligned_len, protect, flags, fd, static_cast<off_t>(aligned_offset));
+    #endif
         if (ptr == MAP_FAILED) {
             return errno;
         }
 
+    #if defined(V_PLATFORM_LINUX) && defined(MADV_HUGEPAGE)
+        // Fall back to regular pages if the kernel rejects huge ones anyway.
+        if (huge_page_size != 0 && madvise(ptr, aligned_len, MADV_HUGEPAGE) != 0) {
+            huge_page_size = 0;
+        }
+    #endif
+
         // Commit the newly created state onto this object.
         m_ptr = static_cast<std::uint8_t *>(ptr) + alignment;
         m_len = len;
 
+        m_granularity = granularity;
+        m_page_size   = huge_page_size != 0 ? huge_page_size : granularity;
+
         return MmapResultSuccess;
     }
 
     void MemoryMapped::Unmap() noexcept {
         // If we don't maintain a mapping, we have nothing to do.
-        if (this->IsMapped()) {
+        if (!this->IsMapped()) {
             return;
         }
 
         // Compute the pointer alignment to revert applied offsets from mapping.
-        const std::size_t alignment = reinterpret_cast<std::uintptr_t>(m_ptr) % AllocationGranularity;
+        const std::size_t alignment = reinterpret_cast<std::uintptr_t>(m_ptr) % m_granularity;
 
         // Unmap the file view.
-        munmap(static_cast<std::uint8_t *>(m_ptr) - alignment, m_len + alignment);
+        munmap(static_cast<std::uint8_t *>(m_ptr) - alignment, AlignUp(m_len + alignment, m_granularity));
+
+        m_ptr = nullptr;
     }
 
     int MemoryMapped::Flush(std::size_t offset, std::size_t len) noexcept {
-        // If we don't maintain a mapping, we have nothing t odo.
-        if (this->IsMapped()) {
+        // If we don't maintain a mapping, we have nothing to do.
+        if (!this->IsMapped()) {
             return MmapResultSuccess;
         }
 
         auto *ptr = static_cast<std::uint8_t *>(m_ptr);
 
         // Compute offset and length of allocation with respect to granularity.
-        const std::size_t alignment        = reinterpret_cast<std::uintptr_t>(ptr + offset) % AllocationGranularity;
+        const std::size_t alignment        = reinterpret_cast<std::uintptr_t>(ptr + offset) % m_granularity;
         const std::size_t unaligned_offset = offset - alignment;
         const std::size_t unaligned_len    = len + alignment;
 
@@ -98,15 +352,15 @@ namespace vtils::impl {
     }
 
     int MemoryMapped::FlushAsync(std::size_t offset, std::size_t len) noexcept {
-        // If we don't maintain a mapping, we have nothing t odo.
-        if (this->IsMapped()) {
+        // If we don't maintain a mapping, we have nothing to do.
+        if (!this->IsMapped()) {
             return MmapResultSuccess;
         }
 
         auto *ptr = static_cast<std::uint8_t *>(m_ptr);
 
         // Compute offset and length of allocation with respect to granularity.
-        const std::size_t alignment        = reinterpret_cast<std::uintptr_t>(ptr + offset) % AllocationGranularity;
+        const std::size_t alignment        = reinterpret_cast<std::uintptr_t>(ptr + offset) % m_granularity;
         const std::size_t unaligned_offset = offset - alignment;
         const std::size_t unaligned_len    = len + alignment;
 
@@ -118,6 +372,38 @@ namespace vtils::impl {
         }
     }
 
+    int MemoryMapped::Advise(std::size_t offset, std::size_t len, int advice) noexcept {
+        // If we don't maintain a mapping, we have nothing to do.
+        if (!this->IsMapped()) {
+            return MmapResultSuccess;
+        }
+
+        auto *ptr = static_cast<std::uint8_t *>(m_ptr);
+
+        // Widen the range to whole pages, as `madvise` only takes those. For
+        // huge pages, both ends need to be aligned since they can't be split.
+        const std::size_t alignment   = reinterpret_cast<std::uintptr_t>(ptr + offset) % m_granularity;
+        const std::size_t aligned_len = AlignUp(len + alignment, m_granularity);
+
+        // Apply the hint to the pages of the mapping only. Fault readahead
+        // honors the access pattern of the mapping, so the file's own state,
+        // which is shared with everyone who has it open, is left alone.
+        void *start = ptr + offset - alignment;
+        if (madvise(start, aligned_len, advice) == 0) {
+            return MmapResultSuccess;
+        }
+
+    #if defined(MADV_PAGEOUT)
+        // Kernels before 5.4 cannot reclaim pages on request, but can at
+        // least drop them from the mapping.
+        if (advice == MADV_PAGEOUT && errno == EINVAL && madvise(start, aligned_len, MADV_DONTNEED) == 0) {
+            return MmapResultSuccess;
+        }
+    #endif
+
+        return errno;
+    }
+
     int GetFileSize(int fd, std::uint64_t *size) {
     #if defined(V_PLATFORM_LINUX) || defined(V_ARCH_WASM)
         #define V_TEMP_FSTAT fstat64
@@ -0,0 +1,261 @@
+#include "vtils/os/impl/parking_lot.hpp"
+
+#include <atomic>
+
+#include "vtils/alignment.hpp"
+#include "vtils/scope_guard.hpp"
+#include "vtils/os/mutex.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils::impl {
+
+    namespace {
+
+        constexpr std::size_t BucketBits = 9;
+        constexpr std::size_t NumBuckets = std::size_t{1} << BucketBits;
+
+        // The upper bound on the time between two fair unlocks of the same
+        // bucket, so that barging threads cannot starve parked ones.
+        constexpr auto FairTimeout = std::chrono::microseconds(1000);
+
+        struct ThreadData {
+            // 1 while the thread sleeps, set to 0 by the unparking thread.
+            std::atomic<std::uint32_t> parked;
+            // The key the thread is parked on, or `nullptr` once dequeued.
+            const void *key;
+            ThreadData *next;
+            ParkToken park_token;
+            UnparkToken unpark_token;
+
+            constexpr ThreadData() : parked(0), key(nullptr), next(nullptr), park_token(0), unpark_token(0) {}
+        };
+
+        constinit thread_local ThreadData t_thread_data;
+
+        struct alignas(CacheLineSize) Bucket {
+            Mutex mutex;
+            ThreadData *head;
+            ThreadData *tail;
+            ParkDeadline fair_timeout;
+            std::uint32_t seed;
+
+            constexpr Bucket() : mutex(), head(nullptr), tail(nullptr), fair_timeout(), seed(0) {}
+
+            // Must be called with the bucket locked.
+            void Enqueue(ThreadData *td) {
+                td->next = nullptr;
+                if (tail != nullptr) {
+                    tail->next = td;
+                } else {
+                    head = td;
+                }
+                tail = td;
+            }
+
+            // Must be called with the bucket locked. Unlinks `td`, which
+            // directly follows `prev` in the queue.
+            void Unlink(ThreadData *prev, ThreadData *td) {
+                if (prev != nullptr) {
+                    prev->next = td->next;
+                } else {
+                    head = td->next;
+                }
+                if (tail == td) {
+                    tail = prev;
+                }
+                td->key = nullptr;
+            }
+
+            // Must be called with the bucket locked.
+            bool HasKey(const void *key, const ThreadData *start) const {
+                for (auto *td = start; td != nullptr; td = td->next) {
+                    if (td->key == key) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Must be called with the bucket locked. Periodically returns
+            // `true` at a random interval of up to one FairTimeout.
+            bool ShouldBeFair() {
+                const auto now = std::chrono::steady_clock::now();
+                if (now < fair_timeout) {
+                    return false;
+                }
+
+                seed = seed * 1664525 + 1013904223;
+                const auto jitter = std::chrono::nanoseconds((seed >> 8) % std::chrono::nanoseconds(FairTimeout).count());
+                fair_timeout = now + jitter;
+
+                return true;
+            }
+        };
+
+        constinit Bucket g_buckets[NumBuckets];
+
+        ALWAYS_INLINE Bucket &GetBucket(const void *key) {
+            // Fibonacci hashing spreads adjacent addresses over all buckets.
+            const auto addr = reinterpret_cast<std::uintptr_t>(key);
+            if constexpr (sizeof(std::uintptr_t) == 8) {
+                return g_buckets[static_cast<std::uint64_t>(addr * 0x9E3779B97F4A7C15ull) >> (64 - BucketBits)];
+            } else {
+                return g_buckets[static_cast<std::uint32_t>(addr * 0x9E3779B9u) >> (32 - BucketBits)];
+            }
+        }
+
+        // Wakes a chain of threads which were dequeued with the bucket lock
+        // held. Each thread may return from Park as soon as it observes its
+        // flag being cleared, so the link must be read before that.
+        void WakeThreads(ThreadData *td) {
+            while (td != nullptr) {
+                ThreadData *next = td->next;
+
+                td->parked.store(0, std::memory_order_release);
+                FutexWakeOne(td->parked);
+
+                td = next;
+            }
+        }
+
+    }
+
+    ParkResult Park(const void *key, FunctionRef<bool()> validate, FunctionRef<void()> before_sleep,
+                    FunctionRef<void(const void *, bool)> timed_out, ParkToken token, const ParkDeadline *deadline) {
+        ThreadData *td = std::addressof(t_thread_data);
+        Bucket &bucket = GetBucket(key);
+
+        {
+            bucket.mutex.Lock();
+            V_ON_SCOPE_EXIT { bucket.mutex.Unlock(); };
+
+            if (!validate()) {
+                return { ParkResultKind::Invalid, DefaultUnparkToken };
+            }
+
+            td->parked.store(1, std::memory_order_relaxed);
+            td->key          = key;
+            td->park_token   = token;
+            td->unpark_token = DefaultUnparkToken;
+            bucket.Enqueue(td);
+        }
+
+        before_sleep();
+
+        if (deadline == nullptr) {
+            while (td->parked.load(std::memory_order_acquire) != 0) {
+                FutexWait(td->parked, 1);
+            }
+            return { ParkResultKind::Unparked, td->unpark_token };
+        }
+
+        while (td->parked.load(std::memory_order_acquire) != 0) {
+            if (FutexWaitUntil(td->parked, 1, *deadline)) {
+                continue;
+            }
+
+            bucket.mutex.Lock();
+            V_ON_SCOPE_EXIT { bucket.mutex.Unlock(); };
+
+            if (td->key == nullptr) {
+                // We were dequeued concurrently, so an unpark is imminent.
+                break;
+            }
+
+            ThreadData *prev = nullptr;
+            for (auto *cur = bucket.head; cur != td; cur = cur->next) {
+                prev = cur;
+            }
+            bucket.Unlink(prev, td);
+
+            timed_out(key, !bucket.HasKey(key, bucket.head));
+            return { ParkResultKind::TimedOut, DefaultUnparkToken };
+        }
+
+        while (td->parked.load(std::memory_order_acquire) != 0) {
+            FutexWait(td->parked, 1);
+        }
+        return { ParkResultKind::Unparked, td->unpark_token };
+    }
+
+    UnparkResult UnparkFiltered(const void *key, FunctionRef<FilterOp(ParkToken)> filter, FunctionRef<UnparkToken(UnparkResult)> callback) {
+        Bucket &bucket = GetBucket(key);
+        UnparkResult result = { 0, false, false };
+
+        ThreadData *woken_head = nullptr;
+        ThreadData *woken_tail = nullptr;
+        {
+            bucket.mutex.Lock();
+            V_ON_SCOPE_EXIT { bucket.mutex.Unlock(); };
+
+            ThreadData *prev = nullptr;
+            ThreadData *cur  = bucket.head;
+            while (cur != nullptr) {
+                if (cur->key != key) {
+                    prev = cur;
+                    cur  = cur->next;
+                    continue;
+                }
+
+                const FilterOp op = filter(cur->park_token);
+                if (op == FilterOp::Stop) {
+                    result.have_more_threads = true;
+                    break;
+                }
+                if (op == FilterOp::Skip) {
+                    result.have_more_threads = true;
+                    prev = cur;
+                    cur  = cur->next;
+                    continue;
+                }
+
+                ThreadData *next = cur->next;
+                bucket.Unlink(prev, cur);
+
+                cur->next = nullptr;
+                if (woken_tail != nullptr) {
+                    woken_tail->next = cur;
+                } else {
+                    woken_head = cur;
+                }
+                woken_tail = cur;
+                ++result.unparked_threads;
+
+                cur = next;
+            }
+
+            if (result.unparked_threads != 0) {
+                result.be_fair = bucket.ShouldBeFair();
+            }
+
+            const UnparkToken token = callback(result);
+            for (auto *td = woken_head; td != nullptr; td = td->next) {
+                td->unpark_token = token;
+            }
+        }
+
+        WakeThreads(woken_head);
+        return result;
+    }
+
+    UnparkResult UnparkOne(const void *key, FunctionRef<UnparkToken(UnparkResult)> callback) {
+        bool found = false;
+        return UnparkFiltered(key, [&](ParkToken) {
+            if (found) {
+                return FilterOp::Stop;
+            }
+            found = true;
+            return FilterOp::Unpark;
+        }, callback);
+    }
+
+    std::size_t UnparkAll(const void *key) {
+        const auto result = UnparkFiltered(
+            key,
+            [](ParkToken) { return FilterOp::Unpark; },
+            [](UnparkResult) { return DefaultUnparkToken; }
+        );
+        return result.unparked_threads;
+    }
+
+}
@@ -0,0 +1,301 @@
+#include "vtils/os/io_uring.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <system_error>
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vtils/assert.hpp"
+
+namespace vtils {
+
+    namespace {
+
+        // The ring indices are shared with the kernel as plain 32-bit words.
+        static_assert(std::atomic_ref<std::uint32_t>::is_always_lock_free);
+
+        ALWAYS_INLINE std::uint32_t LoadAcquire(std::uint32_t *index) {
+            return std::atomic_ref<std::uint32_t>(*index).load(std::memory_order_acquire);
+        }
+
+        ALWAYS_INLINE void StoreRelease(std::uint32_t *index, std::uint32_t value) {
+            std::atomic_ref<std::uint32_t>(*index).store(value, std::memory_order_release);
+        }
+
+        ALWAYS_INLINE void *MapRing(int fd, std::size_t size, off_t offset) {
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+            return ptr != MAP_FAILED ? ptr : nullptr;
+        }
+
+        template <typename T>
+        ALWAYS_INLINE T *RingAt(void *ring, std::uint32_t offset) {
+            return reinterpret_cast<T *>(static_cast<std::uint8_t *>(ring) + offset);
+        }
+
+        NORETURN COLD void ThrowError(int error, const char *what) {
+            throw std::system_error(error, std::generic_category(), what);
+        }
+
+    }
+
+    void IoOperation::await_suspend(std::coroutine_handle<> handle) {
+        m_handle = handle;
+        m_ring.Enqueue(*this);
+    }
+
+    IoUring::IoUring(unsigned entries)
+        : m_fd(-1), m_sq_ring(nullptr), m_cq_ring(nullptr), m_sqes(nullptr), m_sq_ring_size(0), m_cq_ring_size(0),
+          m_sq_head(nullptr), m_sq_tail(nullptr), m_sq_mask(0), m_sq_entries(0), m_sq_local_tail(0),
+          m_cq_head(nullptr), m_cq_tail(nullptr), m_cq_mask(0), m_cqes(nullptr),
+          m_backlog_head(nullptr), m_backlog_tail(nullptr), m_backlog_count(0), m_in_flight(0) {
+        io_uring_params params{};
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, std::addressof(params)));
+        if (m_fd < 0) {
+            ThrowError(errno, "failed to set up io_uring");
+        }
+
+        // Record the sizes before mapping anything, so that `Close` can
+        // unmap partially set up rings.
+        m_sq_entries   = params.sq_entries;
+        m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+        m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        // Newer kernels share a single mapping for both rings.
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+        }
+
+        m_sq_ring = MapRing(m_fd, m_sq_ring_size, IORING_OFF_SQ_RING);
+        m_cq_ring = single_mmap ? m_sq_ring : MapRing(m_fd, m_cq_ring_size, IORING_OFF_CQ_RING);
+        m_sqes    = static_cast<io_uring_sqe *>(MapRing(m_fd, params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+        if (m_sq_ring == nullptr || m_cq_ring == nullptr || m_sqes == nullptr) {
+            const int error = errno;
+            this->Close();
+            ThrowError(error, "failed to map io_uring");
+        }
+
+        m_sq_head    = RingAt<std::uint32_t>(m_sq_ring, params.sq_off.head);
+        m_sq_tail    = RingAt<std::uint32_t>(m_sq_ring, params.sq_off.tail);
+        m_sq_mask    = *RingAt<std::uint32_t>(m_sq_ring, params.sq_off.ring_mask);
+        m_sq_local_tail = *m_sq_tail;
+
+        m_cq_head = RingAt<std::uint32_t>(m_cq_ring, params.cq_off.head);
+        m_cq_tail = RingAt<std::uint32_t>(m_cq_ring, params.cq_off.tail);
+        m_cq_mask = *RingAt<std::uint32_t>(m_cq_ring, params.cq_off.ring_mask);
+        m_cqes    = RingAt<io_uring_cqe>(m_cq_ring, params.cq_off.cqes);
+
+        // Submission entries are always used in ring order, so the
+        // indirection array can map every slot to itself once and for all.
+        auto *array = RingAt<std::uint32_t>(m_sq_ring, params.sq_off.array);
+        for (std::uint32_t i = 0; i < m_sq_entries; ++i) {
+            array[i] = i;
+        }
+    }
+
+    IoUring::~IoUring() {
+        V_DEBUG_ASSERT(m_in_flight == 0, "io_uring destroyed with operations in flight");
+        this->Close();
+    }
+
+    void IoUring::Close() {
+        if (m_sqes != nullptr) {
+            munmap(m_sqes, m_sq_entries * sizeof(io_uring_sqe));
+        }
+        if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring) {
+            munmap(m_cq_ring, m_cq_ring_size);
+        }
+        if (m_sq_ring != nullptr) {
+            munmap(m_sq_ring, m_sq_ring_size);
+        }
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    void IoUring::Enqueue(IoOperation &op) {
+        ++m_in_flight;
+
+        // Keep submission order when operations are already waiting.
+        if (m_backlog_head == nullptr && this->TryPrepare(op)) {
+            return;
+        }
+
+        op.m_next = nullptr;
+        (m_backlog_tail != nullptr ? m_backlog_tail->m_next : m_backlog_head) = std::addressof(op);
+        m_backlog_tail = std::addressof(op);
+        ++m_backlog_count;
+    }
+
+    bool IoUring::TryPrepare(IoOperation &op) {
+        if (m_sq_local_tail - LoadAcquire(m_sq_head) == m_sq_entries) {
+            return false;
+        }
+
+        io_uring_sqe *sqe = m_sqes + (m_sq_local_tail & m_sq_mask);
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sqe->opcode    = op.m_opcode;
+        sqe->flags     = op.m_flags;
+        sqe->fd        = op.m_fd;
+        sqe->off       = op.m_offset;
+        sqe->addr      = op.m_addr;
+        sqe->len       = op.m_len;
+        // Shares its storage with the flags of every other operation.
+        sqe->rw_flags  = static_cast<__kernel_rwf_t>(op.m_op_flags);
+        sqe->buf_index = op.m_buf_index;
+        sqe->user_data = reinterpret_cast<std::uintptr_t>(std::addressof(op));
+
+        ++m_sq_local_tail;
+        return true;
+    }
+
+    void IoUring::FlushBacklog() {
+        while (m_backlog_head != nullptr && this->TryPrepare(*m_backlog_head)) {
+            m_backlog_head = m_backlog_head->m_next;
+            --m_backlog_count;
+        }
+        if (m_backlog_head == nullptr) {
+            m_backlog_tail = nullptr;
+        }
+
+        // Publish everything prepared so far in one go.
+        StoreRelease(m_sq_tail, m_sq_local_tail);
+    }
+
+    std::uint32_t IoUring::Enter(std::uint32_t to_submit, std::uint32_t min_complete) {
+        const unsigned flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0;
+
+        while (true) {
+            const long res = syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0);
+            if (res >= 0) {
+                return static_cast<std::uint32_t>(res);
+            }
+
+            switch (errno) {
+                case EINTR:
+                    continue;
+
+                // The completion ring is backed up, so it needs to be
+                // drained before the kernel accepts more work.
+                case EAGAIN:
+                case EBUSY:
+                    return 0;
+
+                default:
+                    ThrowError(errno, "failed to enter io_uring");
+            }
+        }
+    }
+
+    void IoUring::Register(unsigned opcode, const void *arg, unsigned count) {
+        if (syscall(__NR_io_uring_register, m_fd, opcode, arg, count) < 0) {
+            ThrowError(errno, "failed to register io_uring resources");
+        }
+    }
+
+    void IoUring::RegisterBuffers(std::span<const iovec> buffers) {
+        this->Register(IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size()));
+    }
+
+    void IoUring::UnregisterBuffers() {
+        this->Register(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+
+    void IoUring::RegisterFiles(std::span<const int> fds) {
+        this->Register(IORING_REGISTER_FILES, fds.data(), static_cast<unsigned>(fds.size()));
+    }
+
+    void IoUring::UnregisterFiles() {
+        this->Register(IORING_UNREGISTER_FILES, nullptr, 0);
+    }
+
+    std::size_t IoUring::Submit() {
+        std::size_t submitted = 0;
+        while (true) {
+            this->FlushBacklog();
+
+            const std::uint32_t pending = m_sq_local_tail - LoadAcquire(m_sq_head);
+            if (pending == 0) {
+                break;
+            }
+
+            const std::uint32_t count = this->Enter(pending, 0);
+            submitted += count;
+
+            // Only go again when that made room for the backlog.
+            if (count == 0 || m_backlog_head == nullptr) {
+                break;
+            }
+        }
+
+        return submitted;
+    }
+
+    std::size_t IoUring::Reap() {
+        std::size_t completed = 0;
+
+        std::uint32_t head = *m_cq_head;
+        std::uint32_t tail = LoadAcquire(m_cq_tail);
+        while (head != tail) {
+            const io_uring_cqe &cqe = m_cqes[head & m_cq_mask];
+            auto *op = reinterpret_cast<IoOperation *>(static_cast<std::uintptr_t>(cqe.user_data));
+            op->m_result = cqe.res;
+
+            // Free the entry before resuming, since the coroutine may go
+            // on to await more operations.
+            StoreRelease(m_cq_head, ++head);
+            --m_in_flight;
+            ++completed;
+
+            op->m_handle.resume();
+
+            if (head == tail) {
+                tail = LoadAcquire(m_cq_tail);
+            }
+        }
+
+        return completed;
+    }
+
+    std::size_t IoUring::Poll() {
+        // Coroutines resumed here may queue more operations, which are
+        // then submitted along with everything queued before.
+        const std::size_t completed = this->Reap();
+        this->Submit();
+
+        return completed;
+    }
+
+    std::size_t IoUring::Wait(std::size_t min_complete) {
+        std::size_t completed = this->Reap();
+
+        while (true) {
+            this->FlushBacklog();
+
+            const std::uint32_t pending = m_sq_local_tail - LoadAcquire(m_sq_head);
+            // Never wait for operations which cannot be submitted yet.
+            const std::size_t submitted = m_in_flight - m_backlog_count;
+            const std::size_t wanted = completed < min_complete ? std::min(min_complete - completed, submitted) : 0;
+            if (pending == 0 && wanted == 0) {
+                break;
+            }
+
+            this->Enter(pending, static_cast<std::uint32_t>(wanted));
+            completed += this->Reap();
+
+            // Once satisfied, submit what the resumed coroutines queued
+            // but do not keep going for as long as they produce work.
+            if (wanted == 0) {
+                break;
+            }
+        }
+
+        return completed;
+    }
+
+}
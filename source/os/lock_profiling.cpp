@@ -0,0 +1,330 @@
+#include "vtils/os/lock_profiling.hpp"
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+
+#include <algorithm>
+#include <bit>
+#include <string>
+#include <tuple>
+
+#include <fmt/core.h>
+
+#include "vtils/impl/cpu_relax.hpp"
+
+namespace vtils::impl {
+
+    namespace {
+
+        constexpr std::size_t SiteTableBits = 10;
+        constexpr std::size_t SiteTableSize = std::size_t{1} << SiteTableBits;
+
+        // The number of contenders tracked per site. When more distinct
+        // sites contend, the least frequent one is evicted, so the counts
+        // of the top contenders are approximate.
+        constexpr std::size_t ContenderSlots = 4;
+
+        struct ContenderSlot {
+            std::atomic<LockSite *> site = nullptr;
+            std::atomic<std::uint64_t> count = 0;
+        };
+
+    }
+
+    struct LockSite {
+        static constexpr std::uint32_t Empty        = 0;
+        static constexpr std::uint32_t Initializing = 1;
+        static constexpr std::uint32_t Ready        = 2;
+
+        std::atomic<std::uint32_t> state = Empty;
+
+        const char *file     = nullptr;
+        const char *function = nullptr;
+        std::uint32_t line   = 0;
+        std::uint32_t column = 0;
+
+        std::atomic<std::uint64_t> acquisitions  = 0;
+        std::atomic<std::uint64_t> contended     = 0;
+        std::atomic<std::uint64_t> total_wait_ns = 0;
+        std::atomic<std::uint64_t> max_wait_ns   = 0;
+        std::atomic<std::uint64_t> total_hold_ns = 0;
+
+        std::atomic<std::uint64_t> wait_histogram[LockHistogramBuckets] = {};
+        std::atomic<std::uint64_t> hold_histogram[LockHistogramBuckets] = {};
+
+        ContenderSlot contenders[ContenderSlots] = {};
+
+        constexpr LockSite() = default;
+
+        constexpr explicit LockSite(const char *name) : state(Ready), file(name), function("") {}
+    };
+
+    namespace {
+
+        constinit LockSite g_sites[SiteTableSize];
+
+        // Collects all sites which did not fit the table anymore.
+        constinit LockSite g_overflow_site{"<other lock sites>"};
+
+        ALWAYS_INLINE std::size_t HashLocation(const std::source_location &location) {
+            std::uint64_t hash = reinterpret_cast<std::uintptr_t>(location.file_name());
+            hash ^= (static_cast<std::uint64_t>(location.line()) << 16) ^ location.column();
+            return static_cast<std::size_t>((hash * 0x9E3779B97F4A7C15ull) >> (64 - SiteTableBits));
+        }
+
+        ALWAYS_INLINE std::size_t HistogramBucket(std::uint64_t ns) {
+            return std::min<std::size_t>(std::bit_width(ns), LockHistogramBuckets - 1);
+        }
+
+        void RecordContender(LockSite *site, LockSite *holder) {
+            for (auto &slot : site->contenders) {
+                LockSite *current = slot.site.load(std::memory_order_relaxed);
+                if (current == nullptr && slot.site.compare_exchange_strong(current, holder, std::memory_order_relaxed)) {
+                    current = holder;
+                }
+
+                if (current == holder) {
+                    slot.count.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            // All slots are taken by other sites, so replace the least
+            // frequent one and let the newcomer inherit its count.
+            ContenderSlot *min = std::addressof(site->contenders[0]);
+            for (auto &slot : site->contenders) {
+                if (slot.count.load(std::memory_order_relaxed) < min->count.load(std::memory_order_relaxed)) {
+                    min = std::addressof(slot);
+                }
+            }
+            min->site.store(holder, std::memory_order_relaxed);
+            min->count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::string FormatDuration(std::uint64_t ns) {
+            if (ns < 1'000) {
+                return fmt::format("{}ns", ns);
+            } else if (ns < 1'000'000) {
+                return fmt::format("{:.1f}us", static_cast<double>(ns) / 1e3);
+            } else if (ns < 1'000'000'000) {
+                return fmt::format("{:.1f}ms", static_cast<double>(ns) / 1e6);
+            } else {
+                return fmt::format("{:.2f}s", static_cast<double>(ns) / 1e9);
+            }
+        }
+
+        void PrintHistogram(std::FILE *out, const char *name, const std::array<std::uint64_t, LockHistogramBuckets> &histogram) {
+            fmt::print(out, "    {}:", name);
+            for (std::size_t i = 0; i < LockHistogramBuckets; ++i) {
+                if (histogram[i] == 0) {
+                    continue;
+                }
+
+                if (i == LockHistogramBuckets - 1) {
+                    fmt::print(out, " >={}: {}", FormatDuration(std::uint64_t{1} << (i - 1)), histogram[i]);
+                } else {
+                    fmt::print(out, " <{}: {}", FormatDuration(std::uint64_t{1} << i), histogram[i]);
+                }
+            }
+            fmt::print(out, "\n");
+        }
+
+        LockSiteProfile Snapshot(const LockSite &site) {
+            LockSiteProfile profile = {
+                .file          = site.file,
+                .function      = site.function,
+                .line          = site.line,
+                .column        = site.column,
+                .acquisitions  = site.acquisitions.load(std::memory_order_relaxed),
+                .contended     = site.contended.load(std::memory_order_relaxed),
+                .total_wait_ns = site.total_wait_ns.load(std::memory_order_relaxed),
+                .max_wait_ns   = site.max_wait_ns.load(std::memory_order_relaxed),
+                .total_hold_ns = site.total_hold_ns.load(std::memory_order_relaxed),
+                .wait_histogram = {},
+                .hold_histogram = {},
+                .top_contenders = {},
+            };
+
+            for (std::size_t i = 0; i < LockHistogramBuckets; ++i) {
+                profile.wait_histogram[i] = site.wait_histogram[i].load(std::memory_order_relaxed);
+                profile.hold_histogram[i] = site.hold_histogram[i].load(std::memory_order_relaxed);
+            }
+
+            for (const auto &slot : site.contenders) {
+                const LockSite *holder = slot.site.load(std::memory_order_relaxed);
+                const std::uint64_t count = slot.count.load(std::memory_order_relaxed);
+                if (holder != nullptr && count != 0) {
+                    profile.top_contenders.push_back({ holder->file, holder->function, holder->line, count });
+                }
+            }
+
+            return profile;
+        }
+
+        // The same source location may yield distinct file name pointers
+        // in different translation units, so merge sites by value.
+        void MergeInto(LockSiteProfile &dst, const LockSiteProfile &src) {
+            dst.acquisitions  += src.acquisitions;
+            dst.contended     += src.contended;
+            dst.total_wait_ns += src.total_wait_ns;
+            dst.max_wait_ns    = std::max(dst.max_wait_ns, src.max_wait_ns);
+            dst.total_hold_ns += src.total_hold_ns;
+
+            for (std::size_t i = 0; i < LockHistogramBuckets; ++i) {
+                dst.wait_histogram[i] += src.wait_histogram[i];
+                dst.hold_histogram[i] += src.hold_histogram[i];
+            }
+
+            for (const auto &contender : src.top_contenders) {
+                auto it = std::ranges::find_if(dst.top_contenders, [&](const LockContender &c) {
+                    return c.file == contender.file && c.line == contender.line;
+                });
+
+                if (it != dst.top_contenders.end()) {
+                    it->count += contender.count;
+                } else {
+                    dst.top_contenders.push_back(contender);
+                }
+            }
+        }
+
+    }
+
+    LockSite *GetLockSite(const std::source_location &location) {
+        const std::size_t hash = HashLocation(location);
+        for (std::size_t i = 0; i < SiteTableSize; ++i) {
+            LockSite &site = g_sites[(hash + i) & (SiteTableSize - 1)];
+
+            std::uint32_t state = site.state.load(std::memory_order_acquire);
+            if (state == LockSite::Empty) {
+                if (site.state.compare_exchange_strong(state, LockSite::Initializing, std::memory_order_acquire, std::memory_order_acquire)) {
+                    site.file     = location.file_name();
+                    site.function = location.function_name();
+                    site.line     = location.line();
+                    site.column   = location.column();
+                    site.state.store(LockSite::Ready, std::memory_order_release);
+
+                    return std::addressof(site);
+                }
+            }
+
+            while (state == LockSite::Initializing) {
+                CpuRelax();
+                state = site.state.load(std::memory_order_acquire);
+            }
+
+            if (site.file == location.file_name() && site.line == location.line() && site.column == location.column()) {
+                return std::addressof(site);
+            }
+        }
+
+        return std::addressof(g_overflow_site);
+    }
+
+    void RecordLockAcquire(LockSite *site, std::uint64_t wait_ns, bool contended, LockSite *holder) {
+        site->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        site->total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+        site->wait_histogram[HistogramBucket(wait_ns)].fetch_add(1, std::memory_order_relaxed);
+
+        std::uint64_t max = site->max_wait_ns.load(std::memory_order_relaxed);
+        while (wait_ns > max && !site->max_wait_ns.compare_exchange_weak(max, wait_ns, std::memory_order_relaxed)) {}
+
+        if (contended) {
+            site->contended.fetch_add(1, std::memory_order_relaxed);
+            if (holder != nullptr) {
+                RecordContender(site, holder);
+            }
+        }
+    }
+
+    void RecordLockRelease(LockSite *site, std::uint64_t hold_ns) {
+        site->total_hold_ns.fetch_add(hold_ns, std::memory_order_relaxed);
+        site->hold_histogram[HistogramBucket(hold_ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+}
+
+namespace vtils {
+
+    std::vector<LockSiteProfile> CollectLockProfile() {
+        std::vector<LockSiteProfile> profiles;
+        for (const auto &site : impl::g_sites) {
+            if (site.state.load(std::memory_order_acquire) == impl::LockSite::Ready) {
+                profiles.push_back(impl::Snapshot(site));
+            }
+        }
+        if (impl::g_overflow_site.acquisitions.load(std::memory_order_relaxed) != 0) {
+            profiles.push_back(impl::Snapshot(impl::g_overflow_site));
+        }
+
+        const auto key = [](const LockSiteProfile &p) { return std::tie(p.file, p.line, p.column); };
+        std::ranges::sort(profiles, {}, key);
+
+        std::vector<LockSiteProfile> merged;
+        for (auto &profile : profiles) {
+            if (!merged.empty() && key(merged.back()) == key(profile)) {
+                impl::MergeInto(merged.back(), profile);
+            } else {
+                merged.push_back(std::move(profile));
+            }
+        }
+
+        for (auto &profile : merged) {
+            std::ranges::sort(profile.top_contenders, std::ranges::greater{}, &LockContender::count);
+        }
+        std::ranges::sort(merged, std::ranges::greater{}, &LockSiteProfile::total_wait_ns);
+
+        return merged;
+    }
+
+    void DumpLockProfile(std::FILE *out, std::size_t limit) {
+        const auto profiles = CollectLockProfile();
+
+        fmt::print(out, "Lock contention profile ({} sites, sorted by total wait time):\n", profiles.size());
+        for (std::size_t i = 0; i < std::min(limit, profiles.size()); ++i) {
+            const auto &p = profiles[i];
+
+            const double contended_pct = p.acquisitions != 0 ? 100.0 * static_cast<double>(p.contended) / static_cast<double>(p.acquisitions) : 0.0;
+            fmt::print(out, "\n  {}:{}:{} in {}\n", p.file, p.line, p.column, p.function);
+            fmt::print(out, "    acquisitions: {}, contended: {} ({:.1f}%)\n", p.acquisitions, p.contended, contended_pct);
+            fmt::print(out, "    wait: total {}, max {}; hold: total {}\n",
+                       impl::FormatDuration(p.total_wait_ns), impl::FormatDuration(p.max_wait_ns), impl::FormatDuration(p.total_hold_ns));
+
+            impl::PrintHistogram(out, "wait histogram", p.wait_histogram);
+            impl::PrintHistogram(out, "hold histogram", p.hold_histogram);
+
+            for (const auto &contender : p.top_contenders) {
+                fmt::print(out, "    contended with {}:{} in {} ({} times)\n", contender.file, contender.line, contender.function, contender.count);
+            }
+        }
+    }
+
+    void ResetLockProfile() {
+        // Concurrent acquisitions may still land in between, which is
+        // acceptable for statistics.
+        const auto reset = [](impl::LockSite &site) {
+            site.acquisitions.store(0, std::memory_order_relaxed);
+            site.contended.store(0, std::memory_order_relaxed);
+            site.total_wait_ns.store(0, std::memory_order_relaxed);
+            site.max_wait_ns.store(0, std::memory_order_relaxed);
+            site.total_hold_ns.store(0, std::memory_order_relaxed);
+
+            for (std::size_t i = 0; i < LockHistogramBuckets; ++i) {
+                site.wait_histogram[i].store(0, std::memory_order_relaxed);
+                site.hold_histogram[i].store(0, std::memory_order_relaxed);
+            }
+
+            for (auto &slot : site.contenders) {
+                slot.site.store(nullptr, std::memory_order_relaxed);
+                slot.count.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        for (auto &site : impl::g_sites) {
+            reset(site);
+        }
+        reset(impl::g_overflow_site);
+    }
+
+}
+
+#endif
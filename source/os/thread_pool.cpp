@@ -0,0 +1,241 @@
+#include "vtils/os/thread_pool.hpp"
+
+#include <algorithm>
+
+#include "vtils/impl/cpu_relax.hpp"
+
+namespace vtils {
+
+    namespace {
+
+        // How many rounds of looking for work a worker which waits for a
+        // job to complete performs before it goes to sleep.
+        constexpr int HelpAttempts = 64;
+
+        ALWAYS_INLINE std::uint64_t NextRandom(std::uint64_t &state) {
+            // xorshift64, good enough to spread out steal attempts.
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+    }
+
+    ThreadPool::ThreadPool(std::size_t threads)
+        : m_workers(), m_injected(), m_injected_count(0), m_wake_epoch(0), m_sleepers(0), m_stop(false) {
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // All deques must exist before any worker may try to steal from them.
+        m_workers.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            m_workers.push_back(std::make_unique<impl::PoolWorker>(this, i));
+        }
+
+        for (auto &worker : m_workers) {
+            worker->thread = std::thread([this, w = worker.get()] { this->WorkerMain(*w); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        m_stop.store(true, std::memory_order_seq_cst);
+        m_wake_epoch.fetch_add(1, std::memory_order_seq_cst);
+        impl::FutexWakeAll(m_wake_epoch);
+
+        for (auto &worker : m_workers) {
+            worker->thread.join();
+        }
+    }
+
+    void ThreadPool::WorkerMain(impl::PoolWorker &worker) {
+        impl::t_current_worker = std::addressof(worker);
+
+        while (true) {
+            if (impl::Job *job = this->FindWork(worker)) {
+                job->Execute();
+                continue;
+            }
+
+            // Workers only leave once there is nothing left to do, so that
+            // all jobs submitted before destruction still run.
+            if (m_stop.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            this->Sleep();
+        }
+
+        impl::t_current_worker = nullptr;
+    }
+
+    impl::Job *ThreadPool::FindWork(impl::PoolWorker &worker) {
+        impl::Job *job;
+        if (worker.deque.Take(job)) {
+            return job;
+        }
+
+        if ((job = this->PopInjected()) != nullptr) {
+            return job;
+        }
+
+        return this->Steal(worker);
+    }
+
+    impl::Job *ThreadPool::PopInjected() {
+        if (m_injected_count.load(std::memory_order_relaxed) == 0) {
+            return nullptr;
+        }
+
+        auto queue = m_injected.Lock();
+        impl::Job *job = queue->head;
+        if (job != nullptr) {
+            queue->head = job->next;
+            if (queue->head == nullptr) {
+                queue->tail = nullptr;
+            }
+            m_injected_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    impl::Job *ThreadPool::Steal(impl::PoolWorker &worker) {
+        const std::size_t count = m_workers.size();
+        if (count <= 1) {
+            return nullptr;
+        }
+
+        // Start at a random victim so that thieves do not all gang up
+        // on the same worker.
+        const std::size_t start = static_cast<std::size_t>(NextRandom(worker.rng) % count);
+
+        bool retry = true;
+        while (retry) {
+            retry = false;
+            for (std::size_t i = 0; i < count; ++i) {
+                impl::PoolWorker &victim = *m_workers[(start + i) % count];
+                if (std::addressof(victim) == std::addressof(worker)) {
+                    continue;
+                }
+
+                impl::Job *job;
+                switch (victim.deque.Steal(job)) {
+                    using enum impl::WorkStealingDeque<impl::Job *>::StealResult;
+                    case Success: return job;
+                    case Retry:   retry = true; break;
+                    case Empty:   break;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool ThreadPool::HasWork() const {
+        if (m_injected_count.load(std::memory_order_relaxed) != 0) {
+            return true;
+        }
+
+        return std::any_of(m_workers.begin(), m_workers.end(), [](const auto &worker) {
+            return !worker->deque.IsEmpty();
+        });
+    }
+
+    void ThreadPool::Sleep() {
+        const std::uint32_t epoch = m_wake_epoch.load(std::memory_order_acquire);
+
+        // After registering as a sleeper, anyone who publishes a job either
+        // sees us and bumps the epoch, or we see the job in the check below.
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!this->HasWork() && !m_stop.load(std::memory_order_relaxed)) {
+            impl::FutexWait(m_wake_epoch, epoch);
+        }
+
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void ThreadPool::WakeSleeper() {
+        m_wake_epoch.fetch_add(1, std::memory_order_release);
+        if (impl::FutexWakeOne(m_wake_epoch)) {
+            return;
+        }
+
+        // The sleeper may be a worker which parked while waiting for a job
+        // counter. Those registered before the fence in `NotifyWork`, so
+        // they are visible here unless they already saw the new job.
+        for (auto &worker : m_workers) {
+            if (worker->helping.load(std::memory_order_relaxed)) {
+                worker->park_epoch.fetch_add(1, std::memory_order_release);
+                impl::FutexWakeOne(worker->park_epoch);
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::Inject(impl::Job *job) {
+        {
+            auto queue = m_injected.Lock();
+            job->next = nullptr;
+            if (queue->tail != nullptr) {
+                queue->tail->next = job;
+            } else {
+                queue->head = job;
+            }
+            queue->tail = job;
+            m_injected_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        this->NotifyWork();
+    }
+
+    void ThreadPool::ParkHelper(impl::PoolWorker &worker, impl::JobCounter &counter) {
+        const std::uint32_t epoch = worker.park_epoch.load(std::memory_order_acquire);
+        if (!counter.PrepareHelperPark()) {
+            return;
+        }
+
+        // Like `Sleep`, but on the park word of the worker, which is bumped
+        // by the counter reaching zero and by `WakeSleeper` for new jobs.
+        worker.helping.store(true, std::memory_order_relaxed);
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!this->HasWork() && !counter.IsDone()) {
+            impl::FutexWait(worker.park_epoch, epoch);
+        }
+
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        worker.helping.store(false, std::memory_order_relaxed);
+    }
+
+    void ThreadPool::WaitUntilDone(impl::JobCounter &counter) {
+        impl::PoolWorker *worker = this->GetCurrentWorker();
+        if (worker == nullptr) {
+            counter.Wait();
+            return;
+        }
+
+        // Keep the worker busy with other jobs while the ones we wait for
+        // are being executed elsewhere. Those may still fork off more work
+        // later, so the worker parks where new jobs will wake it up rather
+        // than blocking on the counter alone.
+        int attempts = 0;
+        while (!counter.IsDone()) {
+            if (impl::Job *job = this->FindWork(*worker)) {
+                job->Execute();
+                attempts = 0;
+            } else if (attempts < HelpAttempts) {
+                impl::CpuRelax();
+                ++attempts;
+            } else {
+                this->ParkHelper(*worker, counter);
+                attempts = 0;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,300 @@
+#include "vtils/os/timer_wheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <utility>
+
+#include "vtils/assert.hpp"
+#include "vtils/os/impl/futex.hpp"
+
+namespace vtils {
+
+    namespace {
+
+        // A thread blocked in `TimerWheel::SleepUntil`.
+        struct Sleeper {
+            Timer timer;
+            std::atomic<std::uint32_t> fired;
+
+            static void Wake(Timer &timer) {
+                // `timer` is the first member of a standard-layout struct.
+                auto *self = reinterpret_cast<Sleeper *>(std::addressof(timer));
+                self->fired.store(1, std::memory_order_release);
+                impl::FutexWakeOne(self->fired);
+            }
+        };
+
+    }
+
+    TimerWheel::TimerWheel(Clock::duration resolution)
+        : m_lock(), m_start(Clock::now()), m_resolution(resolution), m_now(0), m_pending(0), m_levels(),
+          m_expired_head(nullptr), m_expired_tail(nullptr), m_driver_asleep(false), m_wake_tick(NoTick), m_wake_epoch(0) {
+        V_ASSERT(resolution > Clock::duration::zero(), "timer resolution must be positive");
+    }
+
+    void TimerWheel::Link(Timer &timer, std::uint64_t expiry) {
+        // Callers make sure that the expiry is not in the past.
+        V_DEBUG_ASSERT(expiry >= m_now);
+
+        timer.m_expiry = expiry;
+        timer.m_state  = Timer::State::Pending;
+
+        const std::uint64_t delta = std::min(expiry - m_now, MaxDelta);
+        const std::uint64_t target = m_now + delta;
+
+        // The lowest level whose rotation spans the delta.
+        const std::size_t level = delta < SlotCount ? 0 : (std::bit_width(delta) - 1) / SlotBits;
+        const std::size_t slot  = static_cast<std::size_t>(target >> (level * SlotBits)) & SlotMask;
+
+        Timer *&head = m_levels[level].slots[slot];
+        timer.m_prev  = nullptr;
+        timer.m_next  = head;
+        timer.m_level = static_cast<std::uint8_t>(level);
+        timer.m_slot  = static_cast<std::uint8_t>(slot);
+        if (head != nullptr) {
+            head->m_prev = std::addressof(timer);
+        }
+        head = std::addressof(timer);
+
+        m_levels[level].occupied |= std::uint64_t{1} << slot;
+    }
+
+    void TimerWheel::Unlink(Timer &timer) {
+        if (timer.m_state == Timer::State::Expired) {
+            (timer.m_prev != nullptr ? timer.m_prev->m_next : m_expired_head) = timer.m_next;
+            (timer.m_next != nullptr ? timer.m_next->m_prev : m_expired_tail) = timer.m_prev;
+        } else {
+            Level &level = m_levels[timer.m_level];
+            (timer.m_prev != nullptr ? timer.m_prev->m_next : level.slots[timer.m_slot]) = timer.m_next;
+            if (timer.m_next != nullptr) {
+                timer.m_next->m_prev = timer.m_prev;
+            }
+
+            if (level.slots[timer.m_slot] == nullptr) {
+                level.occupied &= ~(std::uint64_t{1} << timer.m_slot);
+            }
+        }
+
+        timer.m_state = Timer::State::Idle;
+    }
+
+    void TimerWheel::Cascade(std::size_t level, std::size_t slot) {
+        Timer *timer = std::exchange(m_levels[level].slots[slot], nullptr);
+        m_levels[level].occupied &= ~(std::uint64_t{1} << slot);
+
+        // Redistribute the timers over the finer levels, relative to the
+        // start of the slot which is now reached.
+        while (timer != nullptr) {
+            Timer *next = timer->m_next;
+            this->Link(*timer, timer->m_expiry);
+            timer = next;
+        }
+    }
+
+    void TimerWheel::Expire(std::size_t slot) {
+        Timer *timer = std::exchange(m_levels[0].slots[slot], nullptr);
+        m_levels[0].occupied &= ~(std::uint64_t{1} << slot);
+
+        while (timer != nullptr) {
+            Timer *next = timer->m_next;
+
+            timer->m_state = Timer::State::Expired;
+            timer->m_prev  = m_expired_tail;
+            timer->m_next  = nullptr;
+            (m_expired_tail != nullptr ? m_expired_tail->m_next : m_expired_head) = timer;
+            m_expired_tail = timer;
+
+            timer = next;
+        }
+    }
+
+    std::uint64_t TimerWheel::GetNextEventTick() const {
+        std::uint64_t tick = NoTick;
+        for (std::size_t level = 0; level < LevelCount; ++level) {
+            const std::uint64_t occupied = m_levels[level].occupied;
+            if (occupied == 0) {
+                continue;
+            }
+
+            // Find the next occupied slot after the current one, wrapping
+            // around once. That slot comes up at the start of its block.
+            const std::size_t shift  = level * SlotBits;
+            const std::uint64_t block = (m_now >> shift) + 1;
+            const int distance = std::countr_zero(std::rotr(occupied, static_cast<int>(block & SlotMask)));
+
+            tick = std::min(tick, (block + static_cast<std::uint64_t>(distance)) << shift);
+        }
+
+        return tick;
+    }
+
+    std::size_t TimerWheel::RunExpired() {
+        std::size_t count = 0;
+        while (true) {
+            m_lock.Lock();
+            Timer *timer = m_expired_head;
+            if (timer == nullptr) {
+                m_lock.Unlock();
+                break;
+            }
+
+            // Once the lock is released, the timer may be rescheduled or
+            // cancelled concurrently, so read everything we need first.
+            const Timer::Callback callback = timer->m_callback;
+            this->Unlink(*timer);
+            --m_pending;
+            m_lock.Unlock();
+
+            // The callback may reschedule or free the timer.
+            callback(*timer);
+            ++count;
+        }
+
+        return count;
+    }
+
+    std::size_t TimerWheel::GetPendingCount() {
+        m_lock.Lock();
+        const std::size_t pending = m_pending;
+        m_lock.Unlock();
+
+        return pending;
+    }
+
+    void TimerWheel::Schedule(Timer &timer, TimePoint time) {
+        std::uint64_t expiry = this->ToTick(time, true);
+
+        m_lock.Lock();
+        if (timer.m_state != Timer::State::Idle) {
+            this->Unlink(timer);
+        } else {
+            ++m_pending;
+        }
+
+        // The current tick has already been processed.
+        expiry = std::max(expiry, m_now + 1);
+        this->Link(timer, expiry);
+
+        // Wake up the driver when it sleeps past the new deadline. Once woken,
+        // it looks at the wheel again before it goes back to sleep.
+        const bool wake = m_driver_asleep && expiry < m_wake_tick;
+        if (wake) {
+            m_driver_asleep = false;
+        }
+        m_lock.Unlock();
+
+        if (wake) {
+            m_wake_epoch.fetch_add(1, std::memory_order_release);
+            impl::FutexWakeOne(m_wake_epoch);
+        }
+    }
+
+    bool TimerWheel::Cancel(Timer &timer) {
+        m_lock.Lock();
+        const bool pending = timer.m_state != Timer::State::Idle;
+        if (pending) {
+            this->Unlink(timer);
+            --m_pending;
+        }
+        m_lock.Unlock();
+
+        return pending;
+    }
+
+    std::size_t TimerWheel::AdvanceTo(TimePoint now) {
+        const std::uint64_t target = this->ToTick(now, false);
+
+        m_lock.Lock();
+        while (true) {
+            const std::uint64_t tick = this->GetNextEventTick();
+            if (tick > target) {
+                break;
+            }
+            m_now = tick;
+
+            // Cascade coarser slots first, since their timers may be due in
+            // this very tick.
+            for (std::size_t level = LevelCount - 1; level > 0; --level) {
+                const std::size_t shift = level * SlotBits;
+                if ((tick & ((std::uint64_t{1} << shift) - 1)) != 0) {
+                    continue;
+                }
+
+                const std::size_t slot = static_cast<std::size_t>(tick >> shift) & SlotMask;
+                if (m_levels[level].occupied & (std::uint64_t{1} << slot)) {
+                    this->Cascade(level, slot);
+                }
+            }
+
+            const std::size_t slot = static_cast<std::size_t>(tick) & SlotMask;
+            if (m_levels[0].occupied & (std::uint64_t{1} << slot)) {
+                this->Expire(slot);
+            }
+        }
+        m_now = std::max(m_now, target);
+        m_lock.Unlock();
+
+        return this->RunExpired();
+    }
+
+    std::optional<TimerWheel::TimePoint> TimerWheel::GetNextExpiry() {
+        m_lock.Lock();
+        const std::uint64_t tick = m_expired_head != nullptr ? m_now : this->GetNextEventTick();
+        m_lock.Unlock();
+
+        if (tick == NoTick) {
+            return std::nullopt;
+        }
+        return this->ToTimePoint(tick);
+    }
+
+    void TimerWheel::SleepUntil(TimePoint time) {
+        Sleeper sleeper{ Timer(&Sleeper::Wake), 0 };
+        this->Schedule(sleeper.timer, time);
+
+        while (sleeper.fired.load(std::memory_order_acquire) == 0) {
+            impl::FutexWait(sleeper.fired, 0);
+        }
+    }
+
+    TimerThread::TimerThread(TimerWheel &wheel)
+        : m_wheel(wheel), m_stop(false), m_thread() {
+        m_thread = std::thread([this] { this->Run(); });
+    }
+
+    TimerThread::~TimerThread() {
+        m_stop.store(true, std::memory_order_release);
+        m_wheel.m_wake_epoch.fetch_add(1, std::memory_order_release);
+        impl::FutexWakeAll(m_wheel.m_wake_epoch);
+
+        m_thread.join();
+    }
+
+    void TimerThread::Run() {
+        while (!m_stop.load(std::memory_order_acquire)) {
+            m_wheel.AdvanceTo(TimerWheel::Clock::now());
+
+            // Publish the deadline we are about to sleep until while holding
+            // the lock, so that earlier timers scheduled afterwards bump the
+            // epoch we read here.
+            m_wheel.m_lock.Lock();
+            const std::uint64_t tick = m_wheel.m_expired_head != nullptr ? m_wheel.m_now : m_wheel.GetNextEventTick();
+            m_wheel.m_driver_asleep = true;
+            m_wheel.m_wake_tick     = tick;
+            const std::uint32_t epoch = m_wheel.m_wake_epoch.load(std::memory_order_acquire);
+            m_wheel.m_lock.Unlock();
+
+            if (m_stop.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            if (tick == TimerWheel::NoTick) {
+                impl::FutexWait(m_wheel.m_wake_epoch, epoch);
+            } else {
+                impl::FutexWaitUntil(m_wheel.m_wake_epoch, epoch, m_wheel.ToTimePoint(tick));
+            }
+        }
+    }
+
+}
@@ -0,0 +1,59 @@
+/**
+ * @file coroutine_helpers.hpp
+ * @brief Coroutine scaffolding shared by the tests of awaitable primitives.
+ * @copyright Valentin B.
+ */
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+
+// A coroutine which starts right away and cleans up after itself.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Suspends the awaiting coroutine until the test opens it.
+struct Gate {
+    std::coroutine_handle<> handle;
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) { handle = h; }
+    void await_resume() const {}
+
+    void Open() {
+        const auto h = handle;
+        handle = {};
+        h.resume();
+    }
+};
+
+// Collects granted coroutines so that the test decides when they run.
+struct QueueExecutor {
+    std::deque<std::coroutine_handle<>> queue;
+
+    void Schedule(std::coroutine_handle<> handle) {
+        queue.push_back(handle);
+    }
+
+    bool RunOne() {
+        if (queue.empty()) {
+            return false;
+        }
+        const auto handle = queue.front();
+        queue.pop_front();
+        handle.resume();
+        return true;
+    }
+
+    void RunAll() {
+        while (this->RunOne()) {}
+    }
+};
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/async_mutex.hpp>
+
+#include "coroutine_helpers.hpp"
+
+namespace {
+
+    Detached HoldUntil(vtils::AsyncMutex<std::vector<int>> &mutex, Gate &gate) {
+        auto guard = co_await mutex.Lock();
+        co_await gate;
+    }
+
+    Detached Append(vtils::AsyncMutex<std::vector<int>> &mutex, int value) {
+        auto guard = co_await mutex.Lock();
+        guard->push_back(value);
+    }
+
+    Detached Append(vtils::AsyncMutex<std::vector<int>> &mutex, QueueExecutor &executor, int value) {
+        auto guard = co_await mutex.Lock(executor);
+        guard->push_back(value);
+    }
+
+}
+
+TEST(AsyncMutex, UncontendedLockDoesNotSuspend) {
+    vtils::AsyncMutex<std::vector<int>> mutex;
+
+    bool done = false;
+    [](vtils::AsyncMutex<std::vector<int>> &mutex, bool &done) -> Detached {
+        {
+            auto guard = co_await mutex.Lock();
+            guard->push_back(1);
+        }
+        {
+            auto guard = co_await mutex.Lock();
+            guard->push_back(2);
+        }
+        done = true;
+    }(mutex, done);
+
+    EXPECT_TRUE(done);
+}
+
+TEST(AsyncMutex, TryLockFailsWhileHeld) {
+    vtils::impl::AsyncMutex raw;
+
+    EXPECT_TRUE(raw.TryLock());
+    EXPECT_FALSE(raw.TryLock());
+    raw.Unlock();
+
+    EXPECT_TRUE(raw.TryLock());
+    raw.Unlock();
+}
+
+TEST(AsyncMutex, HandsOverInFifoOrder) {
+    vtils::AsyncMutex<std::vector<int>> mutex;
+    Gate gate;
+
+    HoldUntil(mutex, gate);
+    for (int i = 0; i < 5; ++i) {
+        Append(mutex, i);
+    }
+
+    // Each waiter is resumed inline when the previous holder unlocks.
+    gate.Open();
+
+    std::vector<int> result;
+    [](vtils::AsyncMutex<std::vector<int>> &mutex, std::vector<int> &result) -> Detached {
+        auto guard = co_await mutex.Lock();
+        result = *guard;
+    }(mutex, result);
+
+    EXPECT_EQ(result, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(AsyncMutex, ResumesThroughExecutor) {
+    vtils::AsyncMutex<std::vector<int>> mutex;
+    QueueExecutor executor;
+    Gate gate;
+
+    HoldUntil(mutex, gate);
+    Append(mutex, executor, 1);
+    Append(mutex, executor, 2);
+
+    // Unlocking only schedules the next waiter, which owns the lock even
+    // though it did not run yet.
+    gate.Open();
+    ASSERT_EQ(executor.queue.size(), 1u);
+
+    EXPECT_TRUE(executor.RunOne());
+    ASSERT_EQ(executor.queue.size(), 1u);
+    EXPECT_TRUE(executor.RunOne());
+    EXPECT_FALSE(executor.RunOne());
+
+    std::vector<int> result;
+    [](vtils::AsyncMutex<std::vector<int>> &mutex, std::vector<int> &result) -> Detached {
+        auto guard = co_await mutex.Lock();
+        result = *guard;
+    }(mutex, result);
+    EXPECT_EQ(result, (std::vector<int>{1, 2}));
+}
+
+TEST(AsyncMutex, MutualExclusionAcrossThreads) {
+    constexpr std::size_t Threads    = 4;
+    constexpr std::size_t Iterations = 10'000;
+
+    vtils::AsyncMutex<std::size_t> mutex;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                [](vtils::AsyncMutex<std::size_t> &mutex) -> Detached {
+                    auto guard = co_await mutex.Lock();
+                    const std::size_t value = *guard;
+                    *guard = value + 1;
+                }(mutex);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // Coroutines which had to wait may have been resumed on another thread,
+    // but all of them completed once every thread returned.
+    std::size_t result = 0;
+    [](vtils::AsyncMutex<std::size_t> &mutex, std::size_t &result) -> Detached {
+        auto guard = co_await mutex.Lock();
+        result = *guard;
+    }(mutex, result);
+    EXPECT_EQ(result, Threads * Iterations);
+}
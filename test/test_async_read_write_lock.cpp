@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/async_read_write_lock.hpp>
+
+#include "coroutine_helpers.hpp"
+
+namespace {
+
+    using Lock = vtils::AsyncReadWriteLock<int>;
+    using Log  = std::vector<std::string>;
+
+    Detached Reader(const Lock &lock, Log &log, std::string name, Gate *gate = nullptr) {
+        auto guard = co_await lock.Read();
+        log.push_back(name);
+        if (gate != nullptr) {
+            co_await *gate;
+        }
+    }
+
+    Detached Reader(const Lock &lock, QueueExecutor &executor, Log &log, std::string name) {
+        auto guard = co_await lock.Read(executor);
+        log.push_back(name);
+    }
+
+    Detached Writer(Lock &lock, Log &log, std::string name, Gate *gate = nullptr) {
+        auto guard = co_await lock.Write();
+        ++*guard;
+        log.push_back(name);
+        if (gate != nullptr) {
+            co_await *gate;
+        }
+    }
+
+}
+
+TEST(AsyncReadWriteLock, ReadersShareTheLock) {
+    Lock lock;
+    Log log;
+    Gate first;
+    Gate second;
+
+    Reader(lock, log, "r1", &first);
+    Reader(lock, log, "r2", &second);
+    EXPECT_EQ(log, (Log{"r1", "r2"}));
+
+    vtils::impl::AsyncReadWriteLock raw;
+    EXPECT_TRUE(raw.TryRead());
+    EXPECT_TRUE(raw.TryRead());
+    EXPECT_FALSE(raw.TryWrite());
+    raw.ReadUnlock();
+    raw.ReadUnlock();
+    EXPECT_TRUE(raw.TryWrite());
+    EXPECT_FALSE(raw.TryRead());
+    raw.WriteUnlock();
+
+    first.Open();
+    second.Open();
+}
+
+TEST(AsyncReadWriteLock, WaitersAreServedInFifoOrder) {
+    Lock lock;
+    Log log;
+    Gate reader_gate;
+    Gate writer_gate;
+
+    Reader(lock, log, "r1", &reader_gate);
+    Writer(lock, log, "w1", &writer_gate);
+    // This reader must not overtake the queued writer, even though the
+    // lock is currently only held for reading.
+    Reader(lock, log, "r2");
+    Writer(lock, log, "w2");
+    Reader(lock, log, "r3");
+    Reader(lock, log, "r4");
+    EXPECT_EQ(log, (Log{"r1"}));
+
+    reader_gate.Open();
+    EXPECT_EQ(log, (Log{"r1", "w1"}));
+
+    writer_gate.Open();
+    EXPECT_EQ(log, (Log{"r1", "w1", "r2", "w2", "r3", "r4"}));
+
+    int value = 0;
+    [](const Lock &lock, int &value) -> Detached {
+        auto guard = co_await lock.Read();
+        value = *guard;
+    }(lock, value);
+    EXPECT_EQ(value, 2);
+}
+
+TEST(AsyncReadWriteLock, WriterAdmitsQueuedReadersTogether) {
+    Lock lock;
+    Log log;
+    QueueExecutor executor;
+    Gate gate;
+
+    Writer(lock, log, "w", &gate);
+    Reader(lock, executor, log, "r1");
+    Reader(lock, executor, log, "r2");
+    Reader(lock, executor, log, "r3");
+    Writer(lock, log, "w2");
+
+    // Releasing the writer grants the whole run of readers up to the next
+    // writer at once.
+    gate.Open();
+    EXPECT_EQ(executor.queue.size(), 3u);
+    EXPECT_EQ(log, (Log{"w"}));
+
+    executor.RunAll();
+    EXPECT_EQ(log, (Log{"w", "r1", "r2", "r3", "w2"}));
+}
+
+TEST(AsyncReadWriteLock, WritersExcludeEachOtherAcrossThreads) {
+    constexpr std::size_t Threads    = 4;
+    constexpr std::size_t Iterations = 5'000;
+
+    vtils::AsyncReadWriteLock<std::size_t> lock;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                [](vtils::AsyncReadWriteLock<std::size_t> &lock) -> Detached {
+                    auto guard = co_await lock.Write();
+                    const std::size_t value = *guard;
+                    *guard = value + 1;
+                }(lock);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::size_t result = 0;
+    [](const vtils::AsyncReadWriteLock<std::size_t> &lock, std::size_t &result) -> Detached {
+        auto guard = co_await lock.Read();
+        result = *guard;
+    }(lock, result);
+    EXPECT_EQ(result, Threads * Iterations);
+}
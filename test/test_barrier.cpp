@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/barrier.hpp>
+
+TEST(Barrier, SingleThreadIsAlwaysLast) {
+    vtils::Barrier barrier(1);
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(barrier.ArriveAndWait());
+    }
+}
+
+TEST(Barrier, PhasesAndCompletion) {
+    constexpr std::size_t Threads = 4;
+    constexpr std::size_t Phases  = 200;
+
+    vtils::Barrier barrier(Threads);
+    std::atomic<std::size_t> arrivals[Phases] = {};
+    std::atomic<std::size_t> leaders[Phases]  = {};
+    std::size_t completed = 0;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t phase = 0; phase < Phases; ++phase) {
+                arrivals[phase].fetch_add(1);
+
+                if (barrier.ArriveAndWait()) {
+                    // The last thread runs the completion step for the phase,
+                    // after everyone arrived.
+                    EXPECT_EQ(arrivals[phase].load(), Threads);
+                    leaders[phase].fetch_add(1);
+                    ++completed;
+                }
+
+                // Nobody leaves a phase before everyone arrived.
+                EXPECT_EQ(arrivals[phase].load(), Threads);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t phase = 0; phase < Phases; ++phase) {
+        EXPECT_EQ(leaders[phase].load(), 1u);
+    }
+    EXPECT_EQ(completed, Phases);
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/channel.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(Channel, FifoOrder) {
+    vtils::Channel<int> channel;
+
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(channel.Send(i));
+    }
+    EXPECT_EQ(channel.GetSize(), 100u);
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(channel.Receive(), i);
+    }
+    EXPECT_EQ(channel.TryReceive(), std::nullopt);
+}
+
+TEST(Channel, BoundedTrySendFailsWhenFull) {
+    vtils::Channel<std::unique_ptr<int>> channel(2);
+
+    EXPECT_TRUE(channel.TrySend(std::make_unique<int>(1)));
+    EXPECT_TRUE(channel.TrySend(std::make_unique<int>(2)));
+
+    auto value = std::make_unique<int>(3);
+    EXPECT_FALSE(channel.TrySend(std::move(value)));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(**channel.Receive(), 1);
+}
+
+TEST(Channel, BoundedSendBlocksUntilReceived) {
+    vtils::Channel<int> channel(1);
+    std::atomic<bool> sent = false;
+
+    ASSERT_TRUE(channel.Send(1));
+    std::thread sender([&] {
+        EXPECT_TRUE(channel.Send(2));
+        sent = true;
+    });
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(sent);
+    EXPECT_EQ(channel.Receive(), 1);
+    sender.join();
+
+    EXPECT_TRUE(sent);
+    EXPECT_EQ(channel.Receive(), 2);
+}
+
+TEST(Channel, CloseDrainsRemainingValues) {
+    vtils::Channel<int> channel;
+
+    channel.Send(1);
+    channel.Send(2);
+    channel.Close();
+
+    EXPECT_TRUE(channel.IsClosed());
+    EXPECT_FALSE(channel.Send(3));
+    EXPECT_EQ(channel.Receive(), 1);
+    EXPECT_EQ(channel.Receive(), 2);
+    EXPECT_EQ(channel.Receive(), std::nullopt);
+}
+
+TEST(Channel, CloseWakesBlockedReceiver) {
+    vtils::Channel<int> channel;
+
+    std::thread receiver([&] { EXPECT_EQ(channel.Receive(), std::nullopt); });
+    std::this_thread::sleep_for(20ms);
+    channel.Close();
+    receiver.join();
+}
+
+TEST(Channel, ReceiveTimesOut) {
+    vtils::Channel<int> channel;
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(channel.TryReceiveFor(30ms), std::nullopt);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 30ms);
+
+    channel.Send(5);
+    EXPECT_EQ(channel.TryReceiveFor(30ms), 5);
+}
+
+TEST(Channel, Batches) {
+    vtils::Channel<int> channel(4);
+
+    std::thread sender([&] {
+        std::array<int, 10> values = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+        EXPECT_EQ(channel.SendBatch(values), values.size());
+        channel.Close();
+    });
+
+    int expected = 0;
+    std::array<int, 3> buffer;
+    while (const std::size_t count = channel.ReceiveBatch(buffer)) {
+        for (std::size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(buffer[i], expected++);
+        }
+    }
+    sender.join();
+
+    EXPECT_EQ(expected, 10);
+}
+
+TEST(Channel, SelectPrefersEarlierCases) {
+    vtils::Channel<int> a, b;
+    int received = 0;
+
+    a.Send(1);
+    b.Send(2);
+
+    auto on_a = vtils::OnReceive(a, [&](int v) { received = v; });
+    auto on_b = vtils::OnReceive(b, [&](int v) { received = v; });
+
+    EXPECT_EQ(vtils::Select(on_a, on_b), 0u);
+    EXPECT_EQ(received, 1);
+    EXPECT_EQ(vtils::Select(on_a, on_b), 1u);
+    EXPECT_EQ(received, 2);
+}
+
+TEST(Channel, SelectWaitsForAnyChannel) {
+    vtils::Channel<int> a, b;
+    int received = 0;
+
+    std::thread sender([&] {
+        std::this_thread::sleep_for(20ms);
+        b.Send(7);
+    });
+
+    const auto index = vtils::Select(
+        vtils::OnReceive(a, [&](int v) { received = -v; }),
+        vtils::OnReceive(b, [&](int v) { received = v; })
+    );
+    sender.join();
+
+    EXPECT_EQ(index, 1u);
+    EXPECT_EQ(received, 7);
+}
+
+TEST(Channel, SelectSkipsClosedChannels) {
+    vtils::Channel<int> a, b;
+
+    a.Close();
+    b.Send(3);
+    EXPECT_EQ(vtils::Select(vtils::OnReceive(a, [](int) {}), vtils::OnReceive(b, [](int) {})), 1u);
+
+    b.Close();
+    EXPECT_EQ(vtils::Select(vtils::OnReceive(a, [](int) {}), vtils::OnReceive(b, [](int) {})), std::nullopt);
+}
+
+TEST(Channel, SelectTimesOut) {
+    vtils::Channel<int> a, b;
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(vtils::SelectFor(30ms, vtils::OnReceive(a, [](int) {}), vtils::OnReceive(b, [](int) {})), std::nullopt);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 30ms);
+}
+
+TEST(Channel, NoLossOrDuplicationUnderContention) {
+    constexpr std::uint32_t PerSender = 20'000;
+    constexpr std::size_t Receivers = 4;
+
+    // Selecting and plain receivers compete for the same channels, so
+    // wakeups claimed by a select must never go missing.
+    vtils::Channel<std::uint32_t> a(8), b(8);
+    std::vector<std::atomic<std::uint32_t>> seen(2 * PerSender);
+    std::vector<std::thread> threads;
+
+    threads.emplace_back([&] {
+        for (std::uint32_t i = 0; i < PerSender; ++i) {
+            a.Send(i);
+        }
+        a.Close();
+    });
+    threads.emplace_back([&] {
+        for (std::uint32_t i = 0; i < PerSender; ++i) {
+            b.Send(PerSender + i);
+        }
+        b.Close();
+    });
+
+    for (std::size_t r = 0; r < Receivers; ++r) {
+        threads.emplace_back([&, r] {
+            auto record = [&](std::uint32_t v) { seen[v].fetch_add(1, std::memory_order_relaxed); };
+            if (r % 2 == 0) {
+                while (vtils::Select(vtils::OnReceive(a, record), vtils::OnReceive(b, record))) {}
+            } else {
+                vtils::Channel<std::uint32_t> &channel = r % 4 == 1 ? a : b;
+                while (const auto value = channel.Receive()) {
+                    record(*value);
+                }
+            }
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t i = 0; i < seen.size(); ++i) {
+        ASSERT_EQ(seen[i].load(), 1u) << "value " << i;
+    }
+}
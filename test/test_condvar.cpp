@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/condvar.hpp>
+#include <vtils/os/mutex.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    struct State {
+        std::size_t generation = 0;
+        std::size_t waiting    = 0;
+        std::size_t woken      = 0;
+    };
+
+}
+
+TEST(ConditionVariable, PredicateWait) {
+    vtils::Mutex<bool> mutex;
+    vtils::ConditionVariable cv;
+
+    std::thread producer([&] {
+        std::this_thread::sleep_for(10ms);
+        {
+            auto guard = mutex.Lock();
+            *guard = true;
+        }
+        cv.NotifyOne();
+    });
+
+    {
+        auto guard = mutex.Lock();
+        cv.Wait(guard, [](bool &ready) { return ready; });
+        EXPECT_TRUE(*guard);
+    }
+
+    producer.join();
+}
+
+TEST(ConditionVariable, WaitForTimesOut) {
+    vtils::Mutex<bool> mutex;
+    vtils::ConditionVariable cv;
+
+    auto guard = mutex.Lock();
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(cv.WaitFor(guard, 20ms, [](bool &ready) { return ready; }));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+    EXPECT_FALSE(*guard);
+}
+
+TEST(ConditionVariable, NotifyAllWakesEveryWaiter) {
+    constexpr std::size_t Waiters = 16;
+    constexpr std::size_t Rounds  = 20;
+
+    vtils::Mutex<State> mutex;
+    vtils::ConditionVariable cv;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Waiters; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t round = 1; round <= Rounds; ++round) {
+                auto guard = mutex.Lock();
+                ++guard->waiting;
+                cv.NotifyAll();
+                cv.Wait(guard, [&](State &state) { return state.generation >= round; });
+
+                // The notifier cannot start the next round before everyone
+                // came back for it, so waiters must see exactly the generation
+                // it published under the mutex before notifying.
+                EXPECT_EQ(guard->generation, round);
+                ++guard->woken;
+            }
+        });
+    }
+
+    for (std::size_t round = 1; round <= Rounds; ++round) {
+        auto guard = mutex.Lock();
+        cv.Wait(guard, [&](State &state) { return state.waiting == Waiters * round; });
+
+        ++guard->generation;
+        cv.NotifyAll();
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    auto guard = mutex.Lock();
+    EXPECT_EQ(guard->woken, Waiters * Rounds);
+}
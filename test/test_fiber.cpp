@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/fiber.hpp>
+
+TEST(Fiber, RunsAndJoinsFromThread) {
+    vtils::FiberScheduler scheduler(2);
+    std::atomic<int> value = 0;
+
+    vtils::Fiber fiber(scheduler, [&] {
+        EXPECT_NE(vtils::Fiber::GetCurrent(), nullptr);
+        value = 42;
+    });
+    fiber.Join();
+
+    EXPECT_TRUE(fiber.IsDone());
+    EXPECT_EQ(value, 42);
+    EXPECT_EQ(vtils::Fiber::GetCurrent(), nullptr);
+}
+
+TEST(Fiber, DestructorJoins) {
+    vtils::FiberScheduler scheduler(2);
+    std::atomic<bool> done = false;
+
+    {
+        vtils::Fiber fiber(scheduler, [&] {
+            for (int i = 0; i < 100; ++i) {
+                vtils::Fiber::Yield();
+            }
+            done = true;
+        });
+    }
+
+    EXPECT_TRUE(done);
+}
+
+TEST(Fiber, JoinFromAnotherFiber) {
+    vtils::FiberScheduler scheduler(2);
+
+    for (int round = 0; round < 200; ++round) {
+        std::atomic<int> order = 0;
+        int child_seen = -1, parent_seen = -1;
+
+        vtils::Fiber parent(scheduler, [&] {
+            // The child is destroyed as soon as the join returns, which
+            // must not race with the worker finishing it.
+            auto child = std::make_unique<vtils::Fiber>(scheduler, [&] {
+                if (round % 2 == 0) {
+                    vtils::Fiber::Yield();
+                }
+                child_seen = order++;
+            });
+
+            child->Join();
+            EXPECT_TRUE(child->IsDone());
+            child.reset();
+            parent_seen = order++;
+        });
+        parent.Join();
+
+        ASSERT_EQ(child_seen, 0);
+        ASSERT_EQ(parent_seen, 1);
+    }
+}
+
+TEST(Fiber, ParkAndUnpark) {
+    vtils::FiberScheduler scheduler(2);
+    std::atomic<bool> ready = false;
+    std::atomic<bool> woken = false;
+
+    vtils::Fiber sleeper(scheduler, [&] {
+        ready = true;
+        while (!woken) {
+            vtils::Fiber::Park();
+        }
+    });
+
+    while (!ready) {
+        std::this_thread::yield();
+    }
+    woken = true;
+    sleeper.Unpark();
+    sleeper.Join();
+
+    // A notification before parking makes the next park return right away.
+    vtils::Fiber early(scheduler, [] {
+        vtils::Fiber::GetCurrent()->Unpark();
+        vtils::Fiber::Park();
+    });
+    early.Join();
+}
+
+TEST(Fiber, ManyFibersOnFewThreads) {
+    constexpr std::size_t FiberCount = 500;
+    constexpr int Yields = 20;
+
+    vtils::FiberScheduler scheduler(4, 64 * 1024);
+    EXPECT_EQ(scheduler.GetThreadCount(), 4u);
+
+    // Spawn more fibers than fit into one region of stacks, twice, so that
+    // stacks are reused as well.
+    for (int round = 0; round < 2; ++round) {
+        std::atomic<std::size_t> counter = 0;
+        std::vector<std::unique_ptr<vtils::Fiber>> fibers;
+        for (std::size_t i = 0; i < FiberCount; ++i) {
+            fibers.push_back(std::make_unique<vtils::Fiber>(scheduler, [&counter] {
+                // Touch a good part of the stack.
+                volatile char buffer[16 * 1024];
+                buffer[0] = 1;
+                buffer[sizeof(buffer) - 1] = buffer[0];
+
+                for (int j = 0; j < Yields; ++j) {
+                    counter.fetch_add(1, std::memory_order_relaxed);
+                    vtils::Fiber::Yield();
+                }
+            }));
+        }
+
+        for (auto &fiber : fibers) {
+            fiber->Join();
+        }
+        EXPECT_EQ(counter.load(), FiberCount * Yields);
+    }
+}
+
+TEST(FiberStackPool, ReusesStacks) {
+    vtils::FiberStackPool pool(10'000);
+    EXPECT_EQ(pool.GetStackSize() % 4096, 0u);
+    EXPECT_GE(pool.GetStackSize(), 10'000u);
+
+    void *a = pool.Allocate();
+    void *b = pool.Allocate();
+    EXPECT_NE(a, b);
+
+    pool.Free(b);
+    EXPECT_EQ(pool.Allocate(), b);
+
+    pool.Free(a);
+    pool.Free(b);
+}
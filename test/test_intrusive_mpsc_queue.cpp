@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/intrusive_mpsc_queue.hpp>
+
+namespace {
+
+    struct Node {
+        vtils::MpscHook hook;
+        std::size_t producer = 0;
+        std::size_t sequence = 0;
+        std::atomic<int> pops = 0;
+    };
+
+    using Queue = vtils::IntrusiveMpscQueue<Node, &Node::hook>;
+
+    // Lets every producer push its own nodes, while the calling thread
+    // consumes through `pop` until all of them have come out.
+    template <class Pop>
+    void RunProducers(Queue &queue, std::vector<std::vector<Node>> &nodes, Pop pop) {
+        std::size_t total = 0;
+        for (const auto &list : nodes) {
+            total += list.size();
+        }
+
+        std::atomic<bool> go = false;
+        std::vector<std::thread> producers;
+        for (auto &list : nodes) {
+            producers.emplace_back([&] {
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                for (auto &node : list) {
+                    queue.Push(node);
+                }
+            });
+        }
+
+        go = true;
+        for (std::size_t seen = 0; seen < total;) {
+            seen += pop();
+        }
+
+        for (auto &producer : producers) {
+            producer.join();
+        }
+    }
+
+    std::vector<std::vector<Node>> MakeNodes(std::size_t producers, std::size_t count) {
+        std::vector<std::vector<Node>> nodes(producers);
+        for (std::size_t p = 0; p < producers; ++p) {
+            nodes[p] = std::vector<Node>(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                nodes[p][i].producer = p;
+                nodes[p][i].sequence = i;
+            }
+        }
+        return nodes;
+    }
+
+}
+
+TEST(IntrusiveMpscQueue, EmptyQueue) {
+    Queue queue;
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_EQ(queue.TryPop(), nullptr);
+    EXPECT_EQ(queue.DrainAll([](Node &) { FAIL(); }), 0u);
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(IntrusiveMpscQueue, FifoOrder) {
+    Queue queue;
+    std::vector<Node> nodes(8);
+
+    for (auto &node : nodes) {
+        queue.Push(node);
+    }
+    EXPECT_FALSE(queue.IsEmpty());
+
+    // The last element can only be handed out once the stub is pushed
+    // behind it, which must work repeatedly.
+    for (auto &node : nodes) {
+        EXPECT_EQ(queue.TryPop(), &node);
+    }
+    EXPECT_EQ(queue.TryPop(), nullptr);
+    EXPECT_TRUE(queue.IsEmpty());
+
+    queue.Push(nodes[0]);
+    EXPECT_EQ(queue.TryPop(), &nodes[0]);
+    queue.Push(nodes[1]);
+    queue.Push(nodes[0]);
+    EXPECT_EQ(queue.TryPop(), &nodes[1]);
+    EXPECT_EQ(queue.TryPop(), &nodes[0]);
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(IntrusiveMpscQueue, HooksInsidePolymorphicTypes) {
+    // Neither standard-layout nor with the hooks at the start, and linked
+    // into two queues at once.
+    struct Base {
+        virtual ~Base() = default;
+        int value = 0;
+    };
+    struct Item : Base {
+        vtils::MpscHook first;
+        double weight = 0.0;
+        vtils::MpscHook second;
+    };
+
+    vtils::IntrusiveMpscQueue<Item, &Item::first> first;
+    vtils::IntrusiveMpscQueue<Item, &Item::second> second;
+    std::vector<Item> items(4);
+
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        first.Push(items[i]);
+        second.Push(items[items.size() - 1 - i]);
+    }
+
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        EXPECT_EQ(first.TryPop(), &items[i]);
+        EXPECT_EQ(second.TryPop(), &items[items.size() - 1 - i]);
+    }
+}
+
+TEST(IntrusiveMpscQueue, DrainAll) {
+    Queue queue;
+    std::vector<Node> nodes(16);
+
+    for (std::size_t i = 0; i < 4; ++i) {
+        queue.Push(nodes[i]);
+    }
+    // Leave the stub in the middle of the chain before draining.
+    EXPECT_EQ(queue.TryPop(), &nodes[0]);
+    for (std::size_t i = 4; i < nodes.size(); ++i) {
+        queue.Push(nodes[i]);
+    }
+
+    std::vector<Node *> drained;
+    EXPECT_EQ(queue.DrainAll([&](Node &node) { drained.push_back(&node); }), nodes.size() - 1);
+    ASSERT_EQ(drained.size(), nodes.size() - 1);
+    for (std::size_t i = 1; i < nodes.size(); ++i) {
+        EXPECT_EQ(drained[i - 1], &nodes[i]);
+    }
+    EXPECT_TRUE(queue.IsEmpty());
+
+    // The queue keeps working after a drain, with either way of popping.
+    queue.Push(nodes[3]);
+    queue.Push(nodes[5]);
+    EXPECT_EQ(queue.TryPop(), &nodes[3]);
+    EXPECT_EQ(queue.DrainAll([&](Node &node) { EXPECT_EQ(&node, &nodes[5]); }), 1u);
+    EXPECT_EQ(queue.TryPop(), nullptr);
+}
+
+TEST(IntrusiveMpscQueue, RepushFromDrainAll) {
+    Queue queue;
+    std::vector<Node> nodes(4);
+    for (auto &node : nodes) {
+        queue.Push(node);
+    }
+
+    // Nodes pushed from the callback are left for the next call, even the
+    // one which is being delivered right now.
+    std::size_t calls = 0;
+    auto repush = [&](Node &node) {
+        ++calls;
+        queue.Push(node);
+    };
+    EXPECT_EQ(queue.DrainAll(repush), nodes.size());
+    EXPECT_EQ(calls, nodes.size());
+    EXPECT_EQ(queue.DrainAll(repush), nodes.size());
+    EXPECT_EQ(calls, 2 * nodes.size());
+
+    std::vector<Node *> drained;
+    EXPECT_EQ(queue.DrainAll([&](Node &node) { drained.push_back(&node); }), nodes.size());
+    ASSERT_EQ(drained.size(), nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        EXPECT_EQ(drained[i], &nodes[i]);
+    }
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(IntrusiveMpscQueue, ConcurrentTryPop) {
+    constexpr std::size_t Producers = 4;
+    constexpr std::size_t Count = 20000;
+
+    Queue queue;
+    auto nodes = MakeNodes(Producers, Count);
+    std::vector<std::size_t> next(Producers, 0);
+
+    // The consumer polls while producers are still linking their pushes,
+    // so `TryPop` regularly sees a push which was exchanged into the head
+    // but not linked yet, and must report it as not ready instead of
+    // losing it or the ones behind it.
+    RunProducers(queue, nodes, [&]() -> std::size_t {
+        Node *node = queue.TryPop();
+        if (node == nullptr) {
+            return 0;
+        }
+
+        EXPECT_EQ(node->pops.fetch_add(1), 0);
+        EXPECT_EQ(node->sequence, next[node->producer]++);
+        return 1;
+    });
+
+    EXPECT_EQ(queue.TryPop(), nullptr);
+    EXPECT_TRUE(queue.IsEmpty());
+    for (std::size_t p = 0; p < Producers; ++p) {
+        EXPECT_EQ(next[p], Count);
+    }
+}
+
+TEST(IntrusiveMpscQueue, ConcurrentDrainAll) {
+    constexpr std::size_t Producers = 4;
+    constexpr std::size_t Count = 20000;
+
+    Queue queue;
+    auto nodes = MakeNodes(Producers, Count);
+    std::vector<std::size_t> next(Producers, 0);
+
+    // Alternate between both ways of consuming to mix the stub handling.
+    bool drain = false;
+    RunProducers(queue, nodes, [&]() -> std::size_t {
+        auto check = [&](Node &node) {
+            EXPECT_EQ(node.pops.fetch_add(1), 0);
+            EXPECT_EQ(node.sequence, next[node.producer]++);
+        };
+
+        drain = !drain;
+        if (drain) {
+            return queue.DrainAll(check);
+        }
+
+        Node *node = queue.TryPop();
+        if (node == nullptr) {
+            return 0;
+        }
+        check(*node);
+        return 1;
+    });
+
+    EXPECT_TRUE(queue.IsEmpty());
+    for (std::size_t p = 0; p < Producers; ++p) {
+        EXPECT_EQ(next[p], Count);
+    }
+}
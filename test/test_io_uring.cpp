@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vtils/os/io_uring.hpp>
+
+#include "coroutine_helpers.hpp"
+
+namespace {
+
+    // Sets up a ring, or skips the test when the kernel does not allow it.
+    std::optional<vtils::IoUring> MakeRing(unsigned entries) {
+        try {
+            return std::optional<vtils::IoUring>(std::in_place, entries);
+        } catch (const std::system_error &e) {
+            if (e.code().value() == ENOSYS || e.code().value() == EPERM) {
+                return std::nullopt;
+            }
+            throw;
+        }
+    }
+
+    // A temporary file which is removed again afterwards.
+    class TempFile {
+    private:
+        std::string m_path;
+        int m_fd;
+
+    public:
+        TempFile() : m_path(::testing::TempDir() + "vtils_io_uring_XXXXXX") {
+            m_fd = mkstemp(m_path.data());
+        }
+
+        ~TempFile() {
+            close(m_fd);
+            unlink(m_path.c_str());
+        }
+
+        int GetFd() const { return m_fd; }
+        const std::string &GetPath() const { return m_path; }
+    };
+
+    std::span<const std::byte> AsBytes(const std::string &s) {
+        return std::as_bytes(std::span(s));
+    }
+
+}
+
+#define V_MAKE_RING(name, entries)                          \
+    auto name##_storage = MakeRing(entries);                \
+    if (!name##_storage.has_value()) {                      \
+        GTEST_SKIP() << "io_uring is not available here";   \
+    }                                                       \
+    vtils::IoUring &name = *name##_storage
+
+TEST(IoUring, WriteThenRead) {
+    V_MAKE_RING(ring, 8);
+    TempFile file;
+    ASSERT_GE(file.GetFd(), 0);
+
+    const std::string text = "hello from io_uring";
+    std::array<std::byte, 64> buffer{};
+    std::vector<std::int32_t> results;
+
+    [](vtils::IoUring &ring, int fd, const std::string &text, std::span<std::byte> buffer, std::vector<std::int32_t> &results) -> Detached {
+        results.push_back(co_await ring.Write(fd, AsBytes(text), 0));
+        results.push_back(co_await ring.Fsync(fd, true));
+        results.push_back(co_await ring.Read(fd, buffer, 6));
+    }(ring, file.GetFd(), text, buffer, results);
+
+    EXPECT_EQ(ring.GetInFlightCount(), 1u);
+    while (ring.GetInFlightCount() != 0) {
+        ring.Wait();
+    }
+
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0], static_cast<std::int32_t>(text.size()));
+    EXPECT_EQ(results[1], 0);
+    EXPECT_EQ(results[2], static_cast<std::int32_t>(text.size() - 6));
+    EXPECT_EQ(std::memcmp(buffer.data(), text.data() + 6, text.size() - 6), 0);
+}
+
+TEST(IoUring, ErrorsAreNegatedErrno) {
+    V_MAKE_RING(ring, 4);
+
+    std::array<std::byte, 16> buffer;
+    std::int32_t result = 0;
+    [](vtils::IoUring &ring, std::span<std::byte> buffer, std::int32_t &result) -> Detached {
+        result = co_await ring.Read(-1, buffer, 0);
+    }(ring, buffer, result);
+
+    ring.Wait();
+    EXPECT_EQ(result, -EBADF);
+}
+
+TEST(IoUring, OpenAt) {
+    V_MAKE_RING(ring, 4);
+    TempFile file;
+
+    std::int32_t fd = -1;
+    [](vtils::IoUring &ring, const char *path, std::int32_t &fd) -> Detached {
+        fd = co_await ring.OpenAt(AT_FDCWD, path, O_RDONLY);
+    }(ring, file.GetPath().c_str(), fd);
+
+    ring.Wait();
+    ASSERT_GE(fd, 0);
+    close(fd);
+}
+
+TEST(IoUring, BacklogBeyondRingSize) {
+    // Far more operations than submission entries, which have to wait
+    // for room and must still all complete with the right data.
+    V_MAKE_RING(ring, 4);
+    TempFile file;
+
+    constexpr std::size_t Count = 64;
+    std::string data(Count, '\0');
+    for (std::size_t i = 0; i < Count; ++i) {
+        data[i] = static_cast<char>('A' + i % 26);
+    }
+    ASSERT_EQ(pwrite(file.GetFd(), data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+
+    std::array<std::byte, Count> out{};
+    std::size_t done = 0;
+    for (std::size_t i = 0; i < Count; ++i) {
+        [](vtils::IoUring &ring, int fd, std::byte *dst, std::uint64_t offset, std::size_t &done) -> Detached {
+            EXPECT_EQ(co_await ring.Read(fd, std::span(dst, 1), offset), 1);
+            ++done;
+        }(ring, file.GetFd(), out.data() + i, i, done);
+    }
+    EXPECT_EQ(ring.GetInFlightCount(), Count);
+
+    while (ring.GetInFlightCount() != 0) {
+        ring.Wait(Count);
+    }
+
+    EXPECT_EQ(done, Count);
+    EXPECT_EQ(std::memcmp(out.data(), data.data(), Count), 0);
+}
+
+TEST(IoUring, PollAloneMakesProgress) {
+    // An event loop which never blocks on the ring must still get its
+    // operations submitted, including those queued by resumed coroutines.
+    V_MAKE_RING(ring, 4);
+    TempFile file;
+
+    const std::string text = "polled";
+    std::array<std::byte, 16> buffer{};
+    std::vector<std::int32_t> results;
+
+    [](vtils::IoUring &ring, int fd, const std::string &text, std::span<std::byte> buffer, std::vector<std::int32_t> &results) -> Detached {
+        results.push_back(co_await ring.Write(fd, AsBytes(text), 0));
+        results.push_back(co_await ring.Read(fd, buffer, 0));
+    }(ring, file.GetFd(), text, buffer, results);
+
+    while (ring.GetInFlightCount() != 0) {
+        ring.Poll();
+    }
+
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0], static_cast<std::int32_t>(text.size()));
+    EXPECT_EQ(results[1], static_cast<std::int32_t>(text.size()));
+    EXPECT_EQ(std::memcmp(buffer.data(), text.data(), text.size()), 0);
+}
+
+TEST(IoUring, RegisteredFilesAndBuffers) {
+    V_MAKE_RING(ring, 4);
+    TempFile file;
+
+    alignas(4096) static std::array<std::byte, 4096> buffer;
+    const std::string text = "fixed";
+    std::memcpy(buffer.data(), text.data(), text.size());
+
+    const iovec iov{ buffer.data(), buffer.size() };
+    const int fd = file.GetFd();
+    ring.RegisterBuffers(std::span(&iov, 1));
+    ring.RegisterFiles(std::span(&fd, 1));
+
+    std::int32_t written = 0, read = 0;
+    [](vtils::IoUring &ring, std::span<std::byte> buffer, std::size_t size, std::int32_t &written, std::int32_t &read) -> Detached {
+        written = co_await ring.WriteFixed(vtils::IoFile::Registered(0), buffer.first(size), 0, 0);
+        read    = co_await ring.ReadFixed(vtils::IoFile::Registered(0), buffer.subspan(size, size), 0, 0);
+    }(ring, buffer, text.size(), written, read);
+
+    while (ring.GetInFlightCount() != 0) {
+        ring.Wait();
+    }
+    ring.UnregisterFiles();
+    ring.UnregisterBuffers();
+
+    EXPECT_EQ(written, static_cast<std::int32_t>(text.size()));
+    EXPECT_EQ(read, static_cast<std::int32_t>(text.size()));
+    EXPECT_EQ(std::memcmp(buffer.data() + text.size(), text.data(), text.size()), 0);
+}
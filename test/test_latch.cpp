@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/latch.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(Latch, OpensAtZero) {
+    vtils::Latch latch(3);
+
+    EXPECT_FALSE(latch.TryWait());
+    latch.CountDown();
+    EXPECT_FALSE(latch.TryWait());
+    latch.CountDown(2);
+    EXPECT_TRUE(latch.TryWait());
+
+    // An open latch stays open.
+    latch.Wait();
+    EXPECT_TRUE(latch.WaitFor(0ms));
+}
+
+TEST(Latch, WaitForTimesOut) {
+    vtils::Latch latch(1);
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(latch.WaitFor(20ms));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+
+    latch.CountDown();
+    EXPECT_TRUE(latch.WaitFor(20ms));
+}
+
+TEST(Latch, ReleasesAllWaiters) {
+    constexpr std::size_t Workers = 4;
+    constexpr std::size_t Waiters = 4;
+
+    vtils::Latch latch(Workers);
+    std::atomic<std::size_t> done    = 0;
+    std::atomic<std::size_t> checked = 0;
+
+    std::vector<std::thread> waiters;
+    for (std::size_t i = 0; i < Waiters; ++i) {
+        waiters.emplace_back([&] {
+            latch.Wait();
+            // Every count down happened before the latch opened.
+            EXPECT_EQ(done.load(), Workers);
+            checked.fetch_add(1);
+        });
+    }
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < Workers; ++i) {
+        workers.emplace_back([&] {
+            std::this_thread::sleep_for(5ms);
+            done.fetch_add(1);
+            latch.CountDown();
+        });
+    }
+
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    for (auto &thread : waiters) {
+        thread.join();
+    }
+    EXPECT_EQ(checked.load(), Waiters);
+}
+
+TEST(Latch, ArriveAndWait) {
+    constexpr std::size_t Threads = 4;
+
+    vtils::Latch latch(Threads);
+    std::atomic<std::size_t> arrived = 0;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            arrived.fetch_add(1);
+            latch.ArriveAndWait();
+            EXPECT_EQ(arrived.load(), Threads);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
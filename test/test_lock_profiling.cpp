@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/lock_profiling.hpp>
+#include <vtils/os/mutex.hpp>
+#include <vtils/os/read_write_lock.hpp>
+
+using namespace std::chrono_literals;
+
+#if defined(V_ENABLE_LOCK_PROFILING)
+
+namespace {
+
+    const vtils::LockSiteProfile *FindSite(const std::vector<vtils::LockSiteProfile> &profiles, std::uint32_t line) {
+        for (const auto &profile : profiles) {
+            if (profile.line == line && profile.file.ends_with("test_lock_profiling.cpp")) {
+                return &profile;
+            }
+        }
+        return nullptr;
+    }
+
+}
+
+TEST(LockProfiling, CountsUncontendedAcquisitions) {
+    vtils::ResetLockProfile();
+
+    vtils::Mutex<int> mutex;
+    std::uint32_t line = 0;
+    for (int i = 0; i < 10; ++i) {
+        // The site is the line of the `Lock()` call.
+        auto guard = mutex.Lock(); line = __LINE__;
+        ++*guard;
+    }
+
+    const auto profiles = vtils::CollectLockProfile();
+    const auto *site = FindSite(profiles, line);
+    ASSERT_NE(site, nullptr);
+
+    EXPECT_EQ(site->acquisitions, 10u);
+    EXPECT_EQ(site->contended, 0u);
+    EXPECT_TRUE(site->top_contenders.empty());
+
+    std::uint64_t waits = 0;
+    std::uint64_t holds = 0;
+    for (std::size_t i = 0; i < vtils::LockHistogramBuckets; ++i) {
+        waits += site->wait_histogram[i];
+        holds += site->hold_histogram[i];
+    }
+    EXPECT_EQ(waits, 10u);
+    EXPECT_EQ(holds, 10u);
+}
+
+TEST(LockProfiling, AttributesContentionToTheHolder) {
+    vtils::ResetLockProfile();
+
+    vtils::Mutex<int> mutex;
+    std::atomic<bool> locked = false;
+    std::uint32_t holder_line = 0;
+
+    std::thread holder([&] {
+        auto guard = mutex.Lock(); holder_line = __LINE__;
+        locked = true;
+        std::this_thread::sleep_for(20ms);
+    });
+    while (!locked.load()) {
+        std::this_thread::yield();
+    }
+
+    std::uint32_t waiter_line = 0;
+    {
+        auto guard = mutex.Lock(); waiter_line = __LINE__;
+    }
+    holder.join();
+
+    const auto profiles = vtils::CollectLockProfile();
+    const auto *waiter = FindSite(profiles, waiter_line);
+    const auto *held   = FindSite(profiles, holder_line);
+    ASSERT_NE(waiter, nullptr);
+    ASSERT_NE(held, nullptr);
+
+    EXPECT_EQ(waiter->acquisitions, 1u);
+    EXPECT_EQ(waiter->contended, 1u);
+    EXPECT_GE(waiter->max_wait_ns, std::chrono::nanoseconds(10ms).count());
+    EXPECT_GE(held->total_hold_ns, std::chrono::nanoseconds(10ms).count());
+
+    ASSERT_EQ(waiter->top_contenders.size(), 1u);
+    EXPECT_EQ(waiter->top_contenders[0].line, holder_line);
+    EXPECT_EQ(waiter->top_contenders[0].count, 1u);
+
+    // Sites are reported by total wait time in descending order.
+    EXPECT_EQ(&profiles.front(), waiter);
+}
+
+TEST(LockProfiling, ProfilesReadWriteLocks) {
+    vtils::ResetLockProfile();
+
+    vtils::ReadWriteLock<int> lock;
+    std::uint32_t read_line  = 0;
+    std::uint32_t write_line = 0;
+    {
+        auto guard = lock.Read(); read_line = __LINE__;
+    }
+    {
+        auto guard = lock.Write(); write_line = __LINE__;
+    }
+
+    const auto profiles = vtils::CollectLockProfile();
+    ASSERT_NE(FindSite(profiles, read_line), nullptr);
+    ASSERT_NE(FindSite(profiles, write_line), nullptr);
+    EXPECT_EQ(FindSite(profiles, read_line)->acquisitions, 1u);
+    EXPECT_EQ(FindSite(profiles, write_line)->acquisitions, 1u);
+}
+
+TEST(LockProfiling, DumpReportsSites) {
+    vtils::ResetLockProfile();
+
+    vtils::Mutex<int> mutex;
+    std::uint32_t line = 0;
+    {
+        auto guard = mutex.Lock(); line = __LINE__;
+    }
+
+    std::FILE *file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    vtils::DumpLockProfile(file);
+
+    std::string report(4096, '\0');
+    std::rewind(file);
+    report.resize(std::fread(report.data(), 1, report.size(), file));
+    std::fclose(file);
+
+    EXPECT_NE(report.find("Lock contention profile"), std::string::npos);
+    EXPECT_NE(report.find("test_lock_profiling.cpp:" + std::to_string(line)), std::string::npos);
+}
+
+#else
+
+TEST(LockProfiling, DisabledReportsNothing) {
+    vtils::Mutex<int> mutex;
+    {
+        auto guard = mutex.Lock();
+    }
+
+    EXPECT_TRUE(vtils::CollectLockProfile().empty());
+}
+
+#endif
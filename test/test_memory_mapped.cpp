@@ -0,0 +1,311 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vtils/macros/platform.hpp>
+#include <vtils/os/memory_mapped.hpp>
+
+#if defined(V_PLATFORM_LINUX)
+    #include <linux/magic.h>
+    #include <sys/mman.h>
+    #include <sys/vfs.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr vtils::Access AllAccess[] = {
+        vtils::Access::Normal,
+        vtils::Access::Sequential,
+        vtils::Access::Random,
+        vtils::Access::WillNeed,
+        vtils::Access::DontNeed,
+        vtils::Access::Free,
+    };
+
+    // A temporary file which spans multiple pages of distinct content.
+    class TempFile {
+    private:
+        std::FILE *m_file;
+        std::vector<std::uint8_t> m_contents;
+
+    public:
+        explicit TempFile(std::size_t size) : m_file(std::tmpfile()), m_contents(size) {
+            for (std::size_t i = 0; i < size; ++i) {
+                m_contents[i] = static_cast<std::uint8_t>(i * 31 + i / 4096);
+            }
+
+            if (m_file != nullptr) {
+                std::fwrite(m_contents.data(), 1, m_contents.size(), m_file);
+                std::fflush(m_file);
+            }
+        }
+
+        ~TempFile() {
+            if (m_file != nullptr) {
+                std::fclose(m_file);
+            }
+        }
+
+        std::FILE *Get() const { return m_file; }
+
+        const std::vector<std::uint8_t> &GetContents() const { return m_contents; }
+    };
+
+    constexpr std::size_t FileSize = 16 * 4096 + 123;
+
+    bool Matches(const void *ptr, const std::uint8_t *expected, std::size_t len) {
+        return std::memcmp(ptr, expected, len) == 0;
+    }
+
+}
+
+TEST(MemoryMapped, MapWithEveryAccess) {
+    TempFile file(FileSize);
+    ASSERT_NE(file.Get(), nullptr);
+
+    for (const auto access : AllAccess) {
+        SCOPED_TRACE(static_cast<int>(access));
+
+        const auto mapped = vtils::ReadOnlyMapped::Map(file.Get(), access);
+        ASSERT_EQ(mapped.GetLength(), FileSize);
+        EXPECT_GT(mapped.GetPageSize(), 0u);
+        EXPECT_TRUE(Matches(mapped.GetPtr(), file.GetContents().data(), FileSize));
+    }
+}
+
+TEST(MemoryMapped, MapWithOffsetAndAccess) {
+    TempFile file(FileSize);
+    ASSERT_NE(file.Get(), nullptr);
+
+    // Offsets need not be page aligned, so the hint covers partial pages.
+    constexpr std::size_t Offset = 4096 + 17;
+    constexpr std::size_t Length = 5 * 4096;
+    for (const auto access : AllAccess) {
+        SCOPED_TRACE(static_cast<int>(access));
+
+        const auto tail = vtils::ReadOnlyMapped::MapWithOffset(file.Get(), Offset, access);
+        ASSERT_EQ(tail.GetLength(), FileSize - Offset);
+        EXPECT_TRUE(Matches(tail.GetPtr(), file.GetContents().data() + Offset, FileSize - Offset));
+
+        const auto part = vtils::ReadOnlyMapped::MapWithOffsetAndLength(file.Get(), Offset, Length, access);
+        ASSERT_EQ(part.GetLength(), Length);
+        EXPECT_TRUE(Matches(part.GetPtr(), file.GetContents().data() + Offset, Length));
+    }
+}
+
+TEST(MemoryMapped, AdviseSubranges) {
+    TempFile file(FileSize);
+    ASSERT_NE(file.Get(), nullptr);
+
+    auto mapped = vtils::ReadOnlyMapped::Map(file.Get());
+    const auto *expected = file.GetContents().data();
+
+    struct Range {
+        std::size_t offset;
+        std::size_t len;
+    };
+    const Range ranges[] = {
+        { 0, FileSize },
+        { 0, 1 },
+        { 4096, 4096 },
+        { 100, 3 * 4096 },
+        { FileSize - 10, 10 },
+        { 7 * 4096 + 1, 0 },
+    };
+
+    for (const auto access : AllAccess) {
+        for (const auto &range : ranges) {
+            SCOPED_TRACE(testing::Message() << static_cast<int>(access) << " @ " << range.offset << "+" << range.len);
+
+            EXPECT_NO_THROW(mapped.Advise(range.offset, range.len, access));
+            EXPECT_TRUE(Matches(std::as_const(mapped).GetPtr(), expected, FileSize));
+        }
+    }
+}
+
+TEST(MemoryMapped, DroppedPagesKeepWrites) {
+    TempFile file(FileSize);
+    ASSERT_NE(file.Get(), nullptr);
+
+    auto mapped = vtils::ReadWriteMapped::Map(file.Get(), vtils::Access::Sequential);
+    auto *ptr = static_cast<std::uint8_t *>(mapped.GetPtr());
+    std::vector<std::uint8_t> expected = file.GetContents();
+
+    // The mapping is shared with the file, so dropping or reclaiming pages
+    // must not lose modifications to them. `Access::Free` may fall back to
+    // merely dropping the pages on kernels which cannot reclaim them.
+    for (const auto access : { vtils::Access::DontNeed, vtils::Access::Free }) {
+        SCOPED_TRACE(static_cast<int>(access));
+
+        for (std::size_t i = 2 * 4096; i < 6 * 4096; i += 512) {
+            ptr[i] = static_cast<std::uint8_t>(ptr[i] ^ 0xFF);
+            expected[i] = ptr[i];
+        }
+
+        EXPECT_NO_THROW(mapped.Advise(2 * 4096 + 5, 4 * 4096, access));
+        EXPECT_TRUE(Matches(ptr, expected.data(), FileSize));
+    }
+
+    EXPECT_NO_THROW(mapped.Advise(0, FileSize, vtils::Access::WillNeed));
+    EXPECT_NO_THROW(mapped.Flush());
+    EXPECT_TRUE(Matches(ptr, expected.data(), FileSize));
+}
+
+#if defined(V_PLATFORM_LINUX)
+
+namespace {
+
+    // Large enough to be mapped with transparent huge pages, if allowed.
+    constexpr std::size_t HugeFileSize = 4 << 20;
+
+    const std::size_t BasePageSize = static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE));
+
+    std::string ReadSetting(const char *path) {
+        std::ifstream file(path);
+        std::string setting;
+        std::getline(file, setting);
+        return setting;
+    }
+
+    std::string ReadShmemEnabled() {
+        return ReadSetting("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+    }
+
+    // Gets the size of transparent huge pages if they are enabled for
+    // regions advised with `MADV_HUGEPAGE`, or zero otherwise.
+    std::size_t GetEnabledHugePageSize() {
+        if (ReadSetting("/sys/kernel/mm/transparent_hugepage/enabled").find("[never]") != std::string::npos) {
+            return 0;
+        }
+
+        const std::string size = ReadSetting("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+        return size.empty() ? 0 : std::stoull(size);
+    }
+
+    bool IsOnTmpfs(std::FILE *file) {
+        struct statfs sfs;
+        return fstatfs(fileno(file), &sfs) == 0 && sfs.f_type == TMPFS_MAGIC;
+    }
+
+    // Gets the mount options of the file system mounted at `path`, or an
+    // empty string when there is no such mount.
+    std::string GetMountOptions(const std::string &path) {
+        std::ifstream mounts("/proc/self/mountinfo");
+        std::string options;
+        for (std::string line; std::getline(mounts, line);) {
+            std::istringstream fields(line);
+            std::string id, parent, device, root, mount_point;
+            fields >> id >> parent >> device >> root >> mount_point;
+
+            // Later mounts hide earlier ones at the same place.
+            if (mount_point == path) {
+                options = line.substr(line.find(" - "));
+            }
+        }
+        return options;
+    }
+
+}
+
+TEST(MemoryMapped, MemfdUnderNeverUsesBasePages) {
+    if (ReadShmemEnabled().find("[never]") == std::string::npos) {
+        GTEST_SKIP() << "shmem huge pages are not disabled";
+    }
+
+    const int fd = memfd_create("vtils-test", MFD_CLOEXEC);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, HugeFileSize), 0);
+    std::FILE *file = fdopen(fd, "r+");
+    ASSERT_NE(file, nullptr);
+
+    // The other settings are listed next to the selected one, and must not
+    // be mistaken for it.
+    {
+        const auto mapped = vtils::ReadWriteMapped::Map(file, vtils::Access::Normal, vtils::PageSize::Huge);
+        EXPECT_EQ(mapped.GetLength(), HugeFileSize);
+        EXPECT_EQ(mapped.GetPageSize(), BasePageSize);
+    }
+
+    std::fclose(file);
+}
+
+TEST(MemoryMapped, NonHugeTmpfsUsesBasePages) {
+    struct statfs sfs;
+    if (statfs("/dev/shm", &sfs) != 0 || sfs.f_type != TMPFS_MAGIC) {
+        GTEST_SKIP() << "/dev/shm is not a tmpfs mount";
+    }
+
+    const std::string options = GetMountOptions("/dev/shm");
+    const std::size_t huge = options.find("huge=");
+    if (ReadShmemEnabled().find("[force]") != std::string::npos
+        || (huge != std::string::npos && options.compare(huge, 10, "huge=never") != 0)) {
+        GTEST_SKIP() << "/dev/shm may use huge pages";
+    }
+
+    char path[] = "/dev/shm/vtils-test-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+    ASSERT_EQ(ftruncate(fd, HugeFileSize), 0);
+    std::FILE *file = fdopen(fd, "r+");
+    ASSERT_NE(file, nullptr);
+
+    {
+        const auto mapped = vtils::ReadWriteMapped::Map(file, vtils::Access::Normal, vtils::PageSize::Huge);
+        EXPECT_EQ(mapped.GetLength(), HugeFileSize);
+        EXPECT_EQ(mapped.GetPageSize(), BasePageSize);
+    }
+
+    std::fclose(file);
+}
+
+TEST(MemoryMapped, ReadOnlyRegularFileUsesHugePages) {
+    const std::size_t huge_page_size = GetEnabledHugePageSize();
+    if (huge_page_size == 0) {
+        GTEST_SKIP() << "transparent huge pages are disabled";
+    }
+
+    TempFile file(2 * huge_page_size + 123);
+    ASSERT_NE(file.Get(), nullptr);
+    if (IsOnTmpfs(file.Get())) {
+        GTEST_SKIP() << "temporary files live on tmpfs";
+    }
+
+    const auto &expected = file.GetContents();
+    const auto mapped = vtils::ReadOnlyMapped::Map(file.Get(), vtils::Access::Normal, vtils::PageSize::Huge);
+    ASSERT_EQ(mapped.GetLength(), expected.size());
+    EXPECT_EQ(mapped.GetPageSize(), huge_page_size);
+
+    // The view must be aligned for the kernel to place huge pages in it.
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mapped.GetPtr()) % huge_page_size, 0u);
+    EXPECT_TRUE(Matches(mapped.GetPtr(), expected.data(), expected.size()));
+}
+
+TEST(MemoryMapped, WritableRegularFileUsesBasePages) {
+    const std::size_t huge_page_size = GetEnabledHugePageSize();
+    if (huge_page_size == 0) {
+        GTEST_SKIP() << "transparent huge pages are disabled";
+    }
+
+    TempFile file(2 * huge_page_size);
+    ASSERT_NE(file.Get(), nullptr);
+    if (IsOnTmpfs(file.Get())) {
+        GTEST_SKIP() << "temporary files live on tmpfs";
+    }
+
+    // The page cache cannot use huge pages for writable file mappings.
+    const auto mapped = vtils::ReadWriteMapped::Map(file.Get(), vtils::Access::Normal, vtils::PageSize::Huge);
+    EXPECT_EQ(mapped.GetLength(), file.GetContents().size());
+    EXPECT_EQ(mapped.GetPageSize(), BasePageSize);
+}
+
+#endif
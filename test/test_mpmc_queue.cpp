@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/mpmc_queue.hpp>
+
+TEST(MpmcQueue, CapacityIsRoundedUp) {
+    vtils::MpmcQueue<int> queue(5);
+
+    EXPECT_EQ(queue.GetCapacity(), 8u);
+    EXPECT_EQ(queue.GetSize(), 0u);
+}
+
+TEST(MpmcQueue, FifoOrder) {
+    vtils::MpmcQueue<int> queue(4);
+
+    for (int lap = 0; lap < 3; ++lap) {
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(queue.TryPush(lap * 4 + i));
+        }
+        EXPECT_FALSE(queue.TryPush(-1));
+        EXPECT_EQ(queue.GetSize(), 4u);
+
+        for (int i = 0; i < 4; ++i) {
+            int value = -1;
+            ASSERT_TRUE(queue.TryPop(value));
+            EXPECT_EQ(value, lap * 4 + i);
+        }
+
+        int value;
+        EXPECT_FALSE(queue.TryPop(value));
+    }
+}
+
+TEST(MpmcQueue, DestroysRemainingElements) {
+    auto counter = std::make_shared<int>(0);
+    {
+        vtils::MpmcQueue<std::shared_ptr<int>> queue(4);
+        queue.Push(counter);
+        queue.Push(counter);
+        EXPECT_EQ(counter.use_count(), 3);
+    }
+
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+namespace {
+
+    // Moves without throwing, but may throw when move-assigned.
+    struct ThrowingAssign {
+        int value;
+
+        explicit ThrowingAssign(int value) : value(value) {}
+        ThrowingAssign(ThrowingAssign &&) noexcept = default;
+        ThrowingAssign &operator=(ThrowingAssign &&rhs) {
+            value = rhs.value;
+            return *this;
+        }
+    };
+
+    template <typename Q, typename T>
+    concept CanTryPop = requires (Q &queue, T &out) { queue.TryPop(out); };
+
+}
+
+TEST(MpmcQueue, TryPopRequiresNothrowAssignment) {
+    // An element would be lost if assigning it to the output threw.
+    static_assert(!CanTryPop<vtils::MpmcQueue<ThrowingAssign>, ThrowingAssign>);
+    static_assert(CanTryPop<vtils::MpmcQueue<int>, int>);
+
+    vtils::MpmcQueue<ThrowingAssign> queue(2);
+    queue.Push(ThrowingAssign(7));
+    EXPECT_EQ(queue.Pop().value, 7);
+}
+
+TEST(MpmcQueue, BlockingPopWaitsForPush) {
+    vtils::MpmcQueue<int> queue(2);
+
+    std::thread consumer([&] { EXPECT_EQ(queue.Pop(), 42); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.Push(42);
+    consumer.join();
+}
+
+TEST(MpmcQueue, NoLossOrDuplicationUnderContention) {
+    constexpr std::size_t Producers = 4;
+    constexpr std::size_t Consumers = 4;
+    constexpr std::uint32_t PerProducer = 50'000;
+
+    // A small capacity keeps both sides blocking on each other a lot.
+    vtils::MpmcQueue<std::uint32_t> queue(16);
+    std::vector<std::atomic<std::uint32_t>> seen(Producers * PerProducer);
+    std::vector<std::thread> threads;
+
+    for (std::size_t p = 0; p < Producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (std::uint32_t i = 0; i < PerProducer; ++i) {
+                queue.Push(static_cast<std::uint32_t>(p * PerProducer + i));
+            }
+        });
+    }
+
+    for (std::size_t c = 0; c < Consumers; ++c) {
+        threads.emplace_back([&] {
+            // Values of every single producer must come out in order.
+            std::vector<std::int64_t> last(Producers, -1);
+            for (std::uint32_t i = 0; i < Producers * PerProducer / Consumers; ++i) {
+                const std::uint32_t value = queue.Pop();
+                const std::size_t producer = value / PerProducer;
+
+                EXPECT_LT(last[producer], static_cast<std::int64_t>(value));
+                last[producer] = value;
+                seen[value].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(queue.GetSize(), 0u);
+    for (std::size_t i = 0; i < seen.size(); ++i) {
+        ASSERT_EQ(seen[i].load(), 1u) << "value " << i;
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/mutex.hpp>
+
+namespace {
+
+    constexpr std::size_t Threads    = 4;
+    constexpr std::size_t Iterations = 20'000;
+
+    template <typename M>
+    void HammerCounter(M &mutex) {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < Threads; ++i) {
+            threads.emplace_back([&] {
+                for (std::size_t j = 0; j < Iterations; ++j) {
+                    auto guard = mutex.Lock();
+                    // A non-atomic read-modify-write loses updates unless
+                    // the lock provides mutual exclusion.
+                    const std::size_t value = *guard;
+                    *guard = value + 1;
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+}
+
+TEST(Mutex, TryLockFailsWhileHeld) {
+    vtils::impl::Mutex mutex;
+
+    mutex.Lock();
+    std::thread([&] { EXPECT_FALSE(mutex.TryLock()); }).join();
+    mutex.Unlock();
+
+    EXPECT_TRUE(mutex.TryLock());
+    mutex.Unlock();
+}
+
+TEST(Mutex, MutualExclusion) {
+    vtils::Mutex<std::size_t> mutex;
+    HammerCounter(mutex);
+
+    EXPECT_EQ(*mutex.Lock(), Threads * Iterations);
+}
+
+TEST(AdaptiveMutex, TryLockFailsWhileHeld) {
+    vtils::impl::AdaptiveMutex mutex;
+
+    mutex.Lock();
+    std::thread([&] { EXPECT_FALSE(mutex.TryLock()); }).join();
+    mutex.Unlock();
+
+    EXPECT_TRUE(mutex.TryLock());
+    mutex.Unlock();
+}
+
+TEST(AdaptiveMutex, MutualExclusion) {
+    vtils::AdaptiveMutex<std::size_t> mutex;
+    HammerCounter(mutex);
+
+    EXPECT_EQ(*mutex.Lock(), Threads * Iterations);
+}
+
+#if defined(V_PLATFORM_LINUX)
+// Other backends only report the lock state as a best-effort hint.
+TEST(Mutex, IsLockedTracksOwnership) {
+    vtils::impl::Mutex mutex;
+
+    EXPECT_FALSE(mutex.IsLocked());
+    mutex.Lock();
+    EXPECT_TRUE(mutex.IsLocked());
+    mutex.Unlock();
+    EXPECT_FALSE(mutex.IsLocked());
+}
+#endif
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/once_cell.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    std::atomic<int> g_lazy_inits = 0;
+
+    constinit vtils::Lazy<std::vector<int>, decltype([] {
+        ++g_lazy_inits;
+        return std::vector<int>{1, 2, 3};
+    })> g_lazy;
+
+}
+
+TEST(OnceCell, InitializesOnce) {
+    vtils::OnceCell<std::string> cell;
+    EXPECT_FALSE(cell.IsInitialized());
+    EXPECT_EQ(cell.TryGet(), nullptr);
+
+    EXPECT_EQ(cell.GetOrInit([] { return std::string("first"); }), "first");
+    EXPECT_TRUE(cell.IsInitialized());
+    ASSERT_NE(cell.TryGet(), nullptr);
+
+    EXPECT_EQ(cell.GetOrInit([]() -> std::string {
+        ADD_FAILURE() << "initializer ran twice";
+        return "second";
+    }), "first");
+
+    EXPECT_FALSE(cell.Set("third"));
+    EXPECT_EQ(*cell.TryGet(), "first");
+}
+
+TEST(OnceCell, SetInitializesEmptyCell) {
+    vtils::OnceCell<std::string> cell;
+
+    EXPECT_TRUE(cell.Set(3, 'x'));
+    EXPECT_EQ(*cell.TryGet(), "xxx");
+}
+
+TEST(OnceCell, RetriesAfterInitializerThrows) {
+    vtils::OnceCell<int> cell;
+
+    EXPECT_THROW(cell.GetOrInit([]() -> int { throw std::runtime_error("init failed"); }), std::runtime_error);
+    EXPECT_FALSE(cell.IsInitialized());
+
+    EXPECT_EQ(cell.GetOrInit([] { return 7; }), 7);
+    EXPECT_TRUE(cell.IsInitialized());
+}
+
+TEST(OnceCell, WaiterRetriesAfterInitializerThrows) {
+    vtils::OnceCell<int> cell;
+    std::atomic<bool> started = false;
+
+    std::thread failing([&] {
+        EXPECT_THROW(cell.GetOrInit([&]() -> int {
+            started = true;
+            std::this_thread::sleep_for(20ms);
+            throw std::runtime_error("init failed");
+        }), std::runtime_error);
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+
+    // We block behind the failing initializer and then get to run ours.
+    EXPECT_EQ(cell.GetOrInit([] { return 42; }), 42);
+    failing.join();
+
+    EXPECT_EQ(*cell.TryGet(), 42);
+}
+
+TEST(OnceCell, ConcurrentGetOrInitRunsInitializerOnce) {
+    constexpr std::size_t Threads = 8;
+
+    vtils::OnceCell<std::vector<int>> cell;
+    std::atomic<bool> go    = false;
+    std::atomic<int> inits  = 0;
+    std::vector<const std::vector<int> *> seen(Threads);
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&, i] {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+
+            const auto &value = cell.GetOrInit([&] {
+                ++inits;
+                // Keep the others waiting for a while.
+                std::this_thread::sleep_for(10ms);
+                return std::vector<int>(100, static_cast<int>(i));
+            });
+            EXPECT_EQ(value.size(), 100u);
+            seen[i] = &value;
+        });
+    }
+
+    go = true;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(inits.load(), 1);
+    for (const auto *value : seen) {
+        EXPECT_EQ(value, cell.TryGet());
+    }
+}
+
+TEST(Lazy, InitializesOnFirstAccess) {
+    EXPECT_FALSE(g_lazy.IsInitialized());
+    EXPECT_EQ(g_lazy_inits.load(), 0);
+
+    EXPECT_EQ(g_lazy->size(), 3u);
+    EXPECT_EQ((*g_lazy)[1], 2);
+    EXPECT_TRUE(g_lazy.IsInitialized());
+    EXPECT_EQ(g_lazy_inits.load(), 1);
+}
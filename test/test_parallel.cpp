@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <vtils/os/thread_pool.hpp>
+#include <vtils/parallel.hpp>
+
+namespace {
+
+    // Large enough that the grain size for it collapses to one element.
+    struct HugeElement {
+        std::uint32_t key = 0;
+        std::array<std::uint8_t, 20 * 1024> payload{};
+    };
+
+    std::vector<std::uint32_t> MakeShuffled(std::size_t size) {
+        std::vector<std::uint32_t> values(size);
+        std::iota(values.begin(), values.end(), 0u);
+        std::shuffle(values.begin(), values.end(), std::mt19937(size));
+        return values;
+    }
+
+}
+
+TEST(Parallel, ForVisitsEveryElementOnce) {
+    vtils::ThreadPool pool(4);
+    std::vector<std::uint32_t> values(100'000, 0);
+
+    vtils::ParallelFor(pool, values, [](std::uint32_t &value) { ++value; });
+
+    EXPECT_TRUE(std::ranges::all_of(values, [](std::uint32_t value) { return value == 1; }));
+}
+
+TEST(Parallel, ReduceKeepsOrder) {
+    vtils::ThreadPool pool(4);
+    std::vector<std::uint64_t> values(50'000);
+    std::iota(values.begin(), values.end(), 1u);
+
+    EXPECT_EQ(vtils::ParallelReduce(pool, values, std::uint64_t{0}), 50'000ull * 50'001ull / 2);
+
+    // String concatenation is not commutative, so this only works out
+    // if chunks are combined in their original order.
+    std::vector<std::string> letters(30'000);
+    std::string expected = "init:";
+    for (std::size_t i = 0; i < letters.size(); ++i) {
+        letters[i] = static_cast<char>('a' + i % 26);
+        expected += letters[i];
+    }
+    EXPECT_EQ(vtils::ParallelReduce(pool, letters, std::string("init:")), expected);
+}
+
+TEST(Parallel, ReduceEmptyReturnsInit) {
+    vtils::ThreadPool pool(2);
+    std::vector<int> values;
+
+    EXPECT_EQ(vtils::ParallelReduce(pool, values, 42), 42);
+}
+
+TEST(Parallel, Transform) {
+    vtils::ThreadPool pool(4);
+    const std::vector<std::uint32_t> input = MakeShuffled(70'000);
+    std::vector<std::uint64_t> output(input.size());
+
+    auto end = vtils::ParallelTransform(pool, input, output.begin(), [](std::uint32_t value) { return std::uint64_t{value} * 2; });
+
+    EXPECT_EQ(end, output.end());
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        ASSERT_EQ(output[i], std::uint64_t{input[i]} * 2);
+    }
+}
+
+TEST(Parallel, Sort) {
+    vtils::ThreadPool pool(4);
+
+    for (std::size_t size : {0u, 1u, 2u, 1'000u, 100'000u, 250'001u}) {
+        std::vector<std::uint32_t> values = MakeShuffled(size);
+        vtils::ParallelSort(pool, values);
+
+        ASSERT_EQ(values.size(), size);
+        for (std::size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(values[i], i);
+        }
+    }
+}
+
+TEST(Parallel, SortWithComparatorAndProjection) {
+    vtils::ThreadPool pool(4);
+    std::vector<std::uint32_t> values = MakeShuffled(100'000);
+
+    vtils::ParallelSort(pool, values, std::ranges::greater(), [](std::uint32_t value) { return value / 2; });
+
+    EXPECT_TRUE(std::ranges::is_sorted(values, std::ranges::greater(), [](std::uint32_t value) { return value / 2; }));
+}
+
+TEST(Parallel, SortHugeElements) {
+    // The grain size is a single element here, which used to make merges
+    // of two single elements recurse forever.
+    vtils::ThreadPool pool(4);
+
+    for (std::size_t size : {2u, 3u, 10u, 33u}) {
+        std::vector<HugeElement> values(size);
+        const std::vector<std::uint32_t> keys = MakeShuffled(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            values[i].key = keys[i];
+            values[i].payload.back() = static_cast<std::uint8_t>(keys[i]);
+        }
+
+        vtils::ParallelSort(pool, values, {}, &HugeElement::key);
+
+        for (std::size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(values[i].key, i);
+            ASSERT_EQ(values[i].payload.back(), static_cast<std::uint8_t>(i));
+        }
+    }
+}
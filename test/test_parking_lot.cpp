@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/parking_lot.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    // Parks on `key` until unparked, counting itself in `parked` once queued.
+    vtils::impl::ParkResult ParkOn(const void *key, std::atomic<int> &parked) {
+        return vtils::impl::Park(
+            key,
+            [] { return true; },
+            [&] { parked.fetch_add(1); },
+            [](const void *, bool) {},
+            vtils::impl::DefaultParkToken,
+            nullptr
+        );
+    }
+
+    void WaitForParked(const std::atomic<int> &parked, int count) {
+        while (parked.load() < count) {
+            std::this_thread::yield();
+        }
+    }
+
+}
+
+TEST(ParkingLot, ParkTimesOut) {
+    int key = 0;
+    bool timed_out_called = false;
+    bool was_last = false;
+
+    const auto start    = std::chrono::steady_clock::now();
+    const auto deadline = start + 20ms;
+    const auto result = vtils::impl::Park(
+        &key,
+        [] { return true; },
+        [] {},
+        [&](const void *k, bool last) {
+            EXPECT_EQ(k, &key);
+            timed_out_called = true;
+            was_last = last;
+        },
+        vtils::impl::DefaultParkToken,
+        &deadline
+    );
+
+    EXPECT_EQ(result.kind, vtils::impl::ParkResultKind::TimedOut);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+    EXPECT_TRUE(timed_out_called);
+    EXPECT_TRUE(was_last);
+}
+
+TEST(ParkingLot, ParkValidationFails) {
+    int key = 0;
+    bool slept = false;
+
+    const auto result = vtils::impl::Park(
+        &key,
+        [] { return false; },
+        [&] { slept = true; },
+        [](const void *, bool) {},
+        vtils::impl::DefaultParkToken,
+        nullptr
+    );
+
+    EXPECT_EQ(result.kind, vtils::impl::ParkResultKind::Invalid);
+    EXPECT_FALSE(slept);
+}
+
+TEST(ParkingLot, UnparkOneWakesInFifoOrder) {
+    constexpr int Threads = 3;
+
+    int key = 0;
+    std::atomic<int> parked = 0;
+    std::atomic<int> woken  = 0;
+    std::vector<vtils::impl::UnparkToken> tokens(Threads);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i) {
+        threads.emplace_back([&, i] {
+            const auto result = ParkOn(&key, parked);
+            EXPECT_EQ(result.kind, vtils::impl::ParkResultKind::Unparked);
+            tokens[i] = result.token;
+            woken.fetch_add(1);
+        });
+        // Park one at a time so that the queue order is known.
+        WaitForParked(parked, i + 1);
+    }
+
+    for (int i = 0; i < Threads; ++i) {
+        const auto result = vtils::impl::UnparkOne(&key, [&](vtils::impl::UnparkResult r) {
+            EXPECT_EQ(r.unparked_threads, 1u);
+            EXPECT_EQ(r.have_more_threads, i + 1 < Threads);
+            return static_cast<vtils::impl::UnparkToken>(100 + i);
+        });
+        EXPECT_EQ(result.unparked_threads, 1u);
+
+        while (woken.load() < i + 1) {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < Threads; ++i) {
+        EXPECT_EQ(tokens[i], static_cast<vtils::impl::UnparkToken>(100 + i));
+    }
+
+    // Nobody is left to wake.
+    EXPECT_EQ(vtils::impl::UnparkOne(&key, [](vtils::impl::UnparkResult) { return vtils::impl::DefaultUnparkToken; }).unparked_threads, 0u);
+}
+
+TEST(ParkingLot, UnparkAllWakesEveryone) {
+    constexpr int Threads = 4;
+
+    int key   = 0;
+    int other = 0;
+    std::atomic<int> parked = 0;
+    std::atomic<int> other_parked = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] { ParkOn(&key, parked); });
+    }
+    std::thread bystander([&] { ParkOn(&other, other_parked); });
+
+    WaitForParked(parked, Threads);
+    WaitForParked(other_parked, 1);
+
+    EXPECT_EQ(vtils::impl::UnparkAll(&key), static_cast<std::size_t>(Threads));
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // Threads parked on another key stay asleep.
+    EXPECT_EQ(vtils::impl::UnparkAll(&other), 1u);
+    bystander.join();
+}
+
+TEST(ParkingLot, RawMutexTimesOut) {
+    vtils::RawMutex mutex;
+    mutex.Lock();
+
+    std::thread([&] {
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(mutex.TryLockFor(20ms));
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+    }).join();
+    EXPECT_TRUE(mutex.IsLocked());
+
+    std::thread waiter([&] {
+        EXPECT_TRUE(mutex.TryLockFor(5s));
+        mutex.Unlock();
+    });
+    std::this_thread::sleep_for(10ms);
+    mutex.Unlock();
+    waiter.join();
+
+    EXPECT_FALSE(mutex.IsLocked());
+}
+
+TEST(ParkingLot, RawReadWriteLockTimesOut) {
+    vtils::RawReadWriteLock lock;
+
+    lock.Read();
+    std::thread([&] {
+        EXPECT_TRUE(lock.TryReadFor(20ms));
+        lock.ReadUnlock();
+        EXPECT_FALSE(lock.TryWriteFor(20ms));
+    }).join();
+    lock.ReadUnlock();
+
+    lock.Write();
+    std::thread([&] {
+        EXPECT_FALSE(lock.TryReadFor(20ms));
+        EXPECT_FALSE(lock.TryWriteFor(20ms));
+    }).join();
+    lock.WriteUnlock();
+
+    EXPECT_TRUE(lock.TryWrite());
+    lock.WriteUnlock();
+}
+
+TEST(ParkingLot, ParkingMutexMutualExclusion) {
+    constexpr std::size_t Threads    = 4;
+    constexpr std::size_t Iterations = 20'000;
+
+    vtils::ParkingMutex<std::size_t> mutex;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                auto guard = mutex.Lock();
+                const std::size_t value = *guard;
+                *guard = value + 1;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(*mutex.Lock(), Threads * Iterations);
+}
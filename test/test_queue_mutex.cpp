@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/queue_mutex.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(QueueMutex, TryLockFailsWhileHeld) {
+    vtils::impl::McsLock lock;
+
+    ASSERT_TRUE(lock.TryLock());
+    std::thread([&] { EXPECT_FALSE(lock.TryLock()); }).join();
+    lock.Unlock();
+
+    EXPECT_TRUE(lock.TryLock());
+    lock.Unlock();
+}
+
+TEST(QueueMutex, NestedLocksUseSeparateNodes) {
+    vtils::impl::McsLock first;
+    vtils::impl::McsLock second;
+
+    first.Lock();
+    second.Lock();
+    first.Unlock();
+
+    std::thread([&] {
+        EXPECT_TRUE(first.TryLock());
+        first.Unlock();
+        EXPECT_FALSE(second.TryLock());
+    }).join();
+
+    second.Unlock();
+}
+
+TEST(QueueMutex, MutualExclusion) {
+    constexpr std::size_t Threads    = 4;
+    constexpr std::size_t Iterations = 20'000;
+
+    vtils::QueueMutex<std::size_t> mutex;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                auto guard = mutex.Lock();
+                const std::size_t value = *guard;
+                *guard = value + 1;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(*mutex.Lock(), Threads * Iterations);
+}
+
+TEST(QueueMutex, WaitersAreGrantedInArrivalOrder) {
+    constexpr int Waiters = 4;
+
+    vtils::impl::McsLock lock;
+    std::mutex order_mutex;
+    std::vector<int> order;
+
+    lock.Lock();
+
+    // Spaced out so that every waiter has enqueued itself before the next
+    // one arrives, and long enough for them to fall asleep on their node.
+    std::vector<std::thread> threads;
+    for (int i = 0; i < Waiters; ++i) {
+        threads.emplace_back([&, i] {
+            lock.Lock();
+            {
+                std::scoped_lock guard(order_mutex);
+                order.push_back(i);
+            }
+            lock.Unlock();
+        });
+        std::this_thread::sleep_for(20ms);
+    }
+
+    lock.Unlock();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(order.size(), static_cast<std::size_t>(Waiters));
+    for (int i = 0; i < Waiters; ++i) {
+        EXPECT_EQ(order[i], i);
+    }
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <vtils/os/rcu.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    std::atomic<int> g_live_objects = 0;
+
+    struct Tracked {
+        int value;
+
+        explicit Tracked(int value) : value(value) { ++g_live_objects; }
+        ~Tracked() { --g_live_objects; }
+    };
+
+}
+
+TEST(Rcu, ReadersKeepTheirObjectAcrossStore) {
+    vtils::Rcu<Tracked> cell(std::in_place, 1);
+
+    {
+        auto guard = cell.Read();
+        cell.Emplace(2);
+
+        // The old object stays valid for the pinned reader...
+        EXPECT_EQ(guard->value, 1);
+        // ...while new readers observe the replacement.
+        EXPECT_EQ(cell.Read()->value, 2);
+    }
+
+    EXPECT_EQ(cell.Read()->value, 2);
+}
+
+TEST(Rcu, SynchronizeFreesRetiredObjects) {
+    // Flush objects retired by earlier tests first.
+    vtils::RcuSynchronize();
+    const int live = g_live_objects.load();
+    {
+        vtils::Rcu<Tracked> cell(std::make_unique<Tracked>(1));
+        for (int i = 2; i <= 10; ++i) {
+            cell.Emplace(i);
+        }
+
+        vtils::RcuSynchronize();
+        EXPECT_EQ(g_live_objects.load(), live + 1);
+        EXPECT_EQ(cell.Read()->value, 10);
+    }
+    EXPECT_EQ(g_live_objects.load(), live);
+}
+
+TEST(Rcu, SynchronizeWaitsForPreexistingReaders) {
+    vtils::Rcu<Tracked> cell(std::in_place, 1);
+
+    std::atomic<bool> pinned   = false;
+    std::atomic<bool> release  = false;
+    std::atomic<bool> finished = false;
+    std::atomic<bool> observed_old = false;
+
+    std::thread reader([&] {
+        auto guard = cell.Read();
+        pinned = true;
+        while (!release.load()) {
+            std::this_thread::sleep_for(1ms);
+        }
+
+        observed_old = guard->value == 1;
+        finished = true;
+    });
+    while (!pinned.load()) {
+        std::this_thread::yield();
+    }
+
+    cell.Emplace(2);
+
+    std::atomic<bool> synchronized = false;
+    std::thread writer([&] {
+        vtils::RcuSynchronize();
+        // The reader must have dropped its guard before we get here.
+        EXPECT_TRUE(finished.load());
+        synchronized = true;
+    });
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_FALSE(synchronized.load());
+
+    release = true;
+    reader.join();
+    writer.join();
+
+    EXPECT_TRUE(observed_old.load());
+    EXPECT_TRUE(synchronized.load());
+}
+
+TEST(Rcu, ConcurrentReadersAndWriter) {
+    constexpr int Updates = 2'000;
+
+    vtils::Rcu<Tracked> cell(std::in_place, 0);
+    std::atomic<bool> done = false;
+
+    std::thread reader([&] {
+        int last = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            auto guard = cell.Read();
+            EXPECT_GE(guard->value, last);
+            last = guard->value;
+        }
+    });
+
+    for (int i = 1; i <= Updates; ++i) {
+        cell.Emplace(i);
+    }
+
+    done = true;
+    reader.join();
+    vtils::RcuSynchronize();
+
+    EXPECT_EQ(cell.Read()->value, Updates);
+}
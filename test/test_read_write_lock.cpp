@@ -0,0 +1,363 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/read_write_lock.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    template <vtils::ReadWritePolicy P>
+    struct PolicyTag {
+        static constexpr vtils::ReadWritePolicy Policy = P;
+    };
+
+    using Policies = ::testing::Types<
+        PolicyTag<vtils::ReadWritePolicy::ReaderPreferring>,
+        PolicyTag<vtils::ReadWritePolicy::WriterPreferring>,
+        PolicyTag<vtils::ReadWritePolicy::PhaseFair>
+    >;
+
+    struct Pair {
+        std::size_t a = 0;
+        std::size_t b = 0;
+    };
+
+    // Waits until a writer queued up behind `raw` turns away new readers.
+    template <typename Lock>
+    bool WaitUntilReadersBlocked(Lock &raw) {
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (!raw.TryRead()) {
+                return true;
+            }
+            raw.ReadUnlock();
+            std::this_thread::sleep_for(1ms);
+        }
+        return false;
+    }
+
+}
+
+template <typename T>
+class PolicyReadWriteLockTest : public ::testing::Test {
+public:
+    static constexpr vtils::ReadWritePolicy Policy = T::Policy;
+
+    using RawLock = vtils::impl::FutexReadWriteLockImpl<Policy>;
+
+    template <typename U>
+    using Lock = vtils::PolicyReadWriteLock<U, Policy>;
+};
+
+TYPED_TEST_SUITE(PolicyReadWriteLockTest, Policies);
+
+TYPED_TEST(PolicyReadWriteLockTest, TryLockRespectsModes) {
+    typename TestFixture::RawLock raw;
+
+    ASSERT_TRUE(raw.TryRead());
+    EXPECT_TRUE(raw.TryRead());
+    EXPECT_FALSE(raw.TryWrite());
+    raw.ReadUnlock();
+    raw.ReadUnlock();
+
+    ASSERT_TRUE(raw.TryWrite());
+    EXPECT_FALSE(raw.TryRead());
+    EXPECT_FALSE(raw.TryWrite());
+    raw.WriteUnlock();
+
+    EXPECT_TRUE(raw.TryWrite());
+    raw.WriteUnlock();
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, ReadersNeverSeePartialWrites) {
+    constexpr std::size_t Writers    = 2;
+    constexpr std::size_t Readers    = 4;
+    constexpr std::size_t Iterations = 5'000;
+
+    typename TestFixture::template Lock<Pair> lock;
+    std::atomic<bool> done = false;
+
+    std::vector<std::thread> readers;
+    for (std::size_t i = 0; i < Readers; ++i) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                {
+                    auto guard = lock.Read();
+                    EXPECT_EQ(guard->a, guard->b);
+                }
+                // Reader preference lets a steady stream of readers starve
+                // the writers, so leave them a window.
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (std::size_t i = 0; i < Writers; ++i) {
+        writers.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                auto guard = lock.Write();
+                ++guard->a;
+                ++guard->b;
+            }
+        });
+    }
+
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    auto guard = lock.Read();
+    EXPECT_EQ(guard->a, Writers * Iterations);
+    EXPECT_EQ(guard->b, Writers * Iterations);
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, WaitingWriterAndNewReaders) {
+    typename TestFixture::RawLock raw;
+    raw.Read();
+
+    std::atomic<bool> wrote = false;
+    std::thread writer([&] {
+        raw.Write();
+        wrote = true;
+        raw.WriteUnlock();
+    });
+
+    if constexpr (TestFixture::Policy == vtils::ReadWritePolicy::ReaderPreferring) {
+        // Readers keep joining the active read phase regardless of the writer.
+        std::this_thread::sleep_for(20ms);
+        EXPECT_TRUE(raw.TryRead());
+        raw.ReadUnlock();
+    } else {
+        EXPECT_TRUE(WaitUntilReadersBlocked(raw));
+    }
+    EXPECT_FALSE(wrote.load());
+
+    raw.ReadUnlock();
+    writer.join();
+    EXPECT_TRUE(wrote.load());
+}
+
+TEST(PolicyReadWriteLock, PhaseFairAdmitsWaitingReadersBeforeNextWriter) {
+    vtils::impl::FutexReadWriteLockImpl<vtils::ReadWritePolicy::PhaseFair> raw;
+    std::mutex order_mutex;
+    std::vector<char> order;
+
+    auto record = [&](char c) {
+        std::scoped_lock lock(order_mutex);
+        order.push_back(c);
+    };
+
+    raw.Write();
+
+    // The reader queues up behind the active writer, and a second writer
+    // arrives after it.
+    std::thread reader([&] {
+        raw.Read();
+        record('r');
+        raw.ReadUnlock();
+    });
+    std::this_thread::sleep_for(20ms);
+
+    std::thread writer([&] {
+        raw.Write();
+        record('w');
+        raw.WriteUnlock();
+    });
+    std::this_thread::sleep_for(20ms);
+
+    raw.WriteUnlock();
+    reader.join();
+    writer.join();
+
+    ASSERT_EQ(order.size(), 2u);
+    EXPECT_EQ(order[0], 'r');
+    EXPECT_EQ(order[1], 'w');
+}
+
+TEST(PolicyReadWriteLock, PhaseFairReadersProgressAgainstRelockingWriter) {
+    vtils::impl::FutexReadWriteLockImpl<vtils::ReadWritePolicy::PhaseFair> raw;
+    constexpr std::size_t ReadsPerThread = 100;
+
+    // The writer takes the lock again right after releasing it, which must
+    // not take away the read phase it just granted to the waiting readers.
+    std::atomic<bool> stop = false;
+    std::thread writer([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            raw.Write();
+            raw.WriteUnlock();
+        }
+    });
+
+    std::atomic<std::size_t> reads = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            for (std::size_t j = 0; j < ReadsPerThread; ++j) {
+                raw.Read();
+                reads.fetch_add(1, std::memory_order_relaxed);
+                raw.ReadUnlock();
+            }
+        });
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (reads.load() < readers.size() * ReadsPerThread && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(reads.load(), readers.size() * ReadsPerThread);
+
+    stop = true;
+    writer.join();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, UpgradableSharesWithReadersOnly) {
+    typename TestFixture::RawLock raw;
+    raw.UpgradableRead();
+
+    std::thread([&] {
+        EXPECT_TRUE(raw.TryRead());
+        raw.ReadUnlock();
+
+        EXPECT_FALSE(raw.TryUpgradableRead());
+        EXPECT_FALSE(raw.TryWrite());
+    }).join();
+
+    raw.UpgradableUnlock();
+
+    EXPECT_TRUE(raw.TryUpgradableRead());
+    raw.UpgradableUnlock();
+    EXPECT_TRUE(raw.TryWrite());
+    raw.WriteUnlock();
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, UpgradeWaitsForReaders) {
+    typename TestFixture::template Lock<int> lock;
+
+    std::atomic<bool> reading  = false;
+    std::atomic<bool> release  = false;
+    std::atomic<bool> upgraded = false;
+
+    std::thread reader([&] {
+        auto guard = lock.Read();
+        reading = true;
+        while (!release.load()) {
+            std::this_thread::sleep_for(1ms);
+        }
+        EXPECT_FALSE(upgraded.load());
+    });
+    while (!reading.load()) {
+        std::this_thread::yield();
+    }
+
+    std::thread upgrader([&] {
+        auto guard  = lock.UpgradableRead();
+        auto writer = guard.Upgrade();
+        upgraded = true;
+        *writer = 42;
+    });
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(upgraded.load());
+
+    release = true;
+    reader.join();
+    upgrader.join();
+
+    EXPECT_TRUE(upgraded.load());
+    EXPECT_EQ(*lock.Read(), 42);
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, DowngradeReadmitsReaders) {
+    typename TestFixture::RawLock raw;
+    raw.UpgradableRead();
+    raw.Upgrade();
+
+    std::thread([&] { EXPECT_FALSE(raw.TryRead()); }).join();
+
+    // Downgrading leaves us with upgradable access, so readers get in
+    // again while writers and other upgraders stay out.
+    raw.Downgrade();
+    std::thread([&] {
+        EXPECT_TRUE(raw.TryRead());
+        raw.ReadUnlock();
+
+        EXPECT_FALSE(raw.TryWrite());
+        EXPECT_FALSE(raw.TryUpgradableRead());
+    }).join();
+
+    // The lock can be upgraded again after downgrading.
+    raw.Upgrade();
+    std::thread([&] { EXPECT_FALSE(raw.TryRead()); }).join();
+    raw.Downgrade();
+
+    raw.UpgradableUnlock();
+    EXPECT_TRUE(raw.TryWrite());
+    raw.WriteUnlock();
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, GuardsUpgradeAndDowngrade) {
+    typename TestFixture::template Lock<int> lock;
+
+    auto guard = lock.UpgradableRead();
+    for (int i = 1; i <= 3; ++i) {
+        {
+            auto writer = guard.Upgrade();
+            *writer = i;
+        }
+
+        // Readers see the value written while upgraded.
+        std::thread([&] { EXPECT_EQ(*lock.Read(), i); }).join();
+        EXPECT_EQ(*guard, i);
+    }
+}
+
+TYPED_TEST(PolicyReadWriteLockTest, DowngradeWakesWaitingReaders) {
+    typename TestFixture::RawLock raw;
+    raw.UpgradableRead();
+    raw.Upgrade();
+
+    std::atomic<bool> read = false;
+    std::thread reader([&] {
+        raw.Read();
+        read = true;
+        raw.ReadUnlock();
+    });
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(read.load());
+
+    // Readers parked behind the writer are let in while we keep upgradable
+    // access.
+    raw.Downgrade();
+    reader.join();
+    EXPECT_TRUE(read.load());
+
+    raw.UpgradableUnlock();
+}
+
+#if defined(V_PLATFORM_LINUX)
+TEST(ReadWriteLock, DefaultLockIsUpgradable) {
+    vtils::ReadWriteLock<int> lock;
+
+    auto guard = lock.UpgradableRead();
+    {
+        auto writer = guard.Upgrade();
+        *writer = 3;
+    }
+    EXPECT_EQ(*lock.Read(), 3);
+}
+#endif
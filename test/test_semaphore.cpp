@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/semaphore.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(Semaphore, TryAcquireTakesAvailablePermits) {
+    vtils::Semaphore semaphore(2);
+
+    EXPECT_TRUE(semaphore.TryAcquire());
+    EXPECT_TRUE(semaphore.TryAcquire());
+    EXPECT_FALSE(semaphore.TryAcquire());
+
+    semaphore.Release(2);
+    EXPECT_TRUE(semaphore.TryAcquire());
+    EXPECT_TRUE(semaphore.TryAcquire());
+    EXPECT_FALSE(semaphore.TryAcquire());
+}
+
+TEST(Semaphore, TryAcquireForTimesOut) {
+    vtils::Semaphore semaphore;
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(semaphore.TryAcquireFor(20ms));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(10ms);
+        semaphore.Release();
+    });
+    EXPECT_TRUE(semaphore.TryAcquireFor(5s));
+    releaser.join();
+}
+
+TEST(Semaphore, ReleaseWakesAsManyWaiters) {
+    constexpr std::size_t Waiters = 4;
+
+    vtils::Semaphore semaphore;
+    std::atomic<std::size_t> acquired = 0;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Waiters; ++i) {
+        threads.emplace_back([&] {
+            semaphore.Acquire();
+            acquired.fetch_add(1);
+        });
+    }
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(acquired.load(), 0u);
+
+    semaphore.Release(2);
+    while (acquired.load() < 2) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(acquired.load(), 2u);
+
+    semaphore.Release(2);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(acquired.load(), Waiters);
+    EXPECT_FALSE(semaphore.TryAcquire());
+}
+
+TEST(Semaphore, LimitsConcurrency) {
+    constexpr std::size_t Threads    = 8;
+    constexpr std::size_t Permits    = 3;
+    constexpr std::size_t Iterations = 2'000;
+
+    vtils::Semaphore semaphore(Permits);
+    std::atomic<std::size_t> inside = 0;
+    std::atomic<std::size_t> max_inside = 0;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                semaphore.Acquire();
+
+                const std::size_t now = inside.fetch_add(1) + 1;
+                std::size_t max = max_inside.load();
+                while (now > max && !max_inside.compare_exchange_weak(max, now)) {}
+                inside.fetch_sub(1);
+
+                semaphore.Release();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_LE(max_inside.load(), Permits);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vtils/os/seqlock.hpp>
+
+namespace {
+
+    // Spans several words, so a torn copy shows up as mismatched fields.
+    struct Snapshot {
+        std::uint64_t values[6];
+
+        static Snapshot Filled(std::uint64_t value) {
+            Snapshot snapshot;
+            for (auto &v : snapshot.values) {
+                v = value;
+            }
+            return snapshot;
+        }
+
+        bool IsConsistent() const {
+            for (const auto v : values) {
+                if (v != values[0]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    struct Odd {
+        std::uint8_t a;
+        std::uint16_t b;
+        std::uint8_t c;
+    };
+
+}
+
+TEST(SeqLock, ReadReturnsLastWrite) {
+    vtils::SeqLock<Odd> lock(Odd{1, 2, 3});
+
+    Odd value = lock.Read();
+    EXPECT_EQ(value.a, 1);
+    EXPECT_EQ(value.b, 2);
+    EXPECT_EQ(value.c, 3);
+
+    lock.Write(Odd{4, 5, 6});
+    value = lock.Read();
+    EXPECT_EQ(value.a, 4);
+    EXPECT_EQ(value.b, 5);
+    EXPECT_EQ(value.c, 6);
+}
+
+TEST(SeqLock, InPlaceConstruction) {
+    vtils::SeqLock<Odd> lock(std::in_place, std::uint8_t{7}, std::uint16_t{8}, std::uint8_t{9});
+
+    const Odd value = lock.Read();
+    EXPECT_EQ(value.a, 7);
+    EXPECT_EQ(value.b, 8);
+    EXPECT_EQ(value.c, 9);
+}
+
+TEST(SeqLock, ReadsNeverSeeTornWrites) {
+    constexpr std::size_t Readers = 3;
+    constexpr std::uint64_t Writes = 50'000;
+
+    vtils::SeqLock<Snapshot> lock(Snapshot::Filled(0));
+    std::atomic<bool> done = false;
+    std::atomic<std::size_t> torn = 0;
+
+    std::vector<std::thread> readers;
+    for (std::size_t i = 0; i < Readers; ++i) {
+        readers.emplace_back([&] {
+            std::uint64_t last = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                const Snapshot snapshot = lock.Read();
+                if (!snapshot.IsConsistent() || snapshot.values[0] < last) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+                last = snapshot.values[0];
+            }
+        });
+    }
+
+    for (std::uint64_t i = 1; i <= Writes; ++i) {
+        lock.Write(Snapshot::Filled(i));
+    }
+
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_TRUE(lock.Read().IsConsistent());
+    EXPECT_EQ(lock.Read().values[0], Writes);
+}
+
+TEST(SeqLock, ConcurrentUpdatesAreNotLost) {
+    constexpr std::size_t Threads    = 4;
+    constexpr std::size_t Iterations = 10'000;
+
+    vtils::SeqLock<Snapshot> lock(Snapshot::Filled(0));
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+            for (std::size_t j = 0; j < Iterations; ++j) {
+                lock.Update([](Snapshot &snapshot) {
+                    for (auto &v : snapshot.values) {
+                        ++v;
+                    }
+                });
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const Snapshot snapshot = lock.Read();
+    EXPECT_TRUE(snapshot.IsConsistent());
+    EXPECT_EQ(snapshot.values[0], Threads * Iterations);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/sharded_read_write_lock.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    using RawLock = vtils::impl::ShardedReadWriteLockImpl<8>;
+
+    struct Pair {
+        std::size_t a = 0;
+        std::size_t b = 0;
+    };
+
+}
+
+TEST(ShardedReadWriteLock, ReadersShareTheLock) {
+    RawLock raw;
+
+    // Readers on other threads take the fast path while we hold a read lock.
+    raw.Read();
+    std::thread([&] {
+        ASSERT_TRUE(raw.TryRead());
+        raw.ReadUnlock();
+    }).join();
+    EXPECT_FALSE(raw.TryWrite());
+    raw.ReadUnlock();
+
+    ASSERT_TRUE(raw.TryWrite());
+    std::thread([&] { EXPECT_FALSE(raw.TryRead()); }).join();
+    raw.WriteUnlock();
+}
+
+TEST(ShardedReadWriteLock, WriterRevokesReaders) {
+    RawLock raw;
+    raw.Read();
+
+    std::atomic<bool> wrote = false;
+    std::thread writer([&] {
+        raw.Write();
+        wrote = true;
+        raw.WriteUnlock();
+    });
+
+    // Once the writer raised its flag, new readers are turned away while
+    // it waits for us to drain our slot.
+    std::atomic<bool> blocked = false;
+    std::thread prober([&] {
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (!raw.TryRead()) {
+                blocked = true;
+                return;
+            }
+            raw.ReadUnlock();
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    prober.join();
+    EXPECT_TRUE(blocked.load());
+    EXPECT_FALSE(wrote.load());
+
+    // A reader arriving now sleeps until the writer is done.
+    std::atomic<bool> read_after_write = false;
+    std::thread reader([&] {
+        raw.Read();
+        read_after_write = wrote.load();
+        raw.ReadUnlock();
+    });
+    std::this_thread::sleep_for(20ms);
+
+    raw.ReadUnlock();
+    writer.join();
+    reader.join();
+
+    EXPECT_TRUE(wrote.load());
+    EXPECT_TRUE(read_after_write.load());
+}
+
+TEST(ShardedReadWriteLock, ReadersNeverSeePartialWrites) {
+    constexpr std::size_t Readers    = 4;
+    constexpr std::size_t Iterations = 2'000;
+
+    vtils::ShardedReadWriteLock<Pair, 8> lock;
+    std::atomic<bool> done = false;
+
+    std::vector<std::thread> readers;
+    for (std::size_t i = 0; i < Readers; ++i) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                auto guard = lock.Read();
+                EXPECT_EQ(guard->a, guard->b);
+            }
+        });
+    }
+
+    for (std::size_t i = 0; i < Iterations; ++i) {
+        auto guard = lock.Write();
+        ++guard->a;
+        ++guard->b;
+    }
+
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    auto guard = lock.Read();
+    EXPECT_EQ(guard->a, Iterations);
+    EXPECT_EQ(guard->b, Iterations);
+}
+
+TEST(ShardedReadWriteLock, ReadGuardMayBeReleasedOnAnotherThread) {
+    vtils::ShardedReadWriteLock<Pair, 8> lock;
+
+    // The guard remembers its slot, as a coroutine or fiber holding it may
+    // be resumed on a different thread.
+    std::unique_ptr<const vtils::ReaderGuard<Pair, RawLock>> guard(new auto(lock.Read()));
+    std::thread([&] { guard.reset(); }).join();
+
+    auto writer = lock.Write();
+    EXPECT_EQ(writer->a, writer->b);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/spsc_ring.hpp>
+
+TEST(SpscRing, CapacityIsRoundedUp) {
+    vtils::SpscRing<int> ring(3);
+
+    EXPECT_EQ(ring.GetCapacity(), 4u);
+    EXPECT_EQ(ring.GetSize(), 0u);
+}
+
+TEST(SpscRing, FifoOrder) {
+    vtils::SpscRing<int> ring(4);
+
+    for (int lap = 0; lap < 3; ++lap) {
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(ring.TryPush(lap * 4 + i));
+        }
+        EXPECT_FALSE(ring.TryPush(-1));
+        EXPECT_EQ(ring.GetSize(), 4u);
+
+        for (int i = 0; i < 4; ++i) {
+            int value = -1;
+            ASSERT_TRUE(ring.TryPop(value));
+            EXPECT_EQ(value, lap * 4 + i);
+        }
+
+        int value;
+        EXPECT_FALSE(ring.TryPop(value));
+    }
+}
+
+TEST(SpscRing, WriteAndReadWrapAround) {
+    vtils::SpscRing<int> ring(8);
+
+    // Move the indices close to the end of the buffer first.
+    std::array<int, 6> scratch{};
+    ASSERT_EQ(ring.Write(scratch), 6u);
+    ASSERT_EQ(ring.Read(scratch), 6u);
+
+    std::array<int, 10> input;
+    std::iota(input.begin(), input.end(), 100);
+    EXPECT_EQ(ring.Write(input), 8u);
+    EXPECT_EQ(ring.GetSize(), 8u);
+
+    std::array<int, 10> output{};
+    EXPECT_EQ(ring.Read(output), 8u);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(output[i], 100 + i);
+    }
+}
+
+TEST(SpscRing, ReserveAndPeekStopAtTheEnd) {
+    vtils::SpscRing<int> ring(8);
+
+    std::span<int> slots = ring.Reserve(5);
+    ASSERT_EQ(slots.size(), 5u);
+    std::iota(slots.begin(), slots.end(), 0);
+    ring.Commit(5);
+
+    std::span<const int> items = ring.Peek(8);
+    ASSERT_EQ(items.size(), 5u);
+    EXPECT_EQ(items[4], 4);
+    ring.Consume(5);
+
+    // Only the slots up to the end of the buffer are contiguous.
+    EXPECT_EQ(ring.Reserve(8).size(), 3u);
+    ring.Commit(0);
+    EXPECT_EQ(ring.Peek(1).size(), 0u);
+}
+
+TEST(SpscRing, ExternalStorage) {
+    std::array<std::uint64_t, 4> storage{};
+    vtils::SpscRing<std::uint64_t> ring{std::span(storage)};
+
+    EXPECT_EQ(ring.GetCapacity(), 4u);
+    ASSERT_TRUE(ring.TryPush(7));
+    EXPECT_EQ(storage[0], 7u);
+}
+
+TEST(SpscRing, StreamsInOrderAcrossThreads) {
+    constexpr std::uint32_t Count = 200'000;
+    vtils::SpscRing<std::uint32_t> ring(64);
+
+    std::thread producer([&] {
+        std::uint32_t next = 0;
+        std::array<std::uint32_t, 7> batch;
+        while (next < Count) {
+            // Alternate between single pushes and batches of odd sizes.
+            if (next % 3 == 0) {
+                if (ring.TryPush(next)) {
+                    ++next;
+                } else {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+
+            const std::size_t size = std::min<std::size_t>(batch.size(), Count - next);
+            std::iota(batch.begin(), batch.begin() + size, next);
+            if (const std::size_t written = ring.Write(std::span(batch.data(), size)); written != 0) {
+                next += static_cast<std::uint32_t>(written);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint32_t expected = 0;
+    std::array<std::uint32_t, 5> batch;
+    while (expected < Count) {
+        const std::size_t count = ring.Read(batch);
+        for (std::size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(batch[i], expected++);
+        }
+
+        std::span<const std::uint32_t> items = ring.Peek(3);
+        for (std::uint32_t value : items) {
+            ASSERT_EQ(value, expected++);
+        }
+        ring.Consume(items.size());
+
+        if (count == 0 && items.empty()) {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    EXPECT_EQ(ring.GetSize(), 0u);
+}
@@ -0,0 +1,342 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <vtils/os/latch.hpp>
+#include <vtils/os/thread_pool.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    // Blocks instead of spinning, so that the jobs only overlap in time
+    // when they actually run on different workers, even on a single core.
+    void Work(std::chrono::milliseconds duration) {
+        std::this_thread::sleep_for(duration);
+    }
+
+}
+
+TEST(ThreadPool, NestedJoinFromOutside) {
+    vtils::ThreadPool pool(2);
+
+    // The worker which finishes the short job first has to wait for the
+    // other half, and must pick up the work it forks off in the meantime.
+    const auto start = std::chrono::steady_clock::now();
+    pool.Join(
+        [] { Work(1ms); },
+        [&] {
+            Work(10ms);
+            pool.Join([] { Work(50ms); }, [] { Work(50ms); });
+        }
+    );
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_GE(elapsed, 60ms);
+    EXPECT_LT(elapsed, 100ms);
+}
+
+TEST(ThreadPool, NestedJoinFromWorker) {
+    vtils::ThreadPool pool(2);
+
+    std::atomic<bool> done = false;
+    std::atomic<std::chrono::steady_clock::duration> elapsed{};
+    pool.Spawn([&] {
+        EXPECT_GE(pool.GetCurrentThreadIndex(), 0);
+
+        const auto start = std::chrono::steady_clock::now();
+        pool.Join(
+            [] { Work(1ms); },
+            [&] {
+                Work(10ms);
+                pool.Join([] { Work(50ms); }, [] { Work(50ms); });
+            }
+        );
+        elapsed = std::chrono::steady_clock::now() - start;
+        done = true;
+    });
+
+    while (!done.load()) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_GE(elapsed.load(), 60ms);
+    EXPECT_LT(elapsed.load(), 100ms);
+}
+
+TEST(ThreadPool, DeeplyNestedJoin) {
+    vtils::ThreadPool pool(4);
+    std::atomic<std::size_t> leaves = 0;
+
+    auto recurse = [&](auto &self, int depth) -> void {
+        if (depth == 0) {
+            leaves.fetch_add(1);
+            return;
+        }
+        pool.Join([&] { self(self, depth - 1); }, [&] { self(self, depth - 1); });
+    };
+    recurse(recurse, 12);
+
+    EXPECT_EQ(leaves.load(), 1u << 12);
+}
+
+TEST(ThreadPool, ThreadCountAndIndex) {
+    vtils::ThreadPool pool(3);
+    EXPECT_EQ(pool.GetThreadCount(), 3u);
+    EXPECT_EQ(pool.GetCurrentThreadIndex(), -1);
+
+    auto [a, b] = pool.Join(
+        [&] { return pool.GetCurrentThreadIndex(); },
+        [&] { return pool.GetCurrentThreadIndex(); }
+    );
+    EXPECT_GE(a, 0);
+    EXPECT_LT(a, 3);
+    EXPECT_GE(b, 0);
+    EXPECT_LT(b, 3);
+}
+
+TEST(ThreadPool, JoinReturnsResults) {
+    vtils::ThreadPool pool(2);
+
+    auto [number, text] = pool.Join([] { return 42; }, [] { return std::string("vtils"); });
+    EXPECT_EQ(number, 42);
+    EXPECT_EQ(text, "vtils");
+
+    // Move-only results are moved out of the jobs.
+    auto [ptr, nothing] = pool.Join([] { return std::make_unique<int>(7); }, [] {});
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, 7);
+    static_assert(std::is_same_v<decltype(nothing), std::monostate>);
+
+    // Nested joins on a worker return their results as well.
+    auto sum = [&](auto &self, int lo, int hi) -> int {
+        if (hi - lo == 1) {
+            return lo;
+        }
+        const int mid = lo + (hi - lo) / 2;
+        auto [l, r] = pool.Join([&] { return self(self, lo, mid); }, [&] { return self(self, mid, hi); });
+        return l + r;
+    };
+    EXPECT_EQ(sum(sum, 0, 1000), 999 * 1000 / 2);
+}
+
+TEST(ThreadPool, JoinPropagatesExceptionFromFirst) {
+    vtils::ThreadPool pool(2);
+
+    std::atomic<bool> b_done = false;
+    EXPECT_THROW(
+        pool.Join(
+            [] { throw std::runtime_error("a"); },
+            [&] { Work(10ms); b_done = true; }
+        ),
+        std::runtime_error
+    );
+    // `b` must have completed before `Join` gave up its stack frame.
+    EXPECT_TRUE(b_done.load());
+}
+
+TEST(ThreadPool, JoinPropagatesExceptionFromSecond) {
+    vtils::ThreadPool pool(2);
+
+    std::atomic<bool> a_done = false;
+    EXPECT_THROW(
+        pool.Join(
+            [&] { Work(10ms); a_done = true; },
+            [] { throw std::logic_error("b"); }
+        ),
+        std::logic_error
+    );
+    EXPECT_TRUE(a_done.load());
+}
+
+TEST(ThreadPool, JoinPrefersExceptionFromFirst) {
+    vtils::ThreadPool pool(2);
+
+    EXPECT_THROW(
+        pool.Join([] { throw std::runtime_error("a"); }, [] { throw std::logic_error("b"); }),
+        std::runtime_error
+    );
+
+    // The pool remains usable afterwards, also for nested joins that throw.
+    pool.Spawn([] {});
+    int caught = 0;
+    try {
+        pool.Join(
+            [&] { pool.Join([] {}, [] { throw std::out_of_range("inner"); }); },
+            [] {}
+        );
+    } catch (const std::out_of_range &) {
+        ++caught;
+    }
+    EXPECT_EQ(caught, 1);
+}
+
+TEST(ThreadPool, SpawnRunsAllJobs) {
+    constexpr std::uint32_t Jobs = 1000;
+    vtils::ThreadPool pool(4);
+
+    std::atomic<std::uint32_t> count = 0;
+    vtils::Latch latch(Jobs);
+    for (std::uint32_t i = 0; i < Jobs; ++i) {
+        pool.Spawn([&] {
+            count.fetch_add(1);
+            latch.CountDown();
+        });
+    }
+    latch.Wait();
+
+    EXPECT_EQ(count.load(), Jobs);
+}
+
+TEST(ThreadPool, ScopeWaitsForNestedSpawns) {
+    vtils::ThreadPool pool(4);
+
+    std::vector<std::atomic<int>> hits(256);
+    pool.Scope([&](vtils::TaskScope &scope) {
+        for (std::size_t i = 0; i < hits.size(); i += 16) {
+            scope.Spawn([&, i](vtils::TaskScope &inner) {
+                for (std::size_t j = i; j < i + 16; ++j) {
+                    inner.Spawn([&, j] {
+                        Work(0ms);
+                        hits[j].fetch_add(1);
+                    });
+                }
+            });
+        }
+    });
+
+    // Everything spawned within the scope has run exactly once by now.
+    for (const auto &hit : hits) {
+        EXPECT_EQ(hit.load(), 1);
+    }
+}
+
+TEST(ThreadPool, ScopeFromWorker) {
+    vtils::ThreadPool pool(2);
+
+    auto [count, _] = pool.Join(
+        [&] {
+            std::atomic<int> spawned = 0;
+            pool.Scope([&](vtils::TaskScope &scope) {
+                for (int i = 0; i < 64; ++i) {
+                    scope.Spawn([&] { spawned.fetch_add(1); });
+                }
+            });
+            return spawned.load();
+        },
+        [] {}
+    );
+    EXPECT_EQ(count, 64);
+}
+
+TEST(ThreadPool, ScopeWaitsForJobsWhenBodyThrows) {
+    vtils::ThreadPool pool(2);
+
+    std::atomic<int> count = 0;
+    EXPECT_THROW(
+        pool.Scope([&](vtils::TaskScope &scope) {
+            for (int i = 0; i < 16; ++i) {
+                scope.Spawn([&] {
+                    Work(1ms);
+                    count.fetch_add(1);
+                });
+            }
+            throw std::runtime_error("body");
+        }),
+        std::runtime_error
+    );
+
+    // The scope must not unwind before its jobs are done with it.
+    EXPECT_EQ(count.load(), 16);
+}
+
+TEST(ThreadPool, ScopePropagatesExceptionFromJob) {
+    vtils::ThreadPool pool(4);
+
+    std::atomic<int> count = 0;
+    try {
+        pool.Scope([&](vtils::TaskScope &scope) {
+            for (int i = 0; i < 64; ++i) {
+                scope.Spawn([&, i](vtils::TaskScope &inner) {
+                    inner.Spawn([&] { count.fetch_add(1); });
+                    if (i % 8 == 0) {
+                        throw std::runtime_error("job");
+                    }
+                });
+            }
+        });
+        FAIL() << "Scope did not rethrow the exception of its job";
+    } catch (const std::runtime_error &e) {
+        EXPECT_STREQ(e.what(), "job");
+    }
+
+    // Failing jobs do not keep the others from running.
+    EXPECT_EQ(count.load(), 64);
+}
+
+TEST(ThreadPool, ScopePrefersExceptionFromBody) {
+    vtils::ThreadPool pool(2);
+
+    try {
+        pool.Scope([&](vtils::TaskScope &scope) {
+            scope.Spawn([] { throw std::logic_error("job"); });
+            throw std::runtime_error("body");
+        });
+        FAIL() << "Scope did not rethrow an exception";
+    } catch (const std::runtime_error &e) {
+        EXPECT_STREQ(e.what(), "body");
+    }
+}
+
+TEST(ThreadPool, ScopeSurvivesFailedSpawn) {
+    vtils::ThreadPool pool(2);
+
+    // Moving the callable onto the heap throws, after it was already
+    // moved into the job closure once.
+    struct ThrowingMove {
+        int moves = 0;
+
+        ThrowingMove() = default;
+        ThrowingMove(ThrowingMove &&rhs) : moves(rhs.moves + 1) {
+            if (moves > 1) {
+                throw std::runtime_error("move");
+            }
+        }
+
+        void operator()() const {}
+    };
+
+    // A job which was never queued must not keep the scope waiting.
+    EXPECT_THROW(
+        pool.Scope([&](vtils::TaskScope &scope) {
+            scope.Spawn(ThrowingMove());
+        }),
+        std::runtime_error
+    );
+}
+
+TEST(ThreadPool, DestructionRunsQueuedJobs) {
+    constexpr int Jobs = 100;
+
+    std::atomic<int> count = 0;
+    {
+        vtils::ThreadPool pool(1);
+
+        // Keep the only worker busy, so that the rest queue up behind it.
+        pool.Spawn([] { Work(20ms); });
+        for (int i = 0; i < Jobs; ++i) {
+            pool.Spawn([&] { count.fetch_add(1); });
+        }
+    }
+
+    EXPECT_EQ(count.load(), Jobs);
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <vtils/os/timer_wheel.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    // A timer which records the order in which timers fired.
+    struct RecordingTimer {
+        vtils::Timer timer{&RecordingTimer::Fire};
+        int id = 0;
+        std::vector<int> *log = nullptr;
+
+        static void Fire(vtils::Timer &timer) {
+            // `timer` is the first member of a standard-layout struct.
+            auto *self = reinterpret_cast<RecordingTimer *>(std::addressof(timer));
+            self->log->push_back(self->id);
+        }
+    };
+
+}
+
+TEST(TimerWheel, FiresInDeadlineOrder) {
+    vtils::TimerWheel wheel(1ms);
+    const auto start = vtils::TimerWheel::Clock::now();
+
+    // Spread the deadlines over several levels of the wheel.
+    const std::vector<std::chrono::milliseconds> delays = { 5000ms, 3ms, 70ms, 1ms, 300'000ms, 4100ms, 64ms };
+    std::vector<int> log;
+    std::vector<RecordingTimer> timers(delays.size());
+    for (std::size_t i = 0; i < delays.size(); ++i) {
+        timers[i].id  = static_cast<int>(delays[i].count());
+        timers[i].log = &log;
+        wheel.Schedule(timers[i].timer, start + delays[i]);
+    }
+    EXPECT_EQ(wheel.GetPendingCount(), delays.size());
+
+    // Deadlines are rounded up to whole ticks, so allow for one more.
+    EXPECT_EQ(wheel.AdvanceTo(start), 0u);
+    EXPECT_EQ(wheel.AdvanceTo(start + 71ms), 4u);
+    EXPECT_EQ(wheel.AdvanceTo(start + 301'000ms), 3u);
+
+    EXPECT_EQ(log, (std::vector<int>{ 1, 3, 64, 70, 4100, 5000, 300'000 }));
+    EXPECT_EQ(wheel.GetPendingCount(), 0u);
+}
+
+TEST(TimerWheel, NeverFiresEarly) {
+    vtils::TimerWheel wheel(1ms);
+    const auto start = vtils::TimerWheel::Clock::now();
+
+    std::vector<int> log;
+    RecordingTimer timer;
+    timer.log = &log;
+    wheel.Schedule(timer.timer, start + 10ms + 500us);
+
+    EXPECT_EQ(wheel.AdvanceTo(start + 10ms), 0u);
+    EXPECT_EQ(wheel.AdvanceTo(start + 11ms), 1u);
+}
+
+TEST(TimerWheel, CancelAndReschedule) {
+    vtils::TimerWheel wheel(1ms);
+    const auto start = vtils::TimerWheel::Clock::now();
+
+    std::vector<int> log;
+    RecordingTimer a, b;
+    a.id = 1, a.log = &log;
+    b.id = 2, b.log = &log;
+
+    wheel.Schedule(a.timer, start + 10ms);
+    wheel.Schedule(b.timer, start + 20ms);
+    EXPECT_TRUE(wheel.Cancel(a.timer));
+    EXPECT_FALSE(wheel.Cancel(a.timer));
+
+    // Moving a scheduled timer does not count it twice.
+    wheel.Schedule(b.timer, start + 5ms);
+    EXPECT_EQ(wheel.GetPendingCount(), 1u);
+    const auto next = wheel.GetNextExpiry();
+    ASSERT_TRUE(next.has_value());
+    EXPECT_GE(*next, start + 5ms);
+    EXPECT_LE(*next, start + 6ms);
+
+    EXPECT_EQ(wheel.AdvanceTo(start + 30ms), 1u);
+    EXPECT_EQ(log, std::vector<int>{ 2 });
+    EXPECT_EQ(wheel.GetNextExpiry(), std::nullopt);
+}
+
+TEST(TimerWheel, CallbackMayReschedule) {
+    struct Repeating {
+        vtils::Timer timer{&Repeating::Fire};
+        vtils::TimerWheel *wheel = nullptr;
+        int fired = 0;
+
+        static void Fire(vtils::Timer &timer) {
+            auto *self = reinterpret_cast<Repeating *>(std::addressof(timer));
+            if (++self->fired < 3) {
+                self->wheel->ScheduleAfter(timer, 0ms);
+            }
+        }
+    };
+
+    vtils::TimerWheel wheel(1ms);
+    Repeating repeating;
+    repeating.wheel = &wheel;
+    wheel.ScheduleAfter(repeating.timer, 1ms);
+
+    for (int i = 0; i < 3; ++i) {
+        std::this_thread::sleep_for(2ms);
+        wheel.AdvanceTo(vtils::TimerWheel::Clock::now());
+    }
+    EXPECT_EQ(repeating.fired, 3);
+}
+
+TEST(TimerWheel, DriverThreadFiresTimeouts) {
+    struct Flag {
+        vtils::Timer timer{&Flag::Fire};
+        std::atomic<bool> fired = false;
+
+        static void Fire(vtils::Timer &timer) {
+            reinterpret_cast<Flag *>(std::addressof(timer))->fired = true;
+        }
+    };
+
+    vtils::TimerWheel wheel(1ms);
+    vtils::TimerThread driver(wheel);
+
+    // Schedule after the driver went to sleep with nothing to do.
+    std::this_thread::sleep_for(10ms);
+    Flag early, late;
+    const auto start = vtils::TimerWheel::Clock::now();
+    wheel.Schedule(late.timer, start + 1h);
+    wheel.Schedule(early.timer, start + 20ms);
+
+    while (!early.fired) {
+        ASSERT_LT(vtils::TimerWheel::Clock::now() - start, 5s);
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_GE(vtils::TimerWheel::Clock::now() - start, 20ms);
+    EXPECT_FALSE(late.fired);
+    EXPECT_TRUE(wheel.Cancel(late.timer));
+}
+
+TEST(TimerWheel, SleepUntil) {
+    vtils::TimerWheel wheel(1ms);
+    vtils::TimerThread driver(wheel);
+
+    const auto start = vtils::TimerWheel::Clock::now();
+    std::vector<std::thread> sleepers;
+    for (int i = 0; i < 4; ++i) {
+        sleepers.emplace_back([&] { wheel.SleepUntil(start + 25ms); });
+    }
+    for (std::thread &sleeper : sleepers) {
+        sleeper.join();
+    }
+
+    EXPECT_GE(vtils::TimerWheel::Clock::now() - start, 25ms);
+}